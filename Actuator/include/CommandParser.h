@@ -0,0 +1,214 @@
+#ifndef COMMAND_PARSER_H
+#define COMMAND_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+// Single-pass tokenizer for text commands (Serial lines, MQTT and ESP-NOW
+// text payloads), shared by ShadeController and CommandProcessor.
+//
+// Works on a pointer/length view: nothing is copied, nothing allocated, no
+// NUL terminator needed, and all state lives in the CmdTokenizer object, so
+// it is reentrant (unlike strtok). Tokens are:
+//
+//   TOK_WORD    letter followed by letters, digits or '_', matched
+//               case-insensitively against the keyword table
+//   TOK_NUMBER  [+-]digits[.digits] (or .digits); value and integer part
+//
+// Anything else separates tokens, so "UP 45 5000", "up angle:45" and
+// {"command":"up","angle":45} all tokenize the same way.
+//
+// Keywords are at most 8 characters, so a word packs losslessly into a
+// uint64_t; the lookup is a switch on that value with constexpr case labels,
+// i.e. a collision-free hash that the compiler turns into a branch tree.
+
+enum CmdKeyword : uint8_t {
+  KW_NONE = 0,
+  KW_HELP,
+  KW_SENSOR,
+  KW_UP,
+  KW_DOWN,
+  KW_OPEN,
+  KW_CLOSE,
+  KW_PULSE,
+  KW_STOP,
+  KW_STATUS,
+  KW_ANGLE,
+  KW_DURATION,
+  KW_LIGHT,
+  KW_NAN,
+  // Shade rule text (ShadeRules.h)
+  KW_RULES,
+  KW_LOCK,
+  KW_TEMP,
+  KW_HUMIDITY,
+  KW_LUX,
+  KW_WIND,
+  KW_GUST,
+  KW_LE,
+  KW_GE,
+  KW_HYST,
+  KW_DWELL,
+  KW_PRIO
+};
+
+enum CmdTokenType : uint8_t {
+  TOK_END = 0,
+  TOK_WORD,
+  TOK_NUMBER
+};
+
+typedef struct {
+  CmdTokenType type;
+  CmdKeyword keyword;  // TOK_WORD: KW_NONE for unknown words
+  const char* text;    // points into the input
+  size_t len;
+  float number;        // TOK_NUMBER
+  uint32_t integer;    // TOK_NUMBER: integer part, saturated (exact for seq numbers)
+} cmd_token_t;
+
+// Lower-case word packed into 8 bytes, first character lowest; 0 if longer.
+constexpr uint64_t cmdPackWord(const char* s, size_t len) {
+  if (len == 0 || len > 8) return 0;
+  uint64_t v = 0;
+  for (size_t i = 0; i < len; ++i) {
+    char c = s[i];
+    if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    v |= (uint64_t)(uint8_t)c << (8 * i);
+  }
+  return v;
+}
+
+template <size_t N>
+constexpr uint64_t cmdPack(const char (&s)[N]) { return cmdPackWord(s, N - 1); }
+
+inline CmdKeyword cmdKeyword(const char* s, size_t len) {
+  switch (cmdPackWord(s, len)) {
+    case cmdPack("help"): return KW_HELP;
+    case cmdPack("sensor"): return KW_SENSOR;
+    case cmdPack("up"): return KW_UP;
+    case cmdPack("down"): return KW_DOWN;
+    case cmdPack("open"): return KW_OPEN;
+    case cmdPack("close"): return KW_CLOSE;
+    case cmdPack("pulse"): return KW_PULSE;
+    case cmdPack("stop"): return KW_STOP;
+    case cmdPack("status"): return KW_STATUS;
+    case cmdPack("angle"): return KW_ANGLE;
+    case cmdPack("duration"): return KW_DURATION;
+    case cmdPack("light"): return KW_LIGHT;
+    case cmdPack("nan"): return KW_NAN;
+    case cmdPack("rules"): return KW_RULES;
+    case cmdPack("lock"): return KW_LOCK;
+    case cmdPack("temp"): return KW_TEMP;
+    case cmdPack("humidity"): return KW_HUMIDITY;
+    case cmdPack("lux"): return KW_LUX;
+    case cmdPack("wind"): return KW_WIND;
+    case cmdPack("gust"): return KW_GUST;
+    case cmdPack("le"): return KW_LE;
+    case cmdPack("ge"): return KW_GE;
+    case cmdPack("hyst"): return KW_HYST;
+    case cmdPack("dwell"): return KW_DWELL;
+    case cmdPack("prio"): return KW_PRIO;
+    default: return KW_NONE;
+  }
+}
+
+class CmdTokenizer {
+public:
+  CmdTokenizer(const char* data, size_t len) : _p(data), _end(data + len) {}
+
+  // Next token; false (and TOK_END) at the end of the input.
+  bool next(cmd_token_t &t) {
+    while (_p < _end && !startsToken()) ++_p;
+    t.text = _p;
+    t.keyword = KW_NONE;
+    t.number = 0.0f;
+    t.integer = 0;
+    if (_p >= _end) {
+      t.type = TOK_END;
+      t.len = 0;
+      return false;
+    }
+    if (isAlpha(*_p)) {
+      while (_p < _end && (isAlpha(*_p) || isDigit(*_p) || *_p == '_')) ++_p;
+      t.type = TOK_WORD;
+      t.len = (size_t)(_p - t.text);
+      t.keyword = cmdKeyword(t.text, t.len);
+      return true;
+    }
+    number(t);
+    return true;
+  }
+
+  // Next token as a numeric argument: a number, or the word "nan". Any other
+  // token (or the end) leaves value unchanged and returns false.
+  bool nextNumber(float &value) {
+    cmd_token_t t;
+    if (!next(t)) return false;
+    if (t.type == TOK_NUMBER) { value = t.number; return true; }
+    if (t.keyword == KW_NAN) { value = NAN; return true; }
+    return false;
+  }
+
+  // Same for a non-negative integer (durations, sequence numbers).
+  bool nextInteger(uint32_t &value) {
+    cmd_token_t t;
+    if (!next(t) || t.type != TOK_NUMBER || t.number < 0) return false;
+    value = t.integer;
+    return true;
+  }
+
+  // Unconsumed input, e.g. to hand the rest of a line to another parser
+  const char* rest() const { return _p; }
+  size_t restLen() const { return (size_t)(_end - _p); }
+
+private:
+  const char* _p;
+  const char* _end;
+
+  static bool isAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+  static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+  bool startsNumberAt(const char* p) const {
+    if (p < _end && *p == '.') ++p;
+    return p < _end && isDigit(*p);
+  }
+
+  bool startsToken() const {
+    char c = *_p;
+    if (isAlpha(c) || isDigit(c)) return true;
+    if (c == '.') return startsNumberAt(_p);
+    if (c == '-' || c == '+') return startsNumberAt(_p + 1);
+    return false;
+  }
+
+  void number(cmd_token_t &t) {
+    bool neg = false;
+    if (*_p == '-' || *_p == '+') neg = *_p++ == '-';
+    uint32_t whole = 0;
+    bool saturated = false;
+    while (_p < _end && isDigit(*_p)) {
+      uint32_t d = (uint32_t)(*_p++ - '0');
+      if (whole > (UINT32_MAX - d) / 10) saturated = true;
+      else whole = whole * 10 + d;
+    }
+    float value = saturated ? 4294967295.0f : (float)whole;
+    if (_p < _end && *_p == '.') {
+      ++_p;
+      uint32_t frac = 0;
+      uint32_t scale = 1;
+      while (_p < _end && isDigit(*_p)) {
+        if (scale < 1000000000u) { frac = frac * 10 + (uint32_t)(*_p - '0'); scale *= 10; }
+        ++_p;
+      }
+      value += (float)frac / (float)scale;
+    }
+    t.type = TOK_NUMBER;
+    t.len = (size_t)(_p - t.text);
+    t.integer = saturated ? UINT32_MAX : whole;
+    t.number = neg ? -value : value;
+  }
+};
+
+#endif // COMMAND_PARSER_H
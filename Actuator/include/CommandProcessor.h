@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include "ShadeController.h"
+#include "CommandParser.h"
 
 class CommandProcessor {
 public:
@@ -12,8 +13,8 @@ public:
                    unsigned long downDuration = 10000UL);
   ~CommandProcessor();
 
-  // Parse a single line from Serial and dispatch commands
-  void processLine(String line);
+  // Parse a single line from Serial and dispatch commands (no NUL needed)
+  void processLine(const char* line, size_t len);
 
   // Print help text to Serial
   void printHelp();
@@ -24,10 +25,10 @@ private:
   unsigned long _upDuration;
   unsigned long _downDuration;
 
-  void handleSensorCommand();
-  void handleUpDownCommand(bool isUp);
-  void handleOpenCloseCommand(bool isOpen);
-  void handlePulseCommand();
+  void handleSensorCommand(CmdTokenizer &args);
+  void handleUpDownCommand(CmdTokenizer &args, bool isUp);
+  void handleOpenCloseCommand(CmdTokenizer &args, bool isOpen);
+  void handlePulseCommand(CmdTokenizer &args);
 };
 
 #endif // COMMAND_PROCESSOR_H
\ No newline at end of file
@@ -0,0 +1,201 @@
+#ifndef MOTION_EXECUTOR_H
+#define MOTION_EXECUTOR_H
+
+#include <stdint.h>
+#include "Trajectory.h"
+
+// Time-driven servo motion: a pulse moves from the current angle to
+// baseline + angleRel over moveMs, holds for holdMs and returns to the
+// baseline over moveMs, each leg along a Trajectory profile. update() is
+// called every MOTION_TICK_MS (or when a command arrives) and yields the
+// position to write; nothing here waits, so the caller owns the timing
+// (ShadeController's motion task, or a host test with a fake clock).
+//
+// Commands:
+//   MOTION_NORMAL  waits for the move in progress; a newer normal command
+//                  replaces an older one that has not started yet
+//   MOTION_URGENT  preempts the move in progress from its current angle
+//   MOTION_STOP    cancels everything and returns to the baseline
+//
+// A pulse identical to the one in progress or pending is redundant
+// (repeats()); the caller drops it instead of queueing the same move twice.
+
+static const uint32_t MOTION_TICK_MS = 20; // 50 Hz: one servo PWM frame, faster writes are not seen
+
+enum MotionKind : uint8_t {
+  MOTION_PULSE = 0,
+  MOTION_STOP
+};
+
+enum MotionPriority : uint8_t {
+  MOTION_NORMAL = 0,
+  MOTION_URGENT
+};
+
+typedef struct {
+  MotionKind kind;
+  MotionPriority priority;
+  float angleRel;   // degrees from the baseline, > 0 opens
+  uint32_t holdMs;
+  uint32_t moveMs;  // each leg (out and back)
+} motion_cmd_t;
+
+// A pulse as ShadeController::pulseAngle queues it: the angle clamped to
+// +-180 degrees, a zero move time replaced by the default 500 ms
+inline motion_cmd_t motionPulse(float angleRel, uint32_t holdMs, uint32_t moveMs,
+                                MotionPriority priority = MOTION_NORMAL) {
+  if (angleRel < -180.0f) angleRel = -180.0f;
+  if (angleRel > 180.0f) angleRel = 180.0f;
+  motion_cmd_t cmd;
+  cmd.kind = MOTION_PULSE;
+  cmd.priority = priority;
+  cmd.angleRel = angleRel;
+  cmd.holdMs = holdMs;
+  cmd.moveMs = moveMs ? moveMs : 500;
+  return cmd;
+}
+
+enum MotionPhase : uint8_t {
+  MOTION_IDLE = 0,
+  MOTION_OUT,
+  MOTION_HOLD,
+  MOTION_BACK
+};
+
+// What update() finished or started this call
+enum MotionEvent : uint8_t {
+  MOTION_EVT_NONE = 0,
+  MOTION_EVT_STARTED,   // a queued pulse began (current())
+  MOTION_EVT_DONE,      // pulse completed, back at the baseline
+  MOTION_EVT_STOPPED    // cancelled move is back at the baseline
+};
+
+class MotionExecutor {
+public:
+  explicit MotionExecutor(float baselineDeg, ProfileShape shape = PROFILE_SCURVE)
+    : _baseline(toMdeg(baselineDeg)), _pos(_baseline), _target(_baseline), _shape(shape),
+      _phase(MOTION_IDLE), _phaseStart(0), _hasPending(false), _stopping(false) {}
+
+  // Returns true when an in-flight move was cancelled by this command.
+  bool submit(const motion_cmd_t &cmd, uint32_t now) {
+    if (cmd.kind == MOTION_STOP) {
+      bool active = _phase != MOTION_IDLE;
+      _hasPending = false;
+      if (active || _pos != _baseline) {
+        _active = cmd;
+        _stopping = true;
+        enter(MOTION_BACK, now);
+      }
+      return active;
+    }
+    if (_phase == MOTION_IDLE) {
+      start(cmd, now);
+      return false;
+    }
+    if (cmd.priority == MOTION_URGENT) {
+      _hasPending = false;
+      start(cmd, now);
+      return true;
+    }
+    _pending = cmd;
+    _hasPending = true;
+    return false;
+  }
+
+  // True when cmd is the pulse in progress (nothing pending after it) or the
+  // pending one
+  bool repeats(const motion_cmd_t &cmd) const {
+    if (cmd.kind != MOTION_PULSE) return false;
+    if (_hasPending) return same(cmd, _pending);
+    return _phase != MOTION_IDLE && same(cmd, _active);
+  }
+
+  MotionEvent update(uint32_t now) {
+    uint32_t t = now - _phaseStart;
+    switch (_phase) {
+      case MOTION_IDLE:
+        if (_hasPending) {
+          _hasPending = false;
+          start(_pending, now);
+          return MOTION_EVT_STARTED;
+        }
+        break;
+      case MOTION_OUT:
+        _pos = _leg.position(t);
+        if (_leg.finished(t)) enter(MOTION_HOLD, now);
+        break;
+      case MOTION_HOLD:
+        if (t >= _active.holdMs) enter(MOTION_BACK, now);
+        break;
+      case MOTION_BACK:
+        _pos = _leg.position(t);
+        if (_leg.finished(t)) {
+          _phase = MOTION_IDLE;
+          bool stopped = _stopping;
+          _stopping = false;
+          return stopped ? MOTION_EVT_STOPPED : MOTION_EVT_DONE;
+        }
+        break;
+    }
+    return MOTION_EVT_NONE;
+  }
+
+  // Time until update() has work: servo ticks while moving, the rest of the
+  // hold, 0 when a pending command can start, UINT32_MAX when idle.
+  uint32_t msUntilNextUpdate(uint32_t now) const {
+    switch (_phase) {
+      case MOTION_IDLE: return _hasPending ? 0 : UINT32_MAX;
+      case MOTION_HOLD: {
+        uint32_t t = now - _phaseStart;
+        return t >= _active.holdMs ? 0 : _active.holdMs - t;
+      }
+      default: return MOTION_TICK_MS;
+    }
+  }
+
+  int32_t position() const { return _pos; } // millidegrees
+  float angle() const { return _pos / 1000.0f; }
+  MotionPhase phase() const { return _phase; }
+  bool busy() const { return _phase != MOTION_IDLE || _hasPending; }
+  const motion_cmd_t& current() const { return _active; }
+
+private:
+  int32_t _baseline; // millidegrees
+  int32_t _pos;      // last commanded position
+  int32_t _target;
+  ProfileShape _shape;
+  Trajectory _leg;   // current OUT or BACK leg
+  MotionPhase _phase;
+  uint32_t _phaseStart;
+  motion_cmd_t _active;
+  motion_cmd_t _pending;
+  bool _hasPending;
+  bool _stopping;   // current BACK leg belongs to a MOTION_STOP
+
+  void start(const motion_cmd_t &cmd, uint32_t now) {
+    _active = cmd;
+    _stopping = false;
+    int32_t target = _baseline + toMdeg(cmd.angleRel);
+    if (target < 0) target = 0;
+    if (target > 180000) target = 180000;
+    _target = target;
+    if (_active.moveMs == 0) _active.moveMs = MOTION_TICK_MS;
+    enter(MOTION_OUT, now);
+  }
+
+  void enter(MotionPhase p, uint32_t now) {
+    if (p == MOTION_BACK && _active.moveMs == 0) _active.moveMs = MOTION_TICK_MS;
+    _phase = p;
+    _phaseStart = now;
+    if (p == MOTION_OUT) _leg.start(_pos, _target, _active.moveMs, _shape);
+    else if (p == MOTION_BACK) _leg.start(_pos, _baseline, _active.moveMs, _shape);
+  }
+
+  static bool same(const motion_cmd_t &a, const motion_cmd_t &b) {
+    return a.kind == b.kind && a.angleRel == b.angleRel && a.holdMs == b.holdMs;
+  }
+
+  static int32_t toMdeg(float deg) { return (int32_t)(deg * 1000.0f + (deg < 0 ? -0.5f : 0.5f)); }
+};
+
+#endif // MOTION_EXECUTOR_H
@@ -0,0 +1,62 @@
+#ifndef SERVO_PWM_H
+#define SERVO_PWM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Servo angle -> LEDC duty, tabulated per degree at compile time.
+//
+// The duty for every whole degree is computed from the servo's pulse curve
+// and the PWM period into a table of duty counts in Q8; a position in
+// millidegrees interpolates between two entries with integer math. At 50 Hz
+// and 16-bit resolution one duty count is 0.31 us, so writes land on the
+// requested pulse width to within a microsecond.
+// Requires C++17. Shared with firmware/weather_station.ino.
+
+// Linear pulse curve: MinUs at 0 deg, MaxUs at 180 deg. The range is the
+// calibration of a given build: the Actuator keeps ESP32Servo's attach()
+// default of 544..2400 us it was set up with, the all-in-one firmware its
+// 500..2500 us.
+template <uint32_t MinUs, uint32_t MaxUs>
+struct ServoLinear {
+  static_assert(MinUs < MaxUs, "pulse range");
+  static constexpr double MIN_US = MinUs;
+  static constexpr double MAX_US = MaxUs;
+  static constexpr double pulseUs(double deg) { return MIN_US + (MAX_US - MIN_US) * deg / 180.0; }
+};
+
+template <class Servo, uint32_t FreqHz = 50, uint8_t ResolutionBits = 16>
+class ServoDutyTable {
+public:
+  static constexpr double PERIOD_US = 1e6 / FreqHz;
+  static constexpr uint32_t MAX_DUTY = (1UL << ResolutionBits) - 1;
+  static constexpr int32_t MAX_MDEG = 180000;
+
+  struct Data { uint32_t dutyQ8[181]; };
+
+  static constexpr Data build() {
+    Data d{};
+    for (size_t deg = 0; deg <= 180; ++deg) {
+      d.dutyQ8[deg] = (uint32_t)(Servo::pulseUs((double)deg) / PERIOD_US * MAX_DUTY * 256.0 + 0.5);
+    }
+    return d;
+  }
+
+  static constexpr Data TABLE = build();
+
+  // Duty for an angle in millidegrees, clamped to 0..180 deg.
+  static uint32_t duty(int32_t mdeg) {
+    if (mdeg <= 0) return (TABLE.dutyQ8[0] + 128) >> 8;
+    if (mdeg >= MAX_MDEG) return (TABLE.dutyQ8[180] + 128) >> 8;
+    uint32_t i = (uint32_t)mdeg / 1000;
+    uint32_t frac = (uint32_t)mdeg % 1000;
+    uint32_t a = TABLE.dutyQ8[i];
+    uint32_t q = a + (TABLE.dutyQ8[i + 1] - a) * frac / 1000; // table is increasing
+    return (q + 128) >> 8;
+  }
+};
+
+static_assert(ServoDutyTable<ServoLinear<500, 2500>>::TABLE.dutyQ8[90] / 256 == 4915, "1500 us at 50 Hz, 16 bit");
+static_assert(ServoDutyTable<ServoLinear<544, 2400>>::TABLE.dutyQ8[0] / 256 == 1782, "544 us at 50 Hz, 16 bit");
+
+#endif // SERVO_PWM_H
@@ -2,52 +2,81 @@
 #define SHADE_CONTROLLER_H
 
 #include <Arduino.h>
-#include <ESP32Servo.h>
 #include <stdint.h>
-
-// Sensor payload layout shared with weatherStation
-typedef struct __attribute__((packed)) {
-  float tempC;
-  float humidity;
-  float lux;
-  float wind_kmh;
-  uint32_t seq;
-} SensorPayload;
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "MotionExecutor.h"
+#include "SnapshotAssembler.h"
+#include "ShadeRules.h"
+#include <SensorPayload.h> // shared/WireFormat: sensor_payload_t, same struct as weatherStation
 
 class ShadeController {
 public:
   ShadeController(int servoPin,
                   float defaultAngle = 90.0f,
                   unsigned long upDuration = 5000UL,
-                  unsigned long downDuration = 10000UL);
+                  unsigned long downDuration = 10000UL,
+                  uint8_t espnowGroup = 0);
 
   ~ShadeController();
 
   // Attach servo and perform any initialization
   void begin();
 ///////
-// Handle incoming messages (ASCII or binary SensorPayload)
+// Handle incoming messages: ESP-NOW sample frames (WireFormat.h) or ASCII commands
   void handleMessage(const uint8_t *data, int len);
 
+  // Run the open/close policy on one sensor sample (ESP-NOW, MQTT or Serial)
+  void handleSample(const sensor_payload_t &sample);
+
+  // One per-field MQTT message (<base>/<key>); the policy runs once per
+  // assembled sample. pollSnapshot() hands out samples whose marker is late.
+  void handleMqttField(const char *key, const uint8_t *value, unsigned int len);
+  void pollSnapshot();
+
   // Pulse to an angle, hold for holdMs milliseconds, then return to closed (0).
   // moveDurationMs specifies how long the motion to/from the target should take (ms).
-  void pulseAngle(float angleDeg, unsigned long holdMs, unsigned long moveDurationMs = 500UL);
+  // Queued for the motion task; returns immediately. MOTION_URGENT preempts
+  // a move in progress, MOTION_NORMAL runs after it.
+  void pulseAngle(float angleDeg, unsigned long holdMs, unsigned long moveDurationMs = 500UL,
+                  MotionPriority priority = MOTION_NORMAL);
+
+  // Replace the policy rules (ShadeRules.h text form; empty restores the
+  // built-in set). Malformed text leaves the current rules in place.
+  bool loadRules(const char *text, size_t len);
+  void printRules();
+
+  // Cancel the move in progress (and any queued one) and return to baseline
+  void stop();
 
   // Query whether the shade is currently considered OPEN.
   // Returns true if open, false otherwise.
   bool isOpen();
 
+  // Print ESP-NOW receive counters (accepted, duplicate, missing frames)
+  // and MQTT snapshot counters (complete, partial, late samples)
+  void printLinkStats();
+
 private:
-  Servo _servo;
   int _servoPin;
-  float _currentAngle;
+  int32_t _currentMdeg;         // last position written, millidegrees
   float _defaultAngle;
   unsigned long _upDuration;
   unsigned long _downDuration;
+  uint8_t _espnowGroup;         // station peer-table group; other groups' broadcasts ignored
+  MotionExecutor _motion;       // owned by the motion task
+  QueueHandle_t _motionQueue;   // motion_cmd_t from handleMessage/commands
+  SnapshotAssembler _snapshot;  // MQTT fields -> samples, loop task only
+  RuleTable _rules[2];          // active one evaluated, other one compiled into
+  uint8_t _activeRules;         // swapped under _rulesMux
+  portMUX_TYPE _rulesMux = portMUX_INITIALIZER_UNLOCKED;
 
-  void setServoAngle(float angleDeg);
-  void performUp(float angle, unsigned long durationMs);
-  void performDown(float angle, unsigned long durationMs);
+  static void motionTaskEntry(void* pv);
+  void motionTask();
+  void setServoPosition(int32_t mdeg);
+  rule_decision_t evaluateRules(const float in[RULE_INPUT_COUNT], shade_rule_t &fired, uint32_t &lockMs);
+  void performUp(float angle, unsigned long durationMs, MotionPriority priority = MOTION_NORMAL);
+  void performDown(float angle, unsigned long durationMs, MotionPriority priority = MOTION_NORMAL);
 };
 
 extern ShadeController *gShadeController;
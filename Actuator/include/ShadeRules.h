@@ -0,0 +1,293 @@
+#ifndef SHADE_RULES_H
+#define SHADE_RULES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "CommandParser.h"
+
+// Declarative shade policy. A rule says "<action> when <input> <le|ge>
+// <threshold>", optionally with a hysteresis band (once on, it stays on
+// until the input is hyst past the threshold the other way), a dwell (the
+// condition must hold that long before the rule fires) and a priority.
+//
+// RuleTable::compile() turns a rule list into flat per-rule columns sorted
+// by priority, with "le" folded into "ge" by negating the input, so
+// evaluate() is one fixed loop over at most RULE_MAX rules, no allocation:
+//
+//   - NaN inputs neither fire nor change a rule's state
+//   - of the rules that fire, only those at the highest priority count
+//   - if they disagree (open and close) the decision is ambiguous
+//
+// Text form (retained <base>/rules topic, RULES serial command), clauses
+// in any order, separators free:
+//
+//   lock 5000
+//   close temp le 15
+//   open lux ge 75 hyst 10 dwell 60000 prio 1
+//
+// Inputs: temp, humidity, lux, wind, gust (station samples) and light (the
+// "light:<n>" value of a text command).
+
+enum RuleInput : uint8_t {
+  RULE_IN_TEMP = 0,
+  RULE_IN_HUMIDITY,
+  RULE_IN_LUX,
+  RULE_IN_WIND,
+  RULE_IN_GUST,
+  RULE_IN_CMD_LIGHT,
+  RULE_INPUT_COUNT
+};
+
+enum RuleCompare : uint8_t {
+  RULE_LE = 0,
+  RULE_GE
+};
+
+enum RuleAction : uint8_t {
+  RULE_NONE = 0,
+  RULE_OPEN,
+  RULE_CLOSE
+};
+
+typedef struct {
+  RuleInput input;
+  RuleCompare cmp;
+  float threshold;
+  float hysteresis;   // >= 0, same unit as the input
+  uint32_t dwellMs;
+  RuleAction action;
+  uint8_t priority;   // higher wins
+} shade_rule_t;
+
+enum RuleVerdict : uint8_t {
+  RULE_NO_DATA = 0,   // every input the rules look at is NaN
+  RULE_NO_TRIGGER,
+  RULE_AMBIGUOUS,     // open and close at the same priority
+  RULE_FIRE
+};
+
+typedef struct {
+  RuleVerdict verdict;
+  RuleAction action;  // RULE_FIRE only
+  uint8_t rule;       // index into RuleTable::rule(), RULE_FIRE only
+} rule_decision_t;
+
+static const uint8_t RULE_MAX = 16;
+
+// Built-in policy, identical to the former hard-coded thresholds
+static const shade_rule_t SHADE_DEFAULT_RULES[] = {
+  { RULE_IN_TEMP,      RULE_LE, 15.0f,  0.0f, 0, RULE_CLOSE, 0 },
+  { RULE_IN_LUX,       RULE_LE, 15.0f,  0.0f, 0, RULE_CLOSE, 0 },
+  { RULE_IN_TEMP,      RULE_GE, 23.0f,  0.0f, 0, RULE_OPEN,  0 },
+  { RULE_IN_LUX,       RULE_GE, 75.0f,  0.0f, 0, RULE_OPEN,  0 },
+  { RULE_IN_CMD_LIGHT, RULE_GE, 800.0f, 0.0f, 0, RULE_CLOSE, 0 },
+  { RULE_IN_CMD_LIGHT, RULE_LE, 300.0f, 0.0f, 0, RULE_OPEN,  0 },
+};
+static const uint32_t SHADE_DEFAULT_LOCK_MS = 5000; // min time between policy moves
+
+inline const char* ruleInputName(RuleInput in) {
+  switch (in) {
+    case RULE_IN_TEMP: return "temp";
+    case RULE_IN_HUMIDITY: return "humidity";
+    case RULE_IN_LUX: return "lux";
+    case RULE_IN_WIND: return "wind";
+    case RULE_IN_GUST: return "gust";
+    case RULE_IN_CMD_LIGHT: return "light";
+    default: return "?";
+  }
+}
+
+class RuleTable {
+public:
+  RuleTable() : _count(0), _lockMs(0), _openMask(0), _closeMask(0), _latched(0) {}
+
+  // False (table unchanged) when a rule is malformed or there are too many.
+  bool compile(const shade_rule_t* rules, size_t count, uint32_t lockMs) {
+    if (count > RULE_MAX) return false;
+    for (size_t i = 0; i < count; ++i) {
+      const shade_rule_t &r = rules[i];
+      if (r.input >= RULE_INPUT_COUNT || r.cmp > RULE_GE) return false;
+      if (r.action != RULE_OPEN && r.action != RULE_CLOSE) return false;
+      if (!isfinite(r.threshold) || !isfinite(r.hysteresis) || r.hysteresis < 0) return false;
+    }
+
+    // Stable insertion sort by priority, highest first
+    _count = 0;
+    for (size_t i = 0; i < count; ++i) {
+      size_t j = _count++;
+      while (j > 0 && _src[j - 1].priority < rules[i].priority) {
+        _src[j] = _src[j - 1];
+        --j;
+      }
+      _src[j] = rules[i];
+    }
+
+    _openMask = 0;
+    _closeMask = 0;
+    for (uint8_t i = 0; i < _count; ++i) {
+      const shade_rule_t &r = _src[i];
+      uint16_t bit = (uint16_t)(1u << i);
+      float sign = r.cmp == RULE_GE ? 1.0f : -1.0f;
+      _input[i] = r.input;
+      _sign[i] = sign;
+      _on[i] = sign * r.threshold;
+      _off[i] = sign * r.threshold - r.hysteresis;
+      _dwell[i] = r.dwellMs;
+      _since[i] = 0;
+      if (r.action == RULE_OPEN) _openMask |= bit;
+      else _closeMask |= bit;
+      _peers[i] = 0;
+      for (uint8_t k = 0; k < _count; ++k) {
+        if (_src[k].priority == r.priority) _peers[i] |= (uint16_t)(1u << k);
+      }
+    }
+    _latched = 0;
+    _lockMs = lockMs;
+    return true;
+  }
+
+  rule_decision_t evaluate(const float in[RULE_INPUT_COUNT], uint32_t now) {
+    uint16_t seen = 0;
+    uint16_t firing = 0;
+    for (uint8_t i = 0; i < _count; ++i) {
+      uint16_t bit = (uint16_t)(1u << i);
+      float x = in[_input[i]] * _sign[i];
+      bool latched = (_latched & bit) != 0;
+      bool valid = !isnan(x);
+      bool cond = x >= (latched ? _off[i] : _on[i]); // false for NaN
+      if (valid) {
+        seen |= bit;
+        if (cond && !latched) _since[i] = now;
+        _latched = cond ? (uint16_t)(_latched | bit) : (uint16_t)(_latched & ~bit);
+      }
+      if (cond && now - _since[i] >= _dwell[i]) firing |= bit;
+    }
+
+    rule_decision_t d = { RULE_NO_DATA, RULE_NONE, 0 };
+    if (!seen) return d;
+    d.verdict = RULE_NO_TRIGGER;
+    if (!firing) return d;
+    uint8_t top = (uint8_t)__builtin_ctz(firing); // sorted: lowest bit = highest priority
+    uint16_t group = firing & _peers[top];
+    bool open = (group & _openMask) != 0;
+    bool close = (group & _closeMask) != 0;
+    if (open && close) {
+      d.verdict = RULE_AMBIGUOUS;
+      return d;
+    }
+    d.verdict = RULE_FIRE;
+    d.action = open ? RULE_OPEN : RULE_CLOSE;
+    d.rule = top;
+    return d;
+  }
+
+  uint8_t size() const { return _count; }
+  uint32_t lockMs() const { return _lockMs; }
+  const shade_rule_t& rule(uint8_t i) const { return _src[i]; }
+
+private:
+  shade_rule_t _src[RULE_MAX]; // sorted source rules, for printing
+  uint8_t _count;
+  uint32_t _lockMs;
+
+  // Flat decision table, one column entry per rule
+  uint8_t _input[RULE_MAX];
+  float _sign[RULE_MAX];       // +1 ge, -1 le
+  float _on[RULE_MAX];         // sign * threshold
+  float _off[RULE_MAX];        // _on - hysteresis: stay on while above
+  uint32_t _dwell[RULE_MAX];
+  uint16_t _peers[RULE_MAX];   // rules at the same priority
+  uint16_t _openMask;
+  uint16_t _closeMask;
+
+  // Evaluation state
+  uint16_t _latched;           // condition true at the last valid input
+  uint32_t _since[RULE_MAX];   // when it became true
+};
+
+enum RuleParseStatus : uint8_t {
+  RULES_OK = 0,
+  RULES_TOO_MANY,
+  RULES_BAD_CLAUSE,    // token that does not start lock/open/close
+  RULES_BAD_INPUT,
+  RULES_BAD_COMPARE,
+  RULES_BAD_NUMBER
+};
+
+inline const char* ruleParseStatusName(RuleParseStatus st) {
+  switch (st) {
+    case RULES_OK: return "ok";
+    case RULES_TOO_MANY: return "too many rules";
+    case RULES_BAD_CLAUSE: return "expected lock, open or close";
+    case RULES_BAD_INPUT: return "unknown input";
+    case RULES_BAD_COMPARE: return "expected le or ge";
+    case RULES_BAD_NUMBER: return "expected a number";
+    default: return "?";
+  }
+}
+
+// Parses the text form into rules[0..count) and lockMs (left unchanged when
+// the text has no lock clause). errorAt points at the offending token.
+inline RuleParseStatus parseRules(const char* text, size_t len,
+                                  shade_rule_t* rules, size_t cap, size_t &count,
+                                  uint32_t &lockMs, const char* &errorAt) {
+  CmdTokenizer tok(text, len);
+  cmd_token_t t;
+  count = 0;
+  bool have = tok.next(t);
+  while (have) {
+    errorAt = t.text;
+    if (t.keyword == KW_LOCK) {
+      if (!tok.nextInteger(lockMs)) return RULES_BAD_NUMBER;
+      have = tok.next(t);
+      continue;
+    }
+    if (t.keyword != KW_OPEN && t.keyword != KW_CLOSE) return RULES_BAD_CLAUSE;
+    if (count >= cap) return RULES_TOO_MANY;
+    shade_rule_t &r = rules[count];
+    r.action = t.keyword == KW_OPEN ? RULE_OPEN : RULE_CLOSE;
+    r.hysteresis = 0.0f;
+    r.dwellMs = 0;
+    r.priority = 0;
+
+    tok.next(t);
+    errorAt = t.text;
+    switch (t.keyword) {
+      case KW_TEMP: r.input = RULE_IN_TEMP; break;
+      case KW_HUMIDITY: r.input = RULE_IN_HUMIDITY; break;
+      case KW_LUX: r.input = RULE_IN_LUX; break;
+      case KW_WIND: r.input = RULE_IN_WIND; break;
+      case KW_GUST: r.input = RULE_IN_GUST; break;
+      case KW_LIGHT: r.input = RULE_IN_CMD_LIGHT; break;
+      default: return RULES_BAD_INPUT;
+    }
+    tok.next(t);
+    errorAt = t.text;
+    if (t.keyword == KW_LE) r.cmp = RULE_LE;
+    else if (t.keyword == KW_GE) r.cmp = RULE_GE;
+    else return RULES_BAD_COMPARE;
+    r.threshold = NAN;
+    if (!tok.nextNumber(r.threshold) || isnan(r.threshold)) return RULES_BAD_NUMBER;
+
+    // Optional modifiers until the next clause
+    for (have = tok.next(t); have; have = tok.next(t)) {
+      errorAt = t.text;
+      uint32_t v = 0;
+      if (t.keyword == KW_HYST) {
+        if (!tok.nextNumber(r.hysteresis) || !(r.hysteresis >= 0)) return RULES_BAD_NUMBER;
+      } else if (t.keyword == KW_DWELL) {
+        if (!tok.nextInteger(r.dwellMs)) return RULES_BAD_NUMBER;
+      } else if (t.keyword == KW_PRIO) {
+        if (!tok.nextInteger(v) || v > 255) return RULES_BAD_NUMBER;
+        r.priority = (uint8_t)v;
+      } else {
+        break;
+      }
+    }
+    count++;
+  }
+  return RULES_OK;
+}
+
+#endif // SHADE_RULES_H
@@ -0,0 +1,152 @@
+#ifndef SNAPSHOT_ASSEMBLER_H
+#define SNAPSHOT_ASSEMBLER_H
+
+#include <stdint.h>
+#include <math.h>
+#include <SensorPayload.h> // shared/WireFormat: sensor_payload_t
+
+// Rebuilds whole samples from the station's per-field MQTT topics
+// (<base>/temperature, <base>/light, ... then <base>/update). Fields are
+// collected into a snapshot and handed out once per sample, so the shade
+// policy never sees a mix of old and new values:
+//
+//   marker     "update" closes the snapshot (complete)
+//   repeat     a field already in the snapshot means the marker was lost;
+//              the old snapshot is handed out (partial) and a new one starts
+//   timeout    no marker within timeoutMs of the first field (partial)
+//
+// Fields the station did not publish (it skips NaN readings) stay NaN. When
+// the station also publishes "seq", a snapshot that is not newer than the
+// last one handed out is dropped as late; a large step back is taken as a
+// station reboot. A marker with nothing collected is late as well (its
+// fields already went out on the timeout).
+//
+// Nothing here reads the clock; the caller passes now and polls.
+
+enum SnapshotField : uint8_t {
+  SNAP_TEMP = 0,
+  SNAP_HUMIDITY,
+  SNAP_LUX,
+  SNAP_WIND,
+  SNAP_WIND_GUST,
+  SNAP_WIND_AVG2M,
+  SNAP_WIND_AVG10M,
+  SNAP_WIND_VAR,
+  SNAP_SEQ,
+  SNAP_FIELD_COUNT
+};
+
+typedef struct {
+  uint32_t complete;  // closed by the update marker
+  uint32_t partial;   // handed out without a marker (timeout or repeat)
+  uint32_t late;      // dropped: stale seq, or a marker after its timeout
+  uint32_t fields;    // field messages consumed
+} snapshot_stats_t;
+
+class SnapshotAssembler {
+public:
+  static constexpr uint32_t RESTART_GAP = 32; // seq this far back is a reboot
+
+  explicit SnapshotAssembler(uint32_t timeoutMs)
+    : _timeoutMs(timeoutMs), _mask(0), _firstMs(0), _haveLastSeq(false), _lastSeq(0), _stats() {
+    clear();
+  }
+
+  // Returns true when a snapshot is ready in out (the previous one, if this
+  // field repeats one already collected).
+  bool field(SnapshotField f, float value, uint32_t now, sensor_payload_t &out) {
+    bool ready = collect(f, now, out);
+    set(f, value);
+    return ready;
+  }
+
+  bool sequence(uint32_t seq, uint32_t now, sensor_payload_t &out) {
+    bool ready = collect(SNAP_SEQ, now, out);
+    _snap.seq = seq;
+    return ready;
+  }
+
+  bool marker(sensor_payload_t &out) {
+    if (_mask == 0) {
+      _stats.late++;
+      return false;
+    }
+    return emit(out, _stats.complete);
+  }
+
+  bool poll(uint32_t now, sensor_payload_t &out) {
+    if (_mask == 0 || now - _firstMs < _timeoutMs) return false;
+    return emit(out, _stats.partial);
+  }
+
+  // Time until poll() has work; UINT32_MAX when nothing is collected.
+  uint32_t msUntilTimeout(uint32_t now) const {
+    if (_mask == 0) return UINT32_MAX;
+    uint32_t t = now - _firstMs;
+    return t >= _timeoutMs ? 0 : _timeoutMs - t;
+  }
+
+  const snapshot_stats_t& stats() const { return _stats; }
+
+private:
+  uint32_t _timeoutMs;
+  uint16_t _mask;      // bit per SnapshotField collected
+  uint32_t _firstMs;
+  bool _haveLastSeq;
+  uint32_t _lastSeq;
+  sensor_payload_t _snap;
+  snapshot_stats_t _stats;
+
+  void clear() {
+    _mask = 0;
+    sensorPayloadClear(_snap);
+  }
+
+  void set(SnapshotField f, float v) {
+    switch (f) {
+      case SNAP_TEMP: _snap.tempC = v; break;
+      case SNAP_HUMIDITY: _snap.humidity = v; break;
+      case SNAP_LUX: _snap.lux = v; break;
+      case SNAP_WIND: _snap.wind_kmh = v; break;
+      case SNAP_WIND_GUST: _snap.wind_gust_kmh = v; break;
+      case SNAP_WIND_AVG2M: _snap.wind_avg2m_kmh = v; break;
+      case SNAP_WIND_AVG10M: _snap.wind_avg10m_kmh = v; break;
+      case SNAP_WIND_VAR: _snap.wind_var10m = v; break;
+      default: break;
+    }
+  }
+
+  bool collect(SnapshotField f, uint32_t now, sensor_payload_t &out) {
+    bool ready = false;
+    uint16_t bit = (uint16_t)(1u << f);
+    if (_mask & bit) ready = emit(out, _stats.partial);
+    if (_mask == 0) _firstMs = now;
+    _mask |= bit;
+    _stats.fields++;
+    return ready;
+  }
+
+  // Hands the snapshot out and counts it, unless its seq is stale.
+  bool emit(sensor_payload_t &out, uint32_t &counter) {
+    bool hasSeq = (_mask & (1u << SNAP_SEQ)) != 0;
+    bool stale = false;
+    if (hasSeq) {
+      int32_t d = (int32_t)(_snap.seq - _lastSeq);
+      stale = _haveLastSeq && d <= 0 && (uint32_t)-d < RESTART_GAP;
+      if (!stale) {
+        _haveLastSeq = true;
+        _lastSeq = _snap.seq;
+      }
+    }
+    if (stale) {
+      _stats.late++;
+    } else {
+      counter++;
+      out = _snap;
+    }
+    clear();
+    return !stale;
+  }
+};
+
+#endif // SNAPSHOT_ASSEMBLER_H
@@ -0,0 +1,137 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fixed-point position profiles for servo moves.
+//
+// A move from `from` to `to` (millidegrees) over durationMs follows a
+// normalized profile s(u), with u = elapsed / duration, both in Q16:
+//
+//   PROFILE_TRAPEZOID  constant acceleration over the first and last quarter,
+//                      constant speed in between
+//   PROFILE_SCURVE     quintic 10u^3 - 15u^4 + 6u^5: speed and acceleration
+//                      are zero at both ends, so the servo starts and stops
+//                      without a jolt
+//
+// Both profiles are tabulated at compile time; a position costs one division,
+// a table interpolation and a multiply, with no float. The move takes exactly
+// durationMs however often it is sampled, so the caller's update rate only
+// sets the smoothness. The interpolation error is checked with static_assert
+// like the calibration curves (Calibration.h). Requires C++17.
+
+enum ProfileShape : uint8_t {
+  PROFILE_TRAPEZOID = 0,
+  PROFILE_SCURVE
+};
+
+namespace profile {
+
+constexpr int32_t ONE = 1 << 16; // s and u in Q16
+
+struct Trapezoid {
+  static constexpr double ACCEL = 0.25;              // share of the move spent accelerating
+  static constexpr double CRUISE = 1.0 / (1.0 - ACCEL); // speed in between (distance 1 per duration 1)
+
+  static constexpr double eval(double u) {
+    if (u <= 0.0) return 0.0;
+    if (u >= 1.0) return 1.0;
+    if (u < ACCEL) return CRUISE * u * u / (2 * ACCEL);
+    if (u > 1.0 - ACCEL) return 1.0 - CRUISE * (1.0 - u) * (1.0 - u) / (2 * ACCEL);
+    return CRUISE * (u - ACCEL / 2);
+  }
+};
+
+struct SCurve {
+  static constexpr double eval(double u) {
+    if (u <= 0.0) return 0.0;
+    if (u >= 1.0) return 1.0;
+    return u * u * u * (10.0 + u * (-15.0 + 6.0 * u));
+  }
+};
+
+// 2^Bits intervals over u in [0, 1]
+template <class Curve, unsigned Bits = 6>
+class Table {
+public:
+  static constexpr size_t N = (1u << Bits) + 1;
+  static constexpr unsigned FRAC_BITS = 16 - Bits;
+
+  struct Data { int32_t s[N]; };
+
+  static constexpr Data build() {
+    Data d{};
+    for (size_t i = 0; i < N; ++i) {
+      double s = Curve::eval((double)i / (N - 1));
+      d.s[i] = (int32_t)(s * ONE + 0.5);
+    }
+    return d;
+  }
+
+  static constexpr Data TABLE = build();
+
+  // Largest |table - reference| in Q16 counts, probed at 8 points per interval.
+  static constexpr double maxError() {
+    double worst = 0.0;
+    for (size_t i = 0; i + 1 < N; ++i) {
+      for (int k = 1; k < 8; ++k) {
+        double u = (i + k / 8.0) / (N - 1);
+        double s = TABLE.s[i] + (TABLE.s[i + 1] - TABLE.s[i]) * (k / 8.0);
+        double e = s - Curve::eval(u) * ONE;
+        if (e < 0) e = -e;
+        if (e > worst) worst = e;
+      }
+    }
+    return worst;
+  }
+
+  // s(u), u in Q16 [0, ONE)
+  static int32_t lookup(uint32_t u) {
+    uint32_t i = u >> FRAC_BITS;
+    int32_t frac = (int32_t)(u & ((1u << FRAC_BITS) - 1));
+    int32_t a = TABLE.s[i];
+    return a + (((TABLE.s[i + 1] - a) * frac) >> FRAC_BITS);
+  }
+};
+
+// At most 1/4096 of the move (0.04 deg on a 180 deg move)
+static_assert(Table<Trapezoid>::maxError() < ONE / 4096, "trapezoid table too coarse");
+static_assert(Table<SCurve>::maxError() < ONE / 4096, "S-curve table too coarse");
+
+} // namespace profile
+
+class Trajectory {
+public:
+  Trajectory() : _from(0), _delta(0), _duration(0), _shape(PROFILE_SCURVE) {}
+
+  void start(int32_t fromMdeg, int32_t toMdeg, uint32_t durationMs, ProfileShape shape) {
+    _from = fromMdeg;
+    _delta = toMdeg - fromMdeg;
+    _duration = durationMs;
+    _shape = shape;
+  }
+
+  // Position in millidegrees after elapsedMs; the target once finished.
+  int32_t position(uint32_t elapsedMs) const {
+    if (elapsedMs >= _duration) return _from + _delta;
+    // elapsed < duration, so the 32-bit form cannot overflow below 2^16 ms
+    uint32_t u = _duration < (1u << 16)
+      ? (elapsedMs << 16) / _duration
+      : (uint32_t)(((uint64_t)elapsedMs << 16) / _duration);
+    int32_t s = _shape == PROFILE_TRAPEZOID ? profile::Table<profile::Trapezoid>::lookup(u)
+                                            : profile::Table<profile::SCurve>::lookup(u);
+    return _from + (int32_t)(((int64_t)_delta * s) >> 16);
+  }
+
+  bool finished(uint32_t elapsedMs) const { return elapsedMs >= _duration; }
+  int32_t target() const { return _from + _delta; }
+
+private:
+  int32_t _from;
+  int32_t _delta;
+  uint32_t _duration;
+  ProfileShape _shape;
+};
+
+#endif // TRAJECTORY_H
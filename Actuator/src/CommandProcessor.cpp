@@ -1,6 +1,5 @@
 #include "CommandProcessor.h"
-#include <stdlib.h>
-#include <string.h>
+#include <stdio.h>
 
 CommandProcessor::CommandProcessor(ShadeController* controller,
                                    float defaultAngle,
@@ -22,20 +21,23 @@ void CommandProcessor::printHelp() {
   Serial.println("  OPEN [angle_rel] [hold_ms]");
   Serial.println("  CLOSE [angle_rel] [hold_ms]");
   Serial.println("  PULSE <angle_rel> <hold_ms> [move_ms]");
+  Serial.println("  STOP");
   Serial.println("  STATUS");
+  Serial.println("  RULES [lock <ms>] [open|close <input> le|ge <value> [hyst <v>] [dwell <ms>] [prio <n>]]...");
 }
 
-void CommandProcessor::handleSensorCommand() {
+void CommandProcessor::handleSensorCommand(CmdTokenizer &args) {
   if (!_controller) { Serial.println("No ShadeController instance"); return; }
   float temp = NAN, hum = NAN, lux = NAN, wind = NAN;
   uint32_t seq = 0;
-  char* tok = strtok(NULL, " \t"); if (tok) temp = (strcmp(tok, "NaN")==0 || strcmp(tok, "nan")==0) ? NAN : atof(tok);
-  tok = strtok(NULL, " \t"); if (tok) hum = (strcmp(tok, "NaN")==0 || strcmp(tok, "nan")==0) ? NAN : atof(tok);
-  tok = strtok(NULL, " \t"); if (tok) lux = (strcmp(tok, "NaN")==0 || strcmp(tok, "nan")==0) ? NAN : atof(tok);
-  tok = strtok(NULL, " \t"); if (tok) wind = (strcmp(tok, "NaN")==0 || strcmp(tok, "nan")==0) ? NAN : atof(tok);
-  tok = strtok(NULL, " \t"); if (tok) seq = (uint32_t)strtoul(tok, NULL, 10);
-
-  SensorPayload payload;
+  args.nextNumber(temp);
+  args.nextNumber(hum);
+  args.nextNumber(lux);
+  args.nextNumber(wind);
+  args.nextInteger(seq);
+
+  sensor_payload_t payload;
+  sensorPayloadClear(payload);
   payload.tempC = temp;
   payload.humidity = hum;
   payload.lux = lux;
@@ -45,74 +47,87 @@ void CommandProcessor::handleSensorCommand() {
   Serial.printf("Injecting sensor: temp=%0.1f hum=%0.1f lux=%0.1f wind=%0.2f seq=%u\n",
                 payload.tempC, payload.humidity, payload.lux, payload.wind_kmh, payload.seq);
 
-  _controller->handleMessage((const uint8_t *)&payload, sizeof(payload));
+  _controller->handleSample(payload);
 }
 
-void CommandProcessor::handleUpDownCommand(bool isUp) {
+void CommandProcessor::handleUpDownCommand(CmdTokenizer &args, bool isUp) {
   float angle = _defaultAngle;
-  unsigned long duration = isUp ? _upDuration : _downDuration;
-  char* tok = strtok(NULL, " \t"); if (tok) angle = atof(tok);
-  tok = strtok(NULL, " \t"); if (tok) duration = (unsigned long)strtoul(tok, NULL, 10);
-
-  String payload = isUp ? "up" : "down";
-  payload += " angle:";
-  payload += String(angle, 1);
-  payload += " duration:";
-  payload += String(duration);
-
-  Serial.printf("Injecting command: %s\n", payload.c_str());
-  if (_controller) _controller->handleMessage((const uint8_t *)payload.c_str(), payload.length());
+  uint32_t duration = isUp ? _upDuration : _downDuration;
+  args.nextNumber(angle);
+  args.nextInteger(duration);
+
+  char payload[48];
+  int n = snprintf(payload, sizeof(payload), "%s angle:%.1f duration:%lu",
+                   isUp ? "up" : "down", angle, (unsigned long)duration);
+  if (n < 0) return;
+  if (n >= (int)sizeof(payload)) n = sizeof(payload) - 1;
+
+  Serial.printf("Injecting command: %s\n", payload);
+  if (_controller) _controller->handleMessage((const uint8_t *)payload, n);
 }
 
-void CommandProcessor::handleOpenCloseCommand(bool isOpen) {
+void CommandProcessor::handleOpenCloseCommand(CmdTokenizer &args, bool isOpen) {
   if (!_controller) { Serial.println("No ShadeController instance"); return; }
   float angle_rel = _defaultAngle;
-  unsigned long hold = _upDuration;
-  char* tok = strtok(NULL, " \t"); if (tok) angle_rel = atof(tok);
-  tok = strtok(NULL, " \t"); if (tok) hold = (unsigned long)strtoul(tok, NULL, 10);
+  uint32_t hold = _upDuration;
+  args.nextNumber(angle_rel);
+  args.nextInteger(hold);
 
   if (isOpen) {
-    Serial.printf("OPEN: pulse +%0.1f for %lu ms\n", angle_rel, hold);
+    Serial.printf("OPEN: pulse +%0.1f for %lu ms\n", angle_rel, (unsigned long)hold);
     _controller->pulseAngle(angle_rel, hold);
   } else {
-    Serial.printf("CLOSE: pulse -%0.1f for %lu ms\n", angle_rel, hold);
+    Serial.printf("CLOSE: pulse -%0.1f for %lu ms\n", angle_rel, (unsigned long)hold);
     _controller->pulseAngle(-angle_rel, hold);
   }
 }
 
-void CommandProcessor::handlePulseCommand() {
+void CommandProcessor::handlePulseCommand(CmdTokenizer &args) {
   if (!_controller) { Serial.println("No ShadeController instance"); return; }
   float angle_rel = 0.0f;
-  unsigned long hold = _upDuration;
-  unsigned long move_ms = 500UL;
-  char* tok = strtok(NULL, " \t"); if (tok) angle_rel = atof(tok);
-  tok = strtok(NULL, " \t"); if (tok) hold = (unsigned long)strtoul(tok, NULL, 10);
-  tok = strtok(NULL, " \t"); if (tok) move_ms = (unsigned long)strtoul(tok, NULL, 10);
+  uint32_t hold = _upDuration;
+  uint32_t move_ms = 500UL;
+  args.nextNumber(angle_rel);
+  args.nextInteger(hold);
+  args.nextInteger(move_ms);
 
-  Serial.printf("PULSE: angle=%0.1f hold=%lu move=%lu\n", angle_rel, hold, move_ms);
+  Serial.printf("PULSE: angle=%0.1f hold=%lu move=%lu\n", angle_rel, (unsigned long)hold, (unsigned long)move_ms);
   _controller->pulseAngle(angle_rel, hold, move_ms);
 }
 
-void CommandProcessor::processLine(String line) {
-  line.trim();
-  if (line.length() == 0) return;
-
-  char buf[256];
-  line.toCharArray(buf, sizeof(buf));
-  char* tok = strtok(buf, " \t");
-  if (!tok) return;
-  String cmd = String(tok);
-  cmd.toUpperCase();
-
-  if (cmd == "HELP") { printHelp(); return; }
-  if (cmd == "SENSOR") { handleSensorCommand(); return; }
-  if (cmd == "UP") { handleUpDownCommand(true); return; }
-  if (cmd == "DOWN") { handleUpDownCommand(false); return; }
-  if (cmd == "OPEN") { handleOpenCloseCommand(true); return; }
-  if (cmd == "CLOSE") { handleOpenCloseCommand(false); return; }
-  if (cmd == "PULSE") { handlePulseCommand(); return; }
-  if (cmd == "STATUS") { Serial.println("ShadeController configured."); return; }
-
-  Serial.printf("Unknown command: %s\n", cmd.c_str());
+void CommandProcessor::processLine(const char* line, size_t len) {
+  CmdTokenizer args(line, len);
+  cmd_token_t cmd;
+  if (!args.next(cmd)) return;
+
+  switch (cmd.keyword) {
+    case KW_HELP: printHelp(); return;
+    case KW_SENSOR: handleSensorCommand(args); return;
+    case KW_UP: handleUpDownCommand(args, true); return;
+    case KW_DOWN: handleUpDownCommand(args, false); return;
+    case KW_OPEN: handleOpenCloseCommand(args, true); return;
+    case KW_CLOSE: handleOpenCloseCommand(args, false); return;
+    case KW_PULSE: handlePulseCommand(args); return;
+    case KW_STOP:
+      if (_controller) _controller->stop();
+      return;
+    case KW_RULES: {
+      if (!_controller) return;
+      // Bare RULES only lists; anything after it replaces the rule set
+      CmdTokenizer peek(args.rest(), args.restLen());
+      cmd_token_t first;
+      if (peek.next(first)) _controller->loadRules(args.rest(), args.restLen());
+      _controller->printRules();
+      return;
+    }
+    case KW_STATUS:
+      Serial.println("ShadeController configured.");
+      if (_controller) _controller->printLinkStats();
+      return;
+    default:
+      break;
+  }
+
+  Serial.printf("Unknown command: %.*s\n", (int)cmd.len, cmd.text);
   printHelp();
-}
\ No newline at end of file
+}
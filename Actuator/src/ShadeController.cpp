@@ -2,124 +2,205 @@
 #include <Arduino.h>
 #include <math.h>
 #include <string.h>
-
-static float parseNumericValue(const String &lowerPayload, const String &key, float fallback) {
-  int idx = lowerPayload.indexOf(key);
-  if (idx < 0) return fallback;
-  idx += key.length();
-  while (idx < lowerPayload.length() && !isDigit(lowerPayload[idx]) && lowerPayload[idx] != '-' && lowerPayload[idx] != '.') idx++;
-  String num;
-  while (idx < lowerPayload.length() && (isDigit(lowerPayload[idx]) || lowerPayload[idx] == '.' || lowerPayload[idx] == '-')) {
-    num += lowerPayload[idx++];
-  }
-  if (num.length()) return num.toFloat();
-  return fallback;
-}
+#include <strings.h>
+#include <freertos/task.h>
+#include <WireFormat.h>
+#include <ReliableLink.h>
+#include "ServoPwm.h"
+#include "CommandParser.h"
 
 /* Shade state and thresholds ------------------------------------------------- */
 enum ShadeState { SHADE_CLOSED = 0, SHADE_OPEN = 1, SHADE_MOVING = 2, SHADE_UNKNOWN = 3 };
-static ShadeState s_shadeState = SHADE_CLOSED; // start closed by default
+// Written by the motion task, read by the policy
+static volatile ShadeState s_shadeState = SHADE_CLOSED; // start closed by default
 
-static const float CLOSE_TEMP_THRESHOLD = 15.0f;
-static const float CLOSE_LUX_THRESHOLD  = 15.0f;
-static const float OPEN_TEMP_THRESHOLD  = 23.0f;
-static const float OPEN_LUX_THRESHOLD   = 75.0f;
+// Thresholds and the re-trigger lock live in the rule table (ShadeRules.h)
+static volatile unsigned long s_lastActionMillis = 0;
 
- // Simple lock to avoid rapid re-triggering when sensors fluctuate
-static const unsigned long STATE_CHANGE_LOCK_MS = 5000UL;
-static unsigned long s_lastActionMillis = 0;
+// Stations retransmit frames whose ack was lost; drop the second copy. A
+// station feeds up to two streams here: unicast or its group's broadcast,
+// plus the broadcast to all.
+static const uint8_t ESPNOW_MAX_STREAMS = 8;
+static DuplicateFilter<ESPNOW_MAX_STREAMS> s_dedup;
 
 // The physical resting/baseline angle for the servo. We keep the servo at
 // BASELINE_ANGLE (90°) and treat UP/DOWN pulses relative to this angle.
 static const float BASELINE_ANGLE = 90.0f;
 
+// Servo PWM straight from LEDC: 50 Hz, 16 bit (0.31 us per duty count)
+static const uint8_t SERVO_LEDC_CHANNEL = 0;
+static const uint32_t SERVO_LEDC_FREQ = 50;
+static const uint8_t SERVO_LEDC_RES = 16;
+// Pulse range of ESP32Servo's attach(pin), which this servo was calibrated with
+static const uint32_t SERVO_MIN_US = 544;
+static const uint32_t SERVO_MAX_US = 2400;
+typedef ServoDutyTable<ServoLinear<SERVO_MIN_US, SERVO_MAX_US>, SERVO_LEDC_FREQ, SERVO_LEDC_RES> ServoDuty;
+
+// Motion task: queued commands, return leg of a STOP, move profile
+static const UBaseType_t MOTION_QUEUE_LEN = 4;
+static const ProfileShape MOTION_PROFILE = PROFILE_SCURVE;
+static const uint32_t MOTION_STOP_MS = 500;
+
+// MQTT fields of one station sample arrive within a few ms; after this the
+// sample is used without its update marker
+static const uint32_t MQTT_SNAPSHOT_TIMEOUT_MS = 2000;
+
+// Station topic suffixes (CommManager::publishFields), matched case-insensitively
+typedef struct {
+  const char* key;
+  SnapshotField field;
+} mqtt_field_t;
+
+static const mqtt_field_t MQTT_FIELDS[] = {
+  { "temperature", SNAP_TEMP },
+  { "humidity",    SNAP_HUMIDITY },
+  { "light",       SNAP_LUX },
+  { "windspeed",   SNAP_WIND },
+  { "windgust",    SNAP_WIND_GUST },
+  { "windavg2m",   SNAP_WIND_AVG2M },
+  { "windavg10m",  SNAP_WIND_AVG10M },
+  { "windvar",     SNAP_WIND_VAR },
+  { "seq",         SNAP_SEQ },
+};
+
 /* Constructor ----------------------------------------------------------------*/
 ShadeController::ShadeController(int servoPin,
                                  float defaultAngle,
                                  unsigned long upDuration,
-                                 unsigned long downDuration)
+                                 unsigned long downDuration,
+                                 uint8_t espnowGroup)
   : _servoPin(servoPin),
-    _currentAngle(0.0f),
+    _currentMdeg(-1),
     _defaultAngle(defaultAngle),
     _upDuration(upDuration),
-    _downDuration(downDuration) {}
+    _downDuration(downDuration),
+    _espnowGroup(espnowGroup),
+    _motion(BASELINE_ANGLE, MOTION_PROFILE),
+    _motionQueue(NULL),
+    _snapshot(MQTT_SNAPSHOT_TIMEOUT_MS),
+    _activeRules(0) {
+  _rules[0].compile(SHADE_DEFAULT_RULES, sizeof(SHADE_DEFAULT_RULES) / sizeof(SHADE_DEFAULT_RULES[0]),
+                    SHADE_DEFAULT_LOCK_MS);
+}
 
 ShadeController::~ShadeController() {
-  _servo.detach();
+  ledcDetachPin(_servoPin);
 }
 
 void ShadeController::begin() {
-  _servo.attach(_servoPin);
-  setServoAngle(BASELINE_ANGLE); // start at baseline (90°)
+  ledcSetup(SERVO_LEDC_CHANNEL, SERVO_LEDC_FREQ, SERVO_LEDC_RES);
+  ledcAttachPin(_servoPin, SERVO_LEDC_CHANNEL);
+  setServoPosition(_motion.position()); // start at baseline (90°)
+  _motionQueue = xQueueCreate(MOTION_QUEUE_LEN, sizeof(motion_cmd_t));
+  xTaskCreatePinnedToCore(&ShadeController::motionTaskEntry, "MotionTask", 3072, this, 2, NULL, 1);
   Serial.printf("ShadeController: servo attached to pin %d\n", _servoPin);
 }
 
-void ShadeController::setServoAngle(float angleDeg) {
-  if (angleDeg < 0.0f) angleDeg = 0.0f;
-  if (angleDeg > 180.0f) angleDeg = 180.0f;
-  _servo.write((int)round(angleDeg));
-  _currentAngle = angleDeg;
-  delay(20); // let servo start moving
+void ShadeController::setServoPosition(int32_t mdeg) {
+  ledcWrite(SERVO_LEDC_CHANNEL, ServoDuty::duty(mdeg));
+  _currentMdeg = mdeg;
 }
 
 // Pulse to an angle relative to the baseline: move from the current position
 // to (BASELINE_ANGLE + angleDeg), hold for holdMs milliseconds, then return to
 // BASELINE_ANGLE. moveDurationMs controls how long each leg (to/from target)
-// should take.
-void ShadeController::pulseAngle(float angleDeg, unsigned long holdMs, unsigned long moveDurationMs) {
-  // clamp relative angle to a reasonable range
-  if (angleDeg < -180.0f) angleDeg = -180.0f;
-  if (angleDeg > 180.0f) angleDeg = 180.0f;
-
-  float target = BASELINE_ANGLE + angleDeg;
-  if (target < 0.0f) target = 0.0f;
-  if (target > 180.0f) target = 180.0f;
-
-  Serial.printf("pulseAngle: target=%0.1f hold=%lu moveDur=%lu\n", target, holdMs, moveDurationMs);
-
-  float start = _currentAngle;
-  const int steps = 20;
-  if (moveDurationMs == 0) moveDurationMs = 500;
-  unsigned long stepDelay = moveDurationMs / (unsigned long)steps;
-
-  s_shadeState = SHADE_MOVING;
-
-  // move to target
-  for (int i = 1; i <= steps; ++i) {
-    float a = start + ((target - start) * (float)i / (float)steps);
-    setServoAngle(a);
-    if (stepDelay >= 1) delay(stepDelay);
+// should take. The motion task runs it; this only queues the command.
+void ShadeController::pulseAngle(float angleDeg, unsigned long holdMs, unsigned long moveDurationMs,
+                                 MotionPriority priority) {
+  motion_cmd_t cmd = motionPulse(angleDeg, holdMs, moveDurationMs, priority);
+
+  Serial.printf("pulseAngle: target=%0.1f hold=%lu moveDur=%lu%s\n", BASELINE_ANGLE + cmd.angleRel,
+                (unsigned long)cmd.holdMs, (unsigned long)cmd.moveMs, priority == MOTION_URGENT ? " (urgent)" : "");
+  if (!_motionQueue || xQueueSend(_motionQueue, &cmd, 0) != pdTRUE) {
+    Serial.println("pulseAngle: motion queue full - command dropped");
   }
+}
 
-  // hold
-  if (holdMs >= 1) delay(holdMs);
-
-  // move back to baseline
-  start = _currentAngle;
-  float baseline = BASELINE_ANGLE;
-  for (int i = 1; i <= steps; ++i) {
-    float a = start + ((baseline - start) * (float)i / (float)steps);
-    setServoAngle(a);
-    if (stepDelay >= 1) delay(stepDelay);
+void ShadeController::stop() {
+  motion_cmd_t cmd;
+  cmd.kind = MOTION_STOP;
+  cmd.priority = MOTION_URGENT;
+  cmd.angleRel = 0.0f;
+  cmd.holdMs = 0;
+  cmd.moveMs = MOTION_STOP_MS;
+  // Ahead of anything still queued
+  if (!_motionQueue || xQueueSendToFront(_motionQueue, &cmd, 0) != pdTRUE) {
+    Serial.println("stop: motion queue full");
   }
+}
 
-  // Set final state according to the direction of the pulse: positive angle => OPEN
-  if (angleDeg > 0.0f) {
-    s_shadeState = SHADE_OPEN;
-  } else {
-    s_shadeState = SHADE_CLOSED;
+void ShadeController::motionTaskEntry(void* pv) {
+  static_cast<ShadeController*>(pv)->motionTask();
+}
+
+// Sole owner of the servo: sleeps until the next servo tick, the end of a
+// hold or a new command, so callers never wait for a move
+void ShadeController::motionTask() {
+  for (;;) {
+    uint32_t wait = _motion.msUntilNextUpdate(millis());
+    motion_cmd_t cmd;
+    if (xQueueReceive(_motionQueue, &cmd, wait == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait)) == pdTRUE) {
+      if (_motion.repeats(cmd)) {
+        Serial.println("Motion: same pulse already in progress - dropped");
+      } else if (_motion.submit(cmd, millis())) {
+        Serial.println(cmd.kind == MOTION_STOP ? "Motion: stopped, returning to baseline"
+                                               : "Motion: preempted by urgent command");
+      }
+      if (_motion.busy()) s_shadeState = SHADE_MOVING;
+    }
+
+    MotionEvent ev = _motion.update(millis());
+    if (_motion.position() != _currentMdeg) setServoPosition(_motion.position());
+
+    switch (ev) {
+      case MOTION_EVT_STARTED:
+        s_shadeState = SHADE_MOVING;
+        break;
+      case MOTION_EVT_DONE:
+        // Final state according to the direction of the pulse: positive angle => OPEN
+        s_shadeState = _motion.current().angleRel > 0.0f ? SHADE_OPEN : SHADE_CLOSED;
+        s_lastActionMillis = millis();
+        Serial.println("pulseAngle: complete, returned to baseline");
+        break;
+      case MOTION_EVT_STOPPED:
+        s_shadeState = SHADE_UNKNOWN;
+        s_lastActionMillis = millis();
+        Serial.println("Motion: stopped at baseline");
+        break;
+      default:
+        break;
+    }
   }
-  s_lastActionMillis = millis();
-  Serial.println("pulseAngle: complete, returned to baseline");
 }
 
 void ShadeController::handleMessage(const uint8_t *data, int len) {
   if (len <= 0 || data == nullptr) return;
 
-  // Check printable
-  bool printable = true;
-  for (int i = 0; i < len; ++i) {
-    if (data[i] < 32 || data[i] > 126) { printable = false; break; }
+  // Frames from the weather station are recognised by their header
+  wire_header_t hdr;
+  WireStatus st = wireParse(data, (size_t)len, hdr);
+  if (st == WIRE_OK) {
+    if (hdr.type != WIRE_MSG_SAMPLES || hdr.count == 0) {
+      Serial.printf("Frame type %u from station %04X ignored\n", hdr.type, hdr.stationId);
+      return;
+    }
+    if (hdr.group != WIRE_GROUP_NONE && hdr.group != WIRE_GROUP_ALL &&
+        hdr.group != _espnowGroup) return;
+    if (!s_dedup.accept(hdr.stationId, hdr.group, hdr.seq, millis())) {
+      Serial.printf("Duplicate frame %lu from station %04X dropped\n", (unsigned long)hdr.seq, hdr.stationId);
+      return;
+    }
+    // Only the newest sample matters for the shade; older ones are backlog
+    sensor_payload_t sample;
+    wireSampleAt(data, hdr, hdr.count - 1, sample);
+    Serial.printf("Frame %lu from station %04X: %u samples (v%u)\n",
+                  (unsigned long)hdr.seq, hdr.stationId, hdr.count, hdr.version);
+    handleSample(sample);
+    return;
+  }
+  if (st != WIRE_NOT_A_FRAME) {
+    Serial.printf("Dropping frame: %s (%d bytes)\n", wireStatusName(st), len);
+    return;
   }
 
   float angle = _defaultAngle;
@@ -127,142 +208,241 @@ void ShadeController::handleMessage(const uint8_t *data, int len) {
   bool doUp = false;
   bool doDown = false;
 
-  if (printable) {
-    String payload = String((const char *)data, len);
-    payload.trim();
-    String lower = payload;
-    lower.toLowerCase();
-    Serial.println("Payload: " + payload);
-
-    if (lower.indexOf("up") != -1 || lower.indexOf("open") != -1 || lower.indexOf("\"command\":\"up\"") != -1) doUp = true;
-    if (lower.indexOf("down") != -1 || lower.indexOf("close") != -1 || lower.indexOf("\"command\":\"down\"") != -1) doDown = true;
-
-    angle = parseNumericValue(lower, "angle", angle);
-    float durF = parseNumericValue(lower, "duration", (float)duration);
-    if (durF > 0) duration = (unsigned long)durF;
-
-    int idx = lower.indexOf("light");
-    if (idx >= 0) {
-      float lightVal = parseNumericValue(lower, "light", -1.0f);
-      Serial.printf("Light sensor: %.1f\n", lightVal);
-      if (lightVal >= 0) {
-        if (!doUp && !doDown) {
-          if (lightVal >= 800) doDown = true;
-          else if (lightVal <= 300) doUp = true;
-        }
-      }
+  // Single-byte binary commands
+  if (len == 1) {
+    if (data[0] == 1 || data[0] == 'U' || data[0] == 'u') {
+      performUp(angle, _upDuration);
+      return;
     }
-
-    if (doUp && doDown) {
-      Serial.println("Ambiguous command: contains both up and down; ignoring.");
+    if (data[0] == 2 || data[0] == 'D' || data[0] == 'd') {
+      performDown(angle, _downDuration);
       return;
     }
+  }
+
+  // Anything else is a text command: keywords anywhere in the payload,
+  // "angle"/"duration"/"light" take the number that follows them
+  Serial.printf("Payload: %.*s\n", len, (const char *)data);
+  CmdTokenizer tok((const char *)data, (size_t)len);
+  cmd_token_t t;
+  CmdKeyword key = KW_NONE;
+  bool haveLight = false;
+  float lightVal = -1.0f;
+  while (tok.next(t)) {
+    if (t.type == TOK_NUMBER) {
+      if (key == KW_ANGLE) angle = t.number;
+      else if (key == KW_DURATION && t.number > 0) duration = (unsigned long)t.number;
+      else if (key == KW_LIGHT) lightVal = t.number;
+    } else if (t.keyword == KW_UP || t.keyword == KW_OPEN) {
+      doUp = true;
+    } else if (t.keyword == KW_DOWN || t.keyword == KW_CLOSE) {
+      doDown = true;
+    } else if (t.keyword == KW_LIGHT) {
+      haveLight = true;
+    }
+    key = t.keyword;
+  }
+
+  if (haveLight) {
+    Serial.printf("Light sensor: %.1f\n", lightVal);
+    if (lightVal >= 0 && !doUp && !doDown) {
+      float in[RULE_INPUT_COUNT];
+      for (uint8_t i = 0; i < RULE_INPUT_COUNT; ++i) in[i] = NAN;
+      in[RULE_IN_CMD_LIGHT] = lightVal;
+      shade_rule_t fired;
+      uint32_t lockMs;
+      rule_decision_t d = evaluateRules(in, fired, lockMs);
+      if (d.verdict == RULE_FIRE) {
+        doUp = d.action == RULE_OPEN;
+        doDown = d.action == RULE_CLOSE;
+      }
+    }
+  }
+
+  if (doUp && doDown) {
+    Serial.println("Ambiguous command: contains both up and down; ignoring.");
+    return;
+  }
 
-    if (doUp) {
-      performUp(angle, duration);
-    } else if (doDown) {
-      performDown(angle, duration);
+  if (doUp) {
+    performUp(angle, duration);
+  } else if (doDown) {
+    performDown(angle, duration);
+  } else {
+    Serial.println("No actionable command in payload; ignoring.");
+  }
+}
+
+void ShadeController::handleSample(const sensor_payload_t &payload) {
+  Serial.printf("Sensor: seq=%u temp=%0.1f hum=%0.1f wind=%0.2f lux=%0.1f\n",
+                payload.seq,
+                isnan(payload.tempC) ? NAN : payload.tempC,
+                isnan(payload.humidity) ? NAN : payload.humidity,
+                payload.wind_kmh,
+                isnan(payload.lux) ? NAN : payload.lux);
+
+  float in[RULE_INPUT_COUNT];
+  in[RULE_IN_TEMP] = payload.tempC;
+  in[RULE_IN_HUMIDITY] = payload.humidity;
+  in[RULE_IN_LUX] = payload.lux;
+  in[RULE_IN_WIND] = payload.wind_kmh;
+  in[RULE_IN_GUST] = payload.wind_gust_kmh;
+  in[RULE_IN_CMD_LIGHT] = NAN;
+
+  shade_rule_t fired;
+  uint32_t lockMs;
+  rule_decision_t d = evaluateRules(in, fired, lockMs);
+
+  if (d.verdict == RULE_NO_DATA) {
+    Serial.println("Policy: rule inputs missing - ignoring sensor-based decision.");
+  } else if (d.verdict == RULE_NO_TRIGGER) {
+    Serial.println("Policy: sensors present but do not trigger action.");
+  } else if (d.verdict == RULE_AMBIGUOUS) {
+    Serial.println("Policy: ambiguous open+close triggers - ignoring.");
+  } else if (d.action == RULE_CLOSE) {
+    // Closing and wind-triggered moves preempt a move in progress
+    if (s_shadeState == SHADE_CLOSED) {
+      Serial.println("Policy: already CLOSED - no action taken.");
+    } else if (millis() - s_lastActionMillis < lockMs) {
+      Serial.println("Policy: action locked - ignoring rapid changes.");
     } else {
-      Serial.println("No actionable command in payload; ignoring.");
+      Serial.printf("Policy: CLOSE triggered (%s %s %.1f) -> performing DOWN\n",
+                    ruleInputName(fired.input), fired.cmp == RULE_GE ? "ge" : "le", fired.threshold);
+      performDown(_defaultAngle, _downDuration, MOTION_URGENT);
     }
   } else {
-    // Binary payloads: interpret as SensorPayload (from weatherStation) or fallback to simple commands
-    Serial.println("Binary payload received");
-
-    if (len >= (int)sizeof(SensorPayload)) {
-      SensorPayload payload;
-      memcpy(&payload, data, sizeof(SensorPayload));
-
-      Serial.printf("Sensor: seq=%u temp=%0.1f hum=%0.1f wind=%0.2f lux=%0.1f\n",
-                    payload.seq,
-                    isnan(payload.tempC) ? NAN : payload.tempC,
-                    isnan(payload.humidity) ? NAN : payload.humidity,
-                    payload.wind_kmh,
-                    isnan(payload.lux) ? NAN : payload.lux);
-
-      bool tempValid = !isnan(payload.tempC);
-      bool luxValid = !isnan(payload.lux);
-
-      if (tempValid || luxValid) {
-        bool triggerOpen = false;
-        bool triggerClose = false;
-
-        if (tempValid) {
-          if (payload.tempC <= CLOSE_TEMP_THRESHOLD) triggerClose = true;
-          if (payload.tempC >= OPEN_TEMP_THRESHOLD)  triggerOpen  = true;
-        }
-        if (luxValid) {
-          if (payload.lux <= CLOSE_LUX_THRESHOLD) triggerClose = true;
-          if (payload.lux >= OPEN_LUX_THRESHOLD)  triggerOpen  = true;
-        }
-
-        if (triggerOpen && triggerClose) {
-          Serial.println("Policy: ambiguous open+close triggers - ignoring.");
-        } else if (triggerClose) {
-          if (s_shadeState == SHADE_CLOSED) {
-            Serial.println("Policy: already CLOSED - no action taken.");
-          } else if (millis() - s_lastActionMillis < STATE_CHANGE_LOCK_MS) {
-            Serial.println("Policy: action locked - ignoring rapid changes.");
-          } else {
-            Serial.println("Policy: CLOSE triggered -> performing DOWN");
-            performDown(_defaultAngle, _downDuration);
-          }
-        } else if (triggerOpen) {
-          if (s_shadeState == SHADE_OPEN) {
-            Serial.println("Policy: already OPEN - no action taken.");
-          } else if (millis() - s_lastActionMillis < STATE_CHANGE_LOCK_MS) {
-            Serial.println("Policy: action locked - ignoring rapid changes.");
-          } else {
-            Serial.println("Policy: OPEN triggered -> performing UP");
-            performUp(_defaultAngle, _upDuration);
-          }
-        } else {
-          Serial.println("Policy: sensors present but do not trigger action.");
-        }
-      } else {
-        Serial.println("Policy: temp and lux missing - ignoring sensor-based decision.");
-      }
+    if (s_shadeState == SHADE_OPEN) {
+      Serial.println("Policy: already OPEN - no action taken.");
+    } else if (millis() - s_lastActionMillis < lockMs) {
+      Serial.println("Policy: action locked - ignoring rapid changes.");
     } else {
-      if (data[0] == 1 || data[0] == 'U' || data[0] == 'u') {
-        duration = _upDuration;
-        performUp(angle, duration);
-      } else if (data[0] == 2 || data[0] == 'D' || data[0] == 'd') {
-        duration = _downDuration;
-        performDown(angle, duration);
-      } else {
-        Serial.printf("Unknown binary command: 0x%02X\n", data[0]);
-      }
+      Serial.printf("Policy: OPEN triggered (%s %s %.1f) -> performing UP\n",
+                    ruleInputName(fired.input), fired.cmp == RULE_GE ? "ge" : "le", fired.threshold);
+      bool wind = fired.input == RULE_IN_WIND || fired.input == RULE_IN_GUST;
+      performUp(_defaultAngle, _upDuration, wind ? MOTION_URGENT : MOTION_NORMAL);
     }
   }
 }
 
-void ShadeController::performUp(float angle, unsigned long durationMs) {
+// Samples arrive from the ESP-NOW (WiFi) task and the loop task; the rule
+// state is only touched under the lock, and loadRules swaps tables under it.
+rule_decision_t ShadeController::evaluateRules(const float in[RULE_INPUT_COUNT], shade_rule_t &fired, uint32_t &lockMs) {
+  portENTER_CRITICAL(&_rulesMux);
+  RuleTable &table = _rules[_activeRules];
+  rule_decision_t d = table.evaluate(in, millis());
+  if (d.verdict == RULE_FIRE) fired = table.rule(d.rule);
+  lockMs = table.lockMs();
+  portEXIT_CRITICAL(&_rulesMux);
+  return d;
+}
+
+bool ShadeController::loadRules(const char *text, size_t len) {
+  shade_rule_t rules[RULE_MAX];
+  size_t count = 0;
+  uint32_t lockMs = SHADE_DEFAULT_LOCK_MS;
+  const char *errorAt = text;
+  RuleParseStatus st = parseRules(text, len, rules, RULE_MAX, count, lockMs, errorAt);
+  if (st != RULES_OK) {
+    Serial.printf("Rules rejected: %s at offset %u, keeping current rules\n",
+                  ruleParseStatusName(st), (unsigned)(errorAt - text));
+    return false;
+  }
+
+  // Only the loop task loads rules, so the inactive table is ours to fill
+  uint8_t next = _activeRules ^ 1;
+  bool ok = count == 0
+    ? _rules[next].compile(SHADE_DEFAULT_RULES, sizeof(SHADE_DEFAULT_RULES) / sizeof(SHADE_DEFAULT_RULES[0]), lockMs)
+    : _rules[next].compile(rules, count, lockMs);
+  if (!ok) {
+    Serial.println("Rules rejected: invalid rule, keeping current rules");
+    return false;
+  }
+  portENTER_CRITICAL(&_rulesMux);
+  _activeRules = next;
+  portEXIT_CRITICAL(&_rulesMux);
+  Serial.printf("Rules loaded: %u rules%s, lock %lu ms\n", (unsigned)_rules[next].size(),
+                count == 0 ? " (built-in)" : "", (unsigned long)lockMs);
+  return true;
+}
+
+void ShadeController::printRules() {
+  const RuleTable &table = _rules[_activeRules];
+  Serial.printf("Rules (lock %lu ms):\n", (unsigned long)table.lockMs());
+  for (uint8_t i = 0; i < table.size(); ++i) {
+    const shade_rule_t &r = table.rule(i);
+    Serial.printf("  %s %s %s %.1f hyst %.1f dwell %lu prio %u\n",
+                  r.action == RULE_OPEN ? "open" : "close", ruleInputName(r.input),
+                  r.cmp == RULE_GE ? "ge" : "le", r.threshold, r.hysteresis,
+                  (unsigned long)r.dwellMs, (unsigned)r.priority);
+  }
+}
+
+// Repeats of the move in progress are dropped by the motion task
+// (MotionExecutor::repeats), where commands from every task are serialized.
+void ShadeController::performUp(float angle, unsigned long durationMs, MotionPriority priority) {
   // Treat angle as relative to baseline and durationMs as the hold time at the
   // target. Use a short movement duration for the motion itself.
-  if (s_shadeState == SHADE_MOVING) {
-    Serial.println("performUp: already MOVING - skipping");
-    return;
-  }
   Serial.printf("performUp: pulsing baseline +%0.1f for %lu ms\n", angle, durationMs);
   const unsigned long moveDur = 500UL;
-  pulseAngle(angle, durationMs, moveDur);
+  pulseAngle(angle, durationMs, moveDur, priority);
 }
 
-void ShadeController::performDown(float angle, unsigned long durationMs) {
+void ShadeController::performDown(float angle, unsigned long durationMs, MotionPriority priority) {
   // Treat angle as relative to baseline and durationMs as the hold time at the
   // target. Use a short movement duration for the motion itself.
-  if (s_shadeState == SHADE_MOVING) {
-    Serial.println("performDown: already MOVING - skipping");
-    return;
-  }
   Serial.printf("performDown: pulsing baseline -%0.1f for %lu ms\n", angle, durationMs);
   const unsigned long moveDur = 500UL;
-  pulseAngle(-angle, durationMs, moveDur);
+  pulseAngle(-angle, durationMs, moveDur, priority);
 }
  
 bool ShadeController::isOpen() {
   return s_shadeState == SHADE_OPEN;
 }
+
+void ShadeController::handleMqttField(const char *key, const uint8_t *value, unsigned int len) {
+  sensor_payload_t sample;
+  bool ready = false;
+  uint32_t now = millis();
+
+  if (strcasecmp(key, "update") == 0) {
+    ready = _snapshot.marker(sample);
+  } else {
+    const mqtt_field_t *f = NULL;
+    for (size_t i = 0; i < sizeof(MQTT_FIELDS) / sizeof(MQTT_FIELDS[0]); ++i) {
+      if (strcasecmp(key, MQTT_FIELDS[i].key) == 0) { f = &MQTT_FIELDS[i]; break; }
+    }
+    if (!f) return; // unknown topic suffix (batch, gps, ...)
+
+    // "null", "nan" or an empty payload leave the field NaN
+    CmdTokenizer tok((const char *)value, len);
+    if (f->field == SNAP_SEQ) {
+      uint32_t seq = 0;
+      tok.nextInteger(seq);
+      ready = _snapshot.sequence(seq, now, sample);
+    } else {
+      float v = NAN;
+      tok.nextNumber(v);
+      ready = _snapshot.field(f->field, v, now, sample);
+    }
+  }
+  if (ready) handleSample(sample);
+}
+
+void ShadeController::pollSnapshot() {
+  sensor_payload_t sample;
+  if (_snapshot.poll(millis(), sample)) handleSample(sample);
+}
+
+void ShadeController::printLinkStats() {
+  const reliable_rx_stats_t &st = s_dedup.stats();
+  Serial.printf("ESP-NOW: %lu frames accepted, %lu duplicates dropped, %lu missing, %lu station restarts\n",
+                (unsigned long)st.accepted, (unsigned long)st.duplicates,
+                (unsigned long)st.missing, (unsigned long)st.restarts);
+  const snapshot_stats_t &ss = _snapshot.stats();
+  Serial.printf("MQTT: %lu samples complete, %lu partial, %lu late dropped (%lu field messages)\n",
+                (unsigned long)ss.complete, (unsigned long)ss.partial,
+                (unsigned long)ss.late, (unsigned long)ss.fields);
+}
  
 // ESP-NOW receive callback
 void onDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
@@ -1,11 +1,13 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <PubSubClient.h>
+#include <esp_now.h>
 #include "ShadeController.h"
 #include "CommandProcessor.h"
 #include "secret.h"
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 // Default pin for MG90 servo
 const int SERVO_PIN = 4;
@@ -15,6 +17,10 @@ const float DEFAULT_ANGLE = 90.0f;
 const unsigned long DEFAULT_UP_DURATION = 5000UL;   // 5s
 const unsigned long DEFAULT_DOWN_DURATION = 10000UL; // 10s
 
+// Group of this actuator in the station's peer table (espnowPeers); 0 when
+// it is reached by unicast only
+const uint8_t ESPNOW_GROUP = 1;
+
 // define the extern from the header
 ShadeController *gShadeController = nullptr;
 
@@ -32,61 +38,49 @@ static const uint16_t MQTT_PORT = secret::MQTT_PORT;
 static const char* MQTT_USER = secret::MQTT_USER;
 static const char* MQTT_PASS = secret::MQTT_PASS;
 static const char* MQTT_TOPIC_BASE = secret::MQTT_TOPIC_BASE;
+static const char* MQTT_MOTOR_TOPIC = "homestations/1051804/0/motor";
 
-// Running copy of latest sensor values (shared SensorPayload struct from ShadeController.h)
-static SensorPayload gLatestPayload;
 static unsigned long lastMqttReconnectAttempt = 0;
 
-// MQTT message callback: update the running sensor struct and hand it to the ShadeController
+// Serial command line, filled without blocking; longer lines are truncated
+static const size_t SERIAL_LINE_MAX = 128;
+static char gSerialLine[SERIAL_LINE_MAX];
+static size_t gSerialLineLen = 0;
+
+// MQTT message callback: motor toggles go straight to the ShadeController,
+// station fields are assembled into one sample before the policy runs
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  String t = String(topic);
-  String msg;
-  if (length > 0) msg = String((char*)payload, length); else msg = "";
-  msg.trim();
-  int idx = t.lastIndexOf('/');
-  String key = (idx >= 0) ? t.substring(idx + 1) : t;
-  key.toLowerCase();
+  const char* slash = strrchr(topic, '/');
+  const char* key = slash ? slash + 1 : topic;
 
   // Special-case: motor topic toggles shade open/close when payload == "1"
-  if (t.equalsIgnoreCase("homestations/1051804/0/motor") || t.endsWith("/motor")) {
-    Serial.printf("MQTT motor topic: %s -> %s\n", topic, msg.c_str());
-    if (msg.equals("1")) {
+  if (strcasecmp(key, "motor") == 0) {
+    Serial.printf("MQTT motor topic: %s -> %.*s\n", topic, (int)length, (const char*)payload);
+    if (length == 1 && payload[0] == '1') {
       if (gShadeController) {
         if (gShadeController->isOpen()) {
           Serial.println("MQTT: motor=1 -> currently OPEN, sending CLOSE");
-          String cmd = "close";
-          gShadeController->handleMessage((const uint8_t*)cmd.c_str(), cmd.length());
+          static const char cmd[] = "close";
+          gShadeController->handleMessage((const uint8_t*)cmd, sizeof(cmd) - 1);
         } else {
           Serial.println("MQTT: motor=1 -> currently CLOSED/UNKNOWN, sending OPEN");
-          String cmd = "open";
-          gShadeController->handleMessage((const uint8_t*)cmd.c_str(), cmd.length());
+          static const char cmd[] = "open";
+          gShadeController->handleMessage((const uint8_t*)cmd, sizeof(cmd) - 1);
         }
       }
     } else {
-      Serial.printf("MQTT motor: payload '%s' ignored\n", msg.c_str());
+      Serial.printf("MQTT motor: payload '%.*s' ignored\n", (int)length, (const char*)payload);
     }
     return;
   }
 
-  bool isNull = msg.equalsIgnoreCase("null") || msg.equalsIgnoreCase("nan") || msg.length() == 0;
-
-  if (key == "temperature") {
-    if (isNull) gLatestPayload.tempC = NAN; else gLatestPayload.tempC = msg.toFloat();
-  } else if (key == "humidity") {
-    if (isNull) gLatestPayload.humidity = NAN; else gLatestPayload.humidity = msg.toFloat();
-  } else if (key == "windspeed") {
-    if (isNull) gLatestPayload.wind_kmh = NAN; else gLatestPayload.wind_kmh = msg.toFloat();
-  } else if (key == "light") {
-    if (isNull) gLatestPayload.lux = NAN; else gLatestPayload.lux = msg.toFloat();
-  } else {
-    // unknown topic suffix - ignore
+  // Retained policy rules (ShadeRules.h text form)
+  if (strcasecmp(key, "rules") == 0) {
+    if (gShadeController) gShadeController->loadRules((const char*)payload, length);
+    return;
   }
 
-  Serial.printf("MQTT recv: %s = %s\n", topic, msg.c_str());
-
-  if (gShadeController) {
-    gShadeController->handleMessage((const uint8_t*)&gLatestPayload, sizeof(gLatestPayload));
-  }
+  if (gShadeController) gShadeController->handleMqttField(key, payload, length);
 }
 
 // Try to connect to MQTT broker and subscribe to sensor topics
@@ -102,17 +96,14 @@ void mqttReconnect() {
   id.toCharArray(clientId, sizeof(clientId));
   if (mqttClient.connect(clientId, MQTT_USER, MQTT_PASS)) {
     Serial.println("MQTT connected");
+    // Every station field plus its update marker (and the motor topic when
+    // it lives under the same base)
     char topic[64];
-    snprintf(topic, sizeof(topic), "%s/Temperature", MQTT_TOPIC_BASE);
-    mqttClient.subscribe(topic);
-    snprintf(topic, sizeof(topic), "%s/Humidity", MQTT_TOPIC_BASE);
-    mqttClient.subscribe(topic);
-    snprintf(topic, sizeof(topic), "%s/Windspeed", MQTT_TOPIC_BASE);
-    mqttClient.subscribe(topic);
-    snprintf(topic, sizeof(topic), "%s/Light", MQTT_TOPIC_BASE);
+    snprintf(topic, sizeof(topic), "%s/+", MQTT_TOPIC_BASE);
     mqttClient.subscribe(topic);
     // Subscribe to motor control topic used externally
-    mqttClient.subscribe("homestations/1051804/0/motor");
+    snprintf(topic, sizeof(topic), "%s/motor", MQTT_TOPIC_BASE);
+    if (strcmp(topic, MQTT_MOTOR_TOPIC) != 0) mqttClient.subscribe(MQTT_MOTOR_TOPIC);
   } else {
     Serial.printf("MQTT connect failed, rc=%d\n", mqttClient.state());
   }
@@ -124,7 +115,8 @@ void setup() {
   WiFi.disconnect();
 
   // create controller instance with servo pin
-  gShadeController = new ShadeController(SERVO_PIN, DEFAULT_ANGLE, DEFAULT_UP_DURATION, DEFAULT_DOWN_DURATION);
+  gShadeController = new ShadeController(SERVO_PIN, DEFAULT_ANGLE, DEFAULT_UP_DURATION, DEFAULT_DOWN_DURATION,
+                                        ESPNOW_GROUP);
   gShadeController->begin();
 
   // create command processor and hand it the controller
@@ -145,21 +137,28 @@ void setup() {
     Serial.println("WiFi not connected (will retry in loop)");
   }
  
-  // initialize latest payload to NaN
-  gLatestPayload.tempC = NAN;
-  gLatestPayload.humidity = NAN;
-  gLatestPayload.lux = NAN;
-  gLatestPayload.wind_kmh = NAN;
- 
   mqttReconnect();
 
+  // Sensor frames from the weather station (handled in ShadeController)
+  if (esp_now_init() == ESP_OK) {
+    esp_now_register_recv_cb(onDataRecv);
+    Serial.println("ESP-NOW receiver ready");
+  } else {
+    Serial.println("ESP-NOW init failed");
+  }
+
   Serial.println("Ready. Type HELP for commands.");
 }
 
 void loop() {
-  if (Serial.available()) {
-    String line = Serial.readStringUntil('\n');
-    if (gCommandProcessor) gCommandProcessor->processLine(line);
+  while (Serial.available()) {
+    char c = (char)Serial.read();
+    if (c == '\n') {
+      if (gCommandProcessor) gCommandProcessor->processLine(gSerialLine, gSerialLineLen);
+      gSerialLineLen = 0;
+    } else if (gSerialLineLen < SERIAL_LINE_MAX) {
+      gSerialLine[gSerialLineLen++] = c;
+    }
   }
 
   // Maintain MQTT connection & process incoming messages
@@ -169,6 +168,7 @@ void loop() {
     } else {
       mqttClient.loop();
     }
+    if (gShadeController) gShadeController->pollSnapshot();
   } else {
     // Attempt to reconnect WiFi periodically
     static unsigned long lastWifiAttempt = 0;
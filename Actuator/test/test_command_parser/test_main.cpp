@@ -0,0 +1,262 @@
+#include <unity.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "CommandParser.h"
+
+// Parsed form of one command line, as CommandProcessor sees it
+typedef struct {
+  CmdKeyword kw;
+  float num[4];
+  uint32_t seq;
+} parsed_t;
+
+static void clearParsed(parsed_t &p) {
+  p.kw = KW_NONE;
+  for (float &f : p.num) f = NAN;
+  p.seq = 0;
+}
+
+// The strtok/atof parser CommandProcessor::processLine used before
+// CmdTokenizer (String replaced by std::string, same steps)
+static parsed_t oldParse(const char* line) {
+  parsed_t p;
+  clearParsed(p);
+  char buf[256];
+  strncpy(buf, line, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+  char* tok = strtok(buf, " \t");
+  if (!tok) return p;
+  std::string cmd(tok);
+  for (char &c : cmd) c = (char)toupper((unsigned char)c);
+
+  if (cmd == "SENSOR") {
+    p.kw = KW_SENSOR;
+    for (int i = 0; i < 4; ++i) {
+      tok = strtok(NULL, " \t");
+      if (tok) p.num[i] = (strcmp(tok, "NaN") == 0 || strcmp(tok, "nan") == 0) ? NAN : atof(tok);
+    }
+    tok = strtok(NULL, " \t");
+    if (tok) p.seq = (uint32_t)strtoul(tok, NULL, 10);
+    return p;
+  }
+  if (cmd == "UP") p.kw = KW_UP;
+  else if (cmd == "DOWN") p.kw = KW_DOWN;
+  else if (cmd == "OPEN") p.kw = KW_OPEN;
+  else if (cmd == "CLOSE") p.kw = KW_CLOSE;
+  else if (cmd == "PULSE") p.kw = KW_PULSE;
+  else return p;
+  tok = strtok(NULL, " \t");
+  if (tok) p.num[0] = atof(tok);
+  for (int i = 1; i < 3; ++i) {
+    tok = strtok(NULL, " \t");
+    if (tok) p.num[i] = (float)strtoul(tok, NULL, 10);
+  }
+  return p;
+}
+
+static parsed_t newParse(const char* line, size_t len) {
+  parsed_t p;
+  clearParsed(p);
+  CmdTokenizer args(line, len);
+  cmd_token_t cmd;
+  if (!args.next(cmd)) return p;
+  switch (cmd.keyword) {
+    case KW_SENSOR:
+      for (int i = 0; i < 4; ++i) args.nextNumber(p.num[i]);
+      args.nextInteger(p.seq);
+      break;
+    case KW_UP: case KW_DOWN: case KW_OPEN: case KW_CLOSE: case KW_PULSE: {
+      args.nextNumber(p.num[0]);
+      for (int i = 1; i < 3; ++i) {
+        uint32_t v;
+        if (args.nextInteger(v)) p.num[i] = (float)v;
+      }
+      break;
+    }
+    default:
+      return p;
+  }
+  p.kw = cmd.keyword;
+  return p;
+}
+
+static bool sameNumber(float a, float b) {
+  if (std::isnan(a) || std::isnan(b)) return std::isnan(a) && std::isnan(b);
+  return std::fabs(a - b) <= 1e-4f * (1.0f + std::fabs(a));
+}
+
+// Well-formed command lines as typed on the Serial console
+static std::string randomCommand(std::mt19937 &rng) {
+  static const char* const CMDS[] = { "UP", "down", "Open", "CLOSE", "pulse", "SENSOR" };
+  std::uniform_int_distribution<int> pick(0, 5), digits(0, 99999), frac(0, 99), coin(0, 3);
+  const char* cmd = CMDS[pick(rng)];
+  std::string line = cmd;
+  char num[32];
+  if (strcasecmp(cmd, "sensor") == 0) {
+    for (int i = 0; i < 4; ++i) {
+      if (coin(rng) == 0) line += " NaN";
+      else {
+        snprintf(num, sizeof(num), " %s%d.%02d", coin(rng) == 0 ? "-" : "", digits(rng) % 500, frac(rng));
+        line += num;
+      }
+    }
+    snprintf(num, sizeof(num), " %d", digits(rng));
+    line += num;
+  } else {
+    int args = coin(rng);
+    if (args > 0) {
+      snprintf(num, sizeof(num), " %d.%d", digits(rng) % 180, frac(rng) % 10);
+      line += num;
+    }
+    for (int i = 1; i < args; ++i) {
+      snprintf(num, sizeof(num), "%s%d", coin(rng) == 0 ? "\t" : " ", digits(rng));
+      line += num;
+    }
+  }
+  return line;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_tokens(void) {
+  const char line[] = "pulse -12.5 3000 .5 seq_no x";
+  CmdTokenizer tok(line, sizeof(line) - 1);
+  cmd_token_t t;
+  TEST_ASSERT_TRUE(tok.next(t));
+  TEST_ASSERT_EQUAL(KW_PULSE, t.keyword);
+  TEST_ASSERT_TRUE(tok.next(t));
+  TEST_ASSERT_EQUAL(TOK_NUMBER, t.type);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, -12.5f, t.number);
+  TEST_ASSERT_TRUE(tok.next(t));
+  TEST_ASSERT_EQUAL_UINT32(3000, t.integer);
+  TEST_ASSERT_TRUE(tok.next(t));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, t.number);
+  TEST_ASSERT_TRUE(tok.next(t));
+  TEST_ASSERT_EQUAL(TOK_WORD, t.type);
+  TEST_ASSERT_EQUAL(KW_NONE, t.keyword);
+  TEST_ASSERT_EQUAL(6, t.len);
+  TEST_ASSERT_TRUE(tok.next(t));
+  TEST_ASSERT_FALSE(tok.next(t));
+  TEST_ASSERT_EQUAL(TOK_END, t.type);
+}
+
+void test_json_and_colon_forms(void) {
+  const char* forms[] = { "UP 45 5000", "up angle:45 duration:5000",
+                          "{\"command\":\"up\",\"angle\":45,\"duration\":5000}" };
+  for (const char* f : forms) {
+    CmdTokenizer tok(f, strlen(f));
+    cmd_token_t t;
+    float angle = 0;
+    uint32_t dur = 0;
+    bool up = false;
+    while (tok.next(t)) {
+      if (t.keyword == KW_UP) up = true;
+      if (t.type == TOK_NUMBER) { if (angle == 0) angle = t.number; else dur = t.integer; }
+    }
+    TEST_ASSERT_TRUE(up);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 45.0f, angle);
+    TEST_ASSERT_EQUAL_UINT32(5000, dur);
+  }
+}
+
+void test_saturates_long_integers(void) {
+  const char line[] = "99999999999999999999";
+  CmdTokenizer tok(line, sizeof(line) - 1);
+  uint32_t v = 0;
+  TEST_ASSERT_TRUE(tok.nextInteger(v));
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, v);
+}
+
+// Random bytes: tokens stay inside the input, move forward, and are well formed
+void test_fuzz_random_bytes(void) {
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> lenDist(0, 64), byteDist(0, 255), alphabet(0, 15);
+  static const char NEAR_MISS[] = "+-._: 09azAZ\t\"{";
+  for (int iter = 0; iter < 200000; ++iter) {
+    size_t len = (size_t)lenDist(rng);
+    // Exactly len bytes on the heap, so a read past the end shows up under ASan
+    std::vector<char> buf(len);
+    for (char &c : buf) c = (char)(iter & 1 ? byteDist(rng) : NEAR_MISS[alphabet(rng)]);
+    const char* begin = buf.data();
+    const char* end = begin + len;
+
+    CmdTokenizer tok(begin, len);
+    cmd_token_t t;
+    const char* prevEnd = begin;
+    size_t count = 0;
+    while (tok.next(t)) {
+      TEST_ASSERT_TRUE(t.text >= prevEnd);
+      TEST_ASSERT_TRUE(t.len > 0);
+      TEST_ASSERT_TRUE(t.text + t.len <= end);
+      if (t.type == TOK_WORD) {
+        TEST_ASSERT_TRUE(isalpha((unsigned char)t.text[0]));
+        TEST_ASSERT_EQUAL(cmdKeyword(t.text, t.len), t.keyword);
+      } else {
+        TEST_ASSERT_EQUAL(TOK_NUMBER, t.type);
+        TEST_ASSERT_FALSE(std::isnan(t.number));
+        std::string s(t.text, t.len);
+        if (t.integer < UINT32_MAX) TEST_ASSERT_TRUE(sameNumber((float)strtod(s.c_str(), NULL), t.number));
+      }
+      prevEnd = t.text + t.len;
+      TEST_ASSERT_TRUE(++count <= len);
+    }
+    TEST_ASSERT_TRUE(t.text == end);
+    TEST_ASSERT_EQUAL(0, tok.restLen());
+  }
+}
+
+// Console commands parse to the same values as with the old parser
+void test_matches_old_parser(void) {
+  std::mt19937 rng(42);
+  for (int iter = 0; iter < 50000; ++iter) {
+    std::string line = randomCommand(rng);
+    parsed_t a = oldParse(line.c_str());
+    parsed_t b = newParse(line.data(), line.size());
+    TEST_ASSERT_EQUAL_MESSAGE(a.kw, b.kw, line.c_str());
+    for (int i = 0; i < 4; ++i) TEST_ASSERT_TRUE_MESSAGE(sameNumber(a.num[i], b.num[i]), line.c_str());
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(a.seq, b.seq, line.c_str());
+  }
+}
+
+void test_parse_cost(void) {
+  const int LINES = 2000, ROUNDS = 50;
+  std::mt19937 rng(7);
+  std::vector<std::string> lines;
+  for (int i = 0; i < LINES; ++i) lines.push_back(randomCommand(rng));
+
+  float sinkOld = 0, sinkNew = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < ROUNDS; ++r)
+    for (const std::string &l : lines) sinkOld += oldParse(l.c_str()).num[1];
+  auto t1 = std::chrono::steady_clock::now();
+  for (int r = 0; r < ROUNDS; ++r)
+    for (const std::string &l : lines) sinkNew += newParse(l.data(), l.size()).num[1];
+  auto t2 = std::chrono::steady_clock::now();
+
+  double n = (double)LINES * ROUNDS;
+  double oldNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+  double newNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / n;
+  char msg[128];
+  snprintf(msg, sizeof(msg), "strtok/atof %.1f ns per line, CmdTokenizer %.1f ns (%.1fx, sink %d)",
+           oldNs, newNs, oldNs / newNs, (int)std::isnan(sinkOld + sinkNew));
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_tokens);
+  RUN_TEST(test_json_and_colon_forms);
+  RUN_TEST(test_saturates_long_integers);
+  RUN_TEST(test_fuzz_random_bytes);
+  RUN_TEST(test_matches_old_parser);
+  RUN_TEST(test_parse_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,324 @@
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CommandParser.h"
+#include "MotionExecutor.h"
+
+// ShadeController::motionTask on a fake millisecond clock: the task sleeps
+// for msUntilNextUpdate() or until the next command arrives, submits it
+// (unless it repeats the move in progress) and writes the servo when the
+// position changed.
+typedef struct {
+  uint32_t at;
+  motion_cmd_t cmd;
+} arrival_t;
+
+typedef struct {
+  uint32_t at;
+  int32_t mdeg;
+} write_t;
+
+typedef struct {
+  uint32_t at;
+  MotionEvent ev;
+} event_t;
+
+static std::vector<write_t> writes;
+static std::vector<event_t> events;
+static uint32_t wakeups;
+
+static const float BASELINE = 90.0f;
+
+static motion_cmd_t pulse(float angleRel, uint32_t holdMs, uint32_t moveMs,
+                          MotionPriority priority = MOTION_NORMAL) {
+  motion_cmd_t c;
+  c.kind = MOTION_PULSE;
+  c.priority = priority;
+  c.angleRel = angleRel;
+  c.holdMs = holdMs;
+  c.moveMs = moveMs;
+  return c;
+}
+
+static motion_cmd_t stopCmd(uint32_t moveMs) {
+  motion_cmd_t c = pulse(0.0f, 0, moveMs, MOTION_URGENT);
+  c.kind = MOTION_STOP;
+  return c;
+}
+
+static void runTask(MotionExecutor &m, std::deque<arrival_t> arrivals, uint32_t until) {
+  writes.clear();
+  events.clear();
+  wakeups = 0;
+  uint32_t now = 0;
+  int32_t last = m.position();
+  while (now < until) {
+    uint32_t wait = m.msUntilNextUpdate(now);
+    uint32_t wake = wait == UINT32_MAX ? until : now + wait;
+    if (!arrivals.empty() && arrivals.front().at <= wake) {
+      if (arrivals.front().at > now) now = arrivals.front().at;
+      motion_cmd_t cmd = arrivals.front().cmd;
+      arrivals.pop_front();
+      if (!m.repeats(cmd)) m.submit(cmd, now);
+    } else {
+      now = wake;
+    }
+    wakeups++;
+    MotionEvent ev = m.update(now);
+    if (m.position() != last) {
+      last = m.position();
+      writes.push_back({now, last});
+    }
+    if (ev != MOTION_EVT_NONE) events.push_back({now, ev});
+  }
+}
+
+// First servo write at or after t
+static const write_t* writeFrom(uint32_t t) {
+  for (const write_t &w : writes)
+    if (w.at >= t) return &w;
+  return nullptr;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_pulse_timeline(void) {
+  MotionExecutor m(BASELINE);
+  runTask(m, {{0, pulse(90.0f, 1000, 500)}}, 5000);
+
+  TEST_ASSERT_EQUAL(1, events.size());
+  TEST_ASSERT_EQUAL(MOTION_EVT_DONE, events[0].ev);
+  TEST_ASSERT_EQUAL_UINT32(2000, events[0].at);
+  TEST_ASSERT_EQUAL_INT32(90000, m.position());
+
+  // One write per servo tick while moving, none during the hold
+  uint32_t prev = 0;
+  bool reachedTarget = false;
+  for (const write_t &w : writes) {
+    if (w.mdeg == 180000) reachedTarget = true;
+    TEST_ASSERT_FALSE(w.at > 500 && w.at < 1500);
+    if (w.at <= 500 || prev >= 1500) TEST_ASSERT_TRUE(w.at - prev <= MOTION_TICK_MS);
+    prev = w.at;
+  }
+  TEST_ASSERT_TRUE(reachedTarget);
+  // Idle: the task sleeps until the next command instead of polling
+  TEST_ASSERT_TRUE(wakeups < 2 * (1000 / MOTION_TICK_MS) + 10);
+}
+
+void test_urgent_preempts_within_one_tick(void) {
+  // Open and hold for 5 s; a wind close arrives during the hold
+  MotionExecutor m(BASELINE);
+  const uint32_t arrive = 1234;
+  runTask(m, {{0, pulse(90.0f, 5000, 500)}, {arrive, pulse(-90.0f, 1000, 500, MOTION_URGENT)}}, 10000);
+
+  const write_t* w = writeFrom(arrive);
+  TEST_ASSERT_NOT_NULL(w);
+  TEST_ASSERT_TRUE(w->at - arrive <= MOTION_TICK_MS);
+  TEST_ASSERT_TRUE(w->mdeg < 180000);
+
+  // The open pulse never completes; the close does, from where it was cut off
+  TEST_ASSERT_EQUAL(1, events.size());
+  TEST_ASSERT_EQUAL(MOTION_EVT_DONE, events[0].ev);
+  TEST_ASSERT_EQUAL_UINT32(arrive + 2000, events[0].at);
+  TEST_ASSERT_TRUE(m.current().angleRel < 0.0f);
+}
+
+void test_normal_waits_and_latest_wins(void) {
+  MotionExecutor m(BASELINE);
+  runTask(m, {{0, pulse(90.0f, 1000, 500)},
+              {100, pulse(-90.0f, 1000, 500)},
+              {200, pulse(-45.0f, 1000, 500)}}, 10000);
+
+  TEST_ASSERT_EQUAL(3, events.size());
+  TEST_ASSERT_EQUAL(MOTION_EVT_DONE, events[0].ev);
+  TEST_ASSERT_EQUAL(MOTION_EVT_STARTED, events[1].ev);
+  TEST_ASSERT_EQUAL_UINT32(events[0].at, events[1].at);
+  TEST_ASSERT_EQUAL(MOTION_EVT_DONE, events[2].ev);
+  TEST_ASSERT_EQUAL_UINT32(4000, events[2].at);
+
+  bool reachedReplaced = false, reachedLatest = false;
+  for (const write_t &w : writes) {
+    if (w.mdeg == 0) reachedReplaced = true;
+    if (w.mdeg == 45000) reachedLatest = true;
+  }
+  TEST_ASSERT_FALSE(reachedReplaced);
+  TEST_ASSERT_TRUE(reachedLatest);
+}
+
+void test_repeated_pulse_is_dropped(void) {
+  // The policy re-issues its decision on every sample while the move runs
+  MotionExecutor m(BASELINE);
+  motion_cmd_t close = pulse(-90.0f, 1000, 500, MOTION_URGENT);
+  runTask(m, {{0, close}, {300, close}, {1000, close}, {1700, close}}, 10000);
+
+  TEST_ASSERT_EQUAL(1, events.size());
+  TEST_ASSERT_EQUAL(MOTION_EVT_DONE, events[0].ev);
+  TEST_ASSERT_EQUAL_UINT32(2000, events[0].at);
+
+  // A different pulse is not a repeat
+  TEST_ASSERT_FALSE(m.repeats(close));
+  TEST_ASSERT_FALSE(m.submit(pulse(90.0f, 0, 100), 0));
+  TEST_ASSERT_TRUE(m.repeats(pulse(90.0f, 0, 100)));
+  TEST_ASSERT_FALSE(m.repeats(close));
+  TEST_ASSERT_FALSE(m.repeats(stopCmd(100)));
+}
+
+void test_stop_returns_to_baseline(void) {
+  MotionExecutor m(BASELINE);
+  runTask(m, {{0, pulse(90.0f, 5000, 500)}, {700, stopCmd(300)}}, 10000);
+
+  TEST_ASSERT_EQUAL(1, events.size());
+  TEST_ASSERT_EQUAL(MOTION_EVT_STOPPED, events[0].ev);
+  TEST_ASSERT_EQUAL_UINT32(1000, events[0].at);
+  TEST_ASSERT_EQUAL_INT32(90000, m.position());
+  TEST_ASSERT_FALSE(m.busy());
+}
+
+// Host cost of the motion task's work per wake-up: submit() plus update()
+void test_update_cost(void) {
+  const uint32_t PULSES = 20000;
+  MotionExecutor m(BASELINE);
+  uint32_t now = 0, calls = 0;
+  int64_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < PULSES; ++i) {
+    m.submit(pulse((i & 1) ? 60.0f : -60.0f, 0, 200, MOTION_URGENT), now);
+    while (m.busy()) {
+      now += MOTION_TICK_MS;
+      m.update(now);
+      sink += m.position();
+      calls++;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%u updates, %.1f ns per update (sink %lld)",
+           (unsigned)calls, ns, (long long)(sink & 0xFF));
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(calls > PULSES * 2 * (200 / MOTION_TICK_MS));
+  TEST_ASSERT_TRUE(ns < 10000.0);
+}
+
+// Bounded FIFO with a zero-wait send, standing in for the FreeRTOS motion
+// queue (xQueueSend(.., 0) in pulseAngle)
+class MotionQueue {
+public:
+  explicit MotionQueue(size_t cap) : _cap(cap) {}
+
+  bool trySend(const motion_cmd_t &cmd) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_q.size() >= _cap) return false;
+    _q.push_back(cmd);
+    _ready.notify_one();
+    return true;
+  }
+
+  bool receive(motion_cmd_t &cmd, uint32_t waitMs) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!_ready.wait_for(lock, std::chrono::milliseconds(waitMs), [this] { return !_q.empty(); })) return false;
+    cmd = _q.front();
+    _q.pop_front();
+    return true;
+  }
+
+private:
+  size_t _cap;
+  std::deque<motion_cmd_t> _q;
+  std::mutex _mutex;
+  std::condition_variable _ready;
+};
+
+// Text command to queued pulse, as handleMessage -> performUp/performDown ->
+// pulseAngle does it
+static bool commandToQueue(const char* text, MotionQueue &q) {
+  CmdTokenizer tok(text, strlen(text));
+  cmd_token_t t;
+  CmdKeyword key = KW_NONE;
+  float angle = 90.0f;
+  uint32_t hold = 5000;
+  int dir = 0;
+  while (tok.next(t)) {
+    if (t.type == TOK_NUMBER) {
+      if (key == KW_ANGLE) angle = t.number;
+      else if (key == KW_DURATION && t.number > 0) hold = t.integer;
+    } else if (t.keyword == KW_UP || t.keyword == KW_OPEN) {
+      dir = 1;
+    } else if (t.keyword == KW_DOWN || t.keyword == KW_CLOSE) {
+      dir = -1;
+    }
+    key = t.keyword;
+  }
+  return dir != 0 && q.trySend(motionPulse(dir * angle, hold, 500));
+}
+
+// The motion task runs on its own thread in real time; commands sent while
+// it is mid-move must return in far less than one servo tick, whether the
+// queue takes them or is full.
+void test_command_path_while_moving(void) {
+  MotionQueue q(4); // MOTION_QUEUE_LEN
+  MotionExecutor m(BASELINE);
+  std::atomic<bool> moving(false), quit(false);
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread task([&]() {
+    auto ms = [&]() {
+      return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    };
+    while (!quit) {
+      uint32_t wait = m.msUntilNextUpdate(ms());
+      if (wait > 50) wait = 50;
+      motion_cmd_t cmd;
+      if (q.receive(cmd, wait) && !m.repeats(cmd)) m.submit(cmd, ms());
+      m.update(ms());
+      moving = m.busy();
+    }
+  });
+
+  // 1.5 s pulse; every command below arrives while it runs
+  TEST_ASSERT_TRUE(commandToQueue("open angle 60 duration 500", q));
+  while (!moving) std::this_thread::yield();
+  double worstUs = 0.0;
+  int accepted = 0, duringMove = 0;
+  for (int i = 0; i < 200; ++i) {
+    bool busy = moving;
+    auto a = std::chrono::steady_clock::now();
+    bool ok = commandToQueue((i & 1) ? "close angle 45 duration 300" : "up angle 30 duration 200", q);
+    auto b = std::chrono::steady_clock::now();
+    double us = std::chrono::duration<double, std::micro>(b - a).count();
+    if (us > worstUs) worstUs = us;
+    accepted += ok;
+    duringMove += busy && moving;
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  quit = true;
+  task.join();
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "200 commands during a move: %d queued, worst %.1f us", accepted, worstUs);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL(200, duringMove);
+  TEST_ASSERT_TRUE(accepted > 0);
+  TEST_ASSERT_TRUE(worstUs < MOTION_TICK_MS * 1000.0 / 4);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_pulse_timeline);
+  RUN_TEST(test_urgent_preempts_within_one_tick);
+  RUN_TEST(test_normal_waits_and_latest_wins);
+  RUN_TEST(test_repeated_pulse_is_dropped);
+  RUN_TEST(test_stop_returns_to_baseline);
+  RUN_TEST(test_update_cost);
+  RUN_TEST(test_command_path_while_moving);
+  return UNITY_END();
+}
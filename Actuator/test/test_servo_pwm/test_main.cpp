@@ -0,0 +1,104 @@
+#include <unity.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include "ServoPwm.h"
+#include "Trajectory.h"
+
+// Both calibrations in the tree: Actuator (ESP32Servo range) and firmware
+typedef ServoDutyTable<ServoLinear<544, 2400>> ActuatorDuty;
+typedef ServoDutyTable<ServoLinear<500, 2500>> FirmwareDuty;
+
+static double exactDuty(double minUs, double maxUs, int32_t mdeg) {
+  double us = minUs + (maxUs - minUs) * (mdeg / 1000.0) / 180.0;
+  return us / 20000.0 * 65535.0;
+}
+
+// The float path the servo write replaced: profile and duty per call
+static uint32_t floatDuty(int32_t from, int32_t to, uint32_t durationMs, uint32_t t) {
+  double u = t >= durationMs ? 1.0 : (double)t / durationMs;
+  double deg = (from + (to - from) * profile::SCurve::eval(u)) / 1000.0;
+  double us = 544.0 + (2400.0 - 544.0) * deg / 180.0;
+  return (uint32_t)(us / 20000.0 * 65535.0 + 0.5);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_endpoints_follow_calibration(void) {
+  TEST_ASSERT_EQUAL_UINT32(1783, ActuatorDuty::duty(0));        // 544 us
+  TEST_ASSERT_EQUAL_UINT32(7864, ActuatorDuty::duty(180000));   // 2400 us
+  TEST_ASSERT_EQUAL_UINT32(1638, FirmwareDuty::duty(0));        // 500 us
+  TEST_ASSERT_EQUAL_UINT32(8192, FirmwareDuty::duty(180000));   // 2500 us
+  // Clamped outside 0..180 deg
+  TEST_ASSERT_EQUAL_UINT32(ActuatorDuty::duty(0), ActuatorDuty::duty(-5000));
+  TEST_ASSERT_EQUAL_UINT32(ActuatorDuty::duty(180000), ActuatorDuty::duty(200000));
+}
+
+void test_duty_within_one_count(void) {
+  for (int32_t mdeg = 0; mdeg <= 180000; mdeg += 37) {
+    TEST_ASSERT_TRUE(std::fabs(ActuatorDuty::duty(mdeg) - exactDuty(544, 2400, mdeg)) <= 1.0);
+    TEST_ASSERT_TRUE(std::fabs(FirmwareDuty::duty(mdeg) - exactDuty(500, 2500, mdeg)) <= 1.0);
+  }
+}
+
+void test_trajectory_reaches_target_monotonically(void) {
+  Trajectory leg;
+  leg.start(90000, 180000, 500, PROFILE_SCURVE);
+  TEST_ASSERT_EQUAL_INT32(90000, leg.position(0));
+  TEST_ASSERT_EQUAL_INT32(180000, leg.position(500));
+  int32_t prev = leg.position(0);
+  for (uint32_t t = 1; t <= 500; ++t) {
+    int32_t p = leg.position(t);
+    TEST_ASSERT_TRUE(p >= prev);
+    prev = p;
+  }
+}
+
+// Duty of every millisecond of a move: table path against the float path
+void test_position_and_duty_cost(void) {
+  const uint32_t MOVES = 2000, DURATION = 500;
+  Trajectory leg;
+  uint64_t sinkTable = 0, sinkFloat = 0;
+  uint32_t maxDiff = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t m = 0; m < MOVES; ++m) {
+    int32_t from = (m & 1) ? 0 : 180000;
+    leg.start(from, 180000 - from, DURATION, PROFILE_SCURVE);
+    for (uint32_t t = 0; t <= DURATION; ++t) sinkTable += ActuatorDuty::duty(leg.position(t));
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (uint32_t m = 0; m < MOVES; ++m) {
+    int32_t from = (m & 1) ? 0 : 180000;
+    for (uint32_t t = 0; t <= DURATION; ++t) sinkFloat += floatDuty(from, 180000 - from, DURATION, t);
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  leg.start(0, 180000, DURATION, PROFILE_SCURVE);
+  for (uint32_t t = 0; t <= DURATION; ++t) {
+    uint32_t a = ActuatorDuty::duty(leg.position(t));
+    uint32_t b = floatDuty(0, 180000, DURATION, t);
+    uint32_t d = a > b ? a - b : b - a;
+    if (d > maxDiff) maxDiff = d;
+  }
+
+  double n = (double)MOVES * (DURATION + 1);
+  double tableNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+  double floatNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / n;
+  char msg[128];
+  snprintf(msg, sizeof(msg), "position+duty %.1f ns, float %.1f ns, max diff %u counts (sink %u)",
+           tableNs, floatNs, (unsigned)maxDiff, (unsigned)((sinkTable ^ sinkFloat) & 1));
+  TEST_MESSAGE(msg);
+  // Table interpolation stays within a few duty counts (~1 us) of the float curve
+  TEST_ASSERT_TRUE(maxDiff <= 4);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_endpoints_follow_calibration);
+  RUN_TEST(test_duty_within_one_count);
+  RUN_TEST(test_trajectory_reaches_target_monotonically);
+  RUN_TEST(test_position_and_duty_cost);
+  return UNITY_END();
+}
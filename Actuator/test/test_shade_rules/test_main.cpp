@@ -0,0 +1,211 @@
+#include <unity.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include "ShadeRules.h"
+
+// The hard-coded policy ShadeController had before the rule table: the
+// sample path (temp and lux) and the "light:<n>" path of text commands
+static const float CLOSE_TEMP_THRESHOLD = 15.0f;
+static const float CLOSE_LUX_THRESHOLD  = 15.0f;
+static const float OPEN_TEMP_THRESHOLD  = 23.0f;
+static const float OPEN_LUX_THRESHOLD   = 75.0f;
+
+static rule_decision_t oldSamplePolicy(float tempC, float lux) {
+  rule_decision_t d = { RULE_NO_DATA, RULE_NONE, 0 };
+  bool tempValid = !isnan(tempC);
+  bool luxValid = !isnan(lux);
+  if (!(tempValid || luxValid)) return d;
+  bool triggerOpen = false;
+  bool triggerClose = false;
+  if (tempValid) {
+    if (tempC <= CLOSE_TEMP_THRESHOLD) triggerClose = true;
+    if (tempC >= OPEN_TEMP_THRESHOLD)  triggerOpen  = true;
+  }
+  if (luxValid) {
+    if (lux <= CLOSE_LUX_THRESHOLD) triggerClose = true;
+    if (lux >= OPEN_LUX_THRESHOLD)  triggerOpen  = true;
+  }
+  if (triggerOpen && triggerClose) d.verdict = RULE_AMBIGUOUS;
+  else if (triggerClose) { d.verdict = RULE_FIRE; d.action = RULE_CLOSE; }
+  else if (triggerOpen) { d.verdict = RULE_FIRE; d.action = RULE_OPEN; }
+  else d.verdict = RULE_NO_TRIGGER;
+  return d;
+}
+
+static RuleAction oldLightPolicy(float lightVal) {
+  if (lightVal >= 800) return RULE_CLOSE;
+  if (lightVal <= 300) return RULE_OPEN;
+  return RULE_NONE;
+}
+
+static void inputs(float out[RULE_INPUT_COUNT], float tempC, float humidity, float lux,
+                   float wind, float gust, float light) {
+  out[RULE_IN_TEMP] = tempC;
+  out[RULE_IN_HUMIDITY] = humidity;
+  out[RULE_IN_LUX] = lux;
+  out[RULE_IN_WIND] = wind;
+  out[RULE_IN_GUST] = gust;
+  out[RULE_IN_CMD_LIGHT] = light;
+}
+
+// Mostly values around the thresholds, exactly on them, and NaN
+static float randomReading(std::mt19937 &rng, float lo, float hi, const float* edges, size_t nEdges) {
+  std::uniform_int_distribution<int> kind(0, 9);
+  std::uniform_real_distribution<float> range(lo, hi);
+  int k = kind(rng);
+  if (k == 0) return NAN;
+  if (k <= 2) return edges[rng() % nEdges];
+  return range(rng);
+}
+
+static void compileDefaults(RuleTable &t) {
+  TEST_ASSERT_TRUE(t.compile(SHADE_DEFAULT_RULES, sizeof(SHADE_DEFAULT_RULES) / sizeof(SHADE_DEFAULT_RULES[0]),
+                             SHADE_DEFAULT_LOCK_MS));
+}
+
+static void checkAgainstOldPolicy(RuleTable &table, uint32_t seed) {
+  static const float TEMP_EDGES[] = { 15.0f, 23.0f, 14.999f, 23.001f };
+  static const float LUX_EDGES[] = { 15.0f, 75.0f, 0.0f, 74.99f };
+  std::mt19937 rng(seed);
+  float in[RULE_INPUT_COUNT];
+  for (uint32_t i = 0; i < 100000; ++i) {
+    float tempC = randomReading(rng, -20.0f, 45.0f, TEMP_EDGES, 4);
+    float lux = randomReading(rng, 0.0f, 200.0f, LUX_EDGES, 4);
+    // Humidity and wind are not part of the default policy
+    inputs(in, tempC, (float)(rng() % 100), lux, (float)(rng() % 60), NAN, NAN);
+    rule_decision_t want = oldSamplePolicy(tempC, lux);
+    rule_decision_t got = table.evaluate(in, i * 1000);
+    char msg[64];
+    snprintf(msg, sizeof(msg), "temp %g lux %g", tempC, lux);
+    TEST_ASSERT_EQUAL_MESSAGE(want.verdict, got.verdict, msg);
+    if (want.verdict == RULE_FIRE) TEST_ASSERT_EQUAL_MESSAGE(want.action, got.action, msg);
+  }
+
+  for (uint32_t i = 0; i < 20000; ++i) {
+    float light = (float)(rng() % 1200) + ((rng() & 1) ? 0.5f : 0.0f);
+    inputs(in, NAN, NAN, NAN, NAN, NAN, light);
+    rule_decision_t got = table.evaluate(in, i * 1000);
+    RuleAction want = oldLightPolicy(light);
+    TEST_ASSERT_EQUAL(want == RULE_NONE ? RULE_NO_TRIGGER : RULE_FIRE, got.verdict);
+    if (want != RULE_NONE) TEST_ASSERT_EQUAL(want, got.action);
+  }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_defaults_match_old_policy(void) {
+  RuleTable table;
+  compileDefaults(table);
+  checkAgainstOldPolicy(table, 1);
+}
+
+void test_text_form_matches_old_policy(void) {
+  const char text[] = "lock 5000\n"
+                      "close temp le 15\nclose lux le 15\n"
+                      "open temp ge 23\nopen lux ge 75\n"
+                      "close light ge 800\nopen light le 300\n";
+  shade_rule_t rules[RULE_MAX];
+  size_t count = 0;
+  uint32_t lockMs = 0;
+  const char* errorAt = nullptr;
+  TEST_ASSERT_EQUAL(RULES_OK, parseRules(text, sizeof(text) - 1, rules, RULE_MAX, count, lockMs, errorAt));
+  TEST_ASSERT_EQUAL(6, count);
+  TEST_ASSERT_EQUAL_UINT32(5000, lockMs);
+  RuleTable table;
+  TEST_ASSERT_TRUE(table.compile(rules, count, lockMs));
+  checkAgainstOldPolicy(table, 2);
+}
+
+void test_hysteresis_dwell_priority(void) {
+  const shade_rule_t rules[] = {
+    { RULE_IN_LUX,  RULE_GE, 75.0f, 10.0f, 0,    RULE_OPEN,  0 },
+    { RULE_IN_GUST, RULE_GE, 40.0f, 0.0f,  2000, RULE_CLOSE, 1 },
+  };
+  RuleTable t;
+  TEST_ASSERT_TRUE(t.compile(rules, 2, 0));
+  float in[RULE_INPUT_COUNT];
+
+  // Hysteresis: on at 75, stays on down to 65
+  inputs(in, NAN, NAN, 80.0f, NAN, 0.0f, NAN);
+  TEST_ASSERT_EQUAL(RULE_FIRE, t.evaluate(in, 0).verdict);
+  in[RULE_IN_LUX] = 66.0f;
+  TEST_ASSERT_EQUAL(RULE_FIRE, t.evaluate(in, 100).verdict);
+  in[RULE_IN_LUX] = NAN; // a missing reading does not fire, but keeps the state
+  TEST_ASSERT_EQUAL(RULE_NO_TRIGGER, t.evaluate(in, 150).verdict);
+  in[RULE_IN_LUX] = 66.0f;
+  TEST_ASSERT_EQUAL(RULE_FIRE, t.evaluate(in, 175).verdict);
+  in[RULE_IN_LUX] = 64.0f;
+  TEST_ASSERT_EQUAL(RULE_NO_TRIGGER, t.evaluate(in, 200).verdict);
+  in[RULE_IN_LUX] = 70.0f;
+  TEST_ASSERT_EQUAL(RULE_NO_TRIGGER, t.evaluate(in, 300).verdict);
+
+  // Gust must hold 2 s, then outranks the open rule
+  in[RULE_IN_LUX] = 90.0f;
+  in[RULE_IN_GUST] = 45.0f;
+  rule_decision_t d = t.evaluate(in, 1000);
+  TEST_ASSERT_EQUAL(RULE_OPEN, d.action);
+  d = t.evaluate(in, 2999);
+  TEST_ASSERT_EQUAL(RULE_OPEN, d.action);
+  d = t.evaluate(in, 3000);
+  TEST_ASSERT_EQUAL(RULE_FIRE, d.verdict);
+  TEST_ASSERT_EQUAL(RULE_CLOSE, d.action);
+  TEST_ASSERT_EQUAL(RULE_IN_GUST, t.rule(d.rule).input);
+}
+
+void test_rejects_malformed(void) {
+  shade_rule_t rules[RULE_MAX];
+  size_t count = 0;
+  uint32_t lockMs = 0;
+  const char* errorAt = nullptr;
+  const char bad[] = "open lux ge 75 close pressure le 3";
+  TEST_ASSERT_EQUAL(RULES_BAD_INPUT, parseRules(bad, sizeof(bad) - 1, rules, RULE_MAX, count, lockMs, errorAt));
+  TEST_ASSERT_TRUE(errorAt == strstr(bad, "pressure"));
+
+  shade_rule_t neg = { RULE_IN_LUX, RULE_GE, 75.0f, -1.0f, 0, RULE_OPEN, 0 };
+  RuleTable t;
+  TEST_ASSERT_FALSE(t.compile(&neg, 1, 0));
+}
+
+void test_evaluate_cost(void) {
+  const uint32_t N = 1000000;
+  RuleTable table;
+  compileDefaults(table);
+  std::mt19937 rng(3);
+  static float temps[1024], luxes[1024];
+  for (int i = 0; i < 1024; ++i) {
+    temps[i] = (float)(rng() % 40);
+    luxes[i] = (float)(rng() % 150);
+  }
+
+  uint32_t sinkOld = 0, sinkNew = 0;
+  float in[RULE_INPUT_COUNT];
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < N; ++i) sinkOld += oldSamplePolicy(temps[i & 1023], luxes[i & 1023]).action;
+  auto t1 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < N; ++i) {
+    inputs(in, temps[i & 1023], 50.0f, luxes[i & 1023], 5.0f, 8.0f, NAN);
+    sinkNew += table.evaluate(in, i).action;
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "if-chain %.1f ns, RuleTable %.1f ns per sample (sink %u)",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / N,
+           std::chrono::duration<double, std::nano>(t2 - t1).count() / N,
+           (unsigned)((sinkOld ^ sinkNew) & 1));
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_defaults_match_old_policy);
+  RUN_TEST(test_text_form_matches_old_policy);
+  RUN_TEST(test_hysteresis_dwell_priority);
+  RUN_TEST(test_rejects_malformed);
+  RUN_TEST(test_evaluate_cost);
+  return UNITY_END();
+}
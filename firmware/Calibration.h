@@ -0,0 +1 @@
+../weatherStation/include/Calibration.h
\ No newline at end of file
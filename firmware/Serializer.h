@@ -0,0 +1 @@
+../weatherStation/include/Serializer.h
\ No newline at end of file
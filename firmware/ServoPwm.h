@@ -0,0 +1 @@
+../Actuator/include/ServoPwm.h
\ No newline at end of file
@@ -16,6 +16,10 @@
 #include <Preferences.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include <stddef.h>
+#include "Calibration.h" // symlink to weatherStation/include/Calibration.h (C++17)
+#include "Serializer.h"  // symlink to weatherStation/include/Serializer.h
+#include "ServoPwm.h"    // symlink to Actuator/include/ServoPwm.h
 
 // --- Configuration (edit as needed) ---
 // WiFi / server (leave empty if not using)
@@ -77,12 +81,21 @@ unsigned long last_shade_move_ms = 0;
 const int SERVO_LEDC_CHANNEL = 0;
 const int SERVO_LEDC_FREQ = 50;
 const int SERVO_LEDC_RES = 16; // 16-bit resolution
-const uint32_t SERVO_LEDC_MAX_DUTY = (1UL << SERVO_LEDC_RES) - 1;
+const uint32_t SERVO_MIN_US = 500;
+const uint32_t SERVO_MAX_US = 2500;
+typedef ServoDutyTable<ServoLinear<SERVO_MIN_US, SERVO_MAX_US>, SERVO_LEDC_FREQ, SERVO_LEDC_RES> ServoDuty;
 
-// Gray-code buffer for smoothing direction
+// Calibration tables (generated at compile time, see Calibration.h)
+typedef calib::GrayDirection<6> DirectionCalibration;
+typedef calib::Atan2Table<> DirectionAtan2;
+typedef calib::LinearQ16<calib::LuxBh1750> LuxCalibration;
+
+// Gray-code buffer for smoothing direction (Q15 unit vectors + running sums)
 const int DIR_SMOOTH_SAMPLES = 6;
-float dir_circle_x[DIR_SMOOTH_SAMPLES];
-float dir_circle_y[DIR_SMOOTH_SAMPLES];
+int16_t dir_circle_x[DIR_SMOOTH_SAMPLES];
+int16_t dir_circle_y[DIR_SMOOTH_SAMPLES];
+int32_t dir_sum_x = 0;
+int32_t dir_sum_y = 0;
 int dir_index = 0;
 int dir_sample_count = 0;
 
@@ -107,32 +120,22 @@ unsigned int readGrayRaw() {
   return g;
 }
 
-unsigned int grayToBinary(unsigned int num) {
-  unsigned int mask;
-  for (mask = num >> 1; mask != 0; mask = mask >> 1) {
-    num = num ^ mask;
-  }
-  return num;
-}
-
 float getDirectionDeg() {
-  unsigned int gray = readGrayRaw();
-  unsigned int bin = grayToBinary(gray);
-  const int bits = 6;
-  unsigned int maxCodes = 1U << bits;
-  float deg = (float)bin * (360.0f / (float)maxCodes);
-  // circular smoothing
-  float rad = deg * PI / 180.0f;
-  dir_circle_x[dir_index] = cos(rad);
-  dir_circle_y[dir_index] = sin(rad);
+  // gray code -> unit vector straight from the table (no gray decode, no cos/sin)
+  const DirectionCalibration::Vec& v = DirectionCalibration::fromGray(readGrayRaw());
+  // circular smoothing over the last DIR_SMOOTH_SAMPLES vectors
+  if (dir_sample_count == DIR_SMOOTH_SAMPLES) {
+    dir_sum_x -= dir_circle_x[dir_index];
+    dir_sum_y -= dir_circle_y[dir_index];
+  } else {
+    dir_sample_count++;
+  }
+  dir_circle_x[dir_index] = v.x;
+  dir_circle_y[dir_index] = v.y;
+  dir_sum_x += v.x;
+  dir_sum_y += v.y;
   dir_index = (dir_index + 1) % DIR_SMOOTH_SAMPLES;
-  if (dir_sample_count < DIR_SMOOTH_SAMPLES) dir_sample_count++;
-  float sx = 0, sy = 0;
-  for (int i = 0; i < dir_sample_count; ++i) { sx += dir_circle_x[i]; sy += dir_circle_y[i]; }
-  float avg_rad = atan2(sy / dir_sample_count, sx / dir_sample_count);
-  float avg_deg = avg_rad * 180.0f / PI;
-  if (avg_deg < 0) avg_deg += 360.0f;
-  return avg_deg;
+  return DirectionAtan2::degrees(dir_sum_y, dir_sum_x);
 }
 
 // Minimal BH1750 driver (no external library)
@@ -149,19 +152,15 @@ float bh1750ReadLux() {
     uint16_t high = Wire.read();
     uint16_t low = Wire.read();
     uint16_t raw = (high << 8) | low;
-    float lux = raw / 1.2f; // per BH1750 datasheet
-    return lux;
+    return LuxCalibration::toFloat(raw); // raw / 1.2 per BH1750 datasheet, Q16
   }
   return -1.0f;
 }
 
 void setServoAngle(int angle) {
   angle = constrain(angle, 0, 180);
-  // convert angle -> pulse width (500..2500 us typical)
-  int us = map(angle, 0, 180, 500, 2500);
-  // compute duty for 50Hz: duty = us / 20000us * maxDuty
-  uint32_t duty = (uint32_t)((((float)us) / 20000.0f) * (float)SERVO_LEDC_MAX_DUTY);
-  ledcWrite(SERVO_LEDC_CHANNEL, duty);
+  // angle -> 500..2500 us pulse -> duty at 50 Hz, precomputed per degree (ServoPwm.h)
+  ledcWrite(SERVO_LEDC_CHANNEL, ServoDuty::duty(angle * 1000));
   current_shade_angle = angle;
   last_shade_move_ms = millis();
 }
@@ -212,15 +211,38 @@ void connectWiFiIfConfigured() {
   }
 }
 
-void postJsonToServer(const String& json) {
+// One report as sent over Serial/HTTP
+typedef struct {
+  uint32_t ts;
+  float temp_c;
+  float rh_pct;
+  float wind_mps;
+  float wind_deg;
+  float lux;
+  int32_t shade_angle;
+} report_t;
+
+static constexpr ser::field_t REPORT_FIELDS[] = {
+  { "ts",          offsetof(report_t, ts),          ser::FIELD_U32, 0 },
+  { "temp_c",      offsetof(report_t, temp_c),      ser::FIELD_F32, 2 },
+  { "rh_pct",      offsetof(report_t, rh_pct),      ser::FIELD_F32, 2 },
+  { "wind_mps",    offsetof(report_t, wind_mps),    ser::FIELD_F32, 3 },
+  { "wind_deg",    offsetof(report_t, wind_deg),    ser::FIELD_F32, 1 },
+  { "lux",         offsetof(report_t, lux),         ser::FIELD_F32, 0 },
+  { "shade_angle", offsetof(report_t, shade_angle), ser::FIELD_I32, 0 },
+};
+static constexpr ser::schema_t REPORT_SCHEMA = {
+  "weather", REPORT_FIELDS, sizeof(REPORT_FIELDS) / sizeof(REPORT_FIELDS[0])
+};
+
+void postJsonToServer(const uint8_t* json, size_t len) {
   if (!wifiConnected || strlen(SERVER_URL) == 0) return;
   HTTPClient http;
   http.begin(SERVER_URL);
   http.addHeader("Content-Type", "application/json");
-  int code = http.POST(json);
+  int code = http.POST((uint8_t*)json, len);
   if (code > 0) {
-    String payload = http.getString();
-    Serial.printf("HTTP %d: %s\n", code, payload.c_str());
+    Serial.printf("HTTP %d\n", code); // response body not needed
   } else {
     Serial.printf("HTTP POST failed, err=%d\n", code);
   }
@@ -312,23 +334,23 @@ void loop() {
       moveShade = true;
     }
 
-    // Build JSON payload
-    unsigned long ts = nowMs / 1000UL; // seconds since boot (not epoch unless WiFi+NTP)
-    String payload = "{";
-    payload += "\"ts\":" + String(ts) + ",";
-    payload += "\"temp_c\":" + (isnan(tempC) ? String("null") : String(tempC, 2)) + ",";
-    payload += "\"rh_pct\":" + (isnan(hum) ? String("null") : String(hum, 2)) + ",";
-    payload += "\"wind_mps\":" + String(windMps, 3) + ",";
-    payload += "\"wind_deg\":" + String(windDirDeg, 1) + ",";
-    payload += "\"lux\":" + (isnan(lux) ? String("null") : String((uint32_t)lux)) + ",";
-    payload += "\"shade_angle\":" + String(current_shade_angle);
-    payload += "}";
+    // Build JSON payload into a fixed buffer (no String churn in the loop)
+    report_t report;
+    report.ts = nowMs / 1000UL; // seconds since boot (not epoch unless WiFi+NTP)
+    report.temp_c = tempC;
+    report.rh_pct = hum;
+    report.wind_mps = windMps;
+    report.wind_deg = windDirDeg;
+    report.lux = isnan(lux) ? NAN : (float)(uint32_t)lux;
+    report.shade_angle = current_shade_angle;
+    static uint8_t payload[192];
+    size_t len = ser::encodeRecord<ser::Json>(REPORT_SCHEMA, &report, payload, sizeof(payload));
 
-    Serial.println(payload); // primary transport for now
+    if (len > 0) Serial.println((const char*)payload); // primary transport for now
 
     // optional: HTTP POST to server
-    if (wifiConnected && strlen(SERVER_URL) > 0) {
-      postJsonToServer(payload);
+    if (len > 0 && wifiConnected && strlen(SERVER_URL) > 0) {
+      postJsonToServer(payload, len);
     }
 
     lastReportMs += REPORT_INTERVAL_MS;
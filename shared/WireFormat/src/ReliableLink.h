@@ -0,0 +1,381 @@
+#ifndef SHARED_RELIABLELINK_H
+#define SHARED_RELIABLELINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "WireFormat.h"
+
+// Reliable delivery of WireFormat frames over ESP-NOW.
+//
+// ESP-NOW tells the sender, per unicast frame, whether the peer's MAC
+// acknowledged it (the send callback) but never retries on its own after the
+// MAC gives up. ReliableSender keeps up to Window frames in flight, matches
+// send callbacks to frames in send order (ESP-NOW reports them in that order)
+// and retransmits a failed frame after a doubling delay, up to maxRetries
+// times. Retransmits reuse the frame's header seq, so when the data arrived
+// but the ack was lost, the receiver's SeqWindow drops the second copy. One
+// frame retrying while the rest of the window moves on must stay within the
+// receiver's RELIABLE_SEQ_SPAN, so a sender (whose seqs are consecutive) takes
+// no frame more than that far ahead of its oldest outstanding one.
+//
+// The callback carries nothing that names the transmission, so every
+// transmission gets a send generation and callbacks are counted against
+// them. When the oldest callback is overdue, everything outstanding is given
+// up; a callback that shows up later belongs to one of those generations and
+// is dropped (lateCallbacks) instead of crediting a retransmission. Until
+// those callbacks are in, or one more ackTimeout has passed, nothing is
+// sent, so the count is back in step before the next transmission.
+//
+// Broadcast frames are never acked by the MAC (the callback always reports
+// success), so they go out once.
+//
+// Neither class touches the radio or the clock: time comes in as a parameter
+// and frames leave through a callable, so both run on a host against a
+// simulated lossy link.
+
+// Seqs a receiver remembers below the highest one (SeqWindow), and so the
+// largest seq spread a sender keeps in flight
+static constexpr uint32_t RELIABLE_SEQ_SPAN = 32;
+
+// --- Sender ---
+
+typedef struct {
+  uint32_t frames;        // submitted
+  uint32_t transmissions; // including retransmits
+  uint32_t retransmits;
+  uint32_t delivered;     // acked by the peer's MAC
+  uint32_t dropped;       // gave up after maxRetries
+  uint32_t timeouts;      // no send callback within ackTimeout
+  uint32_t lateCallbacks; // callbacks of transmissions given up at a timeout
+  uint32_t rttMinMs;      // first transmission to ack, delivered frames only
+  uint32_t rttMaxMs;
+  uint32_t rttSumMs;
+} reliable_tx_stats_t;
+
+// Delivered share of finished frames in 1/1000 (1000 before any finished)
+inline uint32_t reliableDeliveryPermille(const reliable_tx_stats_t &s) {
+  uint32_t done = s.delivered + s.dropped;
+  return done ? (uint32_t)((uint64_t)s.delivered * 1000 / done) : 1000;
+}
+
+inline uint32_t reliableMeanRttMs(const reliable_tx_stats_t &s) {
+  return s.delivered ? s.rttSumMs / s.delivered : 0;
+}
+
+template <uint8_t Window>
+class ReliableSender {
+public:
+  ReliableSender(uint8_t maxRetries, uint32_t retryDelayMs, uint32_t ackTimeoutMs)
+    : _used(0), _lastSeq(0), _pendingHead(0), _pendingCount(0), _sendGen(0), _callbackGen(0),
+      _quiet(false), _quietUntil(0), _stats() {
+    setRetryPolicy(maxRetries, retryDelayMs, ackTimeoutMs);
+    for (uint8_t i = 0; i < Window; ++i) _slots[i].state = SLOT_FREE;
+  }
+
+  // No retransmits until setRetryPolicy() (for arrays of senders)
+  ReliableSender() : ReliableSender(0, 0, 1000) {}
+
+  void setRetryPolicy(uint8_t maxRetries, uint32_t retryDelayMs, uint32_t ackTimeoutMs) {
+    _maxRetries = maxRetries;
+    _retryDelay = retryDelayMs;
+    _ackTimeout = ackTimeoutMs;
+  }
+
+  // Room for the next seq (the one after the last submitted)
+  bool canSubmit() const { return _used < Window && withinSpan(_lastSeq + 1); }
+  uint8_t inFlight() const { return _used; }
+
+  // Copy a finished frame into the window; it goes out on the next poll().
+  bool submit(const uint8_t* frame, size_t len, uint32_t seq, uint32_t now) {
+    if (len > WIRE_MAX_FRAME || !withinSpan(seq)) return false;
+    for (uint8_t i = 0; i < Window; ++i) {
+      slot_t &s = _slots[i];
+      if (s.state != SLOT_FREE) continue;
+      memcpy(s.frame, frame, len);
+      s.len = (uint16_t)len;
+      s.seq = seq;
+      s.tries = 0;
+      s.dueAt = now;
+      s.state = SLOT_QUEUED;
+      _used++;
+      _lastSeq = seq;
+      _stats.frames++;
+      return true;
+    }
+    return false;
+  }
+
+  // Outcome of the oldest outstanding transmission (the ESP-NOW send callback).
+  void onSendStatus(bool acked, uint32_t now) {
+    if (_callbackGen == _sendGen) return; // nothing outstanding
+    uint32_t gen = ++_callbackGen;
+    if (_pendingCount == 0 || _slots[_pending[_pendingHead]].gen != gen) {
+      _stats.lateCallbacks++; // its transmission was given up at a timeout
+      return;
+    }
+    slot_t &s = _slots[popPending()];
+    if (!acked) {
+      retry(s, now);
+      return;
+    }
+    uint32_t rtt = now - s.firstSentAt;
+    if (_stats.delivered == 0 || rtt < _stats.rttMinMs) _stats.rttMinMs = rtt;
+    if (rtt > _stats.rttMaxMs) _stats.rttMaxMs = rtt;
+    _stats.rttSumMs += rtt;
+    _stats.delivered++;
+    release(s);
+  }
+
+  // Transmit every frame that is due, oldest seq first. send(frame, len)
+  // returns false when the radio refused the frame outright (no peer, queue
+  // full); that counts as a failed attempt.
+  template <class Send>
+  void poll(uint32_t now, Send send) {
+    // A missing callback would shift every later match, so when the oldest
+    // one is overdue, all outstanding transmissions count as failed
+    if (_pendingCount > 0 && now - _slots[_pending[_pendingHead]].sentAt >= _ackTimeout) {
+      while (_pendingCount > 0) {
+        _stats.timeouts++;
+        retry(_slots[popPending()], now);
+      }
+      _quiet = true;
+      _quietUntil = now + _ackTimeout;
+    }
+    // Wait for the callbacks of what was given up; missing ones are lost
+    if (_quiet) {
+      if (_callbackGen != _sendGen && (int32_t)(now - _quietUntil) < 0) return;
+      _callbackGen = _sendGen;
+      _quiet = false;
+    }
+
+    for (;;) {
+      int next = -1;
+      for (uint8_t i = 0; i < Window; ++i) {
+        const slot_t &s = _slots[i];
+        if (s.state != SLOT_QUEUED || (int32_t)(now - s.dueAt) < 0) continue;
+        if (next < 0 || (int32_t)(s.seq - _slots[next].seq) < 0) next = i;
+      }
+      if (next < 0) break;
+
+      slot_t &s = _slots[next];
+      if (s.tries == 0) s.firstSentAt = now;
+      else _stats.retransmits++;
+      s.tries++;
+      s.sentAt = now;
+      _stats.transmissions++;
+      if (send(s.frame, (size_t)s.len)) {
+        s.state = SLOT_SENT;
+        s.gen = ++_sendGen;
+        _pending[(_pendingHead + _pendingCount) % Window] = (uint8_t)next;
+        _pendingCount++;
+      } else {
+        retry(s, now);
+      }
+    }
+  }
+
+  // Time until poll() has something to do: 0 right away, UINT32_MAX when
+  // only a send callback can make progress (or nothing is in flight).
+  uint32_t msUntilNextAction(uint32_t now) const {
+    uint32_t wait = UINT32_MAX;
+    if (_pendingCount > 0) {
+      uint32_t age = now - _slots[_pending[_pendingHead]].sentAt;
+      wait = age >= _ackTimeout ? 0 : _ackTimeout - age;
+    }
+    bool quiet = _quiet && _callbackGen != _sendGen;
+    for (uint8_t i = 0; i < Window; ++i) {
+      const slot_t &s = _slots[i];
+      if (s.state != SLOT_QUEUED) continue;
+      uint32_t due = quiet && (int32_t)(_quietUntil - s.dueAt) > 0 ? _quietUntil : s.dueAt;
+      int32_t left = (int32_t)(due - now);
+      uint32_t w = left > 0 ? (uint32_t)left : 0;
+      if (w < wait) wait = w;
+    }
+    return wait;
+  }
+
+  const reliable_tx_stats_t& stats() const { return _stats; }
+
+private:
+  enum SlotState : uint8_t { SLOT_FREE = 0, SLOT_QUEUED, SLOT_SENT };
+
+  typedef struct {
+    uint8_t frame[WIRE_MAX_FRAME];
+    uint16_t len;
+    uint32_t seq;
+    uint32_t firstSentAt;
+    uint32_t sentAt;
+    uint32_t dueAt;      // next transmission (SLOT_QUEUED)
+    uint32_t gen;        // send generation of the transmission (SLOT_SENT)
+    uint8_t tries;       // transmissions so far
+    SlotState state;
+  } slot_t;
+
+  uint8_t _maxRetries;
+  uint32_t _retryDelay;
+  uint32_t _ackTimeout;
+  slot_t _slots[Window];
+  uint8_t _used;
+  uint32_t _lastSeq;        // last submitted
+  uint8_t _pending[Window]; // slots awaiting a send callback, in send order
+  uint8_t _pendingHead;
+  uint8_t _pendingCount;
+  uint32_t _sendGen;        // generation of the last accepted transmission
+  uint32_t _callbackGen;    // generation the last send callback accounted for
+  bool _quiet;              // after a timeout: no sends until the late callbacks are in
+  uint32_t _quietUntil;
+  reliable_tx_stats_t _stats;
+
+  // seq not more than RELIABLE_SEQ_SPAN - 1 ahead of the oldest frame held
+  bool withinSpan(uint32_t seq) const {
+    for (uint8_t i = 0; i < Window; ++i) {
+      const slot_t &s = _slots[i];
+      if (s.state != SLOT_FREE && seq - s.seq >= RELIABLE_SEQ_SPAN) return false;
+    }
+    return true;
+  }
+
+  uint8_t popPending() {
+    uint8_t i = _pending[_pendingHead];
+    _pendingHead = (uint8_t)((_pendingHead + 1) % Window);
+    _pendingCount--;
+    return i;
+  }
+
+  void retry(slot_t &s, uint32_t now) {
+    if (s.tries > _maxRetries) {
+      _stats.dropped++;
+      release(s);
+      return;
+    }
+    uint8_t shift = s.tries > 8 ? 8 : (uint8_t)(s.tries - 1);
+    s.dueAt = now + (_retryDelay << shift);
+    s.state = SLOT_QUEUED;
+  }
+
+  void release(slot_t &s) {
+    s.state = SLOT_FREE;
+    _used--;
+  }
+};
+
+// --- Receiver ---
+
+typedef struct {
+  uint32_t accepted;
+  uint32_t duplicates; // retransmitted copies dropped
+  uint32_t missing;    // seqs skipped and not (yet) filled in by a late frame
+  uint32_t restarts;   // sender rebooted (seq far from the last one)
+} reliable_rx_stats_t;
+
+// Duplicate suppression for one sender: the highest seq seen plus a bitmap
+// of the SPAN seqs below it. ReliableSender never keeps a retransmit more
+// than SPAN behind its newest frame, so a seq further back than that means
+// the sender restarted.
+class SeqWindow {
+public:
+  static constexpr uint32_t SPAN = RELIABLE_SEQ_SPAN;
+  static constexpr uint32_t MAX_JUMP = 1024; // larger forward jumps are restarts too
+
+  SeqWindow() : _valid(false), _highest(0), _bits(0) {}
+
+  // True when seq has not been seen before.
+  bool accept(uint32_t seq, reliable_rx_stats_t &st) {
+    if (!_valid) {
+      restart(seq);
+      st.accepted++;
+      return true;
+    }
+    int32_t d = (int32_t)(seq - _highest);
+    if (d > 0) {
+      if ((uint32_t)d > MAX_JUMP) {
+        st.restarts++;
+        restart(seq);
+      } else {
+        st.missing += (uint32_t)d - 1;
+        _bits = (uint32_t)d >= SPAN ? 1u : (_bits << d) | 1u;
+        _highest = seq;
+      }
+      st.accepted++;
+      return true;
+    }
+    uint32_t back = (uint32_t)-d;
+    if (back >= SPAN) {
+      st.restarts++;
+      restart(seq);
+      st.accepted++;
+      return true;
+    }
+    uint32_t bit = 1u << back;
+    if (_bits & bit) {
+      st.duplicates++;
+      return false;
+    }
+    _bits |= bit; // late frame fills an earlier gap
+    if (st.missing > 0) st.missing--;
+    st.accepted++;
+    return true;
+  }
+
+  void reset() { _valid = false; }
+
+private:
+  bool _valid;
+  uint32_t _highest;
+  uint32_t _bits; // bit n: _highest - n seen
+
+  void restart(uint32_t seq) {
+    _valid = true;
+    _highest = seq;
+    _bits = 1u;
+  }
+};
+
+// One SeqWindow per stream: a station numbers its unicast frames, each group
+// broadcast and its broadcast to all separately, so a stream is the pair
+// (station id, group) from the frame header. When the table is full the
+// stream heard from least recently gives up its entry.
+template <uint8_t Streams>
+class DuplicateFilter {
+public:
+  DuplicateFilter() : _stats() {
+    for (uint8_t i = 0; i < Streams; ++i) _entries[i].used = false;
+  }
+
+  bool accept(uint16_t stationId, uint8_t group, uint32_t seq, uint32_t now) {
+    entry_t* e = nullptr;
+    entry_t* victim = &_entries[0];
+    for (uint8_t i = 0; i < Streams; ++i) {
+      entry_t &c = _entries[i];
+      if (c.used && c.stationId == stationId && c.group == group) { e = &c; break; }
+      if (!c.used) { if (victim->used) victim = &c; }
+      else if (victim->used && (int32_t)(c.lastSeen - victim->lastSeen) < 0) victim = &c;
+    }
+    if (!e) {
+      e = victim;
+      e->used = true;
+      e->stationId = stationId;
+      e->group = group;
+      e->window.reset();
+    }
+    e->lastSeen = now;
+    return e->window.accept(seq, _stats);
+  }
+
+  const reliable_rx_stats_t& stats() const { return _stats; }
+
+private:
+  typedef struct {
+    bool used;
+    uint8_t group;
+    uint16_t stationId;
+    uint32_t lastSeen;
+    SeqWindow window;
+  } entry_t;
+
+  entry_t _entries[Streams];
+  reliable_rx_stats_t _stats;
+};
+
+#endif // SHARED_RELIABLELINK_H
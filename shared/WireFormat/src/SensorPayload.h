@@ -0,0 +1,66 @@
+#ifndef SHARED_SENSORPAYLOAD_H
+#define SHARED_SENSORPAYLOAD_H
+
+#include <stdint.h>
+#include <math.h>
+
+// Sample produced by the weather station's SensorManager once per measurement
+// interval; the actuator decodes ESP-NOW frames (WireFormat.h) into the same
+// struct. Kept free of Arduino includes so it also builds on a host.
+typedef struct __attribute__((packed)) {
+  float tempC;
+  float humidity;
+  float lux;
+  float wind_kmh; // wind speed in km/h (calibrated)
+  uint32_t seq;
+  // Wind statistics from 1 s sub-samples (appended so older receivers that
+  // only read the first fields keep working)
+  float wind_gust_kmh;   // peak 3 s mean since the previous sample
+  float wind_avg2m_kmh;  // 2 minute mean
+  float wind_avg10m_kmh; // 10 minute mean
+  float wind_var10m;     // 10 minute variance, (km/h)^2
+  // Rolling aggregates of the raw readings above over the station's last
+  // SENSOR_WINDOW_SAMPLES reports (WindowStats.h); not sent over ESP-NOW
+  float temp_avg;
+  float temp_min;
+  float temp_max;
+  float humidity_avg;
+  float humidity_min;
+  float humidity_max;
+  float lux_avg;
+  float lux_min;
+  float lux_max;
+  float wind_lull_kmh;   // lowest 1 s speed since the previous sample
+  // Sample instant: the scheduled tick of this report on the station's
+  // monotonic microsecond clock, and the same instant in Unix milliseconds
+  // (0 until the station's clock has been set over NTP)
+  uint64_t t_us;
+  uint64_t epoch_ms;
+} sensor_payload_t;
+
+// Every reading NaN ("not measured"), seq and timestamps 0
+inline void sensorPayloadClear(sensor_payload_t &p) {
+  p.tempC = NAN;
+  p.humidity = NAN;
+  p.lux = NAN;
+  p.wind_kmh = NAN;
+  p.seq = 0;
+  p.wind_gust_kmh = NAN;
+  p.wind_avg2m_kmh = NAN;
+  p.wind_avg10m_kmh = NAN;
+  p.wind_var10m = NAN;
+  p.temp_avg = NAN;
+  p.temp_min = NAN;
+  p.temp_max = NAN;
+  p.humidity_avg = NAN;
+  p.humidity_min = NAN;
+  p.humidity_max = NAN;
+  p.lux_avg = NAN;
+  p.lux_min = NAN;
+  p.lux_max = NAN;
+  p.wind_lull_kmh = NAN;
+  p.t_us = 0;
+  p.epoch_ms = 0;
+}
+
+#endif // SHARED_SENSORPAYLOAD_H
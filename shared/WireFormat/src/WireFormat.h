@@ -0,0 +1,224 @@
+#ifndef SHARED_WIREFORMAT_H
+#define SHARED_WIREFORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "SensorPayload.h"
+
+// ESP-NOW frame format shared by weatherStation (sender) and Actuator.
+//
+//   [wire_header_t 14 B][wire_sample_t x count]      <= 250 B (one ESP-NOW frame)
+//
+// All fields are little-endian (both ends are ESP32). The header carries a
+// magic byte, so a receiver tells a frame from a text command by its first
+// byte, and a CRC-16 over the whole frame. Samples are fixed point, 28 bytes
+// each, so one frame holds up to WIRE_MAX_SAMPLES of them.
+//
+// Versioning: a frame states its sample size. Later versions may only append
+// fields to wire_sample_t; a receiver reads the prefix it knows and skips the
+// rest, so old actuators keep working with newer stations. Fields missing
+// from an older station's shorter samples read as 0.
+
+static const uint8_t WIRE_MAGIC = 0xA7;      // not printable: never starts a text command
+static const uint8_t WIRE_VERSION = 1;
+static const size_t WIRE_MAX_FRAME = 250;    // ESP_NOW_MAX_DATA_LEN
+static const uint8_t WIRE_GROUP_NONE = 0;    // unicast frames
+static const uint8_t WIRE_GROUP_ALL = 0xFF;  // broadcasts meant for every actuator
+
+enum WireMsgType : uint8_t {
+  WIRE_MSG_SAMPLES = 1
+};
+
+typedef struct __attribute__((packed)) {
+  uint8_t magic;       // WIRE_MAGIC
+  uint8_t version;     // WIRE_VERSION of the sender
+  uint8_t type;        // WireMsgType
+  uint8_t count;       // samples in this frame
+  uint16_t stationId;  // sender id (low bytes of its MAC)
+  uint8_t group;       // WIRE_GROUP_NONE, an actuator group or WIRE_GROUP_ALL; every
+                       // (stationId, group) pair counts its own seq
+  uint8_t sampleSize;  // bytes per sample in this frame
+  uint32_t seq;        // frame sequence number
+  uint16_t crc;        // CRC-16/CCITT over the frame with this field zeroed
+} wire_header_t;
+
+// Fixed-point sample; the *_MISSING values stand for NaN.
+typedef struct __attribute__((packed)) {
+  uint32_t seq;
+  int16_t tempCenti;       // 0.01 degC
+  uint16_t humidityCenti;  // 0.01 %RH
+  uint16_t lux;            // 1 lx
+  uint16_t windCenti;      // 0.01 km/h
+  uint16_t gustCenti;
+  uint16_t avg2mCenti;
+  uint16_t avg10mCenti;
+  uint16_t var10mCenti;    // 0.01 (km/h)^2
+  // appended after the first 20 bytes (WIRE_SAMPLE_MIN_SIZE)
+  uint64_t epochMs;        // sample instant, Unix ms; 0 when the station had no time
+} wire_sample_t;
+
+static const size_t WIRE_SAMPLE_MIN_SIZE = 20; // first released wire_sample_t
+
+static const int16_t WIRE_I16_MISSING = INT16_MIN;
+static const uint16_t WIRE_U16_MISSING = 0xFFFF;
+
+static const size_t WIRE_MAX_SAMPLES = (WIRE_MAX_FRAME - sizeof(wire_header_t)) / sizeof(wire_sample_t);
+
+enum WireStatus : uint8_t {
+  WIRE_OK = 0,
+  WIRE_NOT_A_FRAME,   // no magic: not ours (text command)
+  WIRE_BAD_VERSION,
+  WIRE_TRUNCATED,     // length does not match count * sampleSize
+  WIRE_BAD_CRC
+};
+
+inline const char* wireStatusName(WireStatus s) {
+  switch (s) {
+    case WIRE_OK: return "OK";
+    case WIRE_NOT_A_FRAME: return "NOT_A_FRAME";
+    case WIRE_BAD_VERSION: return "BAD_VERSION";
+    case WIRE_TRUNCATED: return "TRUNCATED";
+    case WIRE_BAD_CRC: return "BAD_CRC";
+  }
+  return "?";
+}
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+inline uint16_t wireCrc16(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF) {
+  while (len--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (int k = 0; k < 8; ++k) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+// --- fixed point helpers ---
+
+inline int16_t wireToI16(float v, float scale) {
+  if (isnan(v)) return WIRE_I16_MISSING;
+  float s = v * scale;
+  if (s >= 32767.0f) return 32767;
+  if (s <= -32767.0f) return -32767;
+  return (int16_t)(s < 0 ? s - 0.5f : s + 0.5f);
+}
+
+inline uint16_t wireToU16(float v, float scale) {
+  if (isnan(v)) return WIRE_U16_MISSING;
+  float s = v * scale;
+  if (s <= 0.0f) return 0;
+  if (s >= 65534.0f) return 65534;
+  return (uint16_t)(s + 0.5f);
+}
+
+inline float wireFromI16(int16_t v, float scale) {
+  return v == WIRE_I16_MISSING ? NAN : (float)v / scale;
+}
+
+inline float wireFromU16(uint16_t v, float scale) {
+  return v == WIRE_U16_MISSING ? NAN : (float)v / scale;
+}
+
+inline void wirePackSample(const sensor_payload_t &p, wire_sample_t &w) {
+  w.seq = p.seq;
+  w.tempCenti = wireToI16(p.tempC, 100.0f);
+  w.humidityCenti = wireToU16(p.humidity, 100.0f);
+  w.lux = wireToU16(p.lux, 1.0f);
+  w.windCenti = wireToU16(p.wind_kmh, 100.0f);
+  w.gustCenti = wireToU16(p.wind_gust_kmh, 100.0f);
+  w.avg2mCenti = wireToU16(p.wind_avg2m_kmh, 100.0f);
+  w.avg10mCenti = wireToU16(p.wind_avg10m_kmh, 100.0f);
+  w.var10mCenti = wireToU16(p.wind_var10m, 100.0f);
+  w.epochMs = p.epoch_ms;
+}
+
+inline void wireUnpackSample(const wire_sample_t &w, sensor_payload_t &p) {
+  sensorPayloadClear(p); // aggregates are not on the wire
+  p.seq = w.seq;
+  p.tempC = wireFromI16(w.tempCenti, 100.0f);
+  p.humidity = wireFromU16(w.humidityCenti, 100.0f);
+  p.lux = wireFromU16(w.lux, 1.0f);
+  p.wind_kmh = wireFromU16(w.windCenti, 100.0f);
+  p.wind_gust_kmh = wireFromU16(w.gustCenti, 100.0f);
+  p.wind_avg2m_kmh = wireFromU16(w.avg2mCenti, 100.0f);
+  p.wind_avg10m_kmh = wireFromU16(w.avg10mCenti, 100.0f);
+  p.wind_var10m = wireFromU16(w.var10mCenti, 100.0f);
+  p.epoch_ms = w.epochMs;
+}
+
+// Builds one frame in a caller-owned WIRE_MAX_FRAME buffer.
+class WireFrameBuilder {
+public:
+  explicit WireFrameBuilder(uint8_t* buf) : _buf(buf), _len(0) {}
+
+  void begin(WireMsgType type, uint16_t stationId, uint32_t seq, uint8_t group = WIRE_GROUP_NONE) {
+    wire_header_t h;
+    h.magic = WIRE_MAGIC;
+    h.version = WIRE_VERSION;
+    h.type = type;
+    h.count = 0;
+    h.stationId = stationId;
+    h.group = group;
+    h.sampleSize = sizeof(wire_sample_t);
+    h.seq = seq;
+    h.crc = 0;
+    memcpy(_buf, &h, sizeof(h));
+    _len = sizeof(h);
+  }
+
+  // False when the frame is full.
+  bool add(const sensor_payload_t &p) {
+    if (_len + sizeof(wire_sample_t) > WIRE_MAX_FRAME) return false;
+    wire_sample_t w;
+    wirePackSample(p, w);
+    memcpy(_buf + _len, &w, sizeof(w));
+    _len += sizeof(w);
+    _buf[offsetof(wire_header_t, count)]++;
+    return true;
+  }
+
+  uint8_t count() const { return _buf[offsetof(wire_header_t, count)]; }
+  bool full() const { return _len + sizeof(wire_sample_t) > WIRE_MAX_FRAME; }
+
+  // Seal the frame (CRC) and return its length.
+  size_t finish() {
+    _buf[offsetof(wire_header_t, crc)] = 0;
+    _buf[offsetof(wire_header_t, crc) + 1] = 0;
+    uint16_t crc = wireCrc16(_buf, _len);
+    memcpy(_buf + offsetof(wire_header_t, crc), &crc, sizeof(crc));
+    return _len;
+  }
+
+private:
+  uint8_t* _buf;
+  size_t _len;
+};
+
+// Validate a received buffer. The frame/not-frame decision is the first byte
+// only; on WIRE_OK, hdr is filled and samples can be read with wireSampleAt().
+inline WireStatus wireParse(const uint8_t* data, size_t len, wire_header_t &hdr) {
+  if (len < 1 || data[0] != WIRE_MAGIC) return WIRE_NOT_A_FRAME;
+  if (len < sizeof(wire_header_t)) return WIRE_TRUNCATED;
+  memcpy(&hdr, data, sizeof(hdr));
+  if (hdr.version == 0 || hdr.version > WIRE_VERSION) return WIRE_BAD_VERSION;
+  if (hdr.sampleSize < WIRE_SAMPLE_MIN_SIZE && hdr.count > 0) return WIRE_BAD_VERSION;
+  if (len != sizeof(wire_header_t) + (size_t)hdr.count * hdr.sampleSize) return WIRE_TRUNCATED;
+
+  uint16_t zero = 0;
+  uint16_t crc = wireCrc16(data, offsetof(wire_header_t, crc));
+  crc = wireCrc16((const uint8_t*)&zero, sizeof(zero), crc);
+  crc = wireCrc16(data + sizeof(wire_header_t), len - sizeof(wire_header_t), crc);
+  return crc == hdr.crc ? WIRE_OK : WIRE_BAD_CRC;
+}
+
+// Sample i of a frame that passed wireParse().
+inline void wireSampleAt(const uint8_t* data, const wire_header_t &hdr, size_t i, sensor_payload_t &out) {
+  wire_sample_t w;
+  size_t n = hdr.sampleSize < sizeof(w) ? hdr.sampleSize : sizeof(w);
+  memset(&w, 0, sizeof(w));
+  memcpy(&w, data + sizeof(wire_header_t) + i * hdr.sampleSize, n);
+  wireUnpackSample(w, out);
+}
+
+#endif // SHARED_WIREFORMAT_H
@@ -0,0 +1,261 @@
+#ifndef MANAGERS_CALIBRATION_H
+#define MANAGERS_CALIBRATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Compile-time sensor calibration.
+//
+// Every curve is a small struct with a constexpr reference function. The
+// lookup types below evaluate that function at compile time into a table (or
+// a fixed-point constant for linear curves), so the sample path only does an
+// index + linear interpolation and never calls libm. The interpolation error
+// against the reference function is checked with static_assert, so a curve
+// that does not fit its table fails the build instead of drifting on device.
+//
+// Requires C++17 (constexpr loops). Shared with firmware/weather_station.ino.
+
+namespace calib {
+
+// --- constexpr math used to build the tables (never called at run time) ---
+
+constexpr double PI_D = 3.14159265358979323846;
+constexpr double LN2_D = 0.69314718055994530942;
+
+constexpr double absd(double x) { return x < 0 ? -x : x; }
+
+// Natural log: x = m * 2^k with m in [1,2), ln(m) = 2*atanh((m-1)/(m+1)).
+constexpr double ln(double x) {
+  if (x <= 0) return -1e300;
+  int k = 0;
+  while (x >= 2.0) { x /= 2.0; ++k; }
+  while (x < 1.0) { x *= 2.0; --k; }
+  double z = (x - 1.0) / (x + 1.0);
+  double z2 = z * z;
+  double term = z;
+  double sum = 0.0;
+  for (int n = 1; n < 60; n += 2) {
+    sum += term / n;
+    term *= z2;
+  }
+  return 2.0 * sum + k * LN2_D;
+}
+
+// sin/cos by Taylor series after reduction to [-pi, pi].
+constexpr double sin(double x) {
+  while (x > PI_D) x -= 2 * PI_D;
+  while (x < -PI_D) x += 2 * PI_D;
+  double term = x;
+  double sum = 0.0;
+  for (int n = 1; n < 40; n += 2) {
+    sum += term;
+    term *= -x * x / ((n + 1) * (n + 2));
+  }
+  return sum;
+}
+
+constexpr double cos(double x) { return sin(x + PI_D / 2); }
+
+// atan for |x| <= 1 (argument halved twice so the series converges fast).
+constexpr double atan(double x) {
+  double s = x;
+  for (int i = 0; i < 2; ++i) {
+    // atan(x) = 2 * atan(x / (1 + sqrt(1 + x^2)))
+    double r = 1.0 + s * s;
+    double q = r;
+    for (int j = 0; j < 30; ++j) q = 0.5 * (q + r / q);
+    s = s / (1.0 + q);
+  }
+  double term = s;
+  double sum = 0.0;
+  for (int n = 1; n < 60; n += 2) {
+    sum += term / n;
+    term *= -s * s;
+  }
+  return 4.0 * sum;
+}
+
+// --- Curves: x is the sensor's natural unit, eval() returns the calibrated value ---
+
+// Anemometer, logarithmic fit from design/description/kalibratiecurve.tex:
+//   wind_kmh = 6.4056 * ln(pulses_per_sec) + 10.212   (R^2 = 0.9914)
+// Pulse rates below the noise floor and negative fit values read as 0.
+struct WindLogFit {
+  static constexpr double X_MAX = 100.0;      // pulses/s covered by the table
+  static constexpr double CHECK_FROM = 0.5;   // below this the clamp kink dominates
+  static constexpr double MAX_ERROR = 0.05;   // km/h
+  static constexpr double eval(double pps) {
+    if (pps < 0.05) return 0.0;
+    double v = 6.4056 * ln(pps) + 10.212;
+    return v > 0.0 ? v : 0.0;
+  }
+};
+
+// Anemometer, legacy physical conversion (40 mm cup radius, 1 pulse/rev).
+struct WindCupRadius40mm {
+  static constexpr double X_MAX = 100.0;
+  static constexpr double CHECK_FROM = 0.0;
+  static constexpr double MAX_ERROR = 0.001;
+  static constexpr double eval(double pps) {
+    return pps * (2.0 * PI_D * 0.04) * 3.6;
+  }
+};
+
+// BH1750 high resolution mode: lux = raw / 1.2 (datasheet).
+struct LuxBh1750 {
+  static constexpr double SCALE = 1.0 / 1.2;
+};
+
+// --- Lookup types ---
+
+// Uniform-grid table with linear interpolation over [0, Curve::X_MAX]; inputs
+// beyond X_MAX read as the last entry.
+template <class Curve, size_t N = 1025>
+class CurveTable {
+public:
+  static constexpr double STEP = Curve::X_MAX / (N - 1);
+
+  struct Data { float y[N]; };
+
+  static constexpr Data build() {
+    Data d{};
+    for (size_t i = 0; i < N; ++i) d.y[i] = (float)Curve::eval(i * STEP);
+    return d;
+  }
+
+  static constexpr Data TABLE = build();
+
+  // Largest |table - reference| probed at 8 points per interval.
+  static constexpr double maxError() {
+    double worst = 0.0;
+    for (size_t i = 0; i + 1 < N; ++i) {
+      for (int k = 1; k < 8; ++k) {
+        double x = (i + k / 8.0) * STEP;
+        if (x < Curve::CHECK_FROM) continue;
+        double y = TABLE.y[i] + (TABLE.y[i + 1] - TABLE.y[i]) * (k / 8.0);
+        double e = absd(y - Curve::eval(x));
+        if (e > worst) worst = e;
+      }
+    }
+    return worst;
+  }
+
+  static float lookup(float x) {
+    if (!(x > 0.0f)) return TABLE.y[0]; // also catches NaN
+    float pos = x * (float)(1.0 / STEP);
+    if (pos >= (float)(N - 1)) return TABLE.y[N - 1];
+    size_t i = (size_t)pos;
+    float frac = pos - (float)i;
+    return TABLE.y[i] + (TABLE.y[i + 1] - TABLE.y[i]) * frac;
+  }
+};
+
+// Linear curve as a Q16 fixed-point multiply. convert() rounds to integer
+// units; toFloat() keeps the 16 fractional bits.
+template <class Curve>
+class LinearQ16 {
+public:
+  static constexpr uint32_t SCALE_Q16 = (uint32_t)(Curve::SCALE * 65536.0 + 0.5);
+
+  static uint64_t q16(uint32_t raw) { return (uint64_t)raw * SCALE_Q16; }
+
+  static uint32_t convert(uint32_t raw) {
+    return (uint32_t)((q16(raw) + 0x8000u) >> 16);
+  }
+
+  static float toFloat(uint32_t raw) { return (float)q16(raw) * (1.0f / 65536.0f); }
+};
+
+// Gray-coded absolute direction encoder with Bits tracks. Each code maps
+// straight to a Q15 unit vector (the gray->binary decode is folded into the
+// table) so direction smoothing is integer sums plus one table-based atan2.
+template <unsigned Bits>
+class GrayDirection {
+public:
+  static constexpr unsigned CODES = 1u << Bits;
+
+  struct Vec { int16_t x; int16_t y; uint16_t centiDeg; };
+  struct Data { Vec v[CODES]; };
+
+  static constexpr unsigned grayToBinary(unsigned g) {
+    for (unsigned mask = g >> 1; mask != 0; mask >>= 1) g ^= mask;
+    return g;
+  }
+
+  static constexpr Data build() {
+    Data d{};
+    for (unsigned g = 0; g < CODES; ++g) {
+      double deg = grayToBinary(g) * (360.0 / CODES);
+      double rad = deg * PI_D / 180.0;
+      d.v[g].x = (int16_t)(cos(rad) * 32767.0 + (cos(rad) < 0 ? -0.5 : 0.5));
+      d.v[g].y = (int16_t)(sin(rad) * 32767.0 + (sin(rad) < 0 ? -0.5 : 0.5));
+      d.v[g].centiDeg = (uint16_t)(deg * 100.0 + 0.5);
+    }
+    return d;
+  }
+
+  static constexpr Data TABLE = build();
+
+  static const Vec& fromGray(unsigned gray) { return TABLE.v[gray & (CODES - 1)]; }
+};
+
+// atan2 in degrees [0, 360) from integer vector sums, via octant folding and
+// an N entry atan table on [0, 1].
+template <size_t N = 257>
+class Atan2Table {
+public:
+  static constexpr double MAX_ERROR = 0.01; // degrees
+
+  struct Data { float deg[N]; };
+
+  static constexpr Data build() {
+    Data d{};
+    for (size_t i = 0; i < N; ++i) d.deg[i] = (float)(atan((double)i / (N - 1)) * 180.0 / PI_D);
+    return d;
+  }
+
+  static constexpr Data TABLE = build();
+
+  static constexpr double maxError() {
+    double worst = 0.0;
+    for (size_t i = 0; i + 1 < N; ++i) {
+      for (int k = 1; k < 8; ++k) {
+        double r = (i + k / 8.0) / (N - 1);
+        double y = TABLE.deg[i] + (TABLE.deg[i + 1] - TABLE.deg[i]) * (k / 8.0);
+        double e = absd(y - atan(r) * 180.0 / PI_D);
+        if (e > worst) worst = e;
+      }
+    }
+    return worst;
+  }
+
+  static float atanUnit(float r) {
+    float pos = r * (float)(N - 1);
+    size_t i = (size_t)pos;
+    if (i >= N - 1) return TABLE.deg[N - 1];
+    float frac = pos - (float)i;
+    return TABLE.deg[i] + (TABLE.deg[i + 1] - TABLE.deg[i]) * frac;
+  }
+
+  static float degrees(int32_t y, int32_t x) {
+    if (x == 0 && y == 0) return 0.0f;
+    uint32_t ax = x < 0 ? (uint32_t)-x : (uint32_t)x;
+    uint32_t ay = y < 0 ? (uint32_t)-y : (uint32_t)y;
+    // angle within the first quadrant, folded around 45 degrees
+    float a = ay <= ax ? atanUnit((float)ay / (float)ax) : 90.0f - atanUnit((float)ax / (float)ay);
+    if (x < 0) a = 180.0f - a;
+    if (y < 0) a = 360.0f - a;
+    return a >= 360.0f ? a - 360.0f : a;
+  }
+};
+
+static_assert(CurveTable<WindLogFit>::maxError() < WindLogFit::MAX_ERROR,
+              "WindLogFit table too coarse");
+static_assert(CurveTable<WindCupRadius40mm>::maxError() < WindCupRadius40mm::MAX_ERROR,
+              "WindCupRadius40mm table too coarse");
+static_assert(Atan2Table<>::maxError() < Atan2Table<>::MAX_ERROR, "atan table too coarse");
+static_assert(LinearQ16<LuxBh1750>::SCALE_Q16 == 54613, "BH1750 scale");
+
+} // namespace calib
+
+#endif // MANAGERS_CALIBRATION_H
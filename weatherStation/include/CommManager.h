@@ -2,6 +2,12 @@
 #define MANAGERS_COMMMANAGER_H
 
 #include "Common.h"
+#include "MqttBatch.h"
+#include "MqttFields.h"
+#include "FlashLog.h"
+#include "PartitionFlash.h"
+#include "Link.h"
+#include "HttpUplink.h"
 
 class CommManager {
 public:
@@ -9,9 +15,47 @@ public:
   void begin();
 
 private:
+  int _sub; // sample bus subscriber id
+  MqttBatch<MQTT_BATCH_CAPACITY, UplinkEncoding> _batch;
+
+  // Offline backlog on flash
+  PartitionFlash _flash;
+  FlashLog<sensor_payload_t> _log;
+  bool _logReady;
+  unsigned long _lastReplay;
+
+  // Connection state machines (MQTT and HTTP depend on WiFi)
+  Link _wifi;
+  Link _mqtt;
+  Link _http;
+
+  // Batched keep-alive HTTP uplink (only when SERVER_URL is set)
+  bool _httpEnabled;
+  http_url_t _httpUrl;
+  HttpUplink<HTTP_QUEUE_CAPACITY, HTTP_BATCH_SAMPLES, HTTP_MAX_IN_FLIGHT, UplinkEncoding> _httpUplink;
+
+  // Uplink cost counters (PUBLISH calls and bytes on the wire)
+  uint32_t _mqttPublishes;
+  uint32_t _mqttBytes;
+  uint32_t _mqttSamples;
+  unsigned long _lastDiag;
+  unsigned long _lastBench;
+#if DIAG_ENABLED
+  void publishDiag();
+#endif
+#if LATENCY_BENCH
+  void reportBench();
+#endif
   static void taskEntry(void* pv);
   void task();
-  String makeJson(const sensor_payload_t &p);
+  void pollLinks(uint32_t now);
+  void printStatus();
+  bool publish(const char* suffix, const char* msg);
+  bool publish(const char* suffix, const uint8_t* msg, size_t len);
+  bool publishFields(const sensor_payload_t &payload);
+  void flushBatch();
+  void storeOffline(const sensor_payload_t &payload);
+  void replayBacklog();
 };
 
 #endif // MANAGERS_COMMMANAGER_H
\ No newline at end of file
@@ -7,11 +7,24 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 #include <freertos/semphr.h>
+#include "Calibration.h"
+#include "SensorPayload.h"
+#include "Serializer.h"
+#include "SampleBus.h"
+#include "I2cBus.h"
+#include "Diag.h"
+#include "TaskTopology.h"
+#include "LatencyBench.h"
+#include "PeerTable.h"
 
 // Display config
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
 #define OLED_RESET    -1
+#define OLED_ADDR     0x3C
+// Partial updates (FrameShadow.h): changed column runs per 8-pixel page
+static constexpr size_t DISPLAY_MAX_RUNS = 2;        // per page
+static constexpr size_t DISPLAY_RUN_MIN_GAP = 12;    // unchanged columns worth a new run
 
 // Pins and hardware defines
 #define DHTPIN 14
@@ -25,27 +38,199 @@ static constexpr float ANEMOMETER_RADIUS_M = 0.04f;
 // Using a single hall sensor and two magnets mounted on opposite sides -> 2 pulses per revolution
 static constexpr uint8_t PULSES_PER_REV = 1;
 
+// Anemometer counter backend: 1 = PCNT peripheral (hardware count + glitch
+// filter), 0 = falling-edge ISR with software debounce. Override with
+// -DANEMOMETER_USE_PCNT=0 in build_flags.
+#ifndef ANEMOMETER_USE_PCNT
+#define ANEMOMETER_USE_PCNT 1
+#endif
+static constexpr uint32_t ANEMOMETER_DEBOUNCE_US = 1000;   // ISR backend
+static constexpr uint16_t ANEMOMETER_PCNT_FILTER = 1023;   // PCNT backend, APB cycles (~12.8us)
+
+// Wind calibration curve (see Calibration.h). Pick the curve type matching
+// the anemometer model; the table is generated and error-checked at compile time.
+typedef calib::CurveTable<calib::WindLogFit> WindCalibration;
+
 // BH1750
 static constexpr uint8_t BH1750_ADDR = 0x23;
+static constexpr uint8_t BH1750_POWER_ON = 0x01;
 static constexpr uint8_t BH1750_ONE_TIME_HIGH_RES_MODE = 0x20;
 static constexpr uint8_t BH1750_CONTINUOUS_HIGH_RES_MODE = 0x10;
+static constexpr uint32_t BH1750_CONVERSION_MS = 180;   // high-res mode, worst case
+static constexpr float BH1750_COUNTS_PER_LUX = 1.2f;    // default MTreg
+
+// Manager tasks, one row per TaskId (TaskTopology.h), started with
+// startTask(). Queues: I2cTask holds up to queueLen transactions per device
+// (one SSD1306 update: 8 pages x 2 runs x (command + chunks)); EspNowTask
+// takes send results from the ESP-NOW callback; ConnectTask runs the
+// blocking MQTT/HTTP connects for CommTask. The WiFi stack runs on core 0
+// at priorities 18 (lwIP) and 23 (WiFi), above every row here.
+#if TASK_TOPOLOGY == 1
+static constexpr task_config_t TASK_TABLE[] = {
+  // name          core  prio  stack  queue
+  { "SensorTask",  1,    2,    4096,  0 },
+  { "I2cTask",     1,    3,    3072,  40 },
+  { "CommTask",    0,    2,    8192,  0 },
+  { "EspNowTask",  0,    3,    4096,  32 },
+  { "DisplayTask", 1,    1,    4096,  0 },
+  { "ConnectTask", 0,    1,    8192,  2 },
+};
+#elif TASK_TOPOLOGY == 2
+static constexpr task_config_t TASK_TABLE[] = {
+  // name          core           prio  stack  queue
+  { "SensorTask",  TASK_ANY_CORE, 2,    4096,  0 },
+  { "I2cTask",     TASK_ANY_CORE, 3,    3072,  40 },
+  { "CommTask",    TASK_ANY_CORE, 1,    8192,  0 },
+  { "EspNowTask",  TASK_ANY_CORE, 2,    4096,  32 },
+  { "DisplayTask", TASK_ANY_CORE, 1,    4096,  0 },
+  { "ConnectTask", TASK_ANY_CORE, 1,    8192,  2 },
+};
+#else
+static constexpr task_config_t TASK_TABLE[] = {
+  // name          core  prio  stack  queue
+  { "SensorTask",  1,    2,    4096,  0 },
+  { "I2cTask",     1,    3,    3072,  40 },
+  { "CommTask",    1,    1,    8192,  0 },
+  { "EspNowTask",  1,    2,    4096,  32 },
+  { "DisplayTask", 1,    1,    4096,  0 },
+  { "ConnectTask", 1,    1,    8192,  2 },
+};
+#endif
+static_assert(sizeof(TASK_TABLE) / sizeof(TASK_TABLE[0]) == TASK_COUNT, "one TASK_TABLE row per TaskId");
+static constexpr TaskTopology TASK_LAYOUT = (TaskTopology)TASK_TOPOLOGY;
+
+// Creates task id from its TASK_TABLE row; false (and a log line) on failure
+bool startTask(TaskId id, TaskFunction_t fn, void* arg, TaskHandle_t* handle = nullptr);
+void printTaskTable();
+
+// Shared I2C bus (I2cBus.h, I2cManager.h): one bus task owns Wire and runs
+// queued transactions, highest device priority first
+static constexpr uint32_t I2C_CLOCK_HZ = 400000;
+static constexpr size_t I2C_MAX_DEVICES = 3;
+static constexpr uint8_t I2C_PRIORITY_SENSOR = 2;
+static constexpr uint8_t I2C_PRIORITY_DISPLAY = 1;
+static constexpr unsigned long I2C_STATS_INTERVAL_MS = 60000;
+typedef I2cScheduler<I2C_MAX_DEVICES, TASK_TABLE[TASK_I2C].queueLen> I2cQueues;
 
 // Timing
 static constexpr unsigned long MEAS_INTERVAL_MS = 5000;
+// MQTT uplink: one publish per field per sample (legacy, the default), or one
+// batched message per MQTT_BATCH_MAX_SAMPLES samples / MQTT_BATCH_MAX_AGE_MS.
+// Batched mode only refreshes the per-field topics with the newest sample of
+// each flush, so subscribers of those topics see 1 sample in
+// MQTT_BATCH_MAX_SAMPLES; switch once they read <base>/batch. Both modes are
+// compared by test/test_mqtt_uplink.
+enum MqttUplinkMode : uint8_t { MQTT_UPLINK_PER_FIELD = 0, MQTT_UPLINK_BATCHED };
+static constexpr MqttUplinkMode MQTT_UPLINK_MODE = MQTT_UPLINK_PER_FIELD;
+static constexpr size_t MQTT_BATCH_MAX_SAMPLES = LATENCY_BENCH ? 1 : 6; // benchmark: no batching delay
+static constexpr unsigned long MQTT_BATCH_MAX_AGE_MS = 30000;
+static constexpr size_t MQTT_BATCH_CAPACITY = 2 * MQTT_BATCH_MAX_SAMPLES; // held while the broker is down
+static constexpr size_t MQTT_BATCH_BUFFER = 1024;
+static constexpr bool MQTT_BATCH_LEGACY_TOPICS = true; // also publish the newest sample per field
+// Encoding of the MQTT batch and HTTP bodies (Serializer.h): ser::Json,
+// ser::Cbor or ser::LineProtocol
+typedef ser::Json UplinkEncoding;
+
+// Store-and-forward log (FlashLog.h): samples that cannot be sent are kept on
+// the raw data partition and replayed on <base>/batch after reconnecting, one
+// batch per FLASH_LOG_REPLAY_INTERVAL_MS so live samples go first.
+static constexpr const char* FLASH_LOG_PARTITION = "spiffs";
+static constexpr uint32_t FLASH_LOG_MAX_BYTES = 512 * 1024;      // ~5k samples, 7 h at 5 s
+static constexpr size_t FLASH_LOG_REPLAY_BATCH = MQTT_BATCH_MAX_SAMPLES;
+static constexpr unsigned long FLASH_LOG_REPLAY_INTERVAL_MS = 1000;
+
+// SNTP (started whenever WiFi comes up); until the first sync the samples
+// carry epoch_ms = 0. A clock before NTP_VALID_AFTER_S counts as not set.
+static constexpr const char* NTP_SERVER = "pool.ntp.org";
+static constexpr const char* NTP_SERVER_FALLBACK = "time.nist.gov";
+static constexpr uint32_t NTP_VALID_AFTER_S = 1577836800; // 2020-01-01
+
+// Link state machines (Link.h): retry backoff range, connect timeouts
+static constexpr uint32_t WIFI_BACKOFF_MIN_MS = 1000;
+static constexpr uint32_t WIFI_BACKOFF_MAX_MS = 60000;
+static constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 15000;
+static constexpr uint32_t MQTT_BACKOFF_MIN_MS = 2000;
+static constexpr uint32_t MQTT_BACKOFF_MAX_MS = 120000;
+static constexpr uint32_t MQTT_CONNECT_TIMEOUT_MS = 5000;
+static constexpr uint16_t MQTT_SOCKET_TIMEOUT_S = 2; // bounds each PubSubClient::connect() step on ConnectTask
+static constexpr uint32_t HTTP_BACKOFF_MIN_MS = 5000;
+static constexpr uint32_t HTTP_BACKOFF_MAX_MS = 300000;
+static constexpr uint32_t HTTP_CONNECT_TIMEOUT_MS = 5000;
+static constexpr unsigned long LINK_POLL_MS = 250;   // poll period while a link is connecting
+
+// HTTP uplink (HttpUplink.h): JSON arrays over one keep-alive connection
+static constexpr size_t HTTP_BATCH_SAMPLES = 6;
+static constexpr unsigned long HTTP_BATCH_MAX_AGE_MS = 30000;
+static constexpr size_t HTTP_MAX_IN_FLIGHT = 2;       // pipelined requests awaiting a response
+static constexpr size_t HTTP_QUEUE_CAPACITY = 24;     // samples held while the server is unreachable
+static constexpr uint32_t HTTP_RESPONSE_TIMEOUT_MS = 10000;
+static constexpr uint32_t HTTP_SOCKET_TIMEOUT_S = 3;    // bounds the connect (and TLS handshake) on ConnectTask
+static constexpr unsigned long HTTP_POLL_MS = 20;     // response poll period while requests are in flight
+static constexpr const char* HTTP_ROOT_CA = nullptr;  // PEM for https verification (nullptr: not verified)
+
+// ESP-NOW delivery to the actuators (PeerTable.h, ReliableLink.h): frames
+// awaiting each peer's MAC ack, retransmits with a doubling delay from
+// ESPNOW_RETRY_DELAY_MS. Peers are listed in espnowPeers (main.cpp).
+// -DESPNOW_ENABLED=0 builds a station without actuators (no EspNowTask, no bus
+// subscriber); the latency benchmark always sends over ESP-NOW.
+#ifndef ESPNOW_ENABLED
+#define ESPNOW_ENABLED 1
+#endif
+#if LATENCY_BENCH && !ESPNOW_ENABLED
+#error "LATENCY_BENCH measures the ESP-NOW path, build with ESPNOW_ENABLED=1"
+#endif
+static constexpr uint8_t ESPNOW_MAX_PEERS = 8;            // at most ESP_NOW_MAX_TOTAL_PEER_NUM - 1 (broadcast)
+static constexpr uint8_t ESPNOW_WINDOW = 4;
+static constexpr uint8_t ESPNOW_MAX_RETRIES = 5;
+static constexpr uint32_t ESPNOW_RETRY_DELAY_MS = 50;
+static constexpr uint32_t ESPNOW_ACK_TIMEOUT_MS = 500;    // send callback overdue
+static constexpr uint8_t ESPNOW_PEER_LOST_AFTER = 3;      // dropped frames in a row
+static constexpr unsigned long ESPNOW_POLL_MS = 10;       // callback poll period while frames are in flight
+static constexpr unsigned long ESPNOW_STATS_INTERVAL_MS = 60000;
+static_assert(TASK_TABLE[TASK_ESPNOW].queueLen >= ESPNOW_MAX_PEERS * ESPNOW_WINDOW,
+              "EspNowTask queue: one send result per frame in flight");
+
+// Wind sub-sample period for gusts/rolling means (must divide 1000)
+static constexpr unsigned long WIND_SUBSAMPLE_MS = 1000;
+
+// Lux and wind oversampling: both are read every SENSOR_TICK_MS and
+// decimated (Decimator.h) to a mean and min/max per report, so short clouds
+// and gusts show up without sending more. false reads lux once per report.
+static constexpr bool LUX_OVERSAMPLING = true;
+static constexpr unsigned long SENSOR_TICK_MS = 200;       // 5 Hz; divides WIND_SUBSAMPLE_MS, > BH1750 conversion (180 ms max)
+static constexpr uint8_t OVERSAMPLE_FILTER_SHIFT = 2;      // IIR time constant ~4 ticks before min/max
+
+// Per-channel rolling aggregates (WindowStats.h) published with the raw
+// readings: window of the last reports, EWMA weight (the lux spike reference)
+static constexpr size_t SENSOR_WINDOW_SAMPLES = 12;   // 1 min at MEAS_INTERVAL_MS
+static constexpr float SENSOR_EWMA_ALPHA = 0.3f;
+static constexpr float LUX_MAX = 120000.0f;           // BH1750 full scale
+
+// Diagnostics (Diag.h, compiled out with -DDIAG_ENABLED=0): system report on
+// <base>/diag and one histogram per probe on <base>/diag/<probe>
+static constexpr unsigned long DIAG_INTERVAL_MS = 60000;
+static constexpr size_t DIAG_REPORT_BUFFER = 1536;
+static constexpr size_t DIAG_MAX_TASKS = 8;
+
+// Latency benchmark (LatencyBench.h, built with -DLATENCY_BENCH=1): exact
+// percentiles over the last BENCH_WINDOW samples per path, reported on
+// <base>/bench and the serial console
+static constexpr size_t BENCH_WINDOW = 256;
+static constexpr unsigned long BENCH_REPORT_INTERVAL_MS = 60000;
+static constexpr size_t BENCH_REPORT_BUFFER = 768;
 
-// Payload
-typedef struct __attribute__((packed)) {
-  float tempC;
-  float humidity;
-  float lux;
-  float wind_kmh; // wind speed in km/h (calibrated)
-  uint32_t seq;
-} sensor_payload_t;
+// Payload: sensor_payload_t lives in shared/WireFormat (SensorPayload.h), with
+// the ESP-NOW frame format used to send it to the actuator (WireFormat.h)
 
-// Queues (defined in main.cpp)
-extern QueueHandle_t espNowQueue;
-extern QueueHandle_t httpQueue;
-extern QueueHandle_t displayQueue;
+// Sample bus (defined in main.cpp): one pooled copy of every sample, read in
+// place by each subscriber (display: latest-only, uplinks: wait-bounded)
+static constexpr size_t SAMPLE_BUS_SLOTS = 8;
+static constexpr size_t SAMPLE_BUS_MAX_SUBSCRIBERS = 4;
+// How long a publish waits on an uplink SAMPLE_BUS_SLOTS samples behind
+// before that uplink loses its oldest sample
+static constexpr unsigned long SAMPLE_BUS_PUBLISH_WAIT_MS = 100;
+typedef SampleBus<sensor_payload_t, SAMPLE_BUS_SLOTS, SAMPLE_BUS_MAX_SUBSCRIBERS> SensorBus;
+extern SensorBus sampleBus;
 
 // Display object (defined in main.cpp)
 extern Adafruit_SSD1306 display;
@@ -54,6 +239,7 @@ extern Adafruit_SSD1306 display;
 extern const char* WIFI_SSID;
 extern const char* WIFI_PASS;
 extern const char* SERVER_URL;
-extern uint8_t actuatorMac[6];
+extern const espnow_peer_config_t espnowPeers[];
+extern const size_t espnowPeerCount;
 
 #endif // MANAGERS_COMMON_H
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef MANAGERS_DECIMATOR_H
+#define MANAGERS_DECIMATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fixed-point decimation of a fast sensor stream (lux, wind) down to one
+// value per report, integers only:
+//
+//   stage 1  first-order IIR low-pass, y += (x - y) / 2^Shift, Q8 state;
+//            takes the edge off single-tick noise (pulse quantisation,
+//            I2C glitches) before the extremes are taken
+//   stage 2  boxcar over the report window (order-1 CIC): the mean is the
+//            exact average of the raw ticks, min/max come from stage 1
+//
+// Inputs are in the caller's fixed-point unit (e.g. deci-lux, centi-km/h)
+// and must stay below 2^23 so the Q8 state fits an int32_t. take() closes
+// the window; the filter state carries over so windows join seamlessly.
+typedef struct {
+  int32_t mean;
+  int32_t min;
+  int32_t max;
+  uint16_t count; // ticks in the window, 0 = no data (other fields invalid)
+} decimated_t;
+
+template <uint8_t Shift>
+class Decimator {
+public:
+  static constexpr uint8_t FRAC = 8;
+
+  Decimator() : _y(0), _primed(false) { restart(); }
+
+  void add(int32_t x) {
+    int32_t xq = x * (1 << FRAC);
+    if (!_primed) {
+      _y = xq;
+      _primed = true;
+    } else {
+      _y += (xq - _y) / (1 << Shift);
+    }
+    int32_t f = (_y + (1 << (FRAC - 1))) >> FRAC;
+    if (_count == 0 || f < _min) _min = f;
+    if (_count == 0 || f > _max) _max = f;
+    _sum += x;
+    if (_count < UINT16_MAX) _count++;
+  }
+
+  // Statistics of the window since the previous take(); starts a new one.
+  decimated_t take() {
+    decimated_t d;
+    d.count = _count;
+    d.mean = _count ? (int32_t)((_sum + (_sum >= 0 ? _count / 2 : -(int64_t)(_count / 2))) / _count) : 0;
+    d.min = _min;
+    d.max = _max;
+    restart();
+    return d;
+  }
+
+  // Forget the filter state too (sensor re-initialised, long gap)
+  void reset() {
+    _primed = false;
+    restart();
+  }
+
+private:
+  int32_t _y;      // stage 1 output, Q8
+  bool _primed;
+  int64_t _sum;
+  int32_t _min;
+  int32_t _max;
+  uint16_t _count;
+
+  void restart() {
+    _sum = 0;
+    _min = 0;
+    _max = 0;
+    _count = 0;
+  }
+};
+
+#endif // MANAGERS_DECIMATOR_H
@@ -0,0 +1,111 @@
+#ifndef MANAGERS_DHT22DECODER_H
+#define MANAGERS_DHT22DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// DHT22 frame decoder working on a list of captured line edges.
+//
+// SensorManager records a timestamp and the new line level for every edge
+// while the sensor answers, then hands the list to dht22Decode(). The decoder
+// has no Arduino dependencies so recorded traces can be replayed on a host.
+//
+// Frame on the wire (after the host start pulse is released):
+//   response LOW ~80us, response HIGH ~80us,
+//   40 x (LOW ~50us, HIGH ~26us = '0' / ~70us = '1'),
+//   trailing LOW ~50us, then the line is released (HIGH).
+// Only completed HIGH pulses are used: the last 40 are the data bits and the
+// one before them must be the response pulse.
+
+typedef struct {
+  uint32_t us;   // timestamp of the edge (micros())
+  uint8_t level; // line level after the edge
+} dht22_edge_t;
+
+typedef struct {
+  float tempC;
+  float humidity;
+  uint8_t raw[5];
+} dht22_reading_t;
+
+enum Dht22Status : uint8_t {
+  DHT22_OK = 0,
+  DHT22_NO_RESPONSE,  // no HIGH pulse at all
+  DHT22_TRUNCATED,    // fewer pulses than a full frame
+  DHT22_NOISE,        // more pulses than a full frame can contain
+  DHT22_BAD_TIMING,   // response or bit pulse outside the datasheet window
+  DHT22_BAD_CHECKSUM
+};
+
+static constexpr size_t DHT22_FRAME_BITS = 40;
+// Response + 40 bits + optional host release pulse + a little slack for glitches
+static constexpr size_t DHT22_MAX_HIGH_PULSES = 48;
+static constexpr uint32_t DHT22_BIT_THRESHOLD_US = 48; // between 26us ('0') and 70us ('1')
+static constexpr uint32_t DHT22_BIT_MAX_US = 100;
+static constexpr uint32_t DHT22_RESPONSE_MIN_US = 50;
+static constexpr uint32_t DHT22_RESPONSE_MAX_US = 150;
+
+inline const char* dht22StatusName(Dht22Status s) {
+  switch (s) {
+    case DHT22_OK: return "ok";
+    case DHT22_NO_RESPONSE: return "no response";
+    case DHT22_TRUNCATED: return "truncated";
+    case DHT22_NOISE: return "noise";
+    case DHT22_BAD_TIMING: return "bad timing";
+    case DHT22_BAD_CHECKSUM: return "bad checksum";
+  }
+  return "unknown";
+}
+
+inline Dht22Status dht22Decode(const dht22_edge_t* edges, size_t count, dht22_reading_t &out) {
+  uint32_t highs[DHT22_MAX_HIGH_PULSES];
+  size_t nHighs = 0;
+
+  // Collect the width of every completed HIGH pulse. Repeated edges with the
+  // same level (a glitch seen twice) are collapsed onto the first one.
+  bool inHigh = false;
+  uint32_t riseUs = 0;
+  uint8_t lastLevel = 0xFF;
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t level = edges[i].level ? 1 : 0;
+    if (level == lastLevel) continue;
+    lastLevel = level;
+    if (level) {
+      inHigh = true;
+      riseUs = edges[i].us;
+    } else if (inHigh) {
+      inHigh = false;
+      if (nHighs == DHT22_MAX_HIGH_PULSES) return DHT22_NOISE;
+      highs[nHighs++] = edges[i].us - riseUs;
+    }
+  }
+
+  if (nHighs == 0) return DHT22_NO_RESPONSE;
+  if (nHighs < DHT22_FRAME_BITS + 1) return DHT22_TRUNCATED;
+
+  const uint32_t* bits = &highs[nHighs - DHT22_FRAME_BITS];
+  uint32_t response = bits[-1];
+  if (response < DHT22_RESPONSE_MIN_US || response > DHT22_RESPONSE_MAX_US) return DHT22_BAD_TIMING;
+
+  uint8_t data[5] = {0, 0, 0, 0, 0};
+  for (size_t i = 0; i < DHT22_FRAME_BITS; ++i) {
+    if (bits[i] > DHT22_BIT_MAX_US) return DHT22_BAD_TIMING;
+    data[i / 8] = (uint8_t)((data[i / 8] << 1) | (bits[i] > DHT22_BIT_THRESHOLD_US ? 1 : 0));
+  }
+
+  uint8_t sum = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+  if (sum != data[4]) return DHT22_BAD_CHECKSUM;
+
+  uint16_t rawHumidity = ((uint16_t)data[0] << 8) | data[1];
+  uint16_t rawTemp = ((uint16_t)data[2] << 8) | data[3];
+  out.humidity = rawHumidity / 10.0f;
+  if (rawTemp & 0x8000) {
+    out.tempC = -(float)(rawTemp & 0x7FFF) / 10.0f;
+  } else {
+    out.tempC = rawTemp / 10.0f;
+  }
+  for (size_t i = 0; i < 5; ++i) out.raw[i] = data[i];
+  return DHT22_OK;
+}
+
+#endif // MANAGERS_DHT22DECODER_H
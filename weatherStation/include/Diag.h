@@ -0,0 +1,167 @@
+#ifndef MANAGERS_DIAG_H
+#define MANAGERS_DIAG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Hot-path instrumentation: scoped microsecond timers feeding fixed-bucket
+// latency histograms, event counters, and per-task stack/CPU figures. The
+// report goes to <base>/diag (CommManager) and to the "diag" serial command.
+//
+//   DIAG_SCOPE(DIAG_DHT22);          // times the rest of the block
+//   DIAG_RECORD_US(DIAG_LUX, us);    // latency measured elsewhere
+//   DIAG_COUNT(DIAG_CTR_X);
+//   DIAG_COUNT_N(DIAG_CTR_X, n);
+//   DIAG_TASK();                     // first line of a task: stack/CPU tracking
+//
+// Each probe and counter has one writing task, so recording is a plain
+// increment with no lock. Build with -DDIAG_ENABLED=0 and the macros expand to
+// nothing and no diagnostics code or data is linked.
+#ifndef DIAG_ENABLED
+#define DIAG_ENABLED 1
+#endif
+
+enum DiagProbe : uint8_t {
+  DIAG_SENSOR_TICK = 0, // one SensorTask tick, including the report
+  DIAG_DHT22,           // readDHT22: start pulse, capture, decode
+  DIAG_LUX,             // BH1750 read: queued to callback
+  DIAG_I2C_TXN,         // one transaction on the bus task
+  DIAG_ENCODE,          // batch encoding (MQTT batch and backlog replay)
+  DIAG_MQTT_PUBLISH,    // mqttClient.publish
+  DIAG_ESPNOW_SEND,     // esp_now_send
+  DIAG_DISPLAY_UPDATE,  // diff, queue and transfer of one display update
+  DIAG_SENSOR_JITTER,   // SensorTask wake-up against its tick grid
+  DIAG_PROBE_COUNT
+};
+
+enum DiagCounter : uint8_t {
+  DIAG_CTR_DHT22_FAILED = 0,
+  DIAG_CTR_LUX_FAILED,
+  DIAG_CTR_MQTT_FAILED,       // publish returned false
+  DIAG_CTR_OFFLINE_LOST,      // sample neither sent nor logged to flash
+  DIAG_CTR_ESPNOW_STATUS_DROPPED, // send status queue full (xQueueSend, no wait)
+  DIAG_CTR_DISPLAY_FAILED,
+  DIAG_CTR_DISPLAY_UPDATES,   // updates sent
+  DIAG_CTR_DISPLAY_BYTES,     // I2C payload bytes of those updates
+  DIAG_CTR_SENSOR_OVERRUN,    // SensorTask woke a tick or more late (ticks skipped)
+  DIAG_COUNTER_COUNT
+};
+
+inline const char* diagProbeName(DiagProbe p) {
+  switch (p) {
+    case DIAG_SENSOR_TICK: return "sensor_tick";
+    case DIAG_DHT22: return "dht22";
+    case DIAG_LUX: return "lux";
+    case DIAG_I2C_TXN: return "i2c_txn";
+    case DIAG_ENCODE: return "encode";
+    case DIAG_MQTT_PUBLISH: return "mqtt_publish";
+    case DIAG_ESPNOW_SEND: return "espnow_send";
+    case DIAG_DISPLAY_UPDATE: return "display_update";
+    case DIAG_SENSOR_JITTER: return "sensor_jitter";
+    default: return "?";
+  }
+}
+
+inline const char* diagCounterName(DiagCounter c) {
+  switch (c) {
+    case DIAG_CTR_DHT22_FAILED: return "dht22_failed";
+    case DIAG_CTR_LUX_FAILED: return "lux_failed";
+    case DIAG_CTR_MQTT_FAILED: return "mqtt_failed";
+    case DIAG_CTR_OFFLINE_LOST: return "offline_lost";
+    case DIAG_CTR_ESPNOW_STATUS_DROPPED: return "espnow_status_dropped";
+    case DIAG_CTR_DISPLAY_FAILED: return "display_failed";
+    case DIAG_CTR_DISPLAY_UPDATES: return "display_updates";
+    case DIAG_CTR_DISPLAY_BYTES: return "display_bytes";
+    case DIAG_CTR_SENSOR_OVERRUN: return "sensor_overrun";
+    default: return "?";
+  }
+}
+
+// Log2 latency histogram in microseconds: bucket 0 is < 1 us, bucket k
+// covers [2^(k-1), 2^k) us and the last one everything from 2^(k-1) up
+static constexpr size_t DIAG_BUCKETS = 20; // open-ended from 262 ms
+
+typedef struct {
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t sumUs;
+  uint32_t bucket[DIAG_BUCKETS];
+} diag_histogram_t;
+
+inline size_t diagBucket(uint32_t us) {
+  size_t k = us ? 32 - (size_t)__builtin_clz(us) : 0;
+  return k < DIAG_BUCKETS ? k : DIAG_BUCKETS - 1;
+}
+
+// Upper edge of bucket k in us (the last one has none)
+inline uint32_t diagBucketEdge(size_t k) { return 1u << k; }
+
+inline void diagHistogramAdd(diag_histogram_t &h, uint32_t us) {
+  h.count++;
+  h.sumUs += us;
+  if (us > h.maxUs) h.maxUs = us;
+  h.bucket[diagBucket(us)]++;
+}
+
+// Bucket edge at or above the given fraction (permille) of the samples,
+// capped at the maximum seen (which the open last bucket reports); 0 when empty
+inline uint32_t diagPercentileUs(const diag_histogram_t &h, uint32_t permille) {
+  if (h.count == 0) return 0;
+  uint64_t rank = ((uint64_t)h.count * permille + 999) / 1000;
+  if (rank == 0) rank = 1;
+  uint64_t seen = 0;
+  for (size_t k = 0; k < DIAG_BUCKETS; ++k) {
+    seen += h.bucket[k];
+    if (seen >= rank) {
+      if (k + 1 == DIAG_BUCKETS) return h.maxUs;
+      uint32_t edge = diagBucketEdge(k);
+      return edge < h.maxUs ? edge : h.maxUs;
+    }
+  }
+  return h.maxUs;
+}
+
+#if DIAG_ENABLED
+#include <esp_timer.h>
+
+extern diag_histogram_t diagHistograms[DIAG_PROBE_COUNT];
+extern uint32_t diagCounters[DIAG_COUNTER_COUNT];
+
+inline void diagRecordUs(DiagProbe p, uint32_t us) { diagHistogramAdd(diagHistograms[p], us); }
+
+// esp_timer rather than the CPU cycle counter, which is per core (a task
+// can move cores inside a scope) and runs at whatever the CPU clock is
+class DiagScope {
+public:
+  explicit DiagScope(DiagProbe p) : _probe(p), _start(esp_timer_get_time()) {}
+  ~DiagScope() { diagRecordUs(_probe, (uint32_t)(esp_timer_get_time() - _start)); }
+
+private:
+  DiagProbe _probe;
+  int64_t _start;
+};
+
+void diagRegisterTask();  // calling task
+void diagReset();         // histograms and counters (not atomic w.r.t. writers)
+
+// JSON reports, 0 when cap is too small: system (heap, tasks, queues,
+// counters) and one probe's histogram
+size_t diagReportSystem(char* buf, size_t cap);
+size_t diagReportProbe(DiagProbe p, char* buf, size_t cap);
+
+#define DIAG_CONCAT2(a, b) a##b
+#define DIAG_CONCAT(a, b) DIAG_CONCAT2(a, b)
+#define DIAG_SCOPE(probe) DiagScope DIAG_CONCAT(_diagScope, __LINE__)(probe)
+#define DIAG_RECORD_US(probe, us) diagRecordUs((probe), (us))
+#define DIAG_COUNT(ctr) (diagCounters[(ctr)]++)
+#define DIAG_COUNT_N(ctr, n) (diagCounters[(ctr)] += (uint32_t)(n))
+#define DIAG_TASK() diagRegisterTask()
+#else
+#define DIAG_SCOPE(probe) ((void)0)
+#define DIAG_RECORD_US(probe, us) ((void)0)
+#define DIAG_COUNT(ctr) ((void)0)
+#define DIAG_COUNT_N(ctr, n) ((void)0)
+#define DIAG_TASK() ((void)0)
+#endif // DIAG_ENABLED
+
+#endif // MANAGERS_DIAG_H
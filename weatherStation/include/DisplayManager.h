@@ -2,6 +2,9 @@
 #define MANAGERS_DISPLAYMANAGER_H
 
 #include "Common.h"
+#include "FrameShadow.h"
+
+typedef FrameShadow<SCREEN_WIDTH, SCREEN_HEIGHT / 8, DISPLAY_MAX_RUNS, DISPLAY_RUN_MIN_GAP> DisplayShadow;
 
 class DisplayManager {
 public:
@@ -9,8 +12,23 @@ public:
   void begin();
 
 private:
+  int _sub; // sample bus subscriber id
+  int _dev; // I2C bus device id
+  DisplayShadow _shadow;       // what the panel shows; updates are sent from here
+  SemaphoreHandle_t _pushDone; // given when the last chunk of an update is out
+  StaticSemaphore_t _pushDoneBuf;
+  uint32_t _pushErrors;
+  portMUX_TYPE _pushMux = portMUX_INITIALIZER_UNLOCKED; // _pushErrors, _inFlight
+  uint32_t _inFlight;          // queued transactions whose callback has not run
+
   static void taskEntry(void* pv);
   void task();
+  void update();
+  bool pushRuns(const frame_run_t* runs, size_t count, size_t &bytes);
+  bool queue(const uint8_t* head, size_t headLen, const uint8_t* data, size_t len, i2c_callback_t cb);
+  bool waitIdle(uint32_t timeoutMs);
+  static void onFrameWrite(void* ctx, bool ok, const uint8_t* data, size_t len);
+  static void onFrameDone(void* ctx, bool ok, const uint8_t* data, size_t len);
 };
 
 #endif // MANAGERS_DISPLAYMANAGER_H
\ No newline at end of file
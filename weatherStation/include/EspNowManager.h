@@ -2,7 +2,11 @@
 #define MANAGERS_ESPNOWMANAGER_H
 
 #include "Common.h"
+#include <WiFi.h>
 #include <esp_now.h>
+#include "PeerTable.h"
+
+typedef PeerTable<ESPNOW_MAX_PEERS, ESPNOW_WINDOW> EspNowPeers;
 
 class EspNowManager {
 public:
@@ -10,9 +14,30 @@ public:
   void begin();
 
 private:
+  int _sub; // sample bus subscriber id
+  uint16_t _stationId;
+  EspNowPeers _peers;
+  bool _broadcastAll;     // a configured peer is FF:FF:FF:FF:FF:FF: one broadcast for everyone
+  uint32_t _broadcastSeq; // seq of those broadcasts
   static void onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status);
+  static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
   static void taskEntry(void* pv);
   void task();
+  void refreshPeers();
+  void sendSamples(const sensor_payload_t* samples, uint8_t count, uint32_t now);
+  bool sendBroadcast(const uint8_t* frame, size_t len);
+  void printStats();
+#if LATENCY_BENCH
+  // Sample stamps of unicast frames not yet on the air, per peer
+  typedef struct {
+    uint32_t seq;
+    uint8_t count; // 0 = free
+    uint64_t t_us[WIRE_MAX_SAMPLES];
+  } bench_frame_t;
+  bench_frame_t _benchFrames[ESPNOW_MAX_PEERS][ESPNOW_WINDOW];
+  void benchHold(uint8_t peer, uint32_t seq, const sensor_payload_t* samples, uint8_t count);
+  void benchSent(uint8_t peer, const uint8_t* frame);
+#endif
 };
 
-#endif // MANAGERS_ESPNOWMANAGER_H
\ No newline at end of file
+#endif // MANAGERS_ESPNOWMANAGER_H
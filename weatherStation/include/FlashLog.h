@@ -0,0 +1,324 @@
+#ifndef MANAGERS_FLASHLOG_H
+#define MANAGERS_FLASHLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Append-only store-and-forward log on raw NOR flash.
+//
+// The flash region is split into erase-sized segments used as a ring. Every
+// segment starts with a CRC-protected header (magic, segment sequence, record
+// size) followed by fixed-size record slots:
+//
+//   [state u8][pad x3][Record][crc32 u32]
+//
+// A slot is written in two steps: record + CRC first, then the state byte is
+// programmed to COMMITTED. Replayed records are marked CONSUMED by clearing
+// one more bit of the state byte, so no rewrite or erase is needed until the
+// segment comes around again. Because flash bits only go 1 -> 0, a power loss
+// at any point leaves either an erased slot, a torn slot (skipped on mount:
+// not erased but not committed, or bad CRC) or a complete one.
+//
+// When the ring is full the oldest segment is erased and its unsent records
+// are counted as overwritten. Nothing here depends on Arduino: the ESP32 build
+// uses PartitionFlash, a host build can use FileFlashDevice below.
+
+class FlashDevice {
+public:
+  virtual ~FlashDevice() {}
+  virtual uint32_t size() const = 0;        // bytes, multiple of sectorSize()
+  virtual uint32_t sectorSize() const = 0;  // erase unit
+  virtual bool read(uint32_t addr, void* dst, size_t len) = 0;
+  virtual bool write(uint32_t addr, const void* src, size_t len) = 0; // may only clear bits
+  virtual bool erase(uint32_t addr) = 0;    // erase the sector starting at addr to 0xFF
+};
+
+inline uint32_t flashLogCrc32(const void* data, size_t len, uint32_t crc = 0) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+  while (len--) {
+    crc ^= *p++;
+    for (int k = 0; k < 8; ++k) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+  }
+  return ~crc;
+}
+
+template <typename Record>
+class FlashLog {
+public:
+  static constexpr uint32_t MAGIC = 0x474C5357; // "WSLG"
+  static constexpr uint8_t SLOT_ERASED = 0xFF;
+  static constexpr uint8_t SLOT_COMMITTED = 0xFE;
+  static constexpr uint8_t SLOT_CONSUMED = 0xFC;
+  static constexpr uint32_t HEADER_SIZE = 16;
+  static constexpr uint32_t SLOT_SIZE = (4 + sizeof(Record) + 4 + 3) & ~3u;
+
+  explicit FlashLog(FlashDevice &dev)
+    : _dev(dev), _segments(0), _slotsPerSeg(0), _head(-1), _headSeq(0), _writeSlot(0),
+      _readSeg(0), _readSlot(0), _pending(0), _overwritten(0), _corrupt(0) {}
+
+  // Scan the flash and rebuild the write/read positions. Segments with a
+  // different record size (firmware changed the Record layout) are recycled.
+  bool mount() {
+    _segments = _dev.size() / _dev.sectorSize();
+    _slotsPerSeg = (_dev.sectorSize() - HEADER_SIZE) / SLOT_SIZE;
+    if (_segments < 2 || _slotsPerSeg == 0) return false;
+
+    _head = -1;
+    _pending = 0;
+    _corrupt = 0;
+    int32_t tail = -1;
+    uint32_t tailSeq = 0;
+    for (uint32_t s = 0; s < _segments; ++s) {
+      uint32_t seq;
+      if (!readHeader(s, seq)) continue;
+      if (_head < 0 || seq > _headSeq) { _head = (int32_t)s; _headSeq = seq; }
+      if (tail < 0 || seq < tailSeq) { tail = (int32_t)s; tailSeq = seq; }
+    }
+    if (_head < 0) {
+      _writeSlot = _slotsPerSeg; // forces a fresh segment on the first append
+      _readSeg = 0;
+      _readSlot = 0;
+      return true;
+    }
+
+    // Write position: first fully erased slot in the head segment
+    _writeSlot = 0;
+    while (_writeSlot < _slotsPerSeg && !slotErased((uint32_t)_head, _writeSlot)) _writeSlot++;
+
+    // Read position: first committed, unconsumed record from the oldest segment on
+    _readSeg = (uint32_t)tail;
+    _readSlot = 0;
+    bool found = false;
+    for (uint32_t s = (uint32_t)tail;; s = (s + 1) % _segments) {
+      uint32_t seq;
+      if (readHeader(s, seq)) {
+        uint32_t limit = (s == (uint32_t)_head) ? _writeSlot : _slotsPerSeg;
+        for (uint32_t i = 0; i < limit; ++i) {
+          uint8_t st = slotState(s, i);
+          if (st != SLOT_COMMITTED) continue;
+          if (!found) { _readSeg = s; _readSlot = i; found = true; }
+          _pending++;
+        }
+      }
+      if (s == (uint32_t)_head) break;
+    }
+    if (!found) { _readSeg = (uint32_t)_head; _readSlot = _writeSlot; }
+    return true;
+  }
+
+  bool append(const Record &rec) {
+    if (_head < 0 || _writeSlot >= _slotsPerSeg) {
+      if (!openSegment()) return false;
+    }
+    uint32_t addr = slotAddr((uint32_t)_head, _writeSlot);
+    uint8_t buf[SLOT_SIZE];
+    memset(buf, 0xFF, sizeof(buf));
+    memcpy(buf + 4, &rec, sizeof(Record));
+    uint32_t crc = flashLogCrc32(&rec, sizeof(Record));
+    memcpy(buf + 4 + sizeof(Record), &crc, 4);
+    _writeSlot++; // a torn slot is skipped, never rewritten
+    if (!_dev.write(addr, buf, SLOT_SIZE)) return false;
+    uint8_t st = SLOT_COMMITTED;
+    if (!_dev.write(addr, &st, 1)) return false;
+    _pending++;
+    return true;
+  }
+
+  // Copy up to `max` of the oldest unsent records into out without consuming
+  // them; records failing their CRC are skipped. Returns the number copied.
+  size_t peek(Record* out, size_t max) {
+    uint32_t seg = _readSeg, slot = _readSlot;
+    size_t n = 0;
+    while (n < max && next(seg, slot)) {
+      if (readRecord(seg, slot, out[n])) n++;
+      advance(seg, slot);
+    }
+    return n;
+  }
+
+  // Mark the next `count` valid records (as returned by peek) as sent.
+  void consume(size_t count) {
+    while (count > 0 && next(_readSeg, _readSlot)) {
+      Record tmp;
+      bool valid = readRecord(_readSeg, _readSlot, tmp);
+      uint8_t st = SLOT_CONSUMED;
+      _dev.write(slotAddr(_readSeg, _readSlot), &st, 1);
+      if (_pending) _pending--;
+      if (valid) count--; else _corrupt++;
+      advance(_readSeg, _readSlot);
+    }
+  }
+
+  uint32_t pending() const { return _pending; }
+  uint32_t overwritten() const { return _overwritten; }
+  uint32_t corrupt() const { return _corrupt; }
+  uint32_t capacity() const { return _segments * _slotsPerSeg; }
+
+private:
+  FlashDevice &_dev;
+  uint32_t _segments;
+  uint32_t _slotsPerSeg;
+  int32_t _head;      // segment being written (-1: none yet)
+  uint32_t _headSeq;
+  uint32_t _writeSlot;
+  uint32_t _readSeg;
+  uint32_t _readSlot;
+  uint32_t _pending;
+  uint32_t _overwritten;
+  uint32_t _corrupt;
+
+  uint32_t segAddr(uint32_t seg) const { return seg * _dev.sectorSize(); }
+  uint32_t slotAddr(uint32_t seg, uint32_t slot) const { return segAddr(seg) + HEADER_SIZE + slot * SLOT_SIZE; }
+
+  bool readHeader(uint32_t seg, uint32_t &seq) {
+    uint32_t h[4];
+    if (!_dev.read(segAddr(seg), h, sizeof(h))) return false;
+    if (h[0] != MAGIC || h[2] != sizeof(Record)) return false;
+    if (h[3] != flashLogCrc32(h, 12)) return false;
+    seq = h[1];
+    return true;
+  }
+
+  uint8_t slotState(uint32_t seg, uint32_t slot) {
+    uint8_t st = 0;
+    _dev.read(slotAddr(seg, slot), &st, 1);
+    return st;
+  }
+
+  bool slotErased(uint32_t seg, uint32_t slot) {
+    uint8_t buf[SLOT_SIZE];
+    if (!_dev.read(slotAddr(seg, slot), buf, SLOT_SIZE)) return false;
+    for (uint32_t i = 0; i < SLOT_SIZE; ++i) if (buf[i] != 0xFF) return false;
+    return true;
+  }
+
+  bool readRecord(uint32_t seg, uint32_t slot, Record &out) {
+    uint8_t buf[SLOT_SIZE];
+    if (!_dev.read(slotAddr(seg, slot), buf, SLOT_SIZE)) return false;
+    uint32_t crc;
+    memcpy(&crc, buf + 4 + sizeof(Record), 4);
+    if (crc != flashLogCrc32(buf + 4, sizeof(Record))) return false;
+    memcpy(&out, buf + 4, sizeof(Record));
+    return true;
+  }
+
+  // Move (seg, slot) onto the next committed, unconsumed slot; false at the write head.
+  bool next(uint32_t &seg, uint32_t &slot) {
+    while (_head >= 0) {
+      if (seg == (uint32_t)_head && slot >= _writeSlot) return false;
+      if (slot >= _slotsPerSeg) {
+        seg = (seg + 1) % _segments;
+        slot = 0;
+        continue;
+      }
+      if (slotState(seg, slot) == SLOT_COMMITTED) return true;
+      slot++;
+    }
+    return false;
+  }
+
+  void advance(uint32_t &seg, uint32_t &slot) {
+    if (++slot >= _slotsPerSeg && seg != (uint32_t)_head) {
+      seg = (seg + 1) % _segments;
+      slot = 0;
+    }
+  }
+
+  bool openSegment() {
+    uint32_t seg = _head < 0 ? 0 : ((uint32_t)_head + 1) % _segments;
+
+    // Reusing the segment the reader is in: its unsent records are lost
+    if (_pending && _readSeg == seg && _head >= 0) {
+      for (uint32_t i = _readSlot; i < _slotsPerSeg; ++i) {
+        if (slotState(seg, i) == SLOT_COMMITTED) {
+          _overwritten++;
+          _pending--;
+        }
+      }
+      _readSeg = (seg + 1) % _segments;
+      _readSlot = 0;
+    }
+
+    if (!_dev.erase(segAddr(seg))) return false;
+    uint32_t h[4] = { MAGIC, _head < 0 ? 1u : _headSeq + 1, (uint32_t)sizeof(Record), 0 };
+    h[3] = flashLogCrc32(h, 12);
+    if (!_dev.write(segAddr(seg), h, sizeof(h))) return false;
+
+    if (_head < 0) { _readSeg = seg; _readSlot = 0; }
+    _head = (int32_t)seg;
+    _headSeq = h[1];
+    _writeSlot = 0;
+    return true;
+  }
+};
+
+#ifndef ARDUINO
+#include <stdio.h>
+
+// Host stand-in: a file behaves like NOR flash (erase to 0xFF, writes AND
+// into the existing bytes). powerCutAfter(n) lets a test stop all writes
+// after n more bytes to simulate a power loss in the middle of a write.
+class FileFlashDevice : public FlashDevice {
+public:
+  FileFlashDevice(const char* path, uint32_t size, uint32_t sectorSize = 4096)
+    : _size(size), _sector(sectorSize), _budget(-1) {
+    _f = fopen(path, "r+b");
+    if (!_f) {
+      _f = fopen(path, "w+b");
+      uint8_t ff[256];
+      memset(ff, 0xFF, sizeof(ff));
+      for (uint32_t i = 0; _f && i < size; i += sizeof(ff)) fwrite(ff, 1, sizeof(ff), _f);
+    }
+  }
+  ~FileFlashDevice() { if (_f) fclose(_f); }
+
+  void powerCutAfter(long bytes) { _budget = bytes; }
+
+  uint32_t size() const override { return _size; }
+  uint32_t sectorSize() const override { return _sector; }
+
+  bool read(uint32_t addr, void* dst, size_t len) override {
+    if (!_f || addr + len > _size) return false;
+    fseek(_f, (long)addr, SEEK_SET);
+    return fread(dst, 1, len, _f) == len;
+  }
+
+  bool write(uint32_t addr, const void* src, size_t len) override {
+    if (!_f || addr + len > _size) return false;
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+    for (size_t i = 0; i < len; ++i) {
+      if (_budget == 0) return false;
+      if (_budget > 0) _budget--;
+      uint8_t cur;
+      fseek(_f, (long)(addr + i), SEEK_SET);
+      if (fread(&cur, 1, 1, _f) != 1) return false;
+      cur &= s[i];
+      fseek(_f, (long)(addr + i), SEEK_SET);
+      fwrite(&cur, 1, 1, _f);
+    }
+    fflush(_f);
+    return true;
+  }
+
+  bool erase(uint32_t addr) override {
+    if (!_f || addr % _sector || addr + _sector > _size) return false;
+    if (_budget == 0) return false;
+    uint8_t ff[256];
+    memset(ff, 0xFF, sizeof(ff));
+    fseek(_f, (long)addr, SEEK_SET);
+    for (uint32_t i = 0; i < _sector; i += sizeof(ff)) fwrite(ff, 1, sizeof(ff), _f);
+    fflush(_f);
+    return true;
+  }
+
+private:
+  FILE* _f;
+  uint32_t _size;
+  uint32_t _sector;
+  long _budget;
+};
+#endif // ARDUINO
+
+#endif // MANAGERS_FLASHLOG_H
@@ -0,0 +1,80 @@
+#ifndef MANAGERS_FRAMESHADOW_H
+#define MANAGERS_FRAMESHADOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Copy of what a page-organised panel (SSD1306: 8-pixel pages, one byte per
+// column) currently shows. update() compares a freshly rendered frame with
+// it and returns only the column runs that changed, at most MaxRuns per
+// page; changed columns closer together than MinGap are sent as one run,
+// since a new run costs an address command and a data prefix on the bus.
+// The shadow takes the new bytes, so the runs are sent straight from at()
+// and the frame buffer is free for the next render.
+typedef struct {
+  uint8_t page;
+  uint8_t first;   // columns, inclusive
+  uint8_t last;
+} frame_run_t;
+
+template <size_t Width, size_t Pages, size_t MaxRuns = 2, size_t MinGap = 12>
+class FrameShadow {
+public:
+  static_assert(Width > 0 && Width <= 256, "columns must fit a uint8_t");
+  static_assert(MaxRuns > 0, "need at least one run per page");
+  static constexpr size_t MAX_RUNS = Pages * MaxRuns;
+
+  FrameShadow() : _valid(false) { memset(_shown, 0, sizeof(_shown)); }
+
+  // The panel content is unknown (init, failed transfer): next update sends all
+  void invalidate() { _valid = false; }
+
+  // Fills runs[0..n) (room for MAX_RUNS), returns n; 0 when nothing changed
+  size_t update(const uint8_t* frame, frame_run_t* runs) {
+    size_t n = 0;
+    for (size_t p = 0; p < Pages; ++p) {
+      const uint8_t* row = frame + p * Width;
+      uint8_t* shown = _shown + p * Width;
+      if (!_valid) {
+        add(runs, n, p, 0, Width - 1);
+        memcpy(shown, row, Width);
+        continue;
+      }
+      size_t pageRuns = 0;
+      size_t last = 0;
+      bool open = false;
+      for (size_t c = 0; c < Width; ++c) {
+        if (row[c] == shown[c]) continue;
+        shown[c] = row[c];
+        if (open && (c - last < MinGap || pageRuns == MaxRuns)) {
+          last = c; // extend: gap too short to pay for a new run, or out of runs
+          continue;
+        }
+        if (open) runs[n - 1].last = (uint8_t)last;
+        add(runs, n, p, c, c);
+        pageRuns++;
+        last = c;
+        open = true;
+      }
+      if (open) runs[n - 1].last = (uint8_t)last;
+    }
+    _valid = true;
+    return n;
+  }
+
+  const uint8_t* at(const frame_run_t &r) const { return _shown + (size_t)r.page * Width + r.first; }
+
+private:
+  uint8_t _shown[Width * Pages];
+  bool _valid;
+
+  static void add(frame_run_t* runs, size_t &n, size_t page, size_t first, size_t last) {
+    runs[n].page = (uint8_t)page;
+    runs[n].first = (uint8_t)first;
+    runs[n].last = (uint8_t)last;
+    n++;
+  }
+};
+
+#endif // MANAGERS_FRAMESHADOW_H
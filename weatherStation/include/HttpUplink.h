@@ -0,0 +1,419 @@
+#ifndef MANAGERS_HTTPUPLINK_H
+#define MANAGERS_HTTPUPLINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SensorPayload.h"
+#include "SensorSchema.h"
+
+// Keep-alive HTTP/1.1 uplink: samples are queued and POSTed in batches over
+// one persistent connection, encoded with SENSOR_SCHEMA (ser::Json gives an
+// array of objects, Content-Type follows the encoding):
+//
+//   [{"temp":21.3,"humidity":45.2,"lux":812.5,"wind_kmh":3.1,...,"seq":101},...]
+//
+// Up to MaxInFlight requests are written back to back (pipelined) before
+// their responses come in; poll() never waits for a response. Responses are
+// parsed incrementally: only the status line and the headers that frame the
+// body (Content-Length, chunked, Connection: close) are looked at, the body
+// itself is discarded as it arrives. Latency is the time from writing a
+// request to seeing its status, at the resolution poll() is called with.
+//
+// Samples stay queued until their request is answered: 2xx and 4xx free
+// them, a transport error, timeout or 5xx puts every in-flight sample back in
+// the queue to be resent on the next connection. When the queue is full the
+// oldest sample that is not in flight is dropped.
+//
+// The connection is an HttpStream, so the protocol logic runs on a host
+// against a local server through PosixHttpStream below.
+
+class HttpStream {
+public:
+  virtual ~HttpStream() {}
+  virtual bool open() = 0;    // connect (TCP or TLS); true if already open
+  virtual bool isOpen() = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) = 0;
+  virtual int read(uint8_t* buf, size_t len) = 0; // bytes read, 0 if none yet, < 0 if closed
+  virtual void close() = 0;
+};
+
+typedef struct {
+  char host[64];
+  char path[96];
+  uint16_t port;
+  bool tls;
+} http_url_t;
+
+// Split http[s]://host[:port][/path]; false if the URL does not fit or parse.
+inline bool httpParseUrl(const char* url, http_url_t &out) {
+  if (strncmp(url, "http://", 7) == 0) { out.tls = false; out.port = 80; url += 7; }
+  else if (strncmp(url, "https://", 8) == 0) { out.tls = true; out.port = 443; url += 8; }
+  else return false;
+
+  size_t hostLen = strcspn(url, ":/");
+  if (hostLen == 0 || hostLen >= sizeof(out.host)) return false;
+  memcpy(out.host, url, hostLen);
+  out.host[hostLen] = '\0';
+  url += hostLen;
+
+  if (*url == ':') {
+    long port = strtol(url + 1, (char**)&url, 10);
+    if (port <= 0 || port > 65535) return false;
+    out.port = (uint16_t)port;
+  }
+  if (*url == '\0') url = "/";
+  if (*url != '/' || strlen(url) >= sizeof(out.path)) return false;
+  strcpy(out.path, url);
+  return true;
+}
+
+typedef struct {
+  uint32_t requests;       // POSTs written
+  uint32_t ok;             // 2xx
+  uint32_t rejected;       // 4xx, samples dropped
+  uint32_t failed;         // transport errors, timeouts, 5xx (samples requeued)
+  uint32_t samples;        // samples acknowledged with 2xx
+  uint32_t dropped;        // queue overflow
+  uint32_t lastLatencyMs;
+  uint32_t minLatencyMs;
+  uint32_t maxLatencyMs;
+  uint32_t totalLatencyMs; // over ok + rejected
+} http_uplink_stats_t;
+
+template <size_t Capacity, size_t BatchSamples, size_t MaxInFlight, class Encoding = ser::Json>
+class HttpUplink {
+public:
+  static_assert(Capacity > BatchSamples * MaxInFlight, "queue must outgrow what can be in flight");
+  static constexpr size_t RECORD_CAP = 512; // largest encoded SENSOR_SCHEMA record
+  static constexpr size_t BODY_CAP = BatchSamples * RECORD_CAP + 8;
+
+  HttpUplink(HttpStream &stream, uint32_t responseTimeoutMs)
+    : _stream(stream), _host(""), _path("/"), _timeout(responseTimeoutMs),
+      _first(0), _count(0), _inflightSamples(0), _numRequests(0), _queuedSince(0),
+      _resend(false), _stats() {
+    _stats.minLatencyMs = UINT32_MAX;
+    resetParser();
+  }
+
+  void setTarget(const char* host, const char* path) {
+    _host = host;
+    _path = path;
+  }
+
+  void add(const sensor_payload_t &p, uint32_t nowMs) {
+    if (_count == Capacity) dropOldestQueued();
+    if (queued() == 0) _queuedSince = nowMs;
+    _samples[(_first + _count) % Capacity] = p;
+    _count++;
+  }
+
+  // Read responses that arrived, then send batches while fewer than
+  // MaxInFlight requests are outstanding and a batch is full or maxAgeMs old.
+  // Returns false when the connection failed (it is closed and in-flight
+  // samples are requeued).
+  bool poll(uint32_t nowMs, uint32_t maxAgeMs) {
+    if (_numRequests > 0) {
+      if (!readResponses(nowMs)) return fail();
+      if (_numRequests > 0 && nowMs - _requests[0].sentMs >= _timeout) return fail();
+    }
+    while (_stream.isOpen() && _numRequests < MaxInFlight && queued() > 0 &&
+           (_resend || queued() >= BatchSamples || nowMs - _queuedSince >= maxAgeMs)) {
+      if (!sendBatch(nowMs)) return fail();
+      if (queued() == 0) _resend = false;
+    }
+    return true;
+  }
+
+  // The connection went away (link down): resend in-flight samples later.
+  void requeue() {
+    if (_inflightSamples > 0) _resend = true;
+    _inflightSamples = 0;
+    _numRequests = 0;
+    resetParser();
+  }
+
+  size_t queued() const { return _count - _inflightSamples; }
+  size_t inFlight() const { return _numRequests; }
+  const http_uplink_stats_t& stats() const { return _stats; }
+
+private:
+  enum ParseState : uint8_t {
+    RS_STATUS, RS_HEADERS, RS_BODY, RS_CHUNK_SIZE, RS_CHUNK_DATA, RS_CHUNK_END, RS_TRAILER
+  };
+
+  struct Request {
+    size_t samples;
+    uint32_t sentMs;
+  };
+
+  HttpStream &_stream;
+  const char* _host;
+  const char* _path;
+  uint32_t _timeout;
+
+  sensor_payload_t _samples[Capacity];
+  size_t _first;           // oldest sample (in flight first, then queued)
+  size_t _count;
+  size_t _inflightSamples;
+  Request _requests[MaxInFlight];
+  size_t _numRequests;
+  uint32_t _queuedSince;   // when the oldest queued sample was added
+  bool _resend;            // requeued samples waiting: send without batching delay
+  uint8_t _body[BODY_CAP];
+  http_uplink_stats_t _stats;
+
+  // Response parser
+  ParseState _state;
+  char _line[96];
+  size_t _lineLen;
+  int _status;
+  long _contentLength;
+  bool _chunked;
+  bool _closeAfter;
+  uint32_t _remaining;
+
+  const sensor_payload_t& at(size_t i) const { return _samples[(_first + i) % Capacity]; }
+
+  void dropOldestQueued() {
+    // Shift the in-flight samples up over the oldest queued one
+    for (size_t i = _inflightSamples; i > 0; --i) {
+      _samples[(_first + i) % Capacity] = _samples[(_first + i - 1) % Capacity];
+    }
+    _first = (_first + 1) % Capacity;
+    _count--;
+    _stats.dropped++;
+  }
+
+  void freeSamples(size_t n) {
+    _first = (_first + n) % Capacity;
+    _count -= n;
+    _inflightSamples -= n;
+  }
+
+  bool fail() {
+    _stats.failed++;
+    _stream.close();
+    requeue();
+    return false;
+  }
+
+  bool sendBatch(uint32_t nowMs) {
+    size_t n = queued() < BatchSamples ? queued() : BatchSamples;
+    size_t start = _inflightSamples;
+    size_t len = ser::encodeRecords<Encoding>(SENSOR_SCHEMA, n,
+                                              [this, start](size_t i) { return &at(start + i); },
+                                              _body, sizeof(_body));
+    if (len == 0) return false;
+
+    char head[224];
+    int hl = snprintf(head, sizeof(head),
+                      "POST %s HTTP/1.1\r\nHost: %s\r\nContent-Type: %s\r\n"
+                      "Content-Length: %u\r\nConnection: keep-alive\r\n\r\n",
+                      _path, _host, Encoding::CONTENT_TYPE, (unsigned)len);
+    if (hl <= 0 || (size_t)hl >= sizeof(head)) return false;
+    if (_stream.write((const uint8_t*)head, hl) != (size_t)hl) return false;
+    if (_stream.write(_body, len) != len) return false;
+
+    _requests[_numRequests].samples = n;
+    _requests[_numRequests].sentMs = nowMs;
+    _numRequests++;
+    _inflightSamples += n;
+    _stats.requests++;
+    if (queued() > 0) _queuedSince = nowMs;
+    return true;
+  }
+
+  void resetParser() {
+    _state = RS_STATUS;
+    _lineLen = 0;
+  }
+
+  // Oldest request answered
+  bool complete(uint32_t nowMs) {
+    Request r = _requests[0];
+    for (size_t i = 1; i < _numRequests; ++i) _requests[i - 1] = _requests[i];
+    _numRequests--;
+
+    if (_status >= 500) return false; // server trouble: requeue everything in flight
+    uint32_t latency = nowMs - r.sentMs;
+    _stats.lastLatencyMs = latency;
+    _stats.totalLatencyMs += latency;
+    if (latency < _stats.minLatencyMs) _stats.minLatencyMs = latency;
+    if (latency > _stats.maxLatencyMs) _stats.maxLatencyMs = latency;
+    if (_status >= 200 && _status < 300) {
+      _stats.ok++;
+      _stats.samples += r.samples;
+    } else {
+      _stats.rejected++;
+    }
+    freeSamples(r.samples);
+
+    if (_closeAfter) {
+      // Server ends the connection here; anything pipelined behind is resent
+      _stream.close();
+      requeue();
+    }
+    return true;
+  }
+
+  static bool startsWithNoCase(const char* s, const char* prefix) {
+    for (; *prefix; ++s, ++prefix) {
+      char c = *s;
+      if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+      if (c != *prefix) return false;
+    }
+    return true;
+  }
+
+  // One header or chunk-framing line (without CRLF). False on a protocol error.
+  bool onLine(uint32_t nowMs) {
+    switch (_state) {
+      case RS_STATUS: {
+        if (!startsWithNoCase(_line, "http/1.")) return false;
+        const char* sp = strchr(_line, ' ');
+        _status = sp ? atoi(sp + 1) : 0;
+        if (_status < 100) return false;
+        _contentLength = -1;
+        _chunked = false;
+        _closeAfter = _line[7] == '0'; // HTTP/1.0 closes unless told otherwise
+        _state = RS_HEADERS;
+        return true;
+      }
+      case RS_HEADERS:
+        if (_lineLen == 0) {
+          if (_status < 200) { _state = RS_STATUS; return true; } // 100 Continue
+          // 204 and 304 never have a body, whatever the headers say (RFC 9112
+          // 6.3; the same holds for HEAD, which is never sent here)
+          if (_status != 204 && _status != 304) {
+            if (_chunked) { _state = RS_CHUNK_SIZE; return true; }
+            if (_contentLength > 0) { _remaining = (uint32_t)_contentLength; _state = RS_BODY; return true; }
+            if (_contentLength < 0) _closeAfter = true; // no framing: body runs to close
+          }
+          _state = RS_STATUS;
+          return complete(nowMs);
+        }
+        if (startsWithNoCase(_line, "content-length:")) _contentLength = atol(_line + 15);
+        else if (startsWithNoCase(_line, "transfer-encoding:") && strstr(_line, "chunked")) _chunked = true;
+        else if (startsWithNoCase(_line, "connection:")) {
+          if (strstr(_line, "close")) _closeAfter = true;
+          else if (strstr(_line, "keep-alive")) _closeAfter = false;
+        }
+        return true;
+      case RS_CHUNK_SIZE:
+        _remaining = (uint32_t)strtoul(_line, NULL, 16);
+        _state = _remaining ? RS_CHUNK_DATA : RS_TRAILER;
+        return true;
+      case RS_CHUNK_END:
+        _state = RS_CHUNK_SIZE;
+        return true;
+      case RS_TRAILER:
+        if (_lineLen > 0) return true;
+        _state = RS_STATUS;
+        return complete(nowMs);
+      default:
+        return false;
+    }
+  }
+
+  bool readResponses(uint32_t nowMs) {
+    uint8_t buf[256];
+    while (_numRequests > 0) {
+      int n = _stream.read(buf, sizeof(buf));
+      if (n < 0) return false;
+      if (n == 0) return true;
+      for (int i = 0; i < n; ++i) {
+        if (_numRequests == 0) return true; // stray bytes after a close
+        if (_state == RS_BODY || _state == RS_CHUNK_DATA) {
+          // Discard the body without looking at it
+          uint32_t skip = (uint32_t)(n - i) < _remaining ? (uint32_t)(n - i) : _remaining;
+          _remaining -= skip;
+          i += (int)skip - 1;
+          if (_remaining == 0) {
+            if (_state == RS_CHUNK_DATA) {
+              _state = RS_CHUNK_END;
+            } else {
+              _state = RS_STATUS;
+              if (!complete(nowMs)) return false;
+            }
+          }
+          continue;
+        }
+        char c = (char)buf[i];
+        if (c == '\r') continue;
+        if (c != '\n') {
+          if (_lineLen + 1 < sizeof(_line)) _line[_lineLen++] = c;
+          continue;
+        }
+        _line[_lineLen] = '\0';
+        bool ok = onLine(nowMs);
+        _lineLen = 0;
+        if (!ok) return false;
+      }
+    }
+    return true;
+  }
+};
+
+#ifndef ARDUINO
+#include <netdb.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// Host stand-in over a plain TCP socket (no TLS), e.g. against a local
+// test server.
+class PosixHttpStream : public HttpStream {
+public:
+  PosixHttpStream(const char* host, uint16_t port) : _host(host), _port(port), _fd(-1) {}
+  ~PosixHttpStream() { close(); }
+
+  bool open() override {
+    if (_fd >= 0) return true;
+    char port[8];
+    snprintf(port, sizeof(port), "%u", (unsigned)_port);
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(_host, port, &hints, &res) != 0) return false;
+    _fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (_fd >= 0 && connect(_fd, res->ai_addr, res->ai_addrlen) != 0) close();
+    int one = 1;
+    if (_fd >= 0) setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    freeaddrinfo(res);
+    return _fd >= 0;
+  }
+
+  bool isOpen() override { return _fd >= 0; }
+
+  size_t write(const uint8_t* buf, size_t len) override {
+    if (_fd < 0) return 0;
+    ssize_t n = send(_fd, buf, len, MSG_NOSIGNAL);
+    return n < 0 ? 0 : (size_t)n;
+  }
+
+  int read(uint8_t* buf, size_t len) override {
+    if (_fd < 0) return -1;
+    ssize_t n = recv(_fd, buf, len, MSG_DONTWAIT);
+    if (n > 0) return (int)n;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+    return -1;
+  }
+
+  void close() override {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+  }
+
+private:
+  const char* _host;
+  uint16_t _port;
+  int _fd;
+};
+#endif // ARDUINO
+
+#endif // MANAGERS_HTTPUPLINK_H
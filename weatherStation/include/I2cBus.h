@@ -0,0 +1,218 @@
+#ifndef MANAGERS_I2CBUS_H
+#define MANAGERS_I2CBUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Shared I2C bus: every device gets a FIFO of transactions and one bus task
+// (I2cManager) runs them, so the display task and the sensor task never
+// touch Wire at the same time.
+//
+//   - a transaction is bounded (I2C_INLINE_BYTES of header plus at most
+//     I2C_MAX_CHUNK caller-owned bytes), so a framebuffer push is a series
+//     of short transactions and a sensor read waits for one chunk at most
+//   - the next transaction comes from the highest-priority device whose
+//     head is due, round-robin between equal priorities; a device's own
+//     transactions always run in submission order
+//   - afterMs delays a transaction relative to the end of the previous one
+//     on the same device: "start conversion" then "read 180 ms later"
+//   - the callback runs on the bus task once the transaction is done
+//
+// I2cScheduler is the queueing/arbitration part; it does no I/O itself and
+// takes the time as an argument, so it runs against a mock I2cPort on a host.
+
+static constexpr size_t I2C_INLINE_BYTES = 8;  // command bytes / small reads, copied
+static constexpr size_t I2C_MAX_CHUNK = 64;    // caller-owned bytes per transaction (Wire buffer is 128)
+
+class I2cPort {
+public:
+  virtual ~I2cPort() {}
+  // One START..STOP write: head bytes followed by data bytes
+  virtual bool write(uint8_t addr, const uint8_t* head, size_t headLen, const uint8_t* data, size_t len) = 0;
+  virtual bool read(uint8_t addr, uint8_t* out, size_t len) = 0;
+};
+
+// ok is false on a NACK or bus error; data/len are the bytes read (reads only)
+typedef void (*i2c_callback_t)(void* ctx, bool ok, const uint8_t* data, size_t len);
+
+enum I2cOp : uint8_t {
+  I2C_WRITE = 0,
+  I2C_READ
+};
+
+typedef struct {
+  I2cOp op;
+  uint8_t headLen;                   // write: bytes in head; read: bytes to read
+  uint8_t head[I2C_INLINE_BYTES];    // write header / read result
+  const uint8_t* data;               // write: caller-owned until the callback
+  uint16_t len;
+  uint32_t afterMs;
+  uint32_t queuedMs;
+  i2c_callback_t cb;
+  void* ctx;
+} i2c_txn_t;
+
+typedef struct {
+  uint32_t done;
+  uint32_t failed;
+  uint32_t rejected;   // queue full
+  uint32_t maxWaitMs;  // longest time from due to start
+} i2c_device_stats_t;
+
+template <size_t Devices, size_t Depth>
+class I2cScheduler {
+public:
+  I2cScheduler() : _numDevices(0), _rr(0) {}
+
+  // Device id, or -1 when the table is full
+  int addDevice(uint8_t addr, uint8_t priority) {
+    if (_numDevices >= Devices) return -1;
+    device_t &d = _dev[_numDevices];
+    d.addr = addr;
+    d.priority = priority;
+    d.first = 0;
+    d.count = 0;
+    d.headSince = 0;
+    d.stats = i2c_device_stats_t();
+    return (int)_numDevices++;
+  }
+
+  bool submitWrite(int dev, const uint8_t* head, size_t headLen, const uint8_t* data, size_t len,
+                   uint32_t afterMs, uint32_t now, i2c_callback_t cb = nullptr, void* ctx = nullptr) {
+    if (headLen > I2C_INLINE_BYTES || len > I2C_MAX_CHUNK || (len && !data)) return false;
+    i2c_txn_t* t = push(dev, now);
+    if (!t) return false;
+    t->op = I2C_WRITE;
+    t->headLen = (uint8_t)headLen;
+    if (headLen) memcpy(t->head, head, headLen);
+    t->data = data;
+    t->len = (uint16_t)len;
+    fill(*t, afterMs, now, cb, ctx);
+    return true;
+  }
+
+  bool submitRead(int dev, size_t len, uint32_t afterMs, uint32_t now,
+                  i2c_callback_t cb = nullptr, void* ctx = nullptr) {
+    if (len == 0 || len > I2C_INLINE_BYTES) return false;
+    i2c_txn_t* t = push(dev, now);
+    if (!t) return false;
+    t->op = I2C_READ;
+    t->headLen = (uint8_t)len;
+    t->data = nullptr;
+    t->len = 0;
+    fill(*t, afterMs, now, cb, ctx);
+    return true;
+  }
+
+  // Removes the transaction to run next; false when none is due.
+  bool take(uint32_t now, i2c_txn_t &out, int &dev, uint8_t &addr) {
+    int best = -1;
+    for (size_t k = 0; k < _numDevices; ++k) {
+      size_t i = (_rr + k) % _numDevices;
+      const device_t &d = _dev[i];
+      if (d.count == 0 || (int32_t)(now - due(d)) < 0) continue;
+      if (best < 0 || d.priority > _dev[best].priority) best = (int)i;
+    }
+    if (best < 0) return false;
+    device_t &d = _dev[best];
+    uint32_t wait = now - due(d);
+    if (wait > d.stats.maxWaitMs) d.stats.maxWaitMs = wait;
+    out = d.q[d.first];
+    d.first = (d.first + 1) % Depth;
+    d.count--;
+    _rr = ((size_t)best + 1) % _numDevices;
+    dev = best;
+    addr = d.addr;
+    return true;
+  }
+
+  // The transaction from take() is over; the device's next one is timed from now.
+  void finish(int dev, bool ok, uint32_t now) {
+    device_t &d = _dev[dev];
+    d.headSince = now;
+    if (ok) d.stats.done++;
+    else d.stats.failed++;
+  }
+
+  // 0 when something is due, UINT32_MAX when every queue is empty
+  uint32_t msUntilDue(uint32_t now) const {
+    uint32_t best = UINT32_MAX;
+    for (size_t i = 0; i < _numDevices; ++i) {
+      const device_t &d = _dev[i];
+      if (d.count == 0) continue;
+      int32_t left = (int32_t)(due(d) - now);
+      uint32_t ms = left > 0 ? (uint32_t)left : 0;
+      if (ms < best) best = ms;
+    }
+    return best;
+  }
+
+  size_t pending(int dev) const { return _dev[dev].count; }
+  size_t devices() const { return _numDevices; }
+  uint8_t address(int dev) const { return _dev[dev].addr; }
+  const i2c_device_stats_t& stats(int dev) const { return _dev[dev].stats; }
+
+  // Runs one transaction on port (host tests; I2cManager does the same with
+  // the queues unlocked around the I/O). Returns false when nothing was due.
+  bool step(I2cPort &port, uint32_t now) {
+    i2c_txn_t t;
+    int dev;
+    uint8_t addr;
+    if (!take(now, t, dev, addr)) return false;
+    bool ok = execute(port, addr, t);
+    finish(dev, ok, now);
+    complete(t, ok);
+    return true;
+  }
+
+  static bool execute(I2cPort &port, uint8_t addr, i2c_txn_t &t) {
+    if (t.op == I2C_READ) return port.read(addr, t.head, t.headLen);
+    return port.write(addr, t.head, t.headLen, t.data, t.len);
+  }
+
+  static void complete(const i2c_txn_t &t, bool ok) {
+    if (!t.cb) return;
+    if (t.op == I2C_READ) t.cb(t.ctx, ok, t.head, ok ? t.headLen : 0);
+    else t.cb(t.ctx, ok, nullptr, 0);
+  }
+
+private:
+  typedef struct {
+    uint8_t addr;
+    uint8_t priority;
+    i2c_txn_t q[Depth];
+    size_t first;
+    size_t count;
+    uint32_t headSince;   // previous transaction finished, or queue went non-empty
+    i2c_device_stats_t stats;
+  } device_t;
+
+  device_t _dev[Devices];
+  size_t _numDevices;
+  size_t _rr;             // round-robin start
+
+  static uint32_t due(const device_t &d) { return d.headSince + d.q[d.first].afterMs; }
+
+  i2c_txn_t* push(int dev, uint32_t now) {
+    if (dev < 0 || (size_t)dev >= _numDevices) return nullptr;
+    device_t &d = _dev[dev];
+    if (d.count >= Depth) {
+      d.stats.rejected++;
+      return nullptr;
+    }
+    if (d.count == 0 && (int32_t)(now - d.headSince) > 0) d.headSince = now;
+    i2c_txn_t* t = &d.q[(d.first + d.count) % Depth];
+    d.count++;
+    return t;
+  }
+
+  static void fill(i2c_txn_t &t, uint32_t afterMs, uint32_t now, i2c_callback_t cb, void* ctx) {
+    t.afterMs = afterMs;
+    t.queuedMs = now;
+    t.cb = cb;
+    t.ctx = ctx;
+  }
+};
+
+#endif // MANAGERS_I2CBUS_H
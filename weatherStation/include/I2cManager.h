@@ -0,0 +1,57 @@
+#ifndef MANAGERS_I2CMANAGER_H
+#define MANAGERS_I2CMANAGER_H
+
+#include "Common.h"
+#include <freertos/task.h>
+
+// Owns Wire: devices queue transactions (I2cBus.h) from any task and the
+// bus task runs them one at a time, so no task holds the bus for longer
+// than one bounded transaction.
+class I2cManager {
+public:
+  I2cManager();
+
+  // Wire.begin and the bus task; call once from setup() before any device
+  void begin(int sda, int scl, uint32_t clockHz);
+
+  // Device id for write()/read(), -1 when the table is full
+  int addDevice(uint8_t addr, uint8_t priority);
+
+  // Queue a transaction. data must stay valid until the callback (or until
+  // the device's next transaction starts). False when the queue is full.
+  bool write(int dev, const uint8_t* head, size_t headLen, const uint8_t* data = nullptr, size_t len = 0,
+             uint32_t afterMs = 0, i2c_callback_t cb = nullptr, void* ctx = nullptr);
+  bool read(int dev, size_t len, uint32_t afterMs, i2c_callback_t cb, void* ctx);
+
+  // Exclusive synchronous use of Wire, for library code that drives the bus
+  // itself (SSD1306 init); queued transactions wait meanwhile
+  bool lock(TickType_t wait = portMAX_DELAY);
+  void unlock();
+  bool probe(uint8_t addr); // ACK at addr
+
+  // Bus time spent on dev's queued transactions so far; up to date in its callbacks
+  uint32_t busyUs(int dev) const { return dev >= 0 && (size_t)dev < I2C_MAX_DEVICES ? _busyUs[dev] : 0; }
+
+  size_t devices() const { return _queues.devices(); }
+  uint8_t address(int dev) const { return _queues.address(dev); }
+  i2c_device_stats_t stats(int dev, size_t &pending);
+  void printStats();
+
+private:
+  I2cQueues _queues;
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED; // _queues
+  SemaphoreHandle_t _wire;
+  StaticSemaphore_t _wireBuf;
+  TaskHandle_t _task;
+  uint32_t _maxHoldUs; // longest transaction, queue or lock()
+  uint32_t _busyUs[I2C_MAX_DEVICES];
+
+  static void taskEntry(void* pv);
+  void task();
+  void wake();
+};
+
+// Defined in main.cpp
+extern I2cManager i2cBus;
+
+#endif // MANAGERS_I2CMANAGER_H
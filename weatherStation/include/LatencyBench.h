@@ -0,0 +1,90 @@
+#ifndef MANAGERS_LATENCYBENCH_H
+#define MANAGERS_LATENCYBENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Sensor-to-radio latency benchmark. Every sample carries the monotonic
+// instant of its report tick (sensor_payload_t::t_us); when a path hands the
+// sample to the network stack, the age of that stamp is one latency:
+//
+//   mqtt    mqttClient.publish() of the batch (or every field) succeeded
+//   espnow  esp_now_send() accepted the first transmission of the sample's frame
+//
+// Build with -DLATENCY_BENCH=1 and -DTASK_TOPOLOGY=n (TaskTopology.h), once
+// per layout; the MQTT batch then holds a single sample so batching does not
+// mask the task layout. Percentiles are exact over the last BENCH_WINDOW
+// samples of each path. Without the flag BENCH_RECORD() expands to nothing.
+#ifndef LATENCY_BENCH
+#define LATENCY_BENCH 0
+#endif
+
+enum BenchPath : uint8_t {
+  BENCH_MQTT = 0,
+  BENCH_ESPNOW,
+  BENCH_PATH_COUNT
+};
+
+inline const char* benchPathName(BenchPath p) {
+  switch (p) {
+    case BENCH_MQTT: return "mqtt";
+    case BENCH_ESPNOW: return "espnow";
+    default: return "?";
+  }
+}
+
+// Last N latencies of one path, in us
+template <size_t N>
+class LatencyWindow {
+public:
+  LatencyWindow() : _next(0), _count(0), _total(0) {}
+
+  void add(uint32_t us) {
+    _us[_next] = us;
+    _next = (_next + 1) % N;
+    if (_count < N) _count++;
+    _total++;
+  }
+
+  void clear() {
+    _next = 0;
+    _count = 0;
+    _total = 0;
+  }
+
+  size_t count() const { return _count; }
+  uint32_t total() const { return _total; } // since the last clear(), beyond the window too
+
+  // Copies the window into out (N entries), in no particular order; returns count()
+  size_t copyTo(uint32_t* out) const {
+    for (size_t i = 0; i < _count; ++i) out[i] = _us[i];
+    return _count;
+  }
+
+private:
+  uint32_t _us[N];
+  size_t _next;
+  size_t _count;
+  uint32_t _total;
+};
+
+// Nearest-rank percentile (permille) of n ascending values; 0 when empty
+inline uint32_t benchPercentile(const uint32_t* sorted, size_t n, uint32_t permille) {
+  if (n == 0) return 0;
+  size_t rank = (size_t)(((uint64_t)n * permille + 999) / 1000);
+  if (rank == 0) rank = 1;
+  return sorted[rank - 1];
+}
+
+#if LATENCY_BENCH
+void benchRecord(BenchPath path, uint64_t sampleUs); // latency of a sample stamped at sampleUs
+void benchReset();
+// JSON: topology, task table and per-path n/p50/p90/p99/max; 0 when cap is too small
+size_t benchReport(char* buf, size_t cap);
+
+#define BENCH_RECORD(path, sampleUs) benchRecord((path), (sampleUs))
+#else
+#define BENCH_RECORD(path, sampleUs) ((void)0)
+#endif // LATENCY_BENCH
+
+#endif // MANAGERS_LATENCYBENCH_H
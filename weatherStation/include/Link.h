@@ -0,0 +1,182 @@
+#ifndef MANAGERS_LINK_H
+#define MANAGERS_LINK_H
+
+#include <stdint.h>
+
+// Connection state machine for one uplink (WiFi, MQTT or HTTP).
+//
+// CommManager calls poll() every loop iteration with the current time and
+// whether the link it depends on (WiFi for MQTT/HTTP) is up. poll() never
+// waits: it starts an attempt through the LinkPort, checks for completion
+// on later calls and schedules retries with exponential backoff plus
+// jitter. Transports that can only connect synchronously (PubSubClient, the
+// TLS handshake) hand the attempt to CommManager's connect task, so start()
+// returns at once and the result shows up in connected() or failed().
+//
+//   DOWN -> CONNECTING -> UP
+//              |          | lost / reportError()
+//              v          v
+//           BACKOFF <-----+   (retry at now + backoff, backoff doubles)
+//
+// A link that was up reconnects immediately after a drop; only failed
+// attempts back off. Time comes in as a parameter and the port is an
+// interface, so the state machine runs on a host with a fake clock and link.
+
+enum LinkState : uint8_t {
+  LINK_DOWN = 0,    // parent down or not started
+  LINK_CONNECTING,  // attempt in progress
+  LINK_UP,
+  LINK_BACKOFF      // waiting to retry
+};
+
+inline const char* linkStateName(LinkState s) {
+  switch (s) {
+    case LINK_DOWN: return "DOWN";
+    case LINK_CONNECTING: return "CONNECTING";
+    case LINK_UP: return "UP";
+    case LINK_BACKOFF: return "BACKOFF";
+  }
+  return "?";
+}
+
+// What the state machine needs from the real (or fake) connection.
+class LinkPort {
+public:
+  virtual ~LinkPort() {}
+
+  // Start an attempt; return false if it failed right away. May complete
+  // synchronously (connected() is true on return) but must not block.
+  virtual bool start() = 0;
+
+  // Connection currently usable.
+  virtual bool connected() = 0;
+
+  // The attempt in progress has failed (before the connect timeout).
+  virtual bool failed() { return false; }
+
+  // Tear down after the parent link went away.
+  virtual void stop() = 0;
+};
+
+typedef struct {
+  uint32_t attempts;
+  uint32_t failures; // attempts that failed or timed out
+  uint32_t drops;    // up -> lost
+  uint32_t ups;
+} link_stats_t;
+
+class Link {
+public:
+  Link(const char* name, LinkPort &port, uint32_t minBackoffMs, uint32_t maxBackoffMs,
+       uint32_t connectTimeoutMs, uint32_t seed)
+    : _name(name), _port(port), _minBackoff(minBackoffMs), _maxBackoff(maxBackoffMs),
+      _timeout(connectTimeoutMs), _backoff(minBackoffMs), _state(LINK_DOWN),
+      _since(0), _retryAt(0), _rng(seed ? seed : 1), _stats() {}
+
+  void poll(uint32_t now, bool parentUp) {
+    if (!parentUp) {
+      if (_state != LINK_DOWN) {
+        if (_state == LINK_UP) _stats.drops++;
+        _port.stop();
+        enter(LINK_DOWN, now);
+      }
+      _backoff = _minBackoff;
+      return;
+    }
+
+    switch (_state) {
+      case LINK_DOWN:
+        attempt(now);
+        break;
+      case LINK_CONNECTING:
+        if (_port.connected()) up(now);
+        else if (_port.failed() || now - _since >= _timeout) fail(now);
+        break;
+      case LINK_UP:
+        if (!_port.connected()) {
+          _stats.drops++;
+          attempt(now);
+        }
+        break;
+      case LINK_BACKOFF:
+        if ((int32_t)(now - _retryAt) >= 0) attempt(now);
+        break;
+    }
+  }
+
+  // The data path saw the link fail (publish/POST error): back off.
+  void reportError(uint32_t now) {
+    if (_state != LINK_UP) return;
+    _stats.drops++;
+    fail(now);
+  }
+
+  bool up() const { return _state == LINK_UP; }
+  LinkState state() const { return _state; }
+  const char* name() const { return _name; }
+  const link_stats_t& stats() const { return _stats; }
+  uint32_t since() const { return _since; }
+
+  // Time until poll() has something to do (retry or connect timeout); 0 when
+  // it should be polled right away, UINT32_MAX when it only reacts to events.
+  uint32_t msUntilNextAction(uint32_t now) const {
+    switch (_state) {
+      case LINK_CONNECTING: return 0;
+      case LINK_BACKOFF: {
+        int32_t left = (int32_t)(_retryAt - now);
+        return left > 0 ? (uint32_t)left : 0;
+      }
+      default: return UINT32_MAX;
+    }
+  }
+
+private:
+  const char* _name;
+  LinkPort &_port;
+  uint32_t _minBackoff;
+  uint32_t _maxBackoff;
+  uint32_t _timeout;
+  uint32_t _backoff;   // next retry delay before jitter
+  LinkState _state;
+  uint32_t _since;     // time of the last state change
+  uint32_t _retryAt;
+  uint32_t _rng;
+  link_stats_t _stats;
+
+  void enter(LinkState s, uint32_t now) {
+    _state = s;
+    _since = now;
+  }
+
+  void attempt(uint32_t now) {
+    _stats.attempts++;
+    enter(LINK_CONNECTING, now);
+    if (!_port.start()) fail(now);
+    else if (_port.connected()) up(now);
+  }
+
+  void up(uint32_t now) {
+    _stats.ups++;
+    _backoff = _minBackoff;
+    enter(LINK_UP, now);
+  }
+
+  // Equal jitter: wait between backoff/2 and backoff so stations that lost
+  // the same AP do not retry in lockstep.
+  void fail(uint32_t now) {
+    _stats.failures++;
+    uint32_t half = _backoff / 2;
+    _retryAt = now + half + (half ? nextRandom() % (half + 1) : 0);
+    _backoff = _backoff >= _maxBackoff / 2 ? _maxBackoff : _backoff * 2;
+    enter(LINK_BACKOFF, now);
+  }
+
+  uint32_t nextRandom() { // xorshift32
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return _rng;
+  }
+};
+
+#endif // MANAGERS_LINK_H
@@ -0,0 +1,70 @@
+#ifndef MANAGERS_MQTTBATCH_H
+#define MANAGERS_MQTTBATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SensorPayload.h"
+#include "SensorSchema.h"
+
+// Sample batch for the single-message MQTT uplink.
+//
+// CommManager adds every sample and flushes when MQTT_BATCH_MAX_SAMPLES are
+// queued or the oldest one is MQTT_BATCH_MAX_AGE_MS old. The batch is one
+// columnar message on <base>/batch (SENSOR_BATCH_SCHEMA; with ser::Json):
+//
+//   {"f":["seq","ts","temp","humidity","windspeed","windgust","light",
+//         "tempavg","humavg","lightavg"],
+//    "d":[[101,1760000000000,21.3,45.2,3.1,5.0,812.5,21.1,45.6,790.2],[102,...]]}
+//
+// Unavailable values are null; ts is the sample instant in Unix ms (0 before
+// the station's clock was set), so replayed backlog keeps its own time. When
+// full, the oldest sample is overwritten (counted in dropped()) so a broker
+// outage cannot grow it.
+template <size_t Capacity, class Encoding = ser::Json>
+class MqttBatch {
+public:
+  MqttBatch() : _first(0), _count(0), _firstMs(0), _dropped(0) {}
+
+  void add(const sensor_payload_t &p, uint32_t nowMs) {
+    if (_count == 0) _firstMs = nowMs;
+    if (_count == Capacity) {
+      _first = (_first + 1) % Capacity;
+      _count--;
+      _dropped++;
+    }
+    _samples[(_first + _count) % Capacity] = p;
+    _count++;
+  }
+
+  size_t size() const { return _count; }
+  bool empty() const { return _count == 0; }
+  uint32_t dropped() const { return _dropped; }
+
+  void clear() {
+    _first = 0;
+    _count = 0;
+  }
+
+  bool due(uint32_t nowMs, size_t maxSamples, uint32_t maxAgeMs) const {
+    if (_count == 0) return false;
+    return _count >= maxSamples || nowMs - _firstMs >= maxAgeMs;
+  }
+
+  const sensor_payload_t& at(size_t i) const { return _samples[(_first + i) % Capacity]; } // 0 = oldest
+  const sensor_payload_t& newest() const { return at(_count - 1); }
+
+  // Writes the batch message into out; returns its length, or 0 if it does not fit.
+  size_t encode(uint8_t* out, size_t cap) const {
+    return ser::encodeTable<Encoding>(SENSOR_BATCH_SCHEMA, _count,
+                                      [this](size_t i) { return &at(i); }, out, cap);
+  }
+
+private:
+  sensor_payload_t _samples[Capacity];
+  size_t _first;
+  size_t _count;
+  uint32_t _firstMs;
+  uint32_t _dropped;
+};
+
+#endif // MANAGERS_MQTTBATCH_H
@@ -0,0 +1,58 @@
+#ifndef MANAGERS_MQTTFIELDS_H
+#define MANAGERS_MQTTFIELDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <math.h>
+#include "SensorPayload.h"
+#include "Serializer.h"
+
+// Legacy per-field MQTT uplink: one message per value on <base>/<field>,
+// then <base>/seq and <base>/update, which subscribers use to assemble the
+// fields into one sample and drop late ones. Temperature, humidity and light
+// are left out when unavailable; the wind values publish "null".
+//
+// mqttFields() hands every message to emit(suffix, text) in publish order,
+// so CommManager and the host benchmark produce the same stream.
+
+// MQTT 3.1.1 PUBLISH (QoS 0) size on the wire: fixed header, remaining
+// length varint, topic length prefix, topic and payload.
+inline uint32_t mqttWireBytes(size_t topicLen, size_t payloadLen) {
+  size_t remaining = 2 + topicLen + payloadLen;
+  size_t varint = remaining < 128 ? 1 : (remaining < 16384 ? 2 : 3);
+  return (uint32_t)(1 + varint + remaining);
+}
+
+// Fixed-point text for a per-field topic (no printf float path, no heap)
+inline const char* mqttFieldText(char* buf, size_t cap, float v, uint8_t decimals) {
+  ser::Writer w((uint8_t*)buf, cap);
+  if (isnan(v)) w.str("null");
+  else w.fixed(v, decimals);
+  if (w.finish() == 0) buf[0] = '\0';
+  return buf;
+}
+
+template <class Emit>
+void mqttFields(const sensor_payload_t &p, Emit emit) {
+  char msg[32];
+
+  if (!isnan(p.tempC)) emit("temperature", mqttFieldText(msg, sizeof(msg), p.tempC, 1));
+  if (!isnan(p.humidity)) emit("humidity", mqttFieldText(msg, sizeof(msg), p.humidity, 1));
+
+  // Wind speed in km/h (calibrated), then gust and rolling means from the
+  // 1 s wind sub-samples
+  emit("windspeed", mqttFieldText(msg, sizeof(msg), p.wind_kmh, 1));
+  emit("windgust", mqttFieldText(msg, sizeof(msg), p.wind_gust_kmh, 1));
+  emit("windavg2m", mqttFieldText(msg, sizeof(msg), p.wind_avg2m_kmh, 1));
+  emit("windavg10m", mqttFieldText(msg, sizeof(msg), p.wind_avg10m_kmh, 1));
+  emit("windvar", mqttFieldText(msg, sizeof(msg), p.wind_var10m, 2));
+
+  if (!isnan(p.lux)) emit("light", mqttFieldText(msg, sizeof(msg), p.lux, 1));
+
+  snprintf(msg, sizeof(msg), "%lu", (unsigned long)p.seq);
+  emit("seq", msg);
+  emit("update", "1");
+}
+
+#endif // MANAGERS_MQTTFIELDS_H
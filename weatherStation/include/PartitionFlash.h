@@ -0,0 +1,26 @@
+#ifndef MANAGERS_PARTITIONFLASH_H
+#define MANAGERS_PARTITIONFLASH_H
+
+#include <esp_partition.h>
+#include "FlashLog.h"
+
+// FlashDevice on a raw data partition (no filesystem). The default ESP32
+// partition table has an unused "spiffs" data partition; only its first
+// maxBytes are used so the log stays small enough to scan at boot.
+class PartitionFlash : public FlashDevice {
+public:
+  PartitionFlash();
+  bool begin(const char* label, uint32_t maxBytes);
+
+  uint32_t size() const override { return _size; }
+  uint32_t sectorSize() const override { return 4096; }
+  bool read(uint32_t addr, void* dst, size_t len) override;
+  bool write(uint32_t addr, const void* src, size_t len) override;
+  bool erase(uint32_t addr) override;
+
+private:
+  const esp_partition_t* _part;
+  uint32_t _size;
+};
+
+#endif // MANAGERS_PARTITIONFLASH_H
@@ -0,0 +1,170 @@
+#ifndef MANAGERS_PEERTABLE_H
+#define MANAGERS_PEERTABLE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <ReliableLink.h>
+
+// ESP-NOW peers of the station: one entry per actuator with its channel,
+// group, health, sequence number and reliable sender (ReliableLink.h).
+//
+// Actuators in a group (group != 0) with at least two members get one
+// broadcast frame tagged with the group id, which every actuator filters;
+// the others get acked unicast frames. Broadcasts have no MAC ack, so group
+// members stay PEER_UNKNOWN and rely on the next sample instead of retries.
+//
+// Pure bookkeeping: EspNowManager registers the peers with ESP-NOW and moves
+// them between channels.
+
+enum PeerHealth : uint8_t {
+  PEER_UNKNOWN = 0, // no unicast ack yet (or group member)
+  PEER_OK,          // last unicast frame acked
+  PEER_LOST         // lostAfter frames in a row dropped after all retries
+};
+
+inline const char* peerHealthName(PeerHealth h) {
+  switch (h) {
+    case PEER_UNKNOWN: return "UNKNOWN";
+    case PEER_OK: return "OK";
+    case PEER_LOST: return "LOST";
+  }
+  return "?";
+}
+
+typedef struct {
+  uint8_t mac[6];
+  uint8_t group; // 0 = no group (always unicast), 1..254 (255 is WIRE_GROUP_ALL)
+} espnow_peer_config_t;
+
+template <uint8_t Capacity, uint8_t Window>
+class PeerTable {
+public:
+  typedef struct {
+    uint8_t mac[6];
+    uint8_t group;
+    uint8_t channel;      // channel registered with ESP-NOW, 0 = not registered
+    PeerHealth health;
+    uint8_t failStreak;   // frames dropped in a row
+    uint32_t seq;         // next unicast frame seq
+    uint32_t lastAckMs;
+    uint32_t overflows;   // frames skipped because the window was full
+    uint32_t seenDelivered;
+    uint32_t seenDropped;
+    ReliableSender<Window> tx;
+  } peer_t;
+
+  PeerTable(uint8_t maxRetries, uint32_t retryDelayMs, uint32_t ackTimeoutMs, uint8_t lostAfter)
+    : _count(0), _groupCount(0), _maxRetries(maxRetries), _retryDelay(retryDelayMs),
+      _ackTimeout(ackTimeoutMs), _lostAfter(lostAfter) {}
+
+  // Index of the new (or existing) peer, -1 when the table is full.
+  int add(const uint8_t mac[6], uint8_t group, uint32_t firstSeq) {
+    int i = find(mac);
+    if (i >= 0) return i;
+    if (_count >= Capacity) return -1;
+    peer_t &p = _peers[_count];
+    memcpy(p.mac, mac, 6);
+    p.group = group;
+    p.channel = 0;
+    p.health = PEER_UNKNOWN;
+    p.failStreak = 0;
+    p.seq = firstSeq;
+    p.lastAckMs = 0;
+    p.overflows = 0;
+    p.seenDelivered = 0;
+    p.seenDropped = 0;
+    p.tx.setRetryPolicy(_maxRetries, _retryDelay, _ackTimeout);
+    if (group != 0 && !findGroup(group)) {
+      _groups[_groupCount].group = group;
+      _groups[_groupCount].seq = firstSeq;
+      _groups[_groupCount].frames = 0;
+      _groupCount++;
+    }
+    return _count++;
+  }
+
+  int find(const uint8_t* mac) const {
+    for (uint8_t i = 0; i < _count; ++i)
+      if (memcmp(_peers[i].mac, mac, 6) == 0) return i;
+    return -1;
+  }
+
+  uint8_t size() const { return _count; }
+  peer_t& at(uint8_t i) { return _peers[i]; }
+  const peer_t& at(uint8_t i) const { return _peers[i]; }
+
+  uint8_t groupSize(uint8_t group) const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < _count; ++i)
+      if (_peers[i].group == group) n++;
+    return n;
+  }
+
+  // True when frames for this peer go out as its group's broadcast.
+  bool viaBroadcast(uint8_t i) const {
+    return _peers[i].group != 0 && groupSize(_peers[i].group) >= 2;
+  }
+
+  // Groups that get a broadcast (in the order they were first seen)
+  uint8_t groupCount() const { return _groupCount; }
+  uint8_t groupAt(uint8_t i) const { return _groups[i].group; }
+  uint32_t groupFrames(uint8_t i) const { return _groups[i].frames; }
+  bool groupBroadcast(uint8_t i) const { return groupSize(_groups[i].group) >= 2; }
+
+  // Seq for the next broadcast of group i; every group keeps its own count
+  // so its members see no gaps.
+  uint32_t nextGroupSeq(uint8_t i) {
+    _groups[i].frames++;
+    return _groups[i].seq++;
+  }
+
+  // ESP-NOW send callback for mac; broadcasts and unknown macs are ignored.
+  void onSendStatus(const uint8_t* mac, bool acked, uint32_t now) {
+    int i = find(mac);
+    if (i < 0) return;
+    _peers[i].tx.onSendStatus(acked, now);
+    updateHealth(_peers[i], now);
+  }
+
+  // Refresh health after poll(), which can also drop frames (timeouts,
+  // refused sends).
+  void updateHealth(peer_t &p, uint32_t now) {
+    const reliable_tx_stats_t &s = p.tx.stats();
+    if (s.delivered != p.seenDelivered) {
+      p.health = PEER_OK;
+      p.failStreak = 0;
+      p.lastAckMs = now;
+    }
+    if (s.dropped != p.seenDropped) {
+      uint32_t n = s.dropped - p.seenDropped;
+      p.failStreak = (uint8_t)(p.failStreak + n > 255 ? 255 : p.failStreak + n);
+      if (p.failStreak >= _lostAfter) p.health = PEER_LOST;
+    }
+    p.seenDelivered = s.delivered;
+    p.seenDropped = s.dropped;
+  }
+
+private:
+  typedef struct {
+    uint8_t group;
+    uint32_t seq;
+    uint32_t frames;
+  } group_t;
+
+  peer_t _peers[Capacity];
+  group_t _groups[Capacity];
+  uint8_t _count;
+  uint8_t _groupCount;
+  uint8_t _maxRetries;
+  uint32_t _retryDelay;
+  uint32_t _ackTimeout;
+  uint8_t _lostAfter;
+
+  bool findGroup(uint8_t group) const {
+    for (uint8_t i = 0; i < _groupCount; ++i)
+      if (_groups[i].group == group) return true;
+    return false;
+  }
+};
+
+#endif // MANAGERS_PEERTABLE_H
@@ -0,0 +1,86 @@
+#ifndef MANAGERS_PULSECOUNTER_H
+#define MANAGERS_PULSECOUNTER_H
+
+#include <stdint.h>
+
+// Anemometer pulse counter interface.
+//
+// SensorManager only talks to this interface; the backend is picked at build
+// time with ANEMOMETER_USE_PCNT (see Common.h). A host test double just has to
+// implement begin() and take().
+class PulseCounter {
+public:
+  virtual ~PulseCounter() {}
+
+  // Configure the pin/peripheral and start counting.
+  virtual bool begin() = 0;
+
+  // Pulses counted since the previous call (the first call counts from begin()).
+  virtual uint32_t take() = 0;
+};
+
+// Falling-edge GPIO interrupt with a software debounce (one ISR per pulse).
+class IsrPulseCounter : public PulseCounter {
+public:
+  IsrPulseCounter(uint8_t pin, uint32_t debounceUs);
+  bool begin() override;
+  uint32_t take() override;
+
+private:
+  uint8_t _pin;
+};
+
+// Extends a 16-bit counter that resets to 0 at its high limit to a running
+// 32-bit total. The overflow count comes from an interrupt that may not have
+// run yet when the counter has already wrapped: a value below the previous
+// one with no new overflow is such a wrap and is credited here, once (the
+// interrupt's increment then catches up with it). Reads must be less than a
+// full counter period apart. Pure so it can be tested on a host.
+class WrappingCount {
+public:
+  explicit WrappingCount(uint16_t limit) : _limit(limit) { reset(); }
+
+  void reset() {
+    _overflows = 0;
+    _value = 0;
+  }
+
+  // Pulses since the previous call, from the interrupt's overflow count and
+  // the counter value read (consistently) right now
+  uint32_t take(uint32_t overflows, uint16_t value) {
+    uint32_t seen = overflows;
+    if ((int32_t)(seen - _overflows) < 0) seen = _overflows;      // wrap already credited
+    if (seen == _overflows && value < _value) seen = _overflows + 1; // interrupt still pending
+    uint32_t delta = (seen - _overflows) * (uint32_t)_limit + value - _value;
+    _overflows = seen;
+    _value = value;
+    return delta;
+  }
+
+private:
+  uint16_t _limit;
+  uint32_t _overflows; // overflows accounted for, including one credited early
+  uint16_t _value;
+};
+
+// ESP32 PCNT peripheral with its hardware glitch filter; no CPU work per pulse.
+class PcntPulseCounter : public PulseCounter {
+public:
+  PcntPulseCounter(uint8_t pin, uint8_t unit, uint16_t filterApbCycles);
+  bool begin() override;
+  uint32_t take() override;
+
+private:
+  static void overflowISR(void* arg);
+
+  uint8_t _pin;
+  uint8_t _unit;
+  uint16_t _filterApbCycles;
+  volatile uint32_t _overflows;
+  WrappingCount _total;
+};
+
+// Returns the anemometer counter selected by ANEMOMETER_USE_PCNT.
+PulseCounter* createAnemometerCounter();
+
+#endif // MANAGERS_PULSECOUNTER_H
@@ -0,0 +1,223 @@
+#ifndef MANAGERS_SAMPLEBUS_H
+#define MANAGERS_SAMPLEBUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Single-producer publish/subscribe bus for sensor samples.
+//
+// Samples live in a fixed pool of Slots entries and are written exactly once
+// by publish(). Every subscriber keeps its own read cursor (a sample sequence
+// number) and reads the slot in place between acquire() and release(), so an
+// extra consumer costs no copy. A slot carries a reference count of the
+// subscribers that still have to release it and is only reused at zero.
+//
+// Backpressure is chosen per subscriber:
+//   BUS_LATEST_ONLY  acquire() jumps to the newest sample; older unread
+//                    samples are dropped (display).
+//   BUS_WAIT_BOUNDED publish() waits for the subscriber to free the oldest
+//                    slot, but only up to the publisher's losslessWait
+//                    (SAMPLE_BUS_PUBLISH_WAIT_MS); after that the subscriber
+//                    is moved past that sample and it counts as dropped
+//                    (uplinks). Not lossless for a subscriber that stays
+//                    behind longer than Slots samples plus that wait.
+// Drops and lag (samples published but not yet read) are counted per
+// subscriber. A sample that cannot be published at all, because a subscriber
+// is still reading the slot it needs, is dropped for every subscriber and the
+// reader holding the slot gets a stall.
+
+enum SampleBusPolicy : uint8_t {
+  BUS_LATEST_ONLY = 0,
+  BUS_WAIT_BOUNDED
+};
+
+typedef struct {
+  uint32_t delivered; // samples acquired and released
+  uint32_t dropped;   // samples this subscriber never saw
+  uint32_t lag;       // samples published but not yet read
+  uint32_t maxLag;
+  uint32_t stalls;    // publishes dropped because this subscriber held the slot
+} sample_bus_stats_t;
+
+template <typename T, size_t Slots, size_t MaxSubscribers>
+class SampleBus {
+public:
+  SampleBus() : _head(0), _numSubs(0), _space(NULL), _publishDrops(0) {
+    for (size_t i = 0; i < Slots; ++i) _refs[i] = 0;
+  }
+
+  // Create the synchronisation objects; call once before subscribe()/publish().
+  void begin() {
+    if (!_space) _space = xSemaphoreCreateBinaryStatic(&_spaceBuf);
+  }
+
+  // Returns a subscriber id, or -1 when the table is full. Meant to be called
+  // from the managers' begin(); only samples published afterwards are delivered.
+  int subscribe(const char* name, SampleBusPolicy policy) {
+    if (_numSubs >= MaxSubscribers) return -1;
+    Sub &s = _subs[_numSubs];
+    s.name = name;
+    s.policy = policy;
+    s.holding = false;
+    s.stats.delivered = 0;
+    s.stats.dropped = 0;
+    s.stats.lag = 0;
+    s.stats.maxLag = 0;
+    s.stats.stalls = 0;
+    s.ready = xSemaphoreCreateBinaryStatic(&s.readyBuf);
+
+    portENTER_CRITICAL(&_mux);
+    s.next = _head;
+    int id = (int)_numSubs++;
+    portEXIT_CRITICAL(&_mux);
+    return id;
+  }
+
+  // Write one sample into the pool and wake all subscribers. Waits up to
+  // losslessWait for BUS_WAIT_BOUNDED subscribers that still need the oldest slot.
+  // Returns false only if the slot was still being read when the wait expired.
+  bool publish(const T &sample, TickType_t losslessWait) {
+    size_t slot = _head % Slots;
+    for (;;) {
+      portENTER_CRITICAL(&_mux);
+      reclaim(false);
+      if (_refs[slot] == 0) break;
+      portEXIT_CRITICAL(&_mux);
+      if (losslessWait == 0 || xSemaphoreTake(_space, losslessWait) != pdTRUE) {
+        portENTER_CRITICAL(&_mux);
+        reclaim(true);
+        if (_refs[slot] == 0) break;
+        stall();
+        portEXIT_CRITICAL(&_mux);
+        return false;
+      }
+    }
+
+    // Still inside the critical section here
+    _slots[slot] = sample;
+    _refs[slot] = (uint8_t)_numSubs;
+    _head++;
+    for (size_t i = 0; i < _numSubs; ++i) {
+      uint32_t lag = _head - _subs[i].next;
+      _subs[i].stats.lag = lag;
+      if (lag > _subs[i].stats.maxLag) _subs[i].stats.maxLag = lag;
+    }
+    size_t n = _numSubs;
+    portEXIT_CRITICAL(&_mux);
+
+    for (size_t i = 0; i < n; ++i) xSemaphoreGive(_subs[i].ready);
+    return true;
+  }
+
+  // Wait up to `wait` for the subscriber's next sample and return it in
+  // place (nullptr on timeout). The pointer is valid until release(); calling
+  // acquire() again before release() returns the same sample.
+  const T* acquire(int id, TickType_t wait) {
+    Sub &s = _subs[id];
+    for (;;) {
+      portENTER_CRITICAL(&_mux);
+      if (s.holding) {
+        const T* p = &_slots[s.next % Slots];
+        portEXIT_CRITICAL(&_mux);
+        return p;
+      }
+      if (s.policy == BUS_LATEST_ONLY) {
+        while (_head - s.next > 1) skip(s);
+      }
+      if (s.next != _head) {
+        s.holding = true;
+        const T* p = &_slots[s.next % Slots];
+        portEXIT_CRITICAL(&_mux);
+        return p;
+      }
+      portEXIT_CRITICAL(&_mux);
+      if (xSemaphoreTake(s.ready, wait) != pdTRUE) return nullptr;
+    }
+  }
+
+  // Done with the sample returned by acquire().
+  void release(int id) {
+    Sub &s = _subs[id];
+    portENTER_CRITICAL(&_mux);
+    if (!s.holding) {
+      portEXIT_CRITICAL(&_mux);
+      return;
+    }
+    s.holding = false;
+    _refs[s.next % Slots]--;
+    s.next++;
+    s.stats.delivered++;
+    s.stats.lag = _head - s.next;
+    portEXIT_CRITICAL(&_mux);
+    xSemaphoreGive(_space);
+  }
+
+  sample_bus_stats_t stats(int id) {
+    portENTER_CRITICAL(&_mux);
+    sample_bus_stats_t st = _subs[id].stats;
+    portEXIT_CRITICAL(&_mux);
+    return st;
+  }
+
+  const char* name(int id) const { return _subs[id].name; }
+  size_t subscribers() const { return _numSubs; }
+  uint32_t published() const { return _head; }
+  uint32_t publishDrops() const { return _publishDrops; }
+
+private:
+  struct Sub {
+    const char* name;
+    SampleBusPolicy policy;
+    bool holding;
+    uint32_t next;  // sequence of the next sample to read
+    sample_bus_stats_t stats;
+    SemaphoreHandle_t ready;
+    StaticSemaphore_t readyBuf;
+  };
+
+  // Drop the sample at the subscriber's cursor (caller holds _mux).
+  void skip(Sub &s) {
+    _refs[s.next % Slots]--;
+    s.next++;
+    s.stats.dropped++;
+  }
+
+  // The sample being published has no slot: every subscriber misses it, the
+  // one still reading the oldest slot is the cause (caller holds _mux).
+  void stall() {
+    uint32_t oldest = _head - Slots;
+    for (size_t i = 0; i < _numSubs; ++i) {
+      Sub &s = _subs[i];
+      s.stats.dropped++;
+      if (s.holding && s.next == oldest) s.stats.stalls++;
+    }
+    _publishDrops++;
+  }
+
+  // Move subscribers off the oldest sample, whose slot is about to be reused:
+  // latest-only ones always, wait-bounded ones only when `force` is set. A slot
+  // being read right now is never taken away (caller holds _mux).
+  void reclaim(bool force) {
+    if (_head < Slots) return;
+    uint32_t oldest = _head - Slots;
+    for (size_t i = 0; i < _numSubs; ++i) {
+      Sub &s = _subs[i];
+      if (s.next != oldest || s.holding) continue;
+      if (s.policy == BUS_LATEST_ONLY || force) skip(s);
+    }
+  }
+
+  T _slots[Slots];
+  uint8_t _refs[Slots];
+  Sub _subs[MaxSubscribers];
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  uint32_t _head;  // sequence of the next sample to publish
+  size_t _numSubs;
+  SemaphoreHandle_t _space;
+  StaticSemaphore_t _spaceBuf;
+  uint32_t _publishDrops;
+};
+
+#endif // MANAGERS_SAMPLEBUS_H
@@ -2,6 +2,10 @@
 #define MANAGERS_SENSORMANAGER_H
 
 #include "Common.h"
+#include "PulseCounter.h"
+#include "WindStats.h"
+#include "WindowStats.h"
+#include "Decimator.h"
 
 class SensorManager {
 public:
@@ -11,12 +15,39 @@ public:
 private:
   uint32_t _intervalMs;
   uint32_t _seq;
+  PulseCounter* _anemometer;
+  WindStats<1000 / WIND_SUBSAMPLE_MS> _wind;
+  WindowStats<SENSOR_WINDOW_SAMPLES> _temp;
+  WindowStats<SENSOR_WINDOW_SAMPLES> _humidity;
+  WindowStats<SENSOR_WINDOW_SAMPLES> _lux;
+  WindowStats<MEAS_INTERVAL_MS / WIND_SUBSAMPLE_MS> _windSubs; // sub-samples since the last report
+  Decimator<OVERSAMPLE_FILTER_SHIFT> _luxFast;  // deci-lux per tick
+  Decimator<OVERSAMPLE_FILTER_SHIFT> _windFast; // centi-km/h per tick
+
+  // BH1750 on the shared I2C bus: the reading arrives in onLuxRead() on the
+  // bus task and is picked up by takeLux() on a later tick
+  int _luxDev;
+  portMUX_TYPE _luxMux = portMUX_INITIALIZER_UNLOCKED;
+  uint16_t _luxRaw;
+  bool _luxFresh;
+  bool _luxPending;    // read queued, callback not run yet
+  uint32_t _luxErrors;
+  uint32_t _luxDelayMs; // before the first continuous read (first conversion)
+#if DIAG_ENABLED
+  uint32_t _luxRequestUs;
+#endif
 
   static void taskEntry(void* pv);
   void task();
-  float readLuxBH1750();
+  void publishSample(uint32_t windowPulses, uint32_t windowMs, uint64_t tUs);
+  static uint64_t epochMsAt(uint64_t tUs);
+  void requestLux();
+  float takeLux();
+  static void onLuxRead(void* ctx, bool ok, const uint8_t* data, size_t len);
+  static void onLuxConfigured(void* ctx, bool ok, const uint8_t* data, size_t len);
+  void addLuxTick(float lux);
 
-  // Bit-banged DHT22 reader (implemented in the .cpp)
+  // Interrupt-captured DHT22 reader (edges decoded by dht22Decode)
   bool readDHT22(float &tempC, float &humidity);
 };
 
@@ -0,0 +1,59 @@
+#ifndef MANAGERS_SENSORSCHEMA_H
+#define MANAGERS_SENSORSCHEMA_H
+
+#include <stddef.h>
+#include "SensorPayload.h"
+#include "Serializer.h"
+
+// Serializer schemas for sensor_payload_t. A new payload field only needs a
+// line here to show up in every uplink encoding.
+
+// Full record (HTTP uplink)
+static constexpr ser::field_t SENSOR_FIELDS[] = {
+  { "temp",            offsetof(sensor_payload_t, tempC),           ser::FIELD_F32, 1 },
+  { "humidity",        offsetof(sensor_payload_t, humidity),        ser::FIELD_F32, 1 },
+  { "lux",             offsetof(sensor_payload_t, lux),             ser::FIELD_F32, 1 },
+  { "wind_kmh",        offsetof(sensor_payload_t, wind_kmh),        ser::FIELD_F32, 1 },
+  { "wind_gust_kmh",   offsetof(sensor_payload_t, wind_gust_kmh),   ser::FIELD_F32, 1 },
+  { "wind_avg2m_kmh",  offsetof(sensor_payload_t, wind_avg2m_kmh),  ser::FIELD_F32, 1 },
+  { "wind_avg10m_kmh", offsetof(sensor_payload_t, wind_avg10m_kmh), ser::FIELD_F32, 1 },
+  { "wind_var10m",     offsetof(sensor_payload_t, wind_var10m),     ser::FIELD_F32, 2 },
+  { "wind_lull_kmh",   offsetof(sensor_payload_t, wind_lull_kmh),   ser::FIELD_F32, 1 },
+  { "temp_avg",        offsetof(sensor_payload_t, temp_avg),        ser::FIELD_F32, 1 },
+  { "temp_min",        offsetof(sensor_payload_t, temp_min),        ser::FIELD_F32, 1 },
+  { "temp_max",        offsetof(sensor_payload_t, temp_max),        ser::FIELD_F32, 1 },
+  { "humidity_avg",    offsetof(sensor_payload_t, humidity_avg),    ser::FIELD_F32, 1 },
+  { "humidity_min",    offsetof(sensor_payload_t, humidity_min),    ser::FIELD_F32, 1 },
+  { "humidity_max",    offsetof(sensor_payload_t, humidity_max),    ser::FIELD_F32, 1 },
+  { "lux_avg",         offsetof(sensor_payload_t, lux_avg),         ser::FIELD_F32, 1 },
+  { "lux_min",         offsetof(sensor_payload_t, lux_min),         ser::FIELD_F32, 1 },
+  { "lux_max",         offsetof(sensor_payload_t, lux_max),         ser::FIELD_F32, 1 },
+  { "seq",             offsetof(sensor_payload_t, seq),             ser::FIELD_U32, 0 },
+  { "t_us",            offsetof(sensor_payload_t, t_us),            ser::FIELD_U64, 0 },
+  { "epoch_ms",        offsetof(sensor_payload_t, epoch_ms),        ser::FIELD_U64, 0 },
+};
+static constexpr uint8_t SENSOR_FIELD_COUNT = sizeof(SENSOR_FIELDS) / sizeof(SENSOR_FIELDS[0]);
+static constexpr ser::schema_t SENSOR_SCHEMA = {
+  "weather", SENSOR_FIELDS, SENSOR_FIELD_COUNT, SENSOR_FIELD_COUNT - 1 // epoch_ms
+};
+static_assert(SENSOR_FIELDS[SENSOR_FIELD_COUNT - 1].offset == offsetof(sensor_payload_t, epoch_ms),
+              "line protocol timestamp is the last field");
+
+// MQTT batch columns, named like the per-field topics
+static constexpr ser::field_t SENSOR_BATCH_FIELDS[] = {
+  { "seq",       offsetof(sensor_payload_t, seq),           ser::FIELD_U32, 0 },
+  { "ts",        offsetof(sensor_payload_t, epoch_ms),      ser::FIELD_U64, 0 },
+  { "temp",      offsetof(sensor_payload_t, tempC),         ser::FIELD_F32, 1 },
+  { "humidity",  offsetof(sensor_payload_t, humidity),      ser::FIELD_F32, 1 },
+  { "windspeed", offsetof(sensor_payload_t, wind_kmh),      ser::FIELD_F32, 1 },
+  { "windgust",  offsetof(sensor_payload_t, wind_gust_kmh), ser::FIELD_F32, 1 },
+  { "light",     offsetof(sensor_payload_t, lux),           ser::FIELD_F32, 1 },
+  { "tempavg",   offsetof(sensor_payload_t, temp_avg),      ser::FIELD_F32, 1 },
+  { "humavg",    offsetof(sensor_payload_t, humidity_avg),  ser::FIELD_F32, 1 },
+  { "lightavg",  offsetof(sensor_payload_t, lux_avg),       ser::FIELD_F32, 1 },
+};
+static constexpr ser::schema_t SENSOR_BATCH_SCHEMA = {
+  "weather", SENSOR_BATCH_FIELDS, sizeof(SENSOR_BATCH_FIELDS) / sizeof(SENSOR_BATCH_FIELDS[0]), 1 // ts
+};
+
+#endif // MANAGERS_SENSORSCHEMA_H
@@ -0,0 +1,369 @@
+#ifndef MANAGERS_SERIALIZER_H
+#define MANAGERS_SERIALIZER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+// Schema-driven record serializer writing into a caller-provided buffer.
+//
+// A record is described by a table of fields (name, offset, type, decimals),
+// so adding a field to a payload struct is one more schema line. Encoders are
+// plain structs picked at compile time (see UplinkEncoding in Common.h):
+//
+//   Json          {"temp":21.3,"seq":101}, NaN -> null
+//   Cbor          RFC 8949 map, floats as float32, NaN -> null
+//   LineProtocol  InfluxDB: weather temp=21.3,seq=101i 1760000000000000000
+//                 (NaN fields omitted, timestamp from the schema's timeField)
+//
+// Nothing here allocates: numbers are formatted by hand in fixed point
+// (newlib's printf float path allocates on the heap), and a result that does
+// not fit the buffer returns length 0 instead of being truncated. Shared with
+// firmware/weather_station.ino.
+
+namespace ser {
+
+enum FieldType : uint8_t {
+  FIELD_F32 = 0,
+  FIELD_U32,
+  FIELD_I32,
+  FIELD_U64  // timestamps
+};
+
+typedef struct {
+  const char* name;
+  uint16_t offset;  // offsetof() into the record
+  FieldType type;
+  uint8_t decimals; // text encoders only (0..4)
+} field_t;
+
+static constexpr uint8_t NO_TIME_FIELD = 0xFF;
+
+typedef struct {
+  const char* measurement; // line protocol measurement name
+  const field_t* fields;
+  uint8_t count;
+  uint8_t timeField = NO_TIME_FIELD; // FIELD_U64 Unix ms: line protocol timestamp
+} schema_t;
+
+// Bounded append-only buffer; once something does not fit, everything after
+// is ignored and finish() returns 0.
+class Writer {
+public:
+  Writer(uint8_t* buf, size_t cap) : _buf(buf), _cap(cap), _len(0), _overflow(false) {}
+
+  void put(uint8_t c) {
+    if (_len < _cap) _buf[_len++] = c;
+    else _overflow = true;
+  }
+
+  void put(const void* data, size_t n) {
+    if (_len + n > _cap) { _overflow = true; return; }
+    memcpy(_buf + _len, data, n);
+    _len += n;
+  }
+
+  void str(const char* s) { put(s, strlen(s)); }
+
+  void u32(uint32_t v) {
+    char tmp[10];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n) put((uint8_t)tmp[--n]);
+  }
+
+  void u64(uint64_t v) {
+    char tmp[20];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n) put((uint8_t)tmp[--n]);
+  }
+
+  void i32(int32_t v) {
+    if (v < 0) { put('-'); u32(0u - (uint32_t)v); }
+    else u32((uint32_t)v);
+  }
+
+  // Fixed-point decimal, rounded half away from zero. Callers handle NaN;
+  // magnitudes beyond uint32 are clamped.
+  void fixed(float v, uint8_t decimals) {
+    static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000 };
+    if (decimals > 4) decimals = 4;
+    uint32_t scale = POW10[decimals];
+    double a = v < 0 ? -(double)v : (double)v;
+    double limit = 4294967295.0;
+    uint64_t scaled = a >= limit ? (uint64_t)limit * scale : (uint64_t)(a * scale + 0.5);
+    if (v < 0 && scaled != 0) put('-');
+    u32((uint32_t)(scaled / scale));
+    if (decimals == 0) return;
+    put('.');
+    uint32_t frac = (uint32_t)(scaled % scale);
+    for (uint32_t d = scale / 10; d > 0; d /= 10) {
+      put((uint8_t)('0' + frac / d));
+      frac %= d;
+    }
+  }
+
+  size_t length() const { return _len; }
+  bool overflow() const { return _overflow; }
+
+  // Length written, or 0 if it did not fit. Text output is NUL-terminated
+  // when there is room, which is not counted in the length.
+  size_t finish() {
+    if (_overflow) return 0;
+    if (_len < _cap) _buf[_len] = 0;
+    return _len;
+  }
+
+private:
+  uint8_t* _buf;
+  size_t _cap;
+  size_t _len;
+  bool _overflow;
+};
+
+inline float fieldF32(const void* rec, const field_t &f) {
+  float v;
+  memcpy(&v, static_cast<const uint8_t*>(rec) + f.offset, sizeof(v));
+  return v;
+}
+
+inline uint32_t fieldU32(const void* rec, const field_t &f) {
+  uint32_t v;
+  memcpy(&v, static_cast<const uint8_t*>(rec) + f.offset, sizeof(v));
+  return v;
+}
+
+inline uint64_t fieldU64(const void* rec, const field_t &f) {
+  uint64_t v;
+  memcpy(&v, static_cast<const uint8_t*>(rec) + f.offset, sizeof(v));
+  return v;
+}
+
+inline bool fieldMissing(const void* rec, const field_t &f) {
+  return f.type == FIELD_F32 && !isfinite(fieldF32(rec, f));
+}
+
+// Decimal text value (JSON and line protocol share it)
+inline void textValue(Writer &w, const void* rec, const field_t &f) {
+  switch (f.type) {
+    case FIELD_F32: w.fixed(fieldF32(rec, f), f.decimals); break;
+    case FIELD_U32: w.u32(fieldU32(rec, f)); break;
+    case FIELD_I32: w.i32((int32_t)fieldU32(rec, f)); break;
+    case FIELD_U64: w.u64(fieldU64(rec, f)); break;
+  }
+}
+
+struct Json {
+  static constexpr const char* CONTENT_TYPE = "application/json";
+
+  static void value(Writer &w, const void* rec, const field_t &f) {
+    if (fieldMissing(rec, f)) w.str("null");
+    else textValue(w, rec, f);
+  }
+
+  static void key(Writer &w, const char* name) {
+    w.put('"');
+    w.str(name);
+    w.str("\":");
+  }
+
+  static void record(Writer &w, const schema_t &s, const void* rec) {
+    w.put('{');
+    for (uint8_t i = 0; i < s.count; ++i) {
+      if (i) w.put(',');
+      key(w, s.fields[i].name);
+      value(w, rec, s.fields[i]);
+    }
+    w.put('}');
+  }
+
+  // Array of records: [{...},{...}]
+  static void beginRecords(Writer &w, size_t) { w.put('['); }
+  static void recordSeparator(Writer &w) { w.put(','); }
+  static void endRecords(Writer &w) { w.put(']'); }
+
+  // Columnar table: {"f":["seq","temp",...],"d":[[101,21.3,...],...]}
+  static void beginTable(Writer &w, const schema_t &s, size_t) {
+    w.str("{\"f\":[");
+    for (uint8_t i = 0; i < s.count; ++i) {
+      if (i) w.put(',');
+      w.put('"');
+      w.str(s.fields[i].name);
+      w.put('"');
+    }
+    w.str("],\"d\":[");
+  }
+
+  static void row(Writer &w, const schema_t &s, const void* rec) {
+    w.put('[');
+    for (uint8_t i = 0; i < s.count; ++i) {
+      if (i) w.put(',');
+      value(w, rec, s.fields[i]);
+    }
+    w.put(']');
+  }
+
+  static void rowSeparator(Writer &w) { w.put(','); }
+  static void endTable(Writer &w) { w.str("]}"); }
+};
+
+struct Cbor {
+  static constexpr const char* CONTENT_TYPE = "application/cbor";
+
+  static void head(Writer &w, uint8_t major, uint32_t v) {
+    major <<= 5;
+    if (v < 24) {
+      w.put((uint8_t)(major | v));
+    } else if (v <= 0xFF) {
+      w.put((uint8_t)(major | 24));
+      w.put((uint8_t)v);
+    } else if (v <= 0xFFFF) {
+      w.put((uint8_t)(major | 25));
+      w.put((uint8_t)(v >> 8));
+      w.put((uint8_t)v);
+    } else {
+      w.put((uint8_t)(major | 26));
+      for (int s = 24; s >= 0; s -= 8) w.put((uint8_t)(v >> s));
+    }
+  }
+
+  static void head64(Writer &w, uint8_t major, uint64_t v) {
+    if (v <= 0xFFFFFFFFu) { head(w, major, (uint32_t)v); return; }
+    w.put((uint8_t)((major << 5) | 27));
+    for (int s = 56; s >= 0; s -= 8) w.put((uint8_t)(v >> s));
+  }
+
+  static void text(Writer &w, const char* s) {
+    size_t n = strlen(s);
+    head(w, 3, (uint32_t)n);
+    w.put(s, n);
+  }
+
+  static void value(Writer &w, const void* rec, const field_t &f) {
+    if (fieldMissing(rec, f)) { w.put(0xF6); return; } // null
+    if (f.type == FIELD_U64) { head64(w, 0, fieldU64(rec, f)); return; }
+    uint32_t bits = fieldU32(rec, f);
+    switch (f.type) {
+      case FIELD_F32:
+        w.put(0xFA);
+        for (int s = 24; s >= 0; s -= 8) w.put((uint8_t)(bits >> s));
+        break;
+      case FIELD_U32:
+        head(w, 0, bits);
+        break;
+      case FIELD_I32:
+        if ((int32_t)bits < 0) head(w, 1, (uint32_t)(-1 - (int32_t)bits));
+        else head(w, 0, bits);
+        break;
+      case FIELD_U64:
+        break;
+    }
+  }
+
+  static void record(Writer &w, const schema_t &s, const void* rec) {
+    head(w, 5, s.count);
+    for (uint8_t i = 0; i < s.count; ++i) {
+      text(w, s.fields[i].name);
+      value(w, rec, s.fields[i]);
+    }
+  }
+
+  static void beginRecords(Writer &w, size_t n) { head(w, 4, (uint32_t)n); }
+  static void recordSeparator(Writer &) {}
+  static void endRecords(Writer &) {}
+
+  static void beginTable(Writer &w, const schema_t &s, size_t n) {
+    head(w, 5, 2);
+    text(w, "f");
+    head(w, 4, s.count);
+    for (uint8_t i = 0; i < s.count; ++i) text(w, s.fields[i].name);
+    text(w, "d");
+    head(w, 4, (uint32_t)n);
+  }
+
+  static void row(Writer &w, const schema_t &s, const void* rec) {
+    head(w, 4, s.count);
+    for (uint8_t i = 0; i < s.count; ++i) value(w, rec, s.fields[i]);
+  }
+
+  static void rowSeparator(Writer &) {}
+  static void endTable(Writer &) {}
+};
+
+struct LineProtocol {
+  static constexpr const char* CONTENT_TYPE = "text/plain; charset=utf-8";
+
+  // measurement field=value,... timestamp. The time field is written as the
+  // timestamp in ns, not as a field; without one, or while it is 0 (clock
+  // not set), the line has no timestamp and the server stamps arrival.
+  static void record(Writer &w, const schema_t &s, const void* rec) {
+    w.str(s.measurement);
+    bool first = true;
+    for (uint8_t i = 0; i < s.count; ++i) {
+      const field_t &f = s.fields[i];
+      if (i == s.timeField || fieldMissing(rec, f)) continue;
+      w.put(first ? ' ' : ',');
+      first = false;
+      w.str(f.name);
+      w.put('=');
+      textValue(w, rec, f);
+      if (f.type != FIELD_F32) w.put('i');
+    }
+    uint64_t ms = s.timeField < s.count ? fieldU64(rec, s.fields[s.timeField]) : 0;
+    if (ms) {
+      w.put(' ');
+      w.u64(ms);
+      w.str("000000");
+    }
+  }
+
+  static void beginRecords(Writer &, size_t) {}
+  static void recordSeparator(Writer &w) { w.put('\n'); }
+  static void endRecords(Writer &) {}
+
+  // No columnar form: one line per record
+  static void beginTable(Writer &, const schema_t &, size_t) {}
+  static void row(Writer &w, const schema_t &s, const void* rec) { record(w, s, rec); }
+  static void rowSeparator(Writer &w) { w.put('\n'); }
+  static void endTable(Writer &) {}
+};
+
+// --- Entry points; each returns the encoded length, or 0 if cap is too small ---
+
+template <class Encoding>
+size_t encodeRecord(const schema_t &s, const void* rec, uint8_t* out, size_t cap) {
+  Writer w(out, cap);
+  Encoding::record(w, s, rec);
+  return w.finish();
+}
+
+// recordAt(i) returns a pointer to record i, oldest first.
+template <class Encoding, class RecordAt>
+size_t encodeRecords(const schema_t &s, size_t n, RecordAt recordAt, uint8_t* out, size_t cap) {
+  Writer w(out, cap);
+  Encoding::beginRecords(w, n);
+  for (size_t i = 0; i < n; ++i) {
+    if (i) Encoding::recordSeparator(w);
+    Encoding::record(w, s, recordAt(i));
+  }
+  Encoding::endRecords(w);
+  return w.finish();
+}
+
+template <class Encoding, class RecordAt>
+size_t encodeTable(const schema_t &s, size_t n, RecordAt recordAt, uint8_t* out, size_t cap) {
+  Writer w(out, cap);
+  Encoding::beginTable(w, s, n);
+  for (size_t i = 0; i < n; ++i) {
+    if (i) Encoding::rowSeparator(w);
+    Encoding::row(w, s, recordAt(i));
+  }
+  Encoding::endTable(w);
+  return w.finish();
+}
+
+} // namespace ser
+
+#endif // MANAGERS_SERIALIZER_H
@@ -0,0 +1,56 @@
+#ifndef MANAGERS_TASKTOPOLOGY_H
+#define MANAGERS_TASKTOPOLOGY_H
+
+#include <stdint.h>
+
+// Where the manager tasks run. Every task's core, priority, stack and queue
+// length sit in one table (TASK_TABLE in Common.h, one row per TaskId) and a
+// whole layout is picked at build time with -DTASK_TOPOLOGY=n:
+//
+//   0  app core       every manager on core 1, core 0 left to the WiFi stack
+//   1  split network  CommTask and EspNowTask on core 0 beside the WiFi/lwIP
+//                     tasks, sensing, I2C and display on core 1
+//   2  unpinned       same priorities, the scheduler places every task
+//
+// The sensor-to-publish latency of a layout is measured with the benchmark
+// build (LatencyBench.h).
+#ifndef TASK_TOPOLOGY
+#define TASK_TOPOLOGY 0
+#endif
+
+enum TaskTopology : uint8_t {
+  TOPOLOGY_APP_CORE = 0,
+  TOPOLOGY_SPLIT_NETWORK,
+  TOPOLOGY_UNPINNED
+};
+
+inline const char* taskTopologyName(TaskTopology t) {
+  switch (t) {
+    case TOPOLOGY_APP_CORE: return "app_core";
+    case TOPOLOGY_SPLIT_NETWORK: return "split_network";
+    case TOPOLOGY_UNPINNED: return "unpinned";
+  }
+  return "?";
+}
+
+enum TaskId : uint8_t {
+  TASK_SENSOR = 0,
+  TASK_I2C,
+  TASK_COMM,
+  TASK_ESPNOW,
+  TASK_DISPLAY,
+  TASK_CONNECT,
+  TASK_COUNT
+};
+
+static constexpr int8_t TASK_ANY_CORE = -1; // tskNO_AFFINITY
+
+typedef struct {
+  const char* name;
+  int8_t core;          // 0, 1 or TASK_ANY_CORE
+  uint8_t priority;
+  uint16_t stackBytes;
+  uint16_t queueLen;    // the task's own input queue; 0 when it only reads the sample bus
+} task_config_t;
+
+#endif // MANAGERS_TASKTOPOLOGY_H
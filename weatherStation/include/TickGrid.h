@@ -0,0 +1,55 @@
+#ifndef MANAGERS_TICKGRID_H
+#define MANAGERS_TICKGRID_H
+
+#include <stdint.h>
+
+// Phase-locked sampling instants on a monotonic microsecond clock.
+//
+// Tick k is due at start + k * period, however long the work of earlier ticks
+// took, so sample instants never drift. wake() is called when the task wakes
+// for the next tick (vTaskDelayUntil on the caller's side) and reports how far
+// off the grid it woke. A wake-up a whole period or more late skips the missed
+// instants and keeps the phase, instead of running them back to back; the
+// caller advances its own delay reference by the same number of periods.
+typedef struct {
+  uint64_t dueUs;    // grid instant of this tick
+  uint32_t jitterUs; // |wake-up - dueUs|
+  uint32_t skipped;  // grid instants missed before this one
+} tick_t;
+
+class TickGrid {
+public:
+  explicit TickGrid(uint32_t periodUs) : _periodUs(periodUs), _nextUs(0) {}
+
+  // First tick due at nowUs
+  void start(uint64_t nowUs) { _nextUs = nowUs; }
+
+  tick_t wake(uint64_t nowUs) {
+    tick_t t;
+    t.skipped = 0;
+    if (nowUs >= _nextUs + _periodUs) {
+      uint64_t missed = (nowUs - _nextUs) / _periodUs;
+      t.skipped = missed > UINT32_MAX ? UINT32_MAX : (uint32_t)missed;
+      _nextUs += missed * _periodUs;
+    }
+    t.dueUs = _nextUs;
+    uint64_t off = nowUs >= _nextUs ? nowUs - _nextUs : _nextUs - nowUs;
+    t.jitterUs = off > UINT32_MAX ? UINT32_MAX : (uint32_t)off;
+    _nextUs += _periodUs;
+    return t;
+  }
+
+  uint32_t periodUs() const { return _periodUs; }
+
+private:
+  uint32_t _periodUs;
+  uint64_t _nextUs;
+};
+
+// Unix time in ms of monotonic instant tUs, given both clocks read now
+inline uint64_t epochMsAt(uint64_t tUs, uint64_t nowUs, uint64_t nowEpochMs) {
+  uint64_t ageMs = nowUs > tUs ? (nowUs - tUs) / 1000 : 0;
+  return nowEpochMs > ageMs ? nowEpochMs - ageMs : 0;
+}
+
+#endif // MANAGERS_TICKGRID_H
@@ -0,0 +1,28 @@
+#ifndef MANAGERS_WIFIHTTPSTREAM_H
+#define MANAGERS_WIFIHTTPSTREAM_H
+
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include "HttpUplink.h"
+
+// HttpStream over WiFiClient (http) or WiFiClientSecure (https). open() is
+// the only blocking call and is bounded by the connect timeout.
+class WiFiHttpStream : public HttpStream {
+public:
+  WiFiHttpStream();
+  void begin(const http_url_t &url, uint32_t timeoutS, const char* rootCa);
+
+  bool open() override;
+  bool isOpen() override;
+  size_t write(const uint8_t* buf, size_t len) override;
+  int read(uint8_t* buf, size_t len) override;
+  void close() override;
+
+private:
+  http_url_t _url;
+  WiFiClient _plain;
+  WiFiClientSecure _secure;
+  WiFiClient* _client;
+};
+
+#endif // MANAGERS_WIFIHTTPSTREAM_H
@@ -0,0 +1,119 @@
+#ifndef MANAGERS_WINDSTATS_H
+#define MANAGERS_WINDSTATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Rolling wind statistics over fixed-rate wind speed sub-samples.
+//
+// Every sub-sample is stored as centi-km/h in a ring buffer covering 10
+// minutes. Window sums are kept as integers and updated with the sample that
+// enters and the one that leaves each window, so add() is O(1) and the sums
+// never drift. No heap, no Arduino dependencies.
+//
+//   gust      peak of the 3 s mean since the last takeGust() (WMO style gust)
+//   mean2m    mean over the last 2 minutes
+//   mean10m   mean over the last 10 minutes
+//   var10m    population variance over the last 10 minutes, (km/h)^2
+template <size_t SamplesPerSec = 1>
+class WindStats {
+public:
+  static constexpr size_t GUST_SAMPLES = 3 * SamplesPerSec;
+  static constexpr size_t MEAN2M_SAMPLES = 120 * SamplesPerSec;
+  static constexpr size_t MEAN10M_SAMPLES = 600 * SamplesPerSec;
+
+  WindStats() { reset(); }
+
+  void reset() {
+    _head = 0;
+    _count = 0;
+    _sumGust = 0;
+    _sum2m = 0;
+    _sum10m = 0;
+    _sumSq10m = 0;
+    _gustPeak = 0;
+    _gustValid = false;
+  }
+
+  void add(float kmh) {
+    uint32_t v = toCenti(kmh);
+
+    // Samples leaving each window (read before the slot is overwritten)
+    if (_count >= GUST_SAMPLES) _sumGust -= at(GUST_SAMPLES);
+    if (_count >= MEAN2M_SAMPLES) _sum2m -= at(MEAN2M_SAMPLES);
+    if (_count >= MEAN10M_SAMPLES) {
+      uint32_t old = at(MEAN10M_SAMPLES);
+      _sum10m -= old;
+      _sumSq10m -= (uint64_t)old * old;
+    }
+
+    _ring[_head] = (uint16_t)v;
+    _head = (_head + 1) % MEAN10M_SAMPLES;
+    if (_count < MEAN10M_SAMPLES) _count++;
+
+    _sumGust += v;
+    _sum2m += v;
+    _sum10m += v;
+    _sumSq10m += (uint64_t)v * v;
+
+    // Gust = highest 3 s mean; before 3 s are available use what we have
+    uint32_t n = window(GUST_SAMPLES);
+    uint32_t gust = (_sumGust + n / 2) / n;
+    if (!_gustValid || gust > _gustPeak) {
+      _gustPeak = gust;
+      _gustValid = true;
+    }
+  }
+
+  size_t count() const { return _count; }
+
+  // Peak 3 s mean since the previous call; restarts peak tracking.
+  float takeGust() {
+    float g = _gustValid ? _gustPeak / 100.0f : 0.0f;
+    _gustValid = false;
+    _gustPeak = 0;
+    return g;
+  }
+
+  float mean2m() const { return mean(_sum2m, MEAN2M_SAMPLES); }
+  float mean10m() const { return mean(_sum10m, MEAN10M_SAMPLES); }
+
+  float variance10m() const {
+    uint64_t n = window(MEAN10M_SAMPLES);
+    if (n == 0) return 0.0f;
+    // n*sum(x^2) - sum(x)^2 is exact in 64 bit for a full 10 min window
+    uint64_t num = n * _sumSq10m - (uint64_t)_sum10m * _sum10m;
+    return (float)((double)num / (double)(n * n) / 10000.0);
+  }
+
+private:
+  uint16_t _ring[MEAN10M_SAMPLES];
+  size_t _head;
+  size_t _count;
+  uint32_t _sumGust;
+  uint32_t _sum2m;
+  uint32_t _sum10m;
+  uint64_t _sumSq10m;
+  uint32_t _gustPeak;
+  bool _gustValid;
+
+  static uint32_t toCenti(float kmh) {
+    if (!(kmh > 0.0f)) return 0; // also catches NaN
+    float c = kmh * 100.0f + 0.5f;
+    return c >= 65535.0f ? 65535u : (uint32_t)c;
+  }
+
+  // Sample written `age` adds ago (age 1 = newest)
+  uint32_t at(size_t age) const {
+    return _ring[(_head + MEAN10M_SAMPLES - age) % MEAN10M_SAMPLES];
+  }
+
+  uint32_t window(size_t len) const { return (uint32_t)(_count < len ? _count : len); }
+
+  float mean(uint32_t sum, size_t len) const {
+    uint32_t n = window(len);
+    return n ? sum / (100.0f * n) : 0.0f;
+  }
+};
+
+#endif // MANAGERS_WINDSTATS_H
@@ -0,0 +1,125 @@
+#ifndef MANAGERS_WINDOWSTATS_H
+#define MANAGERS_WINDOWSTATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+// Sliding-window statistics over the last Capacity readings of one sensor
+// channel, O(1) per add() and no heap:
+//
+//   mean/variance  sliding Welford update (add the new reading, retire the
+//                  one leaving the window); recomputed exactly once per
+//                  window turn so float error cannot build up
+//   min/max        monotonic deques of (reading, index)
+//   ewma           exponentially weighted mean, alpha given at construction
+//
+// NaN readings (sensor errors) are skipped. Queries return NaN until the
+// first valid reading. No Arduino dependencies, so it also builds on a host.
+template <size_t Capacity>
+class WindowStats {
+public:
+  static_assert(Capacity > 0, "window needs at least one reading");
+
+  explicit WindowStats(float ewmaAlpha = 0.2f) : _alpha(ewmaAlpha) { reset(); }
+
+  void reset() {
+    _head = 0;
+    _count = 0;
+    _added = 0;
+    _mean = 0.0f;
+    _m2 = 0.0f;
+    _ewma = NAN;
+    _minFirst = _minLen = 0;
+    _maxFirst = _maxLen = 0;
+  }
+
+  void add(float x) {
+    if (isnan(x)) return;
+
+    if (_count < Capacity) {
+      _count++;
+      float d = x - _mean;
+      _mean += d / (float)_count;
+      _m2 += d * (x - _mean);
+    } else {
+      float old = _ring[_head];
+      float mean = _mean + (x - old) / (float)Capacity;
+      _m2 += (x - old) * (x - mean + old - _mean);
+      _mean = mean;
+    }
+    _ring[_head] = x;
+    _head = (_head + 1) % Capacity;
+    if (_head == 0 && _count == Capacity) resync();
+    if (_m2 < 0.0f) _m2 = 0.0f;
+
+    _ewma = isnan(_ewma) ? x : _ewma + _alpha * (x - _ewma);
+
+    // The reading that slid out of the window leaves the front; readings
+    // that can no longer be the minimum/maximum leave the back
+    uint32_t idx = _added++;
+    expire(_minQ, _minFirst, _minLen, idx);
+    expire(_maxQ, _maxFirst, _maxLen, idx);
+    while (_minLen && _minQ[back(_minFirst, _minLen)].value >= x) _minLen--;
+    while (_maxLen && _maxQ[back(_maxFirst, _maxLen)].value <= x) _maxLen--;
+    push(_minQ, _minFirst, _minLen, x, idx);
+    push(_maxQ, _maxFirst, _maxLen, x, idx);
+  }
+
+  size_t count() const { return _count; }
+  float mean() const { return _count ? _mean : NAN; }
+  float variance() const { return _count ? _m2 / (float)_count : NAN; } // population
+  float stddev() const { return _count ? sqrtf(_m2 / (float)_count) : NAN; }
+  float min() const { return _minLen ? _minQ[_minFirst].value : NAN; }
+  float max() const { return _maxLen ? _maxQ[_maxFirst].value : NAN; }
+  float ewma() const { return _ewma; }
+
+private:
+  typedef struct {
+    float value;
+    uint32_t index; // _added at the time of the reading
+  } entry_t;
+
+  float _alpha;
+  float _ring[Capacity];
+  size_t _head;
+  size_t _count;
+  uint32_t _added;
+  float _mean;
+  float _m2;       // sum of squared deviations from _mean
+  float _ewma;
+  entry_t _minQ[Capacity];
+  entry_t _maxQ[Capacity];
+  size_t _minFirst, _minLen;
+  size_t _maxFirst, _maxLen;
+
+  static size_t back(size_t first, size_t len) { return (first + len - 1) % Capacity; }
+
+  static void push(entry_t* q, size_t first, size_t &len, float x, uint32_t idx) {
+    entry_t &e = q[(first + len) % Capacity];
+    e.value = x;
+    e.index = idx;
+    len++;
+  }
+
+  static void expire(entry_t* q, size_t &first, size_t &len, uint32_t newest) {
+    if (len && newest - q[first].index >= Capacity) {
+      first = (first + 1) % Capacity;
+      len--;
+    }
+  }
+
+  void resync() {
+    float sum = 0.0f;
+    for (size_t i = 0; i < Capacity; ++i) sum += _ring[i];
+    _mean = sum / (float)Capacity;
+    float m2 = 0.0f;
+    for (size_t i = 0; i < Capacity; ++i) {
+      float d = _ring[i] - _mean;
+      m2 += d * d;
+    }
+    _m2 = m2;
+  }
+};
+
+#endif // MANAGERS_WINDOWSTATS_H
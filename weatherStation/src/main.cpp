@@ -5,22 +5,28 @@
 #include "EspNowManager.h"
 #include "CommManager.h"
 #include "DisplayManager.h"
+#include "I2cManager.h"
 #include "secret.h"
 
-// Global objects declared in Common.h
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+// Global objects declared in Common.h. The display library only drives
+// Wire itself during init (under i2cBus.lock()); keep it at the bus clock.
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, I2C_CLOCK_HZ, I2C_CLOCK_HZ);
 
-QueueHandle_t espNowQueue = NULL;
-QueueHandle_t httpQueue = NULL;
-QueueHandle_t displayQueue = NULL;
+I2cManager i2cBus;
+
+SensorBus sampleBus;
 
 // Networking placeholders
 const char* WIFI_SSID = secret::WIFI_SSID;
 const char* WIFI_PASS = secret::WIFI_PASS;
 const char* SERVER_URL = secret::SERVER_URL;
 
-// ESP-NOW peer
-uint8_t actuatorMac[6] = {0x70, 0xB8, 0xF6, 0x5D, 0x12, 0xCC};
+// ESP-NOW peers: actuator MAC and group. Members of a group with two or more
+// actuators share one broadcast frame; group 0 is always unicast.
+const espnow_peer_config_t espnowPeers[] = {
+  { {0x70, 0xB8, 0xF6, 0x5D, 0x12, 0xCC}, 1 },
+};
+const size_t espnowPeerCount = sizeof(espnowPeers) / sizeof(espnowPeers[0]);
 
 // Manager instances
 static SensorManager* gSensorManager = nullptr;
@@ -28,13 +34,57 @@ static EspNowManager* gEspNowManager = nullptr;
 static CommManager* gCommManager = nullptr;
 static DisplayManager* gDisplayManager = nullptr;
 
+// Serial command line, filled without blocking; longer lines are truncated
+static const size_t SERIAL_LINE_MAX = 64;
+static char gSerialLine[SERIAL_LINE_MAX];
+static size_t gSerialLineLen = 0;
+
+// "diag" prints the diagnostics report (as on <base>/diag), "diag reset" clears
+// it; benchmark builds add "bench" and "bench reset" (LatencyBench.h)
+static void processSerialLine(const char* line, size_t len) {
+  while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ')) len--;
+  if (len == 0) return;
+#if DIAG_ENABLED
+  static char report[DIAG_REPORT_BUFFER];
+  if (len == 4 && strncmp(line, "diag", 4) == 0) {
+    if (diagReportSystem(report, sizeof(report))) Serial.println(report);
+    for (size_t p = 0; p < DIAG_PROBE_COUNT; ++p) {
+      if (diagReportProbe((DiagProbe)p, report, sizeof(report))) Serial.println(report);
+    }
+    return;
+  }
+  if (len == 10 && strncmp(line, "diag reset", 10) == 0) {
+    diagReset();
+    Serial.println("diag: histograms and counters cleared");
+    return;
+  }
+#endif
+#if LATENCY_BENCH
+  if (len == 5 && strncmp(line, "bench", 5) == 0) {
+    static char bench[BENCH_REPORT_BUFFER];
+    if (benchReport(bench, sizeof(bench))) Serial.println(bench);
+    return;
+  }
+  if (len == 11 && strncmp(line, "bench reset", 11) == 0) {
+    benchReset();
+    Serial.println("bench: latency windows cleared");
+    return;
+  }
+#endif
+  Serial.printf("Unknown command '%.*s'%s%s\n", (int)len, line,
+                DIAG_ENABLED ? " (try: diag, diag reset)" : " (diagnostics compiled out)",
+                LATENCY_BENCH ? " (bench, bench reset)" : "");
+}
+
 void setup() {
   Serial.begin(115200);
   vTaskDelay(pdMS_TO_TICKS(100)); // allow serial to start
 
+  // Initialize I2C early for display and sensors; the bus task owns Wire from here
+  i2cBus.begin(SDA_PIN, SCL_PIN, I2C_CLOCK_HZ);
 
-  // Initialize I2C early for display and sensors
-  Wire.begin(SDA_PIN, SCL_PIN);
+  // Sample bus must exist before managers subscribe in begin()
+  sampleBus.begin();
 
   // instantiate managers
   gDisplayManager = new DisplayManager();
@@ -42,14 +92,26 @@ void setup() {
   gCommManager = new CommManager();
   gSensorManager = new SensorManager();
 
-  // Start components
+  // Start components (cores and priorities: TASK_TABLE in Common.h)
+  printTaskTable();
   gDisplayManager->begin(); // start display first for boot messages
-  //gEspNowManager->begin();
+#if ESPNOW_ENABLED
+  gEspNowManager->begin();
+#endif
   gCommManager->begin();
   gSensorManager->begin();
 }
 
 void loop() {
-  // All work is performed in FreeRTOS tasks
-  vTaskDelay(pdMS_TO_TICKS(1000));
+  // All work is performed in FreeRTOS tasks; the loop only reads serial commands
+  while (Serial.available()) {
+    char c = (char)Serial.read();
+    if (c == '\n') {
+      processSerialLine(gSerialLine, gSerialLineLen);
+      gSerialLineLen = 0;
+    } else if (gSerialLineLen < SERIAL_LINE_MAX) {
+      gSerialLine[gSerialLineLen++] = c;
+    }
+  }
+  vTaskDelay(pdMS_TO_TICKS(50));
 }
@@ -1,12 +1,12 @@
 #include "CommManager.h"
 #include "Common.h"
 #include <WiFi.h>
-#include <HTTPClient.h>
 #include <WiFiClient.h>
 #include <PubSubClient.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include "secret.h"
+#include "WiFiHttpStream.h"
 
 static WiFiClient wifiClient;
 static PubSubClient mqttClient(wifiClient);
@@ -14,7 +14,172 @@ static const char* MQTT_BROKER = "145.24.237.211";
 static const uint16_t MQTT_PORT = 8883;
 static const char* MQTT_TOPIC_BASE = "homestations/1051804/0";
 
-CommManager::CommManager() {}
+//
+// Link ports: the only code that sets up connections (see Link.h)
+//
+static volatile bool s_wifiGotIp = false;
+
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP: s_wifiGotIp = true; break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP: s_wifiGotIp = false; break;
+    default: break;
+  }
+}
+
+// WiFi association runs in the driver; GOT_IP/DISCONNECTED events report the result
+class WifiPort : public LinkPort {
+public:
+  bool start() override {
+    s_wifiGotIp = false;
+    WiFi.disconnect();
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    return true;
+  }
+  bool connected() override { return s_wifiGotIp; }
+  void stop() override {}
+};
+
+// PubSubClient and the TLS handshake only connect synchronously, for up to
+// their socket timeouts. Those attempts run on ConnectTask: start() queues
+// the port and returns, and Link sees the result in connected()/failed() on
+// a later poll, so CommTask keeps draining samples, polling HTTP and
+// replaying the backlog meanwhile. CommTask does not touch the client while
+// the link is not UP, and ConnectTask only touches it during an attempt.
+class AsyncConnectPort : public LinkPort {
+public:
+  AsyncConnectPort() : _phase(IDLE), _stopRequested(false) {}
+
+  bool start() override {
+    portENTER_CRITICAL(&_mux);
+    Phase phase = _phase;
+    bool busy = phase == REQUESTED || phase == RUNNING;
+    portEXIT_CRITICAL(&_mux);
+    // The previous attempt outlived its connect timeout and is still running
+    if (busy) return false;
+    // ... or finished late and left a usable connection
+    if (phase == DONE_OK && isConnected()) return true;
+    portENTER_CRITICAL(&_mux);
+    _phase = REQUESTED;
+    _stopRequested = false;
+    portEXIT_CRITICAL(&_mux);
+    AsyncConnectPort* self = this;
+    if (xQueueSend(s_connectQueue, &self, 0) != pdTRUE) {
+      setPhase(IDLE);
+      return false;
+    }
+    return true;
+  }
+
+  bool connected() override { return _phase == DONE_OK && isConnected(); }
+  bool failed() override { return _phase == DONE_FAILED; }
+
+  // During an attempt the disconnect is left to ConnectTask
+  void stop() override {
+    portENTER_CRITICAL(&_mux);
+    bool busy = _phase == REQUESTED || _phase == RUNNING;
+    if (busy) _stopRequested = true;
+    else _phase = IDLE;
+    portEXIT_CRITICAL(&_mux);
+    if (!busy) disconnect();
+  }
+
+  static void begin() {
+    s_connectQueue = xQueueCreate(TASK_TABLE[TASK_CONNECT].queueLen, sizeof(AsyncConnectPort*));
+    startTask(TASK_CONNECT, &AsyncConnectPort::taskEntry, nullptr);
+  }
+
+protected:
+  virtual bool connect() = 0;      // blocking, ConnectTask only
+  virtual bool isConnected() = 0;
+  virtual void disconnect() = 0;
+
+private:
+  enum Phase : uint8_t { IDLE, REQUESTED, RUNNING, DONE_OK, DONE_FAILED };
+  volatile Phase _phase;
+  bool _stopRequested; // parent link went down during the attempt
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  static QueueHandle_t s_connectQueue;
+
+  void setPhase(Phase p) {
+    portENTER_CRITICAL(&_mux);
+    _phase = p;
+    portEXIT_CRITICAL(&_mux);
+  }
+
+  void run() {
+    setPhase(RUNNING);
+    bool ok = !_stopRequested && connect();
+    portENTER_CRITICAL(&_mux);
+    bool stopped = _stopRequested;
+    _phase = stopped ? IDLE : (ok ? DONE_OK : DONE_FAILED);
+    _stopRequested = false;
+    portEXIT_CRITICAL(&_mux);
+    if (stopped && ok) disconnect();
+  }
+
+  static void taskEntry(void*) {
+    DIAG_TASK();
+    AsyncConnectPort* port;
+    for (;;) {
+      if (xQueueReceive(s_connectQueue, &port, portMAX_DELAY) == pdTRUE) port->run();
+    }
+  }
+};
+
+QueueHandle_t AsyncConnectPort::s_connectQueue = nullptr;
+
+class MqttPort : public AsyncConnectPort {
+protected:
+  bool connect() override {
+    char clientId[48];
+    snprintf(clientId, sizeof(clientId), "ws-%s", WiFi.macAddress().c_str());
+    if (!mqttClient.connect(clientId, secret::MQTT_USER, secret::MQTT_PASS)) {
+      Serial.printf("MQTT connect failed, rc=%d\n", mqttClient.state());
+      return false;
+    }
+    Serial.println("MQTT connected");
+    mqttClient.publish("homestations/1051804/0/gps", "51.5040, 3.8880");
+    return true;
+  }
+  bool isConnected() override { return mqttClient.connected(); }
+  void disconnect() override { mqttClient.disconnect(); }
+};
+
+static WiFiHttpStream httpStream;
+
+// Keep-alive connection to the HTTP server; HttpUplink closes it on errors
+class HttpPort : public AsyncConnectPort {
+protected:
+  bool connect() override { return httpStream.open(); }
+  bool isConnected() override { return httpStream.isOpen(); }
+  void disconnect() override { httpStream.close(); }
+};
+
+static WifiPort wifiPort;
+static MqttPort mqttPort;
+static HttpPort httpPort;
+
+static const char* wifiStatusName(int st) {
+  switch (st) {
+    case WL_CONNECTED: return "CONNECTED";
+    case WL_IDLE_STATUS: return "IDLE";
+    case WL_NO_SSID_AVAIL: return "NO_SSID_AVAIL";
+    case WL_CONNECT_FAILED: return "CONNECT_FAILED";
+    case WL_CONNECTION_LOST: return "CONNECTION_LOST";
+    case WL_DISCONNECTED: return "DISCONNECTED";
+    default: return "UNKNOWN";
+  }
+}
+
+CommManager::CommManager()
+  : _sub(-1), _log(_flash), _logReady(false), _lastReplay(0),
+    _wifi("wifi", wifiPort, WIFI_BACKOFF_MIN_MS, WIFI_BACKOFF_MAX_MS, WIFI_CONNECT_TIMEOUT_MS, esp_random()),
+    _mqtt("mqtt", mqttPort, MQTT_BACKOFF_MIN_MS, MQTT_BACKOFF_MAX_MS, MQTT_CONNECT_TIMEOUT_MS, esp_random()),
+    _http("http", httpPort, HTTP_BACKOFF_MIN_MS, HTTP_BACKOFF_MAX_MS, HTTP_CONNECT_TIMEOUT_MS, esp_random()),
+    _httpEnabled(false), _httpUplink(httpStream, HTTP_RESPONSE_TIMEOUT_MS),
+    _mqttPublishes(0), _mqttBytes(0), _mqttSamples(0), _lastDiag(0), _lastBench(0) {}
 
 void CommManager::begin() {
   WiFi.mode(WIFI_STA);
@@ -22,13 +187,44 @@ void CommManager::begin() {
   // and on some SDK versions may also de-initialize ESP-NOW.
   WiFi.disconnect();
   vTaskDelay(pdMS_TO_TICKS(100));
-  WiFi.begin(WIFI_SSID, WIFI_PASS);
+  // Reconnects are driven by the wifi Link (backoff + jitter), not the driver
+  WiFi.setAutoReconnect(false);
+  WiFi.onEvent(onWiFiEvent);
 
-  // configure MQTT server
+  // configure MQTT server; short socket timeouts bound each attempt on ConnectTask
   mqttClient.setServer(MQTT_BROKER, MQTT_PORT);
+  mqttClient.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+  wifiClient.setTimeout(MQTT_SOCKET_TIMEOUT_S);
+
+  // HTTP endpoint (backwards compatibility), optional
+  if (SERVER_URL && SERVER_URL[0] != '\0') {
+    if (httpParseUrl(SERVER_URL, _httpUrl)) {
+      httpStream.begin(_httpUrl, HTTP_SOCKET_TIMEOUT_S, HTTP_ROOT_CA);
+      _httpUplink.setTarget(_httpUrl.host, _httpUrl.path);
+      _httpEnabled = true;
+    } else {
+      Serial.printf("SERVER_URL '%s' not understood, HTTP uplink disabled\n", SERVER_URL);
+    }
+  }
+  // PubSubClient's 256-byte default only fits the per-field topics; the
+  // offline backlog is replayed as batches in either uplink mode
+  size_t mqttBuffer = MQTT_BATCH_BUFFER;
+  if (DIAG_ENABLED && DIAG_REPORT_BUFFER > mqttBuffer) mqttBuffer = DIAG_REPORT_BUFFER;
+  if (LATENCY_BENCH && BENCH_REPORT_BUFFER > mqttBuffer) mqttBuffer = BENCH_REPORT_BUFFER;
+  mqttClient.setBufferSize(mqttBuffer + 128);
 
-  if (!httpQueue) httpQueue = xQueueCreate(5, sizeof(sensor_payload_t));
-  xTaskCreatePinnedToCore(&CommManager::taskEntry, "CommTask", 8192, this, 1, NULL, 1);
+  // Offline backlog survives reboots; anything left over is replayed once connected
+  _logReady = _flash.begin(FLASH_LOG_PARTITION, FLASH_LOG_MAX_BYTES) && _log.mount();
+  if (_logReady) {
+    Serial.printf("Flash log: %lu samples pending (capacity %lu)\n",
+                  (unsigned long)_log.pending(), (unsigned long)_log.capacity());
+  } else {
+    Serial.println("Flash log unavailable, offline samples will be lost");
+  }
+
+  _sub = sampleBus.subscribe("comm", BUS_WAIT_BOUNDED);
+  AsyncConnectPort::begin();
+  startTask(TASK_COMM, &CommManager::taskEntry, this);
   
 }
 
@@ -36,196 +232,275 @@ void CommManager::taskEntry(void* pv) {
   static_cast<CommManager*>(pv)->task();
 }
 
-String CommManager::makeJson(const sensor_payload_t &p) {
-  String body = "{";
-  if (!isnan(p.tempC)) body += "\"temp\":" + String(p.tempC, 1); else body += "\"temp\":null";
-  body += ",\"humidity\":";
-  if (!isnan(p.humidity)) body += String(p.humidity, 1); else body += "null";
-  body += ",\"lux\":";
-  if (!isnan(p.lux)) body += String(p.lux, 1); else body += "null";
-  body += ",\"wind_kmh\":";
-  if (!isnan(p.wind_kmh)) body += String(p.wind_kmh, 1); else body += "null";
-  body += ",\"seq\":";
-  body += String(p.seq);
-  body += "}";
-  return body;
+bool CommManager::publish(const char* suffix, const uint8_t* msg, size_t len) {
+  char topic[64];
+  snprintf(topic, sizeof(topic), "%s/%s", MQTT_TOPIC_BASE, suffix);
+  bool ok;
+  {
+    DIAG_SCOPE(DIAG_MQTT_PUBLISH);
+    ok = mqttClient.publish(topic, msg, len);
+  }
+  if (!ok) {
+    // The broker or the socket is gone: back off and reconnect
+    DIAG_COUNT(DIAG_CTR_MQTT_FAILED);
+    _mqtt.reportError(millis());
+  }
+  _mqttPublishes++;
+  _mqttBytes += mqttWireBytes(strlen(topic), len);
+  return ok;
 }
 
-void CommManager::task() {
-  sensor_payload_t payload;
-  unsigned long start = millis();
-  unsigned long lastStatus = 0;
-  unsigned long lastMqttReconnect = 0;
-
-  // Initial connect attempt with periodic status prints (every 5s)
-  while (WiFi.status() != WL_CONNECTED && millis() - start < 10000) {
-    if (millis() - lastStatus >= 5000) {
-      int st = WiFi.status();
-      const char* ststr;
-      switch (st) {
-        case WL_CONNECTED: ststr = "CONNECTED"; break;
-        case WL_IDLE_STATUS: ststr = "IDLE"; break;
-        case WL_NO_SSID_AVAIL: ststr = "NO_SSID_AVAIL"; break;
-        case WL_CONNECT_FAILED: ststr = "CONNECT_FAILED"; break;
-        case WL_CONNECTION_LOST: ststr = "CONNECTION_LOST"; break;
-        case WL_DISCONNECTED: ststr = "DISCONNECTED"; break;
-        default: ststr = "UNKNOWN"; break;
-      }
-      Serial.printf("WiFi status: %s\n", ststr);
-      lastStatus = millis();
+bool CommManager::publish(const char* suffix, const char* msg) {
+  return publish(suffix, (const uint8_t*)msg, strlen(msg));
+}
+
+// Legacy per-field topics, one publish per value (MqttFields.h). Stops at
+// the first failed publish; false means the sample did not go out.
+bool CommManager::publishFields(const sensor_payload_t &payload) {
+  bool failed = false;
+  mqttFields(payload, [this, &failed](const char* suffix, const char* msg) {
+    if (failed) return;
+    if (!publish(suffix, msg)) {
+      Serial.printf("MQTT publish %s failed\n", suffix);
+      failed = true;
     }
-    vTaskDelay(pdMS_TO_TICKS(200));
+  });
+  return !failed;
+}
+
+// One message for the whole batch on <base>/batch; the per-field topics get
+// the newest sample so old subscribers keep working at the flush rate.
+void CommManager::flushBatch() {
+  static uint8_t body[MQTT_BATCH_BUFFER];
+  size_t len;
+  {
+    DIAG_SCOPE(DIAG_ENCODE);
+    len = _batch.encode(body, sizeof(body));
+  }
+  if (len == 0) {
+    Serial.printf("MQTT batch of %u samples does not fit %u bytes, dropping\n",
+                  (unsigned)_batch.size(), (unsigned)sizeof(body));
+    _batch.clear();
+    return;
+  }
+  if (!publish("batch", body, len)) {
+    Serial.printf("MQTT batch publish failed (%u bytes), will retry\n", (unsigned)len);
+    return;
   }
+  for (size_t i = 0; i < _batch.size(); ++i) BENCH_RECORD(BENCH_MQTT, _batch.at(i).t_us);
+  if (MQTT_BATCH_LEGACY_TOPICS) publishFields(_batch.newest());
+  _mqttSamples += _batch.size();
+  _batch.clear();
+}
+
+void CommManager::storeOffline(const sensor_payload_t &payload) {
+  if (!_logReady || !_log.append(payload)) {
+    Serial.println("Comm: offline and flash log unavailable, sample lost");
+    DIAG_COUNT(DIAG_CTR_OFFLINE_LOST);
+  }
+}
 
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.printf("WiFi connected, IP: %s\n", WiFi.localIP().toString().c_str());
-    lastStatus = millis();
+// Oldest stored samples first, in the same format as a live batch. Records
+// are only consumed once the publish went out.
+void CommManager::replayBacklog() {
+  static sensor_payload_t samples[FLASH_LOG_REPLAY_BATCH];
+  static MqttBatch<FLASH_LOG_REPLAY_BATCH, UplinkEncoding> replay;
+  static uint8_t body[MQTT_BATCH_BUFFER];
+
+  size_t n = _log.peek(samples, FLASH_LOG_REPLAY_BATCH);
+  if (n == 0) return;
+  replay.clear();
+  for (size_t i = 0; i < n; ++i) replay.add(samples[i], 0);
+  size_t len;
+  {
+    DIAG_SCOPE(DIAG_ENCODE);
+    len = replay.encode(body, sizeof(body));
+  }
+  if (len == 0) {
+    Serial.printf("Flash log: %u samples do not fit one batch, dropping\n", (unsigned)n);
+    _log.consume(n);
+    return;
+  }
+  if (!publish("batch", body, len)) return;
+  _log.consume(n);
+  _mqttSamples += n;
+}
+
+#if DIAG_ENABLED
+// System report on <base>/diag, then every probe that has seen traffic on
+// <base>/diag/<probe>
+void CommManager::publishDiag() {
+  static char body[DIAG_REPORT_BUFFER];
+  if (diagReportSystem(body, sizeof(body))) publish("diag", body);
+  for (size_t p = 0; p < DIAG_PROBE_COUNT; ++p) {
+    if (diagHistograms[p].count == 0) continue;
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "diag/%s", diagProbeName((DiagProbe)p));
+    if (diagReportProbe((DiagProbe)p, body, sizeof(body))) publish(suffix, body);
+  }
+}
+#endif
+
+#if LATENCY_BENCH
+// Latency percentiles on the console (ESP-NOW runs without a broker) and on
+// <base>/bench
+void CommManager::reportBench() {
+  static char body[BENCH_REPORT_BUFFER];
+  if (!benchReport(body, sizeof(body))) return;
+  Serial.printf("Bench: %s\n", body);
+  if (_mqtt.up()) publish("bench", body);
+}
+#endif
+
+void CommManager::pollLinks(uint32_t now) {
+  _wifi.poll(now, true);
+  _mqtt.poll(now, _wifi.up());
+  _http.poll(now, _wifi.up() && _httpEnabled);
+
+  // Report transitions once
+  static LinkState last[3] = { LINK_DOWN, LINK_DOWN, LINK_DOWN };
+  Link* links[3] = { &_wifi, &_mqtt, &_http };
+  for (int i = 0; i < 3; ++i) {
+    if (links[i]->state() == last[i]) continue;
+    last[i] = links[i]->state();
+    if (links[i] == &_wifi && _wifi.up()) {
+      Serial.printf("WiFi connected, IP: %s\n", WiFi.localIP().toString().c_str());
+      // (Re)start SNTP; samples are time-stamped once the clock is set
+      configTime(0, 0, NTP_SERVER, NTP_SERVER_FALLBACK);
+    } else {
+      Serial.printf("Link %s: %s\n", links[i]->name(), linkStateName(last[i]));
+    }
+  }
+}
+
+void CommManager::printStatus() {
+  int st = WiFi.status();
+  if (st == WL_CONNECTED) {
+    Serial.printf("WiFi status: %s, IP: %s\n", wifiStatusName(st), WiFi.localIP().toString().c_str());
   } else {
-    Serial.println("WiFi not connected (CommManager will retry on send)");
-    lastStatus = millis();
+    Serial.printf("WiFi status: %s\n", wifiStatusName(st));
   }
+  Serial.printf("Links: wifi %s (%lu tries), mqtt %s (%lu tries), http %s\n",
+                linkStateName(_wifi.state()), (unsigned long)_wifi.stats().attempts,
+                linkStateName(_mqtt.state()), (unsigned long)_mqtt.stats().attempts,
+                linkStateName(_http.state()));
+  if (_httpEnabled) {
+    const http_uplink_stats_t &hs = _httpUplink.stats();
+    uint32_t answered = hs.ok + hs.rejected;
+    Serial.printf("HTTP uplink: %lu req (%lu ok, %lu rejected, %lu failed), %u in flight, %u queued, "
+                  "%lu dropped, latency last/avg/max %lu/%lu/%lu ms\n",
+                  (unsigned long)hs.requests, (unsigned long)hs.ok, (unsigned long)hs.rejected,
+                  (unsigned long)hs.failed, (unsigned)_httpUplink.inFlight(),
+                  (unsigned)_httpUplink.queued(), (unsigned long)hs.dropped,
+                  (unsigned long)hs.lastLatencyMs,
+                  (unsigned long)(answered ? hs.totalLatencyMs / answered : 0),
+                  (unsigned long)hs.maxLatencyMs);
+  }
+  if (_mqttSamples > 0) {
+    Serial.printf("MQTT uplink: %lu samples, %.2f publishes/sample, %.1f bytes/sample\n",
+                  (unsigned long)_mqttSamples,
+                  (float)_mqttPublishes / (float)_mqttSamples,
+                  (float)_mqttBytes / (float)_mqttSamples);
+  }
+  if (_logReady && (_log.pending() > 0 || _log.overwritten() > 0)) {
+    Serial.printf("Flash log: %lu pending, %lu overwritten, %lu corrupt\n",
+                  (unsigned long)_log.pending(), (unsigned long)_log.overwritten(),
+                  (unsigned long)_log.corrupt());
+  }
+}
+
+void CommManager::task() {
+  unsigned long lastStatus = 0;
+  DIAG_TASK();
 
   for (;;) {
-    // Wait up to 5s for an outgoing payload so we can print status periodically
-    BaseType_t got = pdFALSE;
-    if (httpQueue) got = xQueueReceive(httpQueue, &payload, pdMS_TO_TICKS(5000));
+    // Links are polled here, never in the sample path below; the blocking
+    // part of a connect runs on ConnectTask
+    uint32_t now = millis();
+    pollLinks(now);
+
+    // Wait for a sample, but wake up for pending link work and backlog replay
+    uint32_t wait = 5000;
+    Link* links[3] = { &_wifi, &_mqtt, &_http };
+    for (int i = 0; i < 3; ++i) {
+      uint32_t next = links[i]->msUntilNextAction(now);
+      if (next < wait) wait = next;
+    }
+    if (_logReady && _log.pending() > 0 && _mqtt.up() && FLASH_LOG_REPLAY_INTERVAL_MS < wait) {
+      wait = FLASH_LOG_REPLAY_INTERVAL_MS;
+    }
+    if (wait < LINK_POLL_MS) wait = LINK_POLL_MS;
+    if (_httpUplink.inFlight() > 0) wait = HTTP_POLL_MS;
+    const sensor_payload_t* sample = sampleBus.acquire(_sub, pdMS_TO_TICKS(wait));
 
-    unsigned long now = millis();
+    now = millis();
     if (now - lastStatus >= 5000) {
-      int st = WiFi.status();
-      const char* ststr;
-      switch (st) {
-        case WL_CONNECTED: ststr = "CONNECTED"; break;
-        case WL_IDLE_STATUS: ststr = "IDLE"; break;
-        case WL_NO_SSID_AVAIL: ststr = "NO_SSID_AVAIL"; break;
-        case WL_CONNECT_FAILED: ststr = "CONNECT_FAILED"; break;
-        case WL_CONNECTION_LOST: ststr = "CONNECTION_LOST"; break;
-        case WL_DISCONNECTED: ststr = "DISCONNECTED"; break;
-        default: ststr = "UNKNOWN"; break;
-      }
-      if (st == WL_CONNECTED) {
-        Serial.printf("WiFi status: %s, IP: %s\n", ststr, WiFi.localIP().toString().c_str());
-      } else {
-        Serial.printf("WiFi status: %s\n", ststr);
-      }
+      printStatus();
       lastStatus = now;
     }
 
-    // Maintain MQTT connection when WiFi is available
-    if (WiFi.status() == WL_CONNECTED) {
-      if (!mqttClient.connected()) {
-        // Try to reconnect no more than once every 5s
-        if (now - lastMqttReconnect >= 5000) {
-          char clientId[48];
-          String mac = WiFi.macAddress();
-          String id = "ws-";
-          id += mac;
-          id.toCharArray(clientId, sizeof(clientId));
-          if (mqttClient.connect(clientId, secret::MQTT_USER, secret::MQTT_PASS)) {
-            Serial.println("MQTT connected");
-            mqttClient.publish("homestations/1051804/0/gps", "51.5040, 3.8880");
-          } else {
-            Serial.printf("MQTT connect failed, rc=%d\n", mqttClient.state());
-          }
-          lastMqttReconnect = now;
+    if (sample) {
+      const sensor_payload_t &payload = *sample;
+      if (MQTT_UPLINK_MODE == MQTT_UPLINK_BATCHED) {
+        _batch.add(payload, now);
+      } else if (_mqtt.up()) {
+        // A failed field keeps the whole sample for the flash replay
+        if (publishFields(payload)) {
+          BENCH_RECORD(BENCH_MQTT, payload.t_us);
+          _mqttSamples++;
+        } else {
+          storeOffline(payload);
         }
       } else {
-        mqttClient.loop();
+        storeOffline(payload);
       }
+
+      // Also queued for the HTTP endpoint if configured (backwards compatibility)
+      if (_httpEnabled) _httpUplink.add(payload, now);
+      sampleBus.release(_sub);
     }
 
-    if (got == pdTRUE) {
-      if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("Comm: WiFi not connected, attempting reconnect...");
-        WiFi.disconnect();
-        WiFi.begin(WIFI_SSID, WIFI_PASS);
-        unsigned long t = millis();
-        while (WiFi.status() != WL_CONNECTED && millis() - t < 10000) {
-          vTaskDelay(pdMS_TO_TICKS(200));
-        }
+    // HTTP: send due batches and collect responses; never waits on the server
+    if (_http.up()) {
+      if (!_httpUplink.poll(millis(), HTTP_BATCH_MAX_AGE_MS)) {
+        Serial.println("HTTP uplink: connection failed, batch requeued");
+        _http.reportError(millis());
       }
+    } else {
+      _httpUplink.requeue();
+    }
 
-      if (WiFi.status() == WL_CONNECTED) {
-        // Ensure MQTT connected before publish; attempt immediate connect if not
-        if (!mqttClient.connected()) {
-          char clientId[48];
-          String mac = WiFi.macAddress();
-          String id = "ws-";
-          id += mac;
-          id.toCharArray(clientId, sizeof(clientId));
-          if (mqttClient.connect(clientId, secret::MQTT_USER, secret::MQTT_PASS)) {
-            Serial.println("MQTT connected (on send)");
-            mqttClient.publish("homestations/1051804/0/gps", "51.5040, 3.8880");
-          } else {
-            Serial.printf("MQTT connect failed (on send) rc=%d\n", mqttClient.state());
-          }
-        }
-
-        if (mqttClient.connected()) {
-          char topic[64];
-          char msgbuf[32];
-
-          if (!isnan(payload.tempC)) {
-            dtostrf(payload.tempC, 0, 1, msgbuf);
-            snprintf(topic, sizeof(topic), "%s/temperature", MQTT_TOPIC_BASE);
-            if (!mqttClient.publish(topic, msgbuf)) {
-              Serial.println("MQTT publish Temperature failed");
-            }
-          }
-
-          if (!isnan(payload.humidity)) {
-            dtostrf(payload.humidity, 0, 1, msgbuf);
-            snprintf(topic, sizeof(topic), "%s/humidity", MQTT_TOPIC_BASE);
-            mqttClient.publish(topic, msgbuf);
-          }
-
-          // Wind speed in km/h (calibrated)
-          if (!isnan(payload.wind_kmh)) {
-            dtostrf(payload.wind_kmh, 0, 1, msgbuf);
-          } else {
-            snprintf(msgbuf, sizeof(msgbuf), "null");
-          }
-          snprintf(topic, sizeof(topic), "%s/windspeed", MQTT_TOPIC_BASE);
-          mqttClient.publish(topic, msgbuf);
-
-          if (!isnan(payload.lux)) {
-            dtostrf(payload.lux, 0, 1, msgbuf);
-            snprintf(topic, sizeof(topic), "%s/light", MQTT_TOPIC_BASE);
-            mqttClient.publish(topic, msgbuf);
-          }
-
-          // Optionally publish sequence
-          //snprintf(topic, sizeof(topic), "%s/Seq", MQTT_TOPIC_BASE);
-          //snprintf(msgbuf, sizeof(msgbuf), "%lu", (unsigned long)payload.seq);
-          //mqttClient.publish(topic, msgbuf);
-
-          mqttClient.publish("homestations/1051804/0/update", "1");
-
-          mqttClient.loop();
-        } else {
-          Serial.println("Comm: MQTT not connected, skipping MQTT publish");
-        }
-
-        // Also send to HTTP endpoint if configured (backwards compatibility)
-        if (SERVER_URL && SERVER_URL[0] != '\0') {
-          HTTPClient http;
-          http.begin(SERVER_URL);
-          http.addHeader("Content-Type", "application/json");
-          String body = makeJson(payload);
-          int code = http.POST(body);
-          if (code > 0) {
-            String resp = http.getString();
-            Serial.printf("HTTP %d: %s\n", code, resp.c_str());
-          } else {
-            Serial.printf("HTTP POST failed, err=%d\n", code);
-          }
-          http.end();
-        } else {
-          //Serial.println("Comm: SERVER_URL empty, skipping HTTP POST");
-        }
+    // Batched uplink: flush on size or age; spill to flash while offline
+    if (MQTT_UPLINK_MODE == MQTT_UPLINK_BATCHED &&
+        _batch.due(millis(), MQTT_BATCH_MAX_SAMPLES, MQTT_BATCH_MAX_AGE_MS)) {
+      if (_mqtt.up()) {
+        flushBatch();
       } else {
-        Serial.println("Comm: still not connected, skipping network send");
+        for (size_t i = 0; i < _batch.size(); ++i) storeOffline(_batch.at(i));
+        _batch.clear();
       }
     }
+
+    // Replay the offline backlog after live traffic, one batch per interval
+    if (_logReady && _log.pending() > 0 && _mqtt.up() &&
+        millis() - _lastReplay >= FLASH_LOG_REPLAY_INTERVAL_MS) {
+      replayBacklog();
+      _lastReplay = millis();
+    }
+
+#if DIAG_ENABLED
+    if (_mqtt.up() && millis() - _lastDiag >= DIAG_INTERVAL_MS) {
+      publishDiag();
+      _lastDiag = millis();
+    }
+#endif
+#if LATENCY_BENCH
+    if (millis() - _lastBench >= BENCH_REPORT_INTERVAL_MS) {
+      reportBench();
+      _lastBench = millis();
+    }
+#endif
+
+    if (_mqtt.up()) mqttClient.loop();
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,149 @@
+#include "Diag.h"
+#include "Common.h"
+
+#if DIAG_ENABLED
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "I2cManager.h"
+
+diag_histogram_t diagHistograms[DIAG_PROBE_COUNT];
+uint32_t diagCounters[DIAG_COUNTER_COUNT];
+
+typedef struct {
+  TaskHandle_t handle;
+  uint32_t lastRun; // run time counter at the previous report
+} diag_task_t;
+
+static diag_task_t diagTasks[DIAG_MAX_TASKS];
+static size_t diagTaskCount = 0;
+static uint32_t diagLastRunTotal = 0;
+static portMUX_TYPE diagMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Task run time needs FreeRTOS run time stats (off in the stock Arduino
+// sdkconfig); without them the report has stack figures only
+#if (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1)
+#define DIAG_TASK_CPU 1
+#else
+#define DIAG_TASK_CPU 0
+#endif
+
+void diagRegisterTask() {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  portENTER_CRITICAL(&diagMux);
+  if (diagTaskCount < DIAG_MAX_TASKS) {
+    diagTasks[diagTaskCount].handle = self;
+    diagTasks[diagTaskCount].lastRun = 0;
+    diagTaskCount++;
+  }
+  portEXIT_CRITICAL(&diagMux);
+}
+
+void diagReset() {
+  memset(diagHistograms, 0, sizeof(diagHistograms));
+  memset(diagCounters, 0, sizeof(diagCounters));
+}
+
+static void key(ser::Writer &w, const char* name) {
+  w.put('"');
+  w.str(name);
+  w.str("\":");
+}
+
+size_t diagReportSystem(char* buf, size_t cap) {
+  ser::Writer w((uint8_t*)buf, cap);
+  w.put('{');
+  key(w, "uptime_s"); w.u32(millis() / 1000);
+  w.put(','); key(w, "heap"); w.u32(ESP.getFreeHeap());
+  w.put(','); key(w, "heap_min"); w.u32(ESP.getMinFreeHeap());
+
+  // Stack high-water mark (bytes never used) and CPU share since the previous report
+  w.put(','); key(w, "tasks"); w.put('[');
+  portENTER_CRITICAL(&diagMux);
+  size_t tasks = diagTaskCount;
+  portEXIT_CRITICAL(&diagMux);
+#if DIAG_TASK_CPU
+  uint32_t total = portGET_RUN_TIME_COUNTER_VALUE();
+  uint32_t elapsed = total - diagLastRunTotal;
+  diagLastRunTotal = total;
+#endif
+  for (size_t i = 0; i < tasks; ++i) {
+    diag_task_t &t = diagTasks[i];
+    if (i) w.put(',');
+    w.put('{');
+    key(w, "name"); w.put('"'); w.str(pcTaskGetTaskName(t.handle)); w.put('"');
+    w.put(','); key(w, "stack_free"); w.u32((uint32_t)uxTaskGetStackHighWaterMark(t.handle));
+#if DIAG_TASK_CPU
+    TaskStatus_t st;
+    vTaskGetInfo(t.handle, &st, pdFALSE, eInvalid);
+    uint32_t run = st.ulRunTimeCounter - t.lastRun;
+    t.lastRun = st.ulRunTimeCounter;
+    w.put(','); key(w, "cpu"); w.fixed(elapsed ? 100.0f * run / elapsed : 0.0f, 1);
+#endif
+    w.put('}');
+  }
+  w.put(']');
+
+  // Sample bus: every subscriber's backlog and drops, and publishes that found no slot
+  w.put(','); key(w, "bus"); w.put('{');
+  key(w, "published"); w.u32(sampleBus.published());
+  w.put(','); key(w, "drops"); w.u32(sampleBus.publishDrops());
+  for (size_t i = 0; i < sampleBus.subscribers(); ++i) {
+    sample_bus_stats_t st = sampleBus.stats((int)i);
+    w.put(','); key(w, sampleBus.name((int)i)); w.put('{');
+    key(w, "lag"); w.u32(st.lag);
+    w.put(','); key(w, "max_lag"); w.u32(st.maxLag);
+    w.put(','); key(w, "dropped"); w.u32(st.dropped);
+    w.put(','); key(w, "stalls"); w.u32(st.stalls);
+    w.put('}');
+  }
+  w.put('}');
+
+  // I2C queues
+  w.put(','); key(w, "i2c"); w.put('[');
+  for (size_t i = 0; i < i2cBus.devices(); ++i) {
+    size_t pending;
+    i2c_device_stats_t st = i2cBus.stats((int)i, pending);
+    if (i) w.put(',');
+    w.put('{');
+    key(w, "addr"); w.u32(i2cBus.address((int)i));
+    w.put(','); key(w, "pending"); w.u32((uint32_t)pending);
+    w.put(','); key(w, "rejected"); w.u32(st.rejected);
+    w.put(','); key(w, "failed"); w.u32(st.failed);
+    w.put(','); key(w, "max_wait_ms"); w.u32(st.maxWaitMs);
+    w.put('}');
+  }
+  w.put(']');
+
+  w.put(','); key(w, "counters"); w.put('{');
+  for (size_t c = 0; c < DIAG_COUNTER_COUNT; ++c) {
+    if (c) w.put(',');
+    key(w, diagCounterName((DiagCounter)c));
+    w.u32(diagCounters[c]);
+  }
+  w.put('}');
+  w.put('}');
+  return w.finish();
+}
+
+size_t diagReportProbe(DiagProbe p, char* buf, size_t cap) {
+  diag_histogram_t h = diagHistograms[p]; // copy: the writer keeps going
+  ser::Writer w((uint8_t*)buf, cap);
+  w.put('{');
+  key(w, "probe"); w.put('"'); w.str(diagProbeName(p)); w.put('"');
+  w.put(','); key(w, "n"); w.u32(h.count);
+  w.put(','); key(w, "avg_us"); w.u32(h.count ? (uint32_t)(h.sumUs / h.count) : 0);
+  w.put(','); key(w, "p50_us"); w.u32(diagPercentileUs(h, 500));
+  w.put(','); key(w, "p90_us"); w.u32(diagPercentileUs(h, 900));
+  w.put(','); key(w, "p99_us"); w.u32(diagPercentileUs(h, 990));
+  w.put(','); key(w, "max_us"); w.u32(h.maxUs);
+  // Counts per log2 bucket: <1 us, [1,2), [2,4), ... us
+  w.put(','); key(w, "buckets"); w.put('[');
+  for (size_t k = 0; k < DIAG_BUCKETS; ++k) {
+    if (k) w.put(',');
+    w.u32(h.bucket[k]);
+  }
+  w.put(']');
+  w.put('}');
+  return w.finish();
+}
+#endif // DIAG_ENABLED
@@ -1,22 +1,37 @@
 #include "DisplayManager.h"
 #include "Common.h"
+#include "I2cManager.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
-DisplayManager::DisplayManager() {}
+// An update not out after this long is taken as lost
+static constexpr uint32_t DISPLAY_PUSH_TIMEOUT_MS = 500;
+
+DisplayManager::DisplayManager() : _sub(-1), _dev(-1), _pushDone(nullptr), _pushErrors(0), _inFlight(0) {}
 
 void DisplayManager::begin() {
-  if(!display.begin(SSD1306_SWITCHCAPVCC, 0x3C)) {
+  // The library inits the panel with its own Wire calls; Wire is already
+  // started by the bus manager
+  i2cBus.lock();
+  bool ok = display.begin(SSD1306_SWITCHCAPVCC, OLED_ADDR, true, false);
+  if (ok) {
+    display.clearDisplay();
+    display.setTextSize(1);
+    display.setTextColor(SSD1306_WHITE);
+    display.display();
+  }
+  i2cBus.unlock();
+  if(!ok) {
     Serial.println("SSD1306 init failed");
     for(;;) vTaskDelay(pdMS_TO_TICKS(1000));
   }
-  display.clearDisplay();
-  display.setTextSize(1);
-  display.setTextColor(SSD1306_WHITE);
-  display.display();
 
-  if (!displayQueue) displayQueue = xQueueCreate(1, sizeof(sensor_payload_t));
-  xTaskCreatePinnedToCore(&DisplayManager::taskEntry, "DisplayTask", 4096, this, 1, NULL, 1);
+  // Frames after init go through the bus queue, below the sensors
+  _dev = i2cBus.addDevice(OLED_ADDR, I2C_PRIORITY_DISPLAY);
+  _pushDone = xSemaphoreCreateBinaryStatic(&_pushDoneBuf);
+
+  _sub = sampleBus.subscribe("display", BUS_LATEST_ONLY);
+  startTask(TASK_DISPLAY, &DisplayManager::taskEntry, this);
 }
 
 void DisplayManager::taskEntry(void* pv) {
@@ -24,9 +39,12 @@ void DisplayManager::taskEntry(void* pv) {
 }
 
 void DisplayManager::task() {
-  sensor_payload_t payload;
+  DIAG_TASK();
   for(;;) {
-    if (displayQueue && xQueueReceive(displayQueue, &payload, portMAX_DELAY) == pdTRUE) {
+    const sensor_payload_t* sample = sampleBus.acquire(_sub, portMAX_DELAY);
+    if (sample) {
+      const sensor_payload_t &payload = *sample;
+      // Rendered off-screen in the library buffer; update() sends the difference
       display.clearDisplay();
       display.setTextSize(2);
       display.setCursor(0, 0);
@@ -61,7 +79,105 @@ void DisplayManager::task() {
         display.setCursor(0, 44);
         display.print(buf);
       }
-      display.display();
+      sampleBus.release(_sub);
+      update();
     }
   }
-}
\ No newline at end of file
+}
+
+// Sends the runs that differ from what the panel shows and waits until they
+// are out. Queued chunks point into _shadow, so it is only changed once every
+// transaction of the previous update has completed.
+void DisplayManager::update() {
+  DIAG_SCOPE(DIAG_DISPLAY_UPDATE);
+  if (!waitIdle(DISPLAY_PUSH_TIMEOUT_MS)) {
+    Serial.println("Display: previous update still on the bus, skipped");
+    DIAG_COUNT(DIAG_CTR_DISPLAY_FAILED);
+    return;
+  }
+  frame_run_t runs[DisplayShadow::MAX_RUNS];
+  size_t count = _shadow.update(display.getBuffer(), runs);
+  if (count == 0) return;
+
+  // Drop a give left over from an earlier update
+  xSemaphoreTake(_pushDone, 0);
+  uint32_t errorsBefore = _pushErrors;
+  size_t bytes = 0;
+  bool sent = pushRuns(runs, count, bytes) &&
+              xSemaphoreTake(_pushDone, pdMS_TO_TICKS(DISPLAY_PUSH_TIMEOUT_MS)) == pdTRUE &&
+              _pushErrors == errorsBefore;
+  if (!sent) {
+    // Panel content unknown: the next update rewrites every page once
+    // whatever was queued of this one is off the bus
+    Serial.printf("Display: update failed (%lu write errors so far), full refresh next\n",
+                  (unsigned long)_pushErrors);
+    waitIdle(DISPLAY_PUSH_TIMEOUT_MS);
+    _shadow.invalidate();
+    DIAG_COUNT(DIAG_CTR_DISPLAY_FAILED);
+    return;
+  }
+  DIAG_COUNT(DIAG_CTR_DISPLAY_UPDATES);
+  DIAG_COUNT_N(DIAG_CTR_DISPLAY_BYTES, bytes);
+}
+
+// Queues each run as a page/column address command followed by the run in
+// I2C_MAX_CHUNK pieces, so a sensor read waits for one chunk at most
+bool DisplayManager::pushRuns(const frame_run_t* runs, size_t count, size_t &bytes) {
+  static const uint8_t DATA_PREFIX = 0x40; // Co = 0, D/C = 1
+  for (size_t r = 0; r < count; ++r) {
+    const frame_run_t &run = runs[r];
+    const uint8_t cmd[] = { 0x00, SSD1306_PAGEADDR, run.page, run.page, SSD1306_COLUMNADDR, run.first, run.last };
+    if (!queue(cmd, sizeof(cmd), nullptr, 0, &DisplayManager::onFrameWrite)) return false;
+    bytes += sizeof(cmd);
+    const uint8_t* data = _shadow.at(run);
+    size_t len = (size_t)run.last - run.first + 1;
+    for (size_t off = 0; off < len; off += I2C_MAX_CHUNK) {
+      size_t n = len - off < I2C_MAX_CHUNK ? len - off : I2C_MAX_CHUNK;
+      bool last = r == count - 1 && off + n == len;
+      if (!queue(&DATA_PREFIX, 1, data + off, n, last ? &DisplayManager::onFrameDone : &DisplayManager::onFrameWrite)) {
+        return false;
+      }
+      bytes += 1 + n;
+    }
+  }
+  return true;
+}
+
+// One transaction, counted in _inFlight until its callback has run
+bool DisplayManager::queue(const uint8_t* head, size_t headLen, const uint8_t* data, size_t len, i2c_callback_t cb) {
+  portENTER_CRITICAL(&_pushMux);
+  _inFlight++;
+  portEXIT_CRITICAL(&_pushMux);
+  if (i2cBus.write(_dev, head, headLen, data, len, 0, cb, this)) return true;
+  portENTER_CRITICAL(&_pushMux);
+  _inFlight--;
+  portEXIT_CRITICAL(&_pushMux);
+  return false;
+}
+
+// True once every queued transaction has completed, false on timeout
+bool DisplayManager::waitIdle(uint32_t timeoutMs) {
+  TickType_t start = xTaskGetTickCount();
+  for (;;) {
+    portENTER_CRITICAL(&_pushMux);
+    uint32_t left = _inFlight;
+    portEXIT_CRITICAL(&_pushMux);
+    if (left == 0) return true;
+    if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(timeoutMs)) return false;
+    vTaskDelay(1);
+  }
+}
+
+void DisplayManager::onFrameWrite(void* ctx, bool ok, const uint8_t* data, size_t len) {
+  DisplayManager* self = static_cast<DisplayManager*>(ctx);
+  portENTER_CRITICAL(&self->_pushMux);
+  if (!ok) self->_pushErrors++;
+  self->_inFlight--;
+  portEXIT_CRITICAL(&self->_pushMux);
+}
+
+void DisplayManager::onFrameDone(void* ctx, bool ok, const uint8_t* data, size_t len) {
+  DisplayManager* self = static_cast<DisplayManager*>(ctx);
+  onFrameWrite(ctx, ok, data, len);
+  xSemaphoreGive(self->_pushDone);
+}
@@ -2,16 +2,49 @@
 #include "Common.h"
 #include <WiFi.h>
 #include <esp_now.h>
+#include <WireFormat.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
+static_assert(ESPNOW_MAX_PEERS < ESP_NOW_MAX_TOTAL_PEER_NUM, "one ESP-NOW peer slot is kept for broadcast");
+
+// Send callback result, routed to the peer by MAC
+typedef struct {
+    uint8_t mac[6];
+    uint8_t acked;
+} send_status_t;
+
 // Internal state
-static volatile bool s_lastSendFailed = false;
-static int s_peerChannel = -1;
-static bool s_isBroadcast = true;
+static QueueHandle_t s_sendStatus = NULL;
+static volatile bool s_refreshPeers = false; // set by WiFi events: channel may have changed
+static uint8_t s_broadcastChannel = 0;
+static const uint8_t BROADCAST_MAC[6] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
+
+// Add or move one ESP-NOW peer; never deletes, so there is no window in
+// which the peer is missing
+static bool setPeer(const uint8_t* mac, uint8_t channel) {
+    esp_now_peer_info_t peerInfo;
+    memset(&peerInfo, 0, sizeof(peerInfo));
+    memcpy(peerInfo.peer_addr, mac, 6);
+    peerInfo.channel = channel;
+    peerInfo.encrypt = false;
+    esp_err_t res = esp_now_is_peer_exist(mac) ? esp_now_mod_peer(&peerInfo) : esp_now_add_peer(&peerInfo);
+    if (res != ESP_OK) {
+        Serial.printf("ESP-NOW peer %02X:%02X:%02X:%02X:%02X:%02X on channel %d failed (err=%d)\n",
+                      mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], channel, res);
+    }
+    return res == ESP_OK;
+}
 
 // Constructor
-EspNowManager::EspNowManager() {}
+EspNowManager::EspNowManager()
+    : _sub(-1), _stationId(0),
+      _peers(ESPNOW_MAX_RETRIES, ESPNOW_RETRY_DELAY_MS, ESPNOW_ACK_TIMEOUT_MS, ESPNOW_PEER_LOST_AFTER),
+      _broadcastAll(false), _broadcastSeq(0) {
+#if LATENCY_BENCH
+    memset(_benchFrames, 0, sizeof(_benchFrames));
+#endif
+}
 
 // Initialize ESP-NOW
 void EspNowManager::begin() {
@@ -25,46 +58,83 @@ void EspNowManager::begin() {
     }
     Serial.println("ESP-NOW initialized");
 
+    s_sendStatus = xQueueCreate(TASK_TABLE[TASK_ESPNOW].queueLen, sizeof(send_status_t));
     esp_now_register_send_cb(&EspNowManager::onDataSent);
+    WiFi.onEvent(&EspNowManager::onWiFiEvent);
 
-    s_isBroadcast = true;
-    for (int i = 0; i < 6; ++i)
-        if (actuatorMac[i] != 0xFF) { s_isBroadcast = false; break; }
-
-    if (!s_isBroadcast) {
-        esp_now_peer_info_t peerInfo;
-        memset(&peerInfo, 0, sizeof(peerInfo));
-        memcpy(peerInfo.peer_addr, actuatorMac, 6);
-        // Use current WiFi channel (fallback to 1 if unknown)
-        uint8_t ch = WiFi.channel();
-        if (ch == 0) ch = 1;
-        peerInfo.channel = ch;
-        peerInfo.encrypt = false;
-
-        esp_err_t res = esp_now_add_peer(&peerInfo);
-        if (res != ESP_OK) {
-            Serial.printf("Failed to add ESP-NOW peer (err=%d)\n", res);
-            s_peerChannel = -1;
-        } else {
-            Serial.printf("ESP-NOW peer added on channel %d\n", peerInfo.channel);
-            s_peerChannel = peerInfo.channel;
+    // Station id in every frame header: last two bytes of the MAC
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    _stationId = (uint16_t)((mac[4] << 8) | mac[5]);
+
+    // Random first seqs so a rebooted station is not mistaken for duplicates
+    // of its previous run by the actuators
+    _broadcastSeq = esp_random();
+    for (size_t i = 0; i < espnowPeerCount; ++i) {
+        const espnow_peer_config_t &cfg = espnowPeers[i];
+        if (memcmp(cfg.mac, BROADCAST_MAC, 6) == 0) {
+            _broadcastAll = true;
+            continue;
+        }
+        if (_peers.add(cfg.mac, cfg.group, esp_random()) < 0) {
+            Serial.printf("ESP-NOW peer table full (%u), %02X:%02X:%02X:%02X:%02X:%02X ignored\n",
+                          (unsigned)ESPNOW_MAX_PEERS, cfg.mac[0], cfg.mac[1], cfg.mac[2],
+                          cfg.mac[3], cfg.mac[4], cfg.mac[5]);
         }
-    } else {
-        Serial.println("Using broadcast for ESP-NOW");
-        s_peerChannel = -1;
     }
+    if (_peers.size() == 0 && !_broadcastAll) {
+        Serial.println("No ESP-NOW peers configured");
+        return;
+    }
+    refreshPeers();
+
+    _sub = sampleBus.subscribe("espnow", BUS_WAIT_BOUNDED);
+    startTask(TASK_ESPNOW, &EspNowManager::taskEntry, this);
+}
+
+// Register every peer on the current WiFi channel in one pass. Peers reached
+// through their group's broadcast only need the broadcast peer.
+void EspNowManager::refreshPeers() {
+    uint8_t ch = WiFi.channel();
+    if (ch == 0) ch = 1;
 
-    if (!espNowQueue) {
-        espNowQueue = xQueueCreate(5, sizeof(sensor_payload_t));
+    bool needBroadcast = _broadcastAll;
+    uint8_t moved = 0;
+    for (uint8_t i = 0; i < _peers.size(); ++i) {
+        EspNowPeers::peer_t &p = _peers.at(i);
+        if (_peers.viaBroadcast(i)) {
+            needBroadcast = true;
+            continue;
+        }
+        if (p.channel == ch) continue;
+        if (setPeer(p.mac, ch)) {
+            p.channel = ch;
+            moved++;
+        } else {
+            p.channel = 0; // retried on the next refresh
+        }
+    }
+    if (needBroadcast && s_broadcastChannel != ch) {
+        s_broadcastChannel = setPeer(BROADCAST_MAC, ch) ? ch : 0;
+    }
+    if (moved > 0) {
+        Serial.printf("ESP-NOW: %u peers on channel %u\n", moved, ch);
     }
-    xTaskCreatePinnedToCore(&EspNowManager::taskEntry, "EspNowTask", 4096, this, 2, NULL, 1);
 }
 
-// Send callback
+// Send callback (WiFi task): hand the MAC ack result to the ESP-NOW task
 void EspNowManager::onDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-    Serial.print("ESP-NOW send status: ");
-    Serial.println(status == ESP_NOW_SEND_SUCCESS ? "Success" : "Fail");
-    s_lastSendFailed = (status != ESP_NOW_SEND_SUCCESS);
+    if (!s_sendStatus || !mac_addr) return;
+    send_status_t st;
+    memcpy(st.mac, mac_addr, 6);
+    st.acked = (status == ESP_NOW_SEND_SUCCESS) ? 1 : 0;
+    if (xQueueSend(s_sendStatus, &st, 0) != pdTRUE) DIAG_COUNT(DIAG_CTR_ESPNOW_STATUS_DROPPED);
+}
+
+// Joining an AP can move the radio to another channel; peers follow on the
+// next pass of the task instead of being checked before every send
+void EspNowManager::onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED) s_refreshPeers = true;
 }
 
 // Task entry
@@ -74,61 +144,203 @@ void EspNowManager::taskEntry(void* pv) {
 
 // Main task loop
 void EspNowManager::task() {
-    sensor_payload_t payload;
+    unsigned long lastStats = millis();
+    DIAG_TASK();
+
     for (;;) {
-        if (espNowQueue && xQueueReceive(espNowQueue, &payload, portMAX_DELAY) == pdTRUE) {
-            // If we have a specific peer, ensure its channel matches current WiFi channel.
-            if (!s_isBroadcast) {
-                uint8_t currentCh = WiFi.channel();
-                if (currentCh == 0) currentCh = 1;
-                if (currentCh != s_peerChannel) {
-                    Serial.printf("WiFi channel changed (%d != %d), updating ESP-NOW peer\n", currentCh, s_peerChannel);
-                    esp_err_t delRes = esp_now_del_peer(actuatorMac);
-                    if (delRes != ESP_OK) {
-                        Serial.printf("esp_now_del_peer returned %d (continuing)\n", delRes);
-                    }
-                    esp_now_peer_info_t peerInfo;
-                    memset(&peerInfo, 0, sizeof(peerInfo));
-                    memcpy(peerInfo.peer_addr, actuatorMac, 6);
-                    peerInfo.channel = currentCh;
-                    peerInfo.encrypt = false;
-                    esp_err_t addRes = esp_now_add_peer(&peerInfo);
-                    if (addRes == ESP_OK) {
-                        Serial.printf("ESP-NOW peer re-added on channel %d\n", currentCh);
-                        s_peerChannel = currentCh;
-                    } else {
-                        Serial.printf("Failed to re-add ESP-NOW peer on channel %d (err=%d)\n", currentCh, addRes);
-                    }
-                }
-            }
+        uint32_t now = millis();
 
-            esp_err_t res;
-            if (s_isBroadcast) {
-                uint8_t bcast[6] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
-                res = esp_now_send(bcast, (uint8_t*)&payload, sizeof(payload));
-            } else {
-                res = esp_now_send(actuatorMac, (uint8_t*)&payload, sizeof(payload));
-                if (res != ESP_OK) {
-                    Serial.printf("ESP-NOW send failed (err=%d), attempting to re-add peer and resend\n", res);
-                    esp_now_peer_info_t peerInfo;
-                    memset(&peerInfo, 0, sizeof(peerInfo));
-                    memcpy(peerInfo.peer_addr, actuatorMac, 6);
-                    uint8_t ch = WiFi.channel(); if (ch == 0) ch = 1;
-                    peerInfo.channel = ch;
-                    peerInfo.encrypt = false;
-                    esp_err_t add = esp_now_add_peer(&peerInfo);
-                    if (add == ESP_OK) {
-                        s_peerChannel = ch;
-                        res = esp_now_send(actuatorMac, (uint8_t*)&payload, sizeof(payload));
-                    } else {
-                        Serial.printf("esp_now_add_peer failed during resend (err=%d)\n", add);
-                    }
-                }
-            }
+        if (s_refreshPeers) {
+            s_refreshPeers = false;
+            refreshPeers();
+        }
 
-            if (res != ESP_OK) {
-                Serial.printf("ESP-NOW send failed final (err=%d)\n", res);
+        // Acks first, then (re)transmit whatever is due
+        send_status_t st;
+        while (xQueueReceive(s_sendStatus, &st, 0) == pdTRUE) {
+            _peers.onSendStatus(st.mac, st.acked != 0, now);
+        }
+
+        uint32_t wait = UINT32_MAX;
+        bool room = _broadcastAll; // broadcasts never wait for a window
+        for (uint8_t i = 0; i < _peers.size(); ++i) {
+            if (_peers.viaBroadcast(i)) {
+                room = true;
+                continue;
             }
+            EspNowPeers::peer_t &p = _peers.at(i);
+            p.tx.poll(now, [this, &p, i](const uint8_t* frame, size_t len) {
+                esp_err_t res;
+                {
+                    DIAG_SCOPE(DIAG_ESPNOW_SEND);
+                    res = esp_now_send(p.mac, frame, len);
+                }
+                if (res == ESP_ERR_ESPNOW_NOT_FOUND) s_refreshPeers = true;
+#if LATENCY_BENCH
+                if (res == ESP_OK) benchSent(i, frame);
+#endif
+                return res == ESP_OK;
+            });
+            _peers.updateHealth(p, now);
+
+            // Wake up for callbacks and retransmits while frames are in flight
+            uint32_t next = p.tx.msUntilNextAction(now);
+            if (p.tx.inFlight() > 0 && next > ESPNOW_POLL_MS) next = ESPNOW_POLL_MS;
+            if (next < wait) wait = next;
+            if (p.tx.canSubmit()) room = true;
+        }
+
+        if (now - lastStats >= ESPNOW_STATS_INTERVAL_MS) {
+            printStats();
+            lastStats = now;
+        }
+
+        // Every window full: samples wait on the bus and share the next frame
+        if (!room) {
+            vTaskDelay(pdMS_TO_TICKS(wait));
+            continue;
         }
+
+        const sensor_payload_t* sample =
+            sampleBus.acquire(_sub, wait == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait));
+        if (!sample) continue;
+
+        // The new sample plus any that queued up behind it, as many as fit
+        // in one ESP-NOW frame
+        sensor_payload_t batch[WIRE_MAX_SAMPLES];
+        uint8_t count = 0;
+        while (sample) {
+            batch[count++] = *sample;
+            sampleBus.release(_sub);
+            sample = count >= WIRE_MAX_SAMPLES ? nullptr : sampleBus.acquire(_sub, 0);
+        }
+        sendSamples(batch, count, millis());
+    }
+}
+
+static size_t buildFrame(uint8_t* frame, uint16_t stationId, uint32_t seq, uint8_t group,
+                         const sensor_payload_t* samples, uint8_t count) {
+    WireFrameBuilder builder(frame);
+    builder.begin(WIRE_MSG_SAMPLES, stationId, seq, group);
+    for (uint8_t i = 0; i < count; ++i) builder.add(samples[i]);
+    return builder.finish();
+}
+
+// One frame per unicast peer (queued in its window), one broadcast per group
+void EspNowManager::sendSamples(const sensor_payload_t* samples, uint8_t count, uint32_t now) {
+    uint8_t frame[WIRE_MAX_FRAME];
+    bool sent = false;
+
+    for (uint8_t i = 0; i < _peers.size(); ++i) {
+        if (_peers.viaBroadcast(i)) continue;
+        EspNowPeers::peer_t &p = _peers.at(i);
+        if (!p.tx.canSubmit()) {
+            p.overflows++;
+            continue;
+        }
+        size_t len = buildFrame(frame, _stationId, p.seq, WIRE_GROUP_NONE, samples, count);
+#if LATENCY_BENCH
+        if (p.tx.submit(frame, len, p.seq, now)) benchHold(i, p.seq, samples, count);
+#else
+        p.tx.submit(frame, len, p.seq, now);
+#endif
+        p.seq++;
+    }
+
+    for (uint8_t g = 0; g < _peers.groupCount(); ++g) {
+        if (!_peers.groupBroadcast(g)) continue;
+        size_t len = buildFrame(frame, _stationId, _peers.nextGroupSeq(g), _peers.groupAt(g), samples, count);
+        sent |= sendBroadcast(frame, len);
+    }
+
+    if (_broadcastAll) {
+        size_t len = buildFrame(frame, _stationId, _broadcastSeq++, WIRE_GROUP_ALL, samples, count);
+        sent |= sendBroadcast(frame, len);
+    }
+
+    // Benchmark: a broadcast is on the air now; unicast frames count at their
+    // first accepted esp_now_send() (benchSent)
+    if (sent) {
+        for (uint8_t i = 0; i < count; ++i) BENCH_RECORD(BENCH_ESPNOW, samples[i].t_us);
+    }
+}
+
+#if LATENCY_BENCH
+// A frame dropped without ever leaving leaves a stale entry; the oldest seq
+// gives way when every entry is taken.
+void EspNowManager::benchHold(uint8_t peer, uint32_t seq, const sensor_payload_t* samples, uint8_t count) {
+    bench_frame_t* slot = nullptr;
+    for (uint8_t k = 0; k < ESPNOW_WINDOW; ++k) {
+        bench_frame_t &f = _benchFrames[peer][k];
+        if (f.count == 0) { slot = &f; break; }
+        if (!slot || (int32_t)(f.seq - slot->seq) < 0) slot = &f;
+    }
+    slot->seq = seq;
+    slot->count = count;
+    for (uint8_t i = 0; i < count; ++i) slot->t_us[i] = samples[i].t_us;
+}
+
+// Retransmits find no entry: only the first transmission is recorded
+void EspNowManager::benchSent(uint8_t peer, const uint8_t* frame) {
+    uint32_t seq;
+    memcpy(&seq, frame + offsetof(wire_header_t, seq), sizeof(seq));
+    for (uint8_t k = 0; k < ESPNOW_WINDOW; ++k) {
+        bench_frame_t &f = _benchFrames[peer][k];
+        if (f.count == 0 || f.seq != seq) continue;
+        for (uint8_t i = 0; i < f.count; ++i) BENCH_RECORD(BENCH_ESPNOW, f.t_us[i]);
+        f.count = 0;
+        return;
+    }
+}
+#endif
+
+
+// Broadcasts are not acked by the MAC: sent once, the next sample follows
+bool EspNowManager::sendBroadcast(const uint8_t* frame, size_t len) {
+    esp_err_t res;
+    {
+        DIAG_SCOPE(DIAG_ESPNOW_SEND);
+        res = esp_now_send(BROADCAST_MAC, frame, len);
+    }
+    if (res == ESP_ERR_ESPNOW_NOT_FOUND) {
+        s_broadcastChannel = 0;
+        s_refreshPeers = true;
+    }
+    if (res != ESP_OK) {
+        Serial.printf("ESP-NOW broadcast failed (err=%d)\n", res);
+    }
+    return res == ESP_OK;
+}
+
+void EspNowManager::printStats() {
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < _peers.size(); ++i) {
+        const EspNowPeers::peer_t &p = _peers.at(i);
+        if (_peers.viaBroadcast(i)) {
+            Serial.printf("ESP-NOW %02X:%02X:%02X:%02X:%02X:%02X: group %u broadcast\n",
+                          p.mac[0], p.mac[1], p.mac[2], p.mac[3], p.mac[4], p.mac[5], p.group);
+            continue;
+        }
+        const reliable_tx_stats_t &s = p.tx.stats();
+        uint32_t ratio = reliableDeliveryPermille(s);
+        Serial.printf("ESP-NOW %02X:%02X:%02X:%02X:%02X:%02X: %s ch %u, %lu frames, %lu delivered (%lu.%lu%%), "
+                      "%lu dropped, %lu retransmits, %lu ack timeouts (%lu late callbacks), %lu overflows, %u in flight, "
+                      "rtt min/avg/max %lu/%lu/%lu ms, last ack %lu s ago\n",
+                      p.mac[0], p.mac[1], p.mac[2], p.mac[3], p.mac[4], p.mac[5],
+                      peerHealthName(p.health), p.channel,
+                      (unsigned long)s.frames, (unsigned long)s.delivered,
+                      (unsigned long)(ratio / 10), (unsigned long)(ratio % 10),
+                      (unsigned long)s.dropped, (unsigned long)s.retransmits,
+                      (unsigned long)s.timeouts, (unsigned long)s.lateCallbacks,
+                      (unsigned long)p.overflows, (unsigned)p.tx.inFlight(),
+                      (unsigned long)s.rttMinMs, (unsigned long)reliableMeanRttMs(s),
+                      (unsigned long)s.rttMaxMs,
+                      (unsigned long)(s.delivered ? (now - p.lastAckMs) / 1000 : 0));
+    }
+    for (uint8_t g = 0; g < _peers.groupCount(); ++g) {
+        if (!_peers.groupBroadcast(g)) continue;
+        Serial.printf("ESP-NOW group %u: %u peers, %lu broadcast frames\n",
+                      _peers.groupAt(g), _peers.groupSize(_peers.groupAt(g)),
+                      (unsigned long)_peers.groupFrames(g));
     }
 }
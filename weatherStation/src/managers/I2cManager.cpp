@@ -0,0 +1,151 @@
+#include "I2cManager.h"
+#include "Common.h"
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// I2cPort on the Arduino Wire driver
+class WireI2cPort : public I2cPort {
+public:
+  bool write(uint8_t addr, const uint8_t* head, size_t headLen, const uint8_t* data, size_t len) override {
+    Wire.beginTransmission(addr);
+    if (headLen) Wire.write(head, headLen);
+    if (len) Wire.write(data, len);
+    return Wire.endTransmission() == 0;
+  }
+
+  bool read(uint8_t addr, uint8_t* out, size_t len) override {
+    if (Wire.requestFrom(addr, len) != len) return false;
+    for (size_t i = 0; i < len; ++i) out[i] = (uint8_t)Wire.read();
+    return true;
+  }
+};
+
+static uint32_t lockStartUs = 0;
+
+I2cManager::I2cManager() : _wire(nullptr), _task(nullptr), _maxHoldUs(0), _busyUs() {}
+
+void I2cManager::begin(int sda, int scl, uint32_t clockHz) {
+  Wire.begin(sda, scl);
+  Wire.setClock(clockHz);
+  _wire = xSemaphoreCreateMutexStatic(&_wireBuf);
+  // Above the sensor and display tasks (TASK_TABLE): a due transaction starts right away
+  startTask(TASK_I2C, &I2cManager::taskEntry, this, &_task);
+}
+
+int I2cManager::addDevice(uint8_t addr, uint8_t priority) {
+  portENTER_CRITICAL(&_mux);
+  int dev = _queues.addDevice(addr, priority);
+  portEXIT_CRITICAL(&_mux);
+  return dev;
+}
+
+bool I2cManager::write(int dev, const uint8_t* head, size_t headLen, const uint8_t* data, size_t len,
+                       uint32_t afterMs, i2c_callback_t cb, void* ctx) {
+  uint32_t now = millis();
+  portENTER_CRITICAL(&_mux);
+  bool ok = _queues.submitWrite(dev, head, headLen, data, len, afterMs, now, cb, ctx);
+  portEXIT_CRITICAL(&_mux);
+  if (ok) wake();
+  return ok;
+}
+
+bool I2cManager::read(int dev, size_t len, uint32_t afterMs, i2c_callback_t cb, void* ctx) {
+  uint32_t now = millis();
+  portENTER_CRITICAL(&_mux);
+  bool ok = _queues.submitRead(dev, len, afterMs, now, cb, ctx);
+  portEXIT_CRITICAL(&_mux);
+  if (ok) wake();
+  return ok;
+}
+
+bool I2cManager::lock(TickType_t wait) {
+  if (xSemaphoreTake(_wire, wait) != pdTRUE) return false;
+  lockStartUs = micros();
+  return true;
+}
+
+void I2cManager::unlock() {
+  uint32_t held = micros() - lockStartUs;
+  if (held > _maxHoldUs) _maxHoldUs = held;
+  xSemaphoreGive(_wire);
+}
+
+bool I2cManager::probe(uint8_t addr) {
+  lock();
+  Wire.beginTransmission(addr);
+  uint8_t err = Wire.endTransmission();
+  unlock();
+  return err == 0;
+}
+
+void I2cManager::wake() {
+  if (_task) xTaskNotifyGive(_task);
+}
+
+void I2cManager::taskEntry(void* pv) {
+  static_cast<I2cManager*>(pv)->task();
+}
+
+void I2cManager::task() {
+  WireI2cPort port;
+  uint32_t lastStats = millis();
+  DIAG_TASK();
+
+  for (;;) {
+    uint32_t now = millis();
+    if (now - lastStats >= I2C_STATS_INTERVAL_MS) {
+      printStats();
+      lastStats = now;
+    }
+
+    i2c_txn_t txn;
+    int dev;
+    uint8_t addr;
+    portENTER_CRITICAL(&_mux);
+    bool due = _queues.take(now, txn, dev, addr);
+    uint32_t wait = due ? 0 : _queues.msUntilDue(now);
+    portEXIT_CRITICAL(&_mux);
+
+    // Nothing due: sleep until the next delayed transaction, a new one, or stats
+    if (!due) {
+      uint32_t untilStats = I2C_STATS_INTERVAL_MS - (now - lastStats);
+      if (wait > untilStats) wait = untilStats;
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait ? wait : 1));
+      continue;
+    }
+
+    xSemaphoreTake(_wire, portMAX_DELAY);
+    uint32_t start = micros();
+    bool ok = I2cQueues::execute(port, addr, txn);
+    uint32_t held = micros() - start;
+    xSemaphoreGive(_wire);
+    if (held > _maxHoldUs) _maxHoldUs = held;
+    _busyUs[dev] += held;
+    DIAG_RECORD_US(DIAG_I2C_TXN, held);
+
+    portENTER_CRITICAL(&_mux);
+    _queues.finish(dev, ok, millis());
+    portEXIT_CRITICAL(&_mux);
+    I2cQueues::complete(txn, ok);
+  }
+}
+
+i2c_device_stats_t I2cManager::stats(int dev, size_t &pending) {
+  portENTER_CRITICAL(&_mux);
+  i2c_device_stats_t s = _queues.stats(dev);
+  pending = _queues.pending(dev);
+  portEXIT_CRITICAL(&_mux);
+  return s;
+}
+
+void I2cManager::printStats() {
+  for (size_t i = 0; i < _queues.devices(); ++i) {
+    size_t pending;
+    i2c_device_stats_t s = stats((int)i, pending);
+    Serial.printf("I2C 0x%02X: %lu done, %lu failed, %lu rejected, %u pending, max wait %lu ms\n",
+                  _queues.address((int)i), (unsigned long)s.done, (unsigned long)s.failed,
+                  (unsigned long)s.rejected, (unsigned)pending, (unsigned long)s.maxWaitMs);
+  }
+  Serial.printf("I2C: longest bus hold %lu us\n", (unsigned long)_maxHoldUs);
+}
@@ -0,0 +1,67 @@
+#include "LatencyBench.h"
+#include "Common.h"
+
+#if LATENCY_BENCH
+#include <esp_timer.h>
+#include <algorithm>
+
+static LatencyWindow<BENCH_WINDOW> benchWindows[BENCH_PATH_COUNT];
+static portMUX_TYPE benchMux = portMUX_INITIALIZER_UNLOCKED;
+
+void benchRecord(BenchPath path, uint64_t sampleUs) {
+  uint64_t now = (uint64_t)esp_timer_get_time();
+  uint64_t age = now > sampleUs ? now - sampleUs : 0;
+  uint32_t us = age > UINT32_MAX ? UINT32_MAX : (uint32_t)age;
+  portENTER_CRITICAL(&benchMux);
+  benchWindows[path].add(us);
+  portEXIT_CRITICAL(&benchMux);
+}
+
+void benchReset() {
+  portENTER_CRITICAL(&benchMux);
+  for (size_t p = 0; p < BENCH_PATH_COUNT; ++p) benchWindows[p].clear();
+  portEXIT_CRITICAL(&benchMux);
+}
+
+static void key(ser::Writer &w, const char* name) {
+  w.put('"');
+  w.str(name);
+  w.str("\":");
+}
+
+size_t benchReport(char* buf, size_t cap) {
+  uint32_t sorted[BENCH_WINDOW];
+  ser::Writer w((uint8_t*)buf, cap);
+  w.put('{');
+  key(w, "topology"); w.put('"'); w.str(taskTopologyName(TASK_LAYOUT)); w.put('"');
+
+  // The layout being measured: core (-1 = any) and priority per task
+  w.put(','); key(w, "tasks"); w.put('{');
+  for (size_t i = 0; i < TASK_COUNT; ++i) {
+    if (i) w.put(',');
+    key(w, TASK_TABLE[i].name);
+    w.put('['); w.i32(TASK_TABLE[i].core); w.put(','); w.u32(TASK_TABLE[i].priority); w.put(']');
+  }
+  w.put('}');
+
+  for (size_t p = 0; p < BENCH_PATH_COUNT; ++p) {
+    // Copy under the lock, sort outside it: the writers keep going
+    portENTER_CRITICAL(&benchMux);
+    size_t n = benchWindows[p].copyTo(sorted);
+    uint32_t total = benchWindows[p].total();
+    portEXIT_CRITICAL(&benchMux);
+    std::sort(sorted, sorted + n);
+
+    w.put(','); key(w, benchPathName((BenchPath)p)); w.put('{');
+    key(w, "n"); w.u32(total);
+    w.put(','); key(w, "window"); w.u32((uint32_t)n);
+    w.put(','); key(w, "p50_us"); w.u32(benchPercentile(sorted, n, 500));
+    w.put(','); key(w, "p90_us"); w.u32(benchPercentile(sorted, n, 900));
+    w.put(','); key(w, "p99_us"); w.u32(benchPercentile(sorted, n, 990));
+    w.put(','); key(w, "max_us"); w.u32(n ? sorted[n - 1] : 0);
+    w.put('}');
+  }
+  w.put('}');
+  return w.finish();
+}
+#endif // LATENCY_BENCH
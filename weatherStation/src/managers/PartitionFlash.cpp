@@ -0,0 +1,27 @@
+#include "PartitionFlash.h"
+#include <Arduino.h>
+
+PartitionFlash::PartitionFlash() : _part(NULL), _size(0) {}
+
+bool PartitionFlash::begin(const char* label, uint32_t maxBytes) {
+  _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  if (!_part) {
+    Serial.printf("Flash log: partition '%s' not found\n", label);
+    return false;
+  }
+  _size = _part->size < maxBytes ? _part->size : maxBytes;
+  _size -= _size % sectorSize();
+  return _size > 0;
+}
+
+bool PartitionFlash::read(uint32_t addr, void* dst, size_t len) {
+  return _part && esp_partition_read(_part, addr, dst, len) == ESP_OK;
+}
+
+bool PartitionFlash::write(uint32_t addr, const void* src, size_t len) {
+  return _part && esp_partition_write(_part, addr, src, len) == ESP_OK;
+}
+
+bool PartitionFlash::erase(uint32_t addr) {
+  return _part && esp_partition_erase_range(_part, addr, sectorSize()) == ESP_OK;
+}
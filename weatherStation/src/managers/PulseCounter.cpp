@@ -0,0 +1,118 @@
+#include "PulseCounter.h"
+#include "Common.h"
+#include <Arduino.h>
+#include <driver/pcnt.h>
+
+//
+// ISR backend (kept private to this translation unit)
+//
+static volatile uint32_t pulseCount = 0;
+static volatile uint32_t lastPulseMicros = 0;
+static uint32_t pulseDebounceUs = 1000;
+
+static void IRAM_ATTR hallISR() {
+  uint32_t now = micros();
+  if (now - lastPulseMicros > pulseDebounceUs) {
+    pulseCount++;
+    lastPulseMicros = now;
+  }
+}
+
+IsrPulseCounter::IsrPulseCounter(uint8_t pin, uint32_t debounceUs)
+  : _pin(pin) {
+  pulseDebounceUs = debounceUs;
+}
+
+bool IsrPulseCounter::begin() {
+  pinMode(_pin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(_pin), hallISR, FALLING);
+  return true;
+}
+
+uint32_t IsrPulseCounter::take() {
+  noInterrupts();
+  uint32_t pulses = pulseCount;
+  pulseCount = 0;
+  interrupts();
+  return pulses;
+}
+
+//
+// PCNT backend
+//
+// The hardware counter is 16 bit and resets to zero when it reaches the high
+// limit, so an event interrupt (once every PCNT_H_LIM pulses) extends it to
+// 32 bit; WrappingCount covers a wrap whose interrupt has not run yet.
+static constexpr int16_t PCNT_H_LIM = 32767;
+
+PcntPulseCounter::PcntPulseCounter(uint8_t pin, uint8_t unit, uint16_t filterApbCycles)
+  : _pin(pin), _unit(unit), _filterApbCycles(filterApbCycles), _overflows(0), _total(PCNT_H_LIM) {}
+
+void IRAM_ATTR PcntPulseCounter::overflowISR(void* arg) {
+  PcntPulseCounter* self = static_cast<PcntPulseCounter*>(arg);
+  self->_overflows = self->_overflows + 1;
+}
+
+bool PcntPulseCounter::begin() {
+  pcnt_unit_t unit = (pcnt_unit_t)_unit;
+  pinMode(_pin, INPUT_PULLUP);
+
+  pcnt_config_t cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.pulse_gpio_num = _pin;
+  cfg.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+  cfg.unit = unit;
+  cfg.channel = PCNT_CHANNEL_0;
+  cfg.pos_mode = PCNT_COUNT_DIS;   // count falling edges, same as the ISR backend
+  cfg.neg_mode = PCNT_COUNT_INC;
+  cfg.lctrl_mode = PCNT_MODE_KEEP;
+  cfg.hctrl_mode = PCNT_MODE_KEEP;
+  cfg.counter_h_lim = PCNT_H_LIM;
+  cfg.counter_l_lim = 0;
+
+  esp_err_t err = pcnt_unit_config(&cfg);
+  if (err != ESP_OK) {
+    Serial.printf("PCNT: unit config failed (err=%d)\n", err);
+    return false;
+  }
+
+  // Glitch filter: ignore pulses shorter than filterApbCycles / 80MHz (max 1023).
+  pcnt_set_filter_value(unit, _filterApbCycles);
+  pcnt_filter_enable(unit);
+
+  pcnt_event_enable(unit, PCNT_EVT_H_LIM);
+  pcnt_isr_service_install(0); // may already be installed by another unit
+  err = pcnt_isr_handler_add(unit, &PcntPulseCounter::overflowISR, this);
+  if (err != ESP_OK) {
+    Serial.printf("PCNT: overflow handler failed (err=%d)\n", err);
+    return false;
+  }
+
+  pcnt_counter_pause(unit);
+  pcnt_counter_clear(unit);
+  _overflows = 0;
+  _total.reset();
+  pcnt_counter_resume(unit);
+  return true;
+}
+
+uint32_t PcntPulseCounter::take() {
+  // Re-read if an overflow happened while sampling the counter
+  uint32_t overflows;
+  int16_t value;
+  do {
+    overflows = _overflows;
+    pcnt_get_counter_value((pcnt_unit_t)_unit, &value);
+  } while (overflows != _overflows);
+
+  return _total.take(overflows, (uint16_t)value);
+}
+
+PulseCounter* createAnemometerCounter() {
+#if ANEMOMETER_USE_PCNT
+  static PcntPulseCounter counter(HALL_PIN, 0, ANEMOMETER_PCNT_FILTER);
+#else
+  static IsrPulseCounter counter(HALL_PIN, ANEMOMETER_DEBOUNCE_US);
+#endif
+  return &counter;
+}
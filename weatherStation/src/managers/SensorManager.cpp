@@ -1,285 +1,357 @@
 #include "SensorManager.h"
 #include "Common.h"
+#include "Dht22Decoder.h"
+#include "PulseCounter.h"
+#include "I2cManager.h"
+#include "TickGrid.h"
 #include <Arduino.h>
 #include <cmath>
-#include <Wire.h>
-#include <BH1750.h>
+#include <sys/time.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
-//
-// Local ISR state (kept private to this translation unit)
-//
-volatile uint32_t pulseCount = 0;
-volatile uint32_t lastPulseMicros = 0;
-
-IRAM_ATTR void hallISR() {
-  uint32_t now = micros();
-  if (now - lastPulseMicros > 1000) {
-    pulseCount++;
-    lastPulseMicros = now;
+// DHT22 edge capture: every edge on DHTPIN is timestamped here and decoded
+// afterwards by dht22Decode(), so interrupts stay enabled during the frame.
+static constexpr size_t DHT22_MAX_EDGES = 2 * DHT22_MAX_HIGH_PULSES + 4;
+static constexpr uint32_t DHT22_CAPTURE_MS = 8;
+static dht22_edge_t dhtEdges[DHT22_MAX_EDGES];
+static volatile size_t dhtEdgeCount = 0;
+
+IRAM_ATTR void dhtEdgeISR() {
+  size_t n = dhtEdgeCount;
+  if (n < DHT22_MAX_EDGES) {
+    dhtEdges[n].us = micros();
+    dhtEdges[n].level = (uint8_t)digitalRead(DHTPIN);
+    dhtEdgeCount = n + 1;
   }
 }
 
-static BH1750 lightMeter;
-
 SensorManager::SensorManager(uint32_t intervalMs)
-  : _intervalMs(intervalMs), _seq(0) {}
+  : _intervalMs(intervalMs), _seq(0), _anemometer(nullptr),
+    _temp(SENSOR_EWMA_ALPHA), _humidity(SENSOR_EWMA_ALPHA), _lux(SENSOR_EWMA_ALPHA), _windSubs(SENSOR_EWMA_ALPHA),
+    _luxDev(-1), _luxRaw(0), _luxFresh(false), _luxPending(false), _luxErrors(0), _luxDelayMs(0) {}
 
 void SensorManager::begin() {
-  Wire.begin(SDA_PIN, SCL_PIN);
-
-  // Scan I2C for BH1750 on common addresses (0x23 and 0x5C) and attempt init.
+  // Scan I2C for BH1750 on common addresses (0x23 and 0x5C)
   Serial.println("Scanning I2C for BH1750...");
   uint8_t candidate_addrs[] = { BH1750_ADDR, 0x5C };
   uint8_t foundAddr = 0;
   size_t naddrs = sizeof(candidate_addrs) / sizeof(candidate_addrs[0]);
   for (size_t i = 0; i < naddrs; ++i) {
     uint8_t addr = candidate_addrs[i];
-    Wire.beginTransmission(addr);
-    uint8_t ack = Wire.endTransmission();
-    if (ack == 0) {
+    if (i2cBus.probe(addr)) {
       Serial.printf("I2C device responds at 0x%02X\n", addr);
       foundAddr = addr;
       break;
     } else {
-      Serial.printf("No I2C ack at 0x%02X (err=%d)\n", addr, ack);
+      Serial.printf("No I2C ack at 0x%02X\n", addr);
     }
   }
+  if (!foundAddr) {
+    Serial.printf("BH1750 not found, trying default addr 0x%02X\n", BH1750_ADDR);
+    foundAddr = BH1750_ADDR;
+  }
 
-  bool bhOk = false;
-  if (foundAddr) {
-    // Pass explicit address and Wire instance to the BH1750 library to avoid address ambiguity.
-    bhOk = lightMeter.begin(BH1750::ONE_TIME_HIGH_RES_MODE, foundAddr, &Wire);
-    if (bhOk) {
-      Serial.printf("BH1750 init OK at 0x%02X (one-shot)\n", foundAddr);
-    } else {
-      Serial.printf("BH1750 init failed at 0x%02X\n", foundAddr);
-    }
+  // Power on, and start continuous conversions (a fresh one every 120 ms)
+  // when oversampling; one-shot conversions are started per report
+  _luxDev = i2cBus.addDevice(foundAddr, I2C_PRIORITY_SENSOR);
+  const uint8_t powerOn = BH1750_POWER_ON;
+  const uint8_t continuous = BH1750_CONTINUOUS_HIGH_RES_MODE;
+  if (LUX_OVERSAMPLING) {
+    i2cBus.write(_luxDev, &powerOn, 1);
+    i2cBus.write(_luxDev, &continuous, 1, nullptr, 0, 0, &SensorManager::onLuxConfigured, this);
+    _luxDelayMs = BH1750_CONVERSION_MS;
   } else {
-    // Try default address from Common.h, then library default as fallback.
-    if (lightMeter.begin(BH1750::ONE_TIME_HIGH_RES_MODE, BH1750_ADDR, &Wire)) {
-      Serial.printf("BH1750 init OK at default addr 0x%02X\n", BH1750_ADDR);
-      bhOk = true;
-    } else if (lightMeter.begin(BH1750::ONE_TIME_HIGH_RES_MODE)) {
-      Serial.println("BH1750 init OK (library default)");
-      bhOk = true;
-    } else {
-      Serial.println("BH1750 init failed (no BH1750 found)");
-    }
+    i2cBus.write(_luxDev, &powerOn, 1, nullptr, 0, 0, &SensorManager::onLuxConfigured, this);
   }
 
-  delay(200);
-
-  // DHT22 handled by manual bit-banged reader; no library init required
-  pinMode(HALL_PIN, INPUT_PULLUP);
-  attachInterrupt(digitalPinToInterrupt(HALL_PIN), hallISR, FALLING);
+  // DHT22 is read through edge capture + dht22Decode(); no library init required
+  pinMode(DHTPIN, INPUT_PULLUP);
 
-  if (!espNowQueue) espNowQueue = xQueueCreate(5, sizeof(sensor_payload_t));
-  if (!httpQueue) httpQueue = xQueueCreate(5, sizeof(sensor_payload_t));
-  if (!displayQueue) displayQueue = xQueueCreate(1, sizeof(sensor_payload_t));
+  _anemometer = createAnemometerCounter();
+  if (!_anemometer->begin()) {
+    Serial.println("Anemometer counter init failed");
+  }
 
-  xTaskCreatePinnedToCore(&SensorManager::taskEntry, "SensorTask", 4096, this, 2, NULL, 1);
+  startTask(TASK_SENSOR, &SensorManager::taskEntry, this);
 }
 
 void SensorManager::taskEntry(void* pv) {
   static_cast<SensorManager*>(pv)->task();
 }
 
-void SensorManager::task() {
-  for (;;) {
-    uint32_t start = millis();
-
-    noInterrupts();
-    uint32_t pulses = pulseCount;
-    pulseCount = 0;
-    interrupts();
-
-    // Use pulses per second and apply calibration to convert to km/h:
-    // Calibration (logarithmic fit from calibration curve):
-    //   wind_kmh = 6.4056 * ln(pulses_per_sec) + 10.212   (R^2 = 0.9914)
-    float pulses_per_sec = (float)pulses / (_intervalMs / 1000.0f);
-    float wind_kmh;
-    // Treat tiny pulse rates as zero (noise floor)
-    if (pulses_per_sec < 0.05f) {
-      wind_kmh = 0.0f;
-    } else {
-      // Use natural logarithm; clamp negative results to zero
-      float fitVal = 6.4056f * logf(pulses_per_sec) + 10.212f;
-      wind_kmh = (fitVal > 0.0f) ? fitVal : 0.0f;
-    }
-    // Legacy physical conversion (kept as reference):
-    // const float PI_f = 3.14159265358979323846f;
-    // float linear_speed_m_s = (pulses_per_sec / (float)PULSES_PER_REV) * (2.0f * PI_f * ANEMOMETER_RADIUS_M);
-    // float wind_kmh = linear_speed_m_s * 3.6f;
-    
-    float tempC, humidity;
-    if (!readDHT22(tempC, humidity)) {
-      tempC = NAN;
-      humidity = NAN;
-    }
-    float lux = readLuxBH1750();
-    
-    sensor_payload_t payload;
-    payload.tempC = tempC;
-    payload.humidity = humidity;
-    payload.lux = lux;
-    payload.wind_kmh = wind_kmh;
-    payload.seq = ++_seq;
-
-    Serial.printf("Sensor: seq=%u temp=%0.1f hum=%0.1f wind=%0.2f km/h lux=%0.1f\n",
-                  payload.seq,
-                  isnan(payload.tempC) ? NAN : payload.tempC,
-                  isnan(payload.humidity) ? NAN : payload.humidity,
-                  payload.wind_kmh,
-                  isnan(payload.lux) ? NAN : payload.lux);
-
-    // Publish to queues (non-blocking)
-    if (espNowQueue) xQueueSend(espNowQueue, &payload, 0);
-    if (httpQueue) xQueueSend(httpQueue, &payload, 0);
-    if (displayQueue) xQueueOverwrite(displayQueue, &payload);
-
-    // Sleep until next measurement window
-    uint32_t elapsed = millis() - start;
-    if (elapsed < _intervalMs) vTaskDelay(pdMS_TO_TICKS(_intervalMs - elapsed));
-  }
+// Use pulses per second and apply calibration to convert to km/h. The curve
+// (WindCalibration in Common.h) is a compile-time table of the logarithmic fit
+// from the calibration curve:
+//   wind_kmh = 6.4056 * ln(pulses_per_sec) + 10.212   (R^2 = 0.9914)
+// with rates below the noise floor and negative fit values reading as zero.
+static float windKmhFromRate(float pulses_per_sec) {
+  return WindCalibration::lookup(pulses_per_sec);
 }
 
-bool SensorManager::readDHT22(float &tempC, float &humidity) {
-  uint8_t data[5] = {0,0,0,0,0};
-
-  // Send start signal: pull low >800us, then release
-  pinMode(DHTPIN, OUTPUT);
-  digitalWrite(DHTPIN, LOW);
-  delayMicroseconds(1100); // >800us to ensure sensor registers the start
-  digitalWrite(DHTPIN, HIGH);
-  delayMicroseconds(30);
-  pinMode(DHTPIN, INPUT_PULLUP);
-
-  noInterrupts();
-
-  uint32_t t = micros();
-
-  // Wait for sensor response: LOW (~80us)
-  while (digitalRead(DHTPIN) == HIGH) {
-    if (micros() - t > 1000) { interrupts(); pinMode(DHTPIN, INPUT_PULLUP); return false; }
-  }
+// Fixed-point units for the decimators
+static int32_t toCenti(float v) { return (int32_t)(v * 100.0f + 0.5f); }
+static int32_t toDeci(float v) { return (int32_t)(v * 10.0f + 0.5f); }
 
-  // Wait for response: HIGH (~80us)
-  t = micros();
-  while (digitalRead(DHTPIN) == LOW) {
-    if (micros() - t > 1000) { interrupts(); pinMode(DHTPIN, INPUT_PULLUP); return false; }
-  }
+void SensorManager::task() {
+  // Lux and wind are read every SENSOR_TICK_MS; the anemometer is summed
+  // into WIND_SUBSAMPLE_MS sub-samples for the gust and rolling averages,
+  // and the other sensors are read once per report interval.
+  const uint32_t ticksPerSub = WIND_SUBSAMPLE_MS / SENSOR_TICK_MS;
+  const uint32_t ticksPerReport = _intervalMs > SENSOR_TICK_MS ? _intervalMs / SENSOR_TICK_MS : 1;
+  const TickType_t period = pdMS_TO_TICKS(SENSOR_TICK_MS);
+  uint32_t windowPulses = 0;
+  uint32_t subPulses = 0;
+  uint32_t subTicks = 0;
+  uint32_t ticks = 0;
+  bool luxRequested = false; // one-shot conversion started for the next report
+
+  DIAG_TASK();
+  // Ticks run on a fixed grid (TickGrid.h) started on an RTOS tick boundary,
+  // so vTaskDelayUntil() wake-ups line up with it
+  vTaskDelay(1);
+  TickType_t lastWake = xTaskGetTickCount();
+  TickGrid grid(SENSOR_TICK_MS * 1000UL);
+  grid.start((uint64_t)esp_timer_get_time());
 
-  // Read 40 bits (5 bytes)
-  for (int i = 0; i < 40; ++i) {
-    // Wait for start of the bit (line goes LOW)
-    t = micros();
-    while (digitalRead(DHTPIN) == HIGH) {
-      if (micros() - t > 1000) { interrupts(); pinMode(DHTPIN, INPUT_PULLUP); return false; }
+  for (;;) {
+    tick_t tick = grid.wake((uint64_t)esp_timer_get_time());
+    DIAG_RECORD_US(DIAG_SENSOR_JITTER, tick.jitterUs);
+    if (tick.skipped) {
+      lastWake += (TickType_t)(tick.skipped * period);
+      DIAG_COUNT(DIAG_CTR_SENSOR_OVERRUN);
+      Serial.printf("Sensor: tick %lu us late, %lu skipped\n",
+                    (unsigned long)tick.jitterUs, (unsigned long)tick.skipped);
     }
+    {
+      DIAG_SCOPE(DIAG_SENSOR_TICK);
+      // The pulses of skipped ticks arrive with this one, so the rates and
+      // the report window count every elapsed tick
+      uint32_t elapsed = 1 + tick.skipped;
+      uint32_t pulses = _anemometer->take();
+      windowPulses += pulses;
+      subPulses += pulses;
+      _windFast.add(toCenti(windKmhFromRate((float)pulses * (1000.0f / (elapsed * SENSOR_TICK_MS)))));
+      subTicks += elapsed;
+      if (subTicks >= ticksPerSub) {
+        float subKmh = windKmhFromRate((float)subPulses * (1000.0f / (subTicks * SENSOR_TICK_MS)));
+        _wind.add(subKmh);
+        _windSubs.add(subKmh);
+        subPulses = 0;
+        subTicks = 0;
+      }
 
-    // Wait for the line to go HIGH - start of the data bit
-    t = micros();
-    while (digitalRead(DHTPIN) == LOW) {
-      if (micros() - t > 1000) { interrupts(); pinMode(DHTPIN, INPUT_PULLUP); return false; }
-    }
+      // Oversampling: take the reading queued on the previous tick, queue the next
+      if (LUX_OVERSAMPLING) {
+        addLuxTick(takeLux());
+        requestLux();
+      }
 
-    // Measure length of the HIGH signal; > ~40us means '1'
-    uint32_t startHigh = micros();
-    while (digitalRead(DHTPIN) == HIGH) {
-      if (micros() - startHigh > 200) break;
+      ticks += elapsed;
+      // Skipped ticks can jump over the tick that starts the one-shot lux
+      // conversion; that report then waits one more tick for it
+      bool luxLate = !LUX_OVERSAMPLING && !luxRequested && ticks >= ticksPerReport;
+      if (ticks >= ticksPerReport && !luxLate) {
+        publishSample(windowPulses, ticks * SENSOR_TICK_MS, tick.dueUs);
+        windowPulses = 0;
+        ticks = 0;
+        luxRequested = false;
+      }
+      // One-shot: start the conversion a tick ahead of the report that reads it
+      if (!LUX_OVERSAMPLING && !luxRequested && ticks + 1 >= ticksPerReport) {
+        requestLux();
+        luxRequested = true;
+      }
     }
-    uint32_t highLen = micros() - startHigh;
 
-    data[i/8] <<= 1;
-    if (highLen > 40) data[i/8] |= 1;
+    // Sleep until the next grid instant
+    vTaskDelayUntil(&lastWake, period);
   }
+}
 
-  interrupts();
-
-  // Validate checksum
-  uint8_t sum = data[0] + data[1] + data[2] + data[3];
-  if (sum != data[4]) {
-    pinMode(DHTPIN, INPUT_PULLUP);
-    return false;
-  }
+// Out-of-range readings and spikes (10x the running level and above
+// 10 klx) are dropped before they reach the decimator
+void SensorManager::addLuxTick(float lux) {
+  if (isnan(lux) || lux > LUX_MAX) return;
+  if (_lux.count() > 0 && lux > _lux.ewma() * 10.0f && lux > 10000.0f) return;
+  _luxFast.add(toDeci(lux));
+}
 
-  uint16_t rawHumidity = ((uint16_t)data[0] << 8) | data[1];
-  uint16_t rawTemp = ((uint16_t)data[2] << 8) | data[3];
+void SensorManager::publishSample(uint32_t windowPulses, uint32_t windowMs, uint64_t tUs) {
+  float pulses_per_sec = (float)windowPulses / (windowMs / 1000.0f);
+  float wind_kmh = windKmhFromRate(pulses_per_sec);
 
-  humidity = rawHumidity / 10.0f;
-  if (rawTemp & 0x8000) {
-    rawTemp &= 0x7FFF;
-    tempC = -((int16_t)rawTemp) / 10.0f;
-  } else {
-    tempC = rawTemp / 10.0f;
+  float tempC, humidity;
+  if (!readDHT22(tempC, humidity)) {
+    tempC = NAN;
+    humidity = NAN;
+  }
+  // Mean and extremes of the lux ticks in this report (a single reading
+  // without oversampling); a report without any valid tick has no lux
+  if (!LUX_OVERSAMPLING) {
+    float reading = takeLux();
+    if (isnan(reading)) Serial.printf("BH1750: measurement not ready (%lu bus errors)\n", (unsigned long)_luxErrors);
+    addLuxTick(reading);
   }
+  decimated_t luxWin = _luxFast.take();
+  float lux = luxWin.count ? luxWin.mean / 10.0f : NAN;
+  decimated_t windWin = _windFast.take();
+  _lux.add(lux);
+  _temp.add(tempC);
+  _humidity.add(humidity);
+
+  sensor_payload_t payload;
+  payload.tempC = tempC;
+  payload.humidity = humidity;
+  payload.lux = lux;
+  payload.wind_kmh = wind_kmh;
+  payload.seq = ++_seq;
+  payload.wind_gust_kmh = _wind.takeGust();
+  payload.wind_avg2m_kmh = _wind.mean2m();
+  payload.wind_avg10m_kmh = _wind.mean10m();
+  payload.wind_var10m = _wind.variance10m();
+  payload.temp_avg = _temp.mean();
+  payload.temp_min = _temp.min();
+  payload.temp_max = _temp.max();
+  payload.humidity_avg = _humidity.mean();
+  payload.humidity_min = _humidity.min();
+  payload.humidity_max = _humidity.max();
+  payload.lux_avg = _lux.mean();
+  payload.lux_min = _lux.min();
+  payload.lux_max = _lux.max();
+  payload.wind_lull_kmh = _windSubs.min();
+  _windSubs.reset();
+  payload.t_us = tUs;
+  payload.epoch_ms = epochMsAt(tUs);
+
+  Serial.printf("Sensor: seq=%u temp=%0.1f hum=%0.1f wind=%0.2f km/h gust=%0.2f avg2m=%0.2f avg10m=%0.2f lux=%0.1f\n",
+                payload.seq,
+                isnan(payload.tempC) ? NAN : payload.tempC,
+                isnan(payload.humidity) ? NAN : payload.humidity,
+                payload.wind_kmh,
+                payload.wind_gust_kmh,
+                payload.wind_avg2m_kmh,
+                payload.wind_avg10m_kmh,
+                isnan(payload.lux) ? NAN : payload.lux);
+  Serial.printf("Sensor: 1 min temp %0.1f [%0.1f..%0.1f] hum %0.1f [%0.1f..%0.1f] lux %0.1f [%0.1f..%0.1f] lull=%0.2f\n",
+                payload.temp_avg, payload.temp_min, payload.temp_max,
+                payload.humidity_avg, payload.humidity_min, payload.humidity_max,
+                payload.lux_avg, payload.lux_min, payload.lux_max, payload.wind_lull_kmh);
+  // Per-tick extremes stay local: the uplink byte rate does not grow
+  Serial.printf("Sensor: ticks lux [%0.1f..%0.1f] wind [%0.2f..%0.2f] (%u ticks)\n",
+                luxWin.count ? luxWin.min / 10.0f : NAN, luxWin.count ? luxWin.max / 10.0f : NAN,
+                windWin.count ? windWin.min / 100.0f : NAN, windWin.count ? windWin.max / 100.0f : NAN,
+                (unsigned)luxWin.count);
+
+  // Publish once to all subscribers; waits at most
+  // SAMPLE_BUS_PUBLISH_WAIT_MS on a lagging uplink
+  if (!sampleBus.publish(payload, pdMS_TO_TICKS(SAMPLE_BUS_PUBLISH_WAIT_MS))) {
+    Serial.printf("Sensor: sample %u dropped, bus slot still in use\n", payload.seq);
+  }
+}
 
-  pinMode(DHTPIN, INPUT_PULLUP);
-  return true;
+// Unix ms of the monotonic instant tUs, 0 while the clock is not set (SNTP
+// is started by CommManager). Both clocks are read back to back, so the
+// conversion is as good as the NTP offset itself.
+uint64_t SensorManager::epochMsAt(uint64_t tUs) {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  uint64_t nowUs = (uint64_t)esp_timer_get_time();
+  if ((uint64_t)tv.tv_sec < NTP_VALID_AFTER_S) return 0;
+  return ::epochMsAt(tUs, nowUs, (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000);
 }
 
-float SensorManager::readLuxBH1750() {
-  // One-shot measurement: wait for ready then read
-  float lux = NAN;
+bool SensorManager::readDHT22(float &tempC, float &humidity) {
+  DIAG_SCOPE(DIAG_DHT22);
+  // Send start signal: pull low >1ms, then release. The low phase is a plain
+  // task delay so the core is free while we wait.
+  pinMode(DHTPIN, OUTPUT);
+  digitalWrite(DHTPIN, LOW);
+  vTaskDelay(pdMS_TO_TICKS(2));
 
-  // Wait (blocking) until measurement is ready. Pass true to allow maxWait which will yield.
-  if (!lightMeter.measurementReady(true)) {
-    Serial.println("BH1750: measurement not ready");
-    // Reconfigure for next measurement
-    lightMeter.configure(BH1750::ONE_TIME_HIGH_RES_MODE);
-    return NAN;
+  // Release the line and arm edge capture. The sensor pulls low ~20-40us later
+  // and the first edge the decoder needs (response LOW->HIGH) follows ~80us after.
+  pinMode(DHTPIN, INPUT_PULLUP);
+  dhtEdgeCount = 0;
+  attachInterrupt(digitalPinToInterrupt(DHTPIN), dhtEdgeISR, CHANGE);
+
+  // A full frame takes ~5ms; let the ISR record it while other tasks run.
+  vTaskDelay(pdMS_TO_TICKS(DHT22_CAPTURE_MS));
+  detachInterrupt(digitalPinToInterrupt(DHTPIN));
+
+  dht22_reading_t reading;
+  Dht22Status st = dht22Decode(dhtEdges, dhtEdgeCount, reading);
+  if (st != DHT22_OK) {
+    Serial.printf("DHT22: decode failed (%s, %u edges)\n", dht22StatusName(st), (unsigned)dhtEdgeCount);
+    DIAG_COUNT(DIAG_CTR_DHT22_FAILED);
+    return false;
   }
 
-  lux = lightMeter.readLightLevel();
-  if (lux < 0.0f) {
-    Serial.printf("BH1750: readLightLevel returned %0.2f\n", lux);
-    lightMeter.configure(BH1750::ONE_TIME_HIGH_RES_MODE);
-    return NAN;
-  }
+  tempC = reading.tempC;
+  humidity = reading.humidity;
+  return true;
+}
 
-  // Reconfigure for next one-shot measurement
-  lightMeter.configure(BH1750::ONE_TIME_HIGH_RES_MODE);
-
-  // 5-sample moving average with basic sanity/clamp checks
-  static const int BUF_SIZE = 5;
-  static float buf[BUF_SIZE] = {NAN, NAN, NAN, NAN, NAN};
-  static int idx = 0;
-  static int count = 0;
-  static float sum = 0.0f;
-
-  if (!isnan(lux) && (lux >= 0.0f)) {
-    // Clamp to plausible BH1750 range
-    if (lux < 0.0f || lux > 120000.0f) {
-      // invalid reading, return previous average if available
-      if (count > 0) return sum / (float)count;
-      return NAN;
-    }
+// Queues the next BH1750 read, unless the previous one is still queued. A
+// one-shot conversion is started first and read BH1750_CONVERSION_MS later.
+void SensorManager::requestLux() {
+  portENTER_CRITICAL(&_luxMux);
+  bool busy = _luxPending;
+  _luxPending = true;
+  portEXIT_CRITICAL(&_luxMux);
+  if (busy) return;
+
+  const uint8_t oneShot = BH1750_ONE_TIME_HIGH_RES_MODE;
+  uint32_t after = _luxDelayMs;
+  bool ok = true;
+  if (!LUX_OVERSAMPLING) {
+    ok = i2cBus.write(_luxDev, &oneShot, 1);
+    after = BH1750_CONVERSION_MS;
+  }
+#if DIAG_ENABLED
+  _luxRequestUs = micros();
+#endif
+  ok = ok && i2cBus.read(_luxDev, 2, after, &SensorManager::onLuxRead, this);
+
+  portENTER_CRITICAL(&_luxMux);
+  if (ok) _luxDelayMs = 0;
+  else _luxPending = false;
+  portEXIT_CRITICAL(&_luxMux);
+}
 
-    // basic spike rejection: if we have previous avg and new lux is > 10x avg and > 10000, ignore it
-    if (count > 0) {
-      float avg = sum / (float)count;
-      if (lux > avg * 10.0f && lux > 10000.0f) {
-        return avg;
-      }
-    }
+// Latest reading since the previous call, NaN when there is none
+float SensorManager::takeLux() {
+  portENTER_CRITICAL(&_luxMux);
+  bool fresh = _luxFresh;
+  uint16_t raw = _luxRaw;
+  _luxFresh = false;
+  portEXIT_CRITICAL(&_luxMux);
+  return fresh ? (float)raw / BH1750_COUNTS_PER_LUX : NAN;
+}
 
-    // add to circular buffer
-    if (count < BUF_SIZE) {
-      buf[idx] = lux;
-      sum += lux;
-      count++;
-    } else {
-      sum -= buf[idx];
-      buf[idx] = lux;
-      sum += lux;
-    }
-    idx = (idx + 1) % BUF_SIZE;
-    return sum / (float)count;
+// Bus task
+void SensorManager::onLuxRead(void* ctx, bool ok, const uint8_t* data, size_t len) {
+  SensorManager* self = static_cast<SensorManager*>(ctx);
+  portENTER_CRITICAL(&self->_luxMux);
+  self->_luxPending = false;
+  if (ok && len == 2) {
+    self->_luxRaw = (uint16_t)((data[0] << 8) | data[1]);
+    self->_luxFresh = true;
+  } else {
+    self->_luxErrors++;
   }
+  portEXIT_CRITICAL(&self->_luxMux);
+  DIAG_RECORD_US(DIAG_LUX, micros() - self->_luxRequestUs);
+  if (!ok) DIAG_COUNT(DIAG_CTR_LUX_FAILED);
+}
 
-  // No data available: return previous average if any
-  if (count > 0) return sum / (float)count;
-  return NAN;
+void SensorManager::onLuxConfigured(void* ctx, bool ok, const uint8_t* data, size_t len) {
+  SensorManager* self = static_cast<SensorManager*>(ctx);
+  if (ok) {
+    Serial.printf("BH1750 init OK (%s)\n", LUX_OVERSAMPLING ? "continuous" : "one-shot");
+  } else {
+    Serial.println("BH1750 init failed");
+    self->_luxErrors++;
+  }
 }
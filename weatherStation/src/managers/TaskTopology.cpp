@@ -0,0 +1,25 @@
+#include "Common.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+bool startTask(TaskId id, TaskFunction_t fn, void* arg, TaskHandle_t* handle) {
+  const task_config_t &t = TASK_TABLE[id];
+  BaseType_t core = t.core == TASK_ANY_CORE ? tskNO_AFFINITY : (BaseType_t)t.core;
+  if (xTaskCreatePinnedToCore(fn, t.name, t.stackBytes, arg, t.priority, handle, core) != pdPASS) {
+    Serial.printf("%s: task not created (%u bytes stack)\n", t.name, (unsigned)t.stackBytes);
+    return false;
+  }
+  return true;
+}
+
+void printTaskTable() {
+  Serial.printf("Task topology %s:\n", taskTopologyName(TASK_LAYOUT));
+  for (size_t i = 0; i < TASK_COUNT; ++i) {
+    const task_config_t &t = TASK_TABLE[i];
+    char core[4];
+    if (t.core == TASK_ANY_CORE) snprintf(core, sizeof(core), "any");
+    else snprintf(core, sizeof(core), "%d", t.core);
+    Serial.printf("  %-12s core %s, prio %u, stack %u, queue %u\n",
+                  t.name, core, (unsigned)t.priority, (unsigned)t.stackBytes, (unsigned)t.queueLen);
+  }
+}
@@ -0,0 +1,43 @@
+#include "WiFiHttpStream.h"
+#include <Arduino.h>
+
+WiFiHttpStream::WiFiHttpStream() : _client(&_plain) {
+  memset(&_url, 0, sizeof(_url));
+}
+
+void WiFiHttpStream::begin(const http_url_t &url, uint32_t timeoutS, const char* rootCa) {
+  _url = url;
+  _client = url.tls ? static_cast<WiFiClient*>(&_secure) : &_plain;
+  if (url.tls) {
+    if (rootCa) _secure.setCACert(rootCa);
+    else _secure.setInsecure(); // encrypted but unauthenticated, set HTTP_ROOT_CA to verify
+    _secure.setHandshakeTimeout(timeoutS);
+  }
+  _client->setTimeout(timeoutS);
+}
+
+bool WiFiHttpStream::open() {
+  if (_client->connected()) return true;
+  _client->stop();
+  if (!_client->connect(_url.host, _url.port)) return false;
+  _client->setNoDelay(true); // request head and body go out without waiting for ACKs
+  return true;
+}
+
+bool WiFiHttpStream::isOpen() {
+  return _client->connected();
+}
+
+size_t WiFiHttpStream::write(const uint8_t* buf, size_t len) {
+  return _client->write(buf, len);
+}
+
+int WiFiHttpStream::read(uint8_t* buf, size_t len) {
+  int avail = _client->available();
+  if (avail <= 0) return _client->connected() ? 0 : -1;
+  return _client->read(buf, (size_t)avail < len ? (size_t)avail : len);
+}
+
+void WiFiHttpStream::close() {
+  _client->stop();
+}
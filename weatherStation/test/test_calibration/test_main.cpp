@@ -0,0 +1,84 @@
+#include <unity.h>
+#include <cmath>
+#include "Calibration.h"
+
+// The compile-time tables against the same curves evaluated with libm.
+using namespace calib;
+
+typedef CurveTable<WindLogFit> WindTable;
+typedef CurveTable<WindCupRadius40mm> CupTable;
+typedef LinearQ16<LuxBh1750> Lux;
+
+static double windReference(double pps) {
+  if (pps < 0.05) return 0.0;
+  double v = 6.4056 * std::log(pps) + 10.212;
+  return v > 0.0 ? v : 0.0;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_constexpr_ln_matches_std_log(void) {
+  const double xs[] = {0.01, 0.1, 0.5, 1.0, 1.5, 2.0, 3.7, 10.0, 99.9, 12345.0};
+  for (double x : xs) TEST_ASSERT_FLOAT_WITHIN(1e-9, std::log(x), ln(x));
+}
+
+void test_wind_table_matches_std_log(void) {
+  double worst = 0.0;
+  for (double pps = WindLogFit::CHECK_FROM; pps <= WindLogFit::X_MAX; pps += 0.0137) {
+    double e = std::fabs(WindTable::lookup((float)pps) - windReference(pps));
+    if (e > worst) worst = e;
+  }
+  TEST_ASSERT_TRUE(worst < WindLogFit::MAX_ERROR);
+}
+
+void test_wind_table_edges(void) {
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, WindTable::lookup(0.0f));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, WindTable::lookup(-3.0f));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, WindTable::lookup(NAN));
+  // Beyond the table: last entry
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, (float)windReference(WindLogFit::X_MAX), WindTable::lookup(500.0f));
+}
+
+void test_cup_table_is_linear(void) {
+  for (double pps = 0.0; pps <= 100.0; pps += 0.37) {
+    double ref = pps * (2.0 * M_PI * 0.04) * 3.6;
+    TEST_ASSERT_FLOAT_WITHIN(WindCupRadius40mm::MAX_ERROR, ref, CupTable::lookup((float)pps));
+  }
+}
+
+void test_lux_q16(void) {
+  TEST_ASSERT_EQUAL_UINT32(0, Lux::convert(0));
+  TEST_ASSERT_EQUAL_UINT32(833, Lux::convert(1000));
+  TEST_ASSERT_EQUAL_UINT32(54612, Lux::convert(65535));
+  // toFloat keeps the fraction convert() rounds away
+  for (uint32_t raw = 0; raw <= 65535; raw += 7) {
+    TEST_ASSERT_FLOAT_WITHIN(raw / 1.2 * 1e-5 + 1e-4, raw / 1.2, Lux::toFloat(raw));
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.8333f, Lux::toFloat(1));
+}
+
+void test_atan2_table(void) {
+  for (int deg = 0; deg < 360; deg += 3) {
+    double rad = deg * M_PI / 180.0;
+    int32_t x = (int32_t)std::lround(std::cos(rad) * 10000.0);
+    int32_t y = (int32_t)std::lround(std::sin(rad) * 10000.0);
+    double ref = std::atan2((double)y, (double)x) * 180.0 / M_PI;
+    if (ref < 0) ref += 360.0;
+    float got = Atan2Table<>::degrees(y, x);
+    double d = std::fabs(got - ref);
+    if (d > 180.0) d = 360.0 - d;
+    TEST_ASSERT_TRUE(d < Atan2Table<>::MAX_ERROR);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_constexpr_ln_matches_std_log);
+  RUN_TEST(test_wind_table_matches_std_log);
+  RUN_TEST(test_wind_table_edges);
+  RUN_TEST(test_cup_table_is_linear);
+  RUN_TEST(test_lux_q16);
+  RUN_TEST(test_atan2_table);
+  return UNITY_END();
+}
@@ -0,0 +1,225 @@
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "Dht22Decoder.h"
+
+// Synthetic edge traces as SensorManager's CHANGE interrupt records them:
+// host release (HIGH), response LOW/HIGH, 40 bits, trailing LOW, release.
+static dht22_edge_t edges[2 * DHT22_MAX_HIGH_PULSES + 16];
+static size_t edgeCount;
+static uint32_t clockUs;
+
+static void edge(uint8_t level, uint32_t afterUs) {
+  clockUs += afterUs;
+  edges[edgeCount].us = clockUs;
+  edges[edgeCount].level = level;
+  edgeCount++;
+}
+
+static void bit(bool one) {
+  edge(0, 0);              // falling edge ends the previous HIGH
+  edge(1, 50);             // LOW ~50us
+  clockUs += one ? 70 : 26;
+}
+
+// Full frame for the five raw bytes, response HIGH of responseUs
+static void frame(const uint8_t raw[5], uint32_t responseUs = 80) {
+  edgeCount = 0;
+  clockUs = 1000;
+  edge(1, 0);              // host releases the line
+  edge(0, 30);             // sensor pulls low
+  edge(1, 80);             // response HIGH
+  clockUs += responseUs;
+  for (size_t i = 0; i < DHT22_FRAME_BITS; ++i) bit((raw[i / 8] >> (7 - i % 8)) & 1);
+  edge(0, 0);
+  edge(1, 50);             // release
+}
+
+static void rawFor(uint16_t humidity10, uint16_t temp10, uint8_t out[5]) {
+  out[0] = humidity10 >> 8;
+  out[1] = humidity10 & 0xFF;
+  out[2] = temp10 >> 8;
+  out[3] = temp10 & 0xFF;
+  out[4] = (uint8_t)(out[0] + out[1] + out[2] + out[3]);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_decodes_positive_temperature(void) {
+  uint8_t raw[5];
+  rawFor(652, 215, raw);
+  frame(raw);
+  dht22_reading_t r;
+  TEST_ASSERT_EQUAL(DHT22_OK, dht22Decode(edges, edgeCount, r));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 65.2f, r.humidity);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 21.5f, r.tempC);
+  TEST_ASSERT_EQUAL_MEMORY(raw, r.raw, 5);
+}
+
+void test_decodes_negative_temperature(void) {
+  uint8_t raw[5];
+  rawFor(1000, 0x8000 | 101, raw);
+  frame(raw);
+  dht22_reading_t r;
+  TEST_ASSERT_EQUAL(DHT22_OK, dht22Decode(edges, edgeCount, r));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, r.humidity);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, -10.1f, r.tempC);
+}
+
+void test_repeated_level_glitch_is_collapsed(void) {
+  uint8_t raw[5];
+  rawFor(500, 200, raw);
+  frame(raw);
+  // Duplicate a HIGH edge in the middle of the frame (ISR saw the level twice)
+  size_t at = 20;
+  for (size_t i = edgeCount; i > at; --i) edges[i] = edges[i - 1];
+  edgeCount++;
+  edges[at + 1].us += 2;
+  TEST_ASSERT_EQUAL(edges[at].level, edges[at + 1].level);
+  dht22_reading_t r;
+  TEST_ASSERT_EQUAL(DHT22_OK, dht22Decode(edges, edgeCount, r));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 20.0f, r.tempC);
+}
+
+void test_no_edges_is_no_response(void) {
+  dht22_reading_t r;
+  TEST_ASSERT_EQUAL(DHT22_NO_RESPONSE, dht22Decode(edges, 0, r));
+  edgeCount = 0;
+  clockUs = 0;
+  edge(0, 0);
+  TEST_ASSERT_EQUAL(DHT22_NO_RESPONSE, dht22Decode(edges, edgeCount, r));
+}
+
+void test_truncated_frames(void) {
+  uint8_t raw[5];
+  rawFor(500, 200, raw);
+  frame(raw);
+  size_t full = edgeCount;
+  dht22_reading_t r;
+  // Cut the capture anywhere before the last data bit completes
+  for (size_t cut = 4; cut < full - 3; cut += 3) {
+    TEST_ASSERT_EQUAL(DHT22_TRUNCATED, dht22Decode(edges, cut, r));
+  }
+}
+
+void test_too_many_pulses_is_noise(void) {
+  edgeCount = 0;
+  clockUs = 0;
+  for (size_t i = 0; i < DHT22_MAX_HIGH_PULSES + 1; ++i) {
+    edge(1, 40);
+    edge(0, 30);
+  }
+  dht22_reading_t r;
+  TEST_ASSERT_EQUAL(DHT22_NOISE, dht22Decode(edges, edgeCount, r));
+}
+
+void test_bad_checksum(void) {
+  uint8_t raw[5];
+  rawFor(500, 200, raw);
+  raw[4] ^= 0x01;
+  frame(raw);
+  dht22_reading_t r;
+  TEST_ASSERT_EQUAL(DHT22_BAD_CHECKSUM, dht22Decode(edges, edgeCount, r));
+}
+
+void test_corrupt_bit_flips_fail_checksum(void) {
+  uint8_t raw[5];
+  rawFor(432, 187, raw);
+  dht22_reading_t r;
+  // Any single flipped data bit must be caught
+  for (size_t b = 0; b < 32; ++b) {
+    uint8_t bad[5];
+    for (int i = 0; i < 5; ++i) bad[i] = raw[i];
+    bad[b / 8] ^= (uint8_t)(0x80 >> (b % 8));
+    frame(bad);
+    TEST_ASSERT_EQUAL(DHT22_BAD_CHECKSUM, dht22Decode(edges, edgeCount, r));
+  }
+}
+
+void test_bad_response_timing(void) {
+  uint8_t raw[5];
+  rawFor(500, 200, raw);
+  dht22_reading_t r;
+  frame(raw, DHT22_RESPONSE_MIN_US - 10);
+  TEST_ASSERT_EQUAL(DHT22_BAD_TIMING, dht22Decode(edges, edgeCount, r));
+  frame(raw, DHT22_RESPONSE_MAX_US + 10);
+  TEST_ASSERT_EQUAL(DHT22_BAD_TIMING, dht22Decode(edges, edgeCount, r));
+}
+
+void test_overlong_bit_is_bad_timing(void) {
+  uint8_t raw[5];
+  rawFor(500, 200, raw);
+  frame(raw);
+  // Stretch the HIGH of the 10th data bit past DHT22_BIT_MAX_US: every edge
+  // from its falling edge on moves later
+  size_t fall = 4 + 2 * 10 + 1;
+  for (size_t i = fall; i < edgeCount; ++i) edges[i].us += DHT22_BIT_MAX_US;
+  dht22_reading_t r;
+  TEST_ASSERT_EQUAL(DHT22_BAD_TIMING, dht22Decode(edges, edgeCount, r));
+}
+
+void test_status_names(void) {
+  TEST_ASSERT_EQUAL_STRING("ok", dht22StatusName(DHT22_OK));
+  TEST_ASSERT_EQUAL_STRING("truncated", dht22StatusName(DHT22_TRUNCATED));
+  TEST_ASSERT_EQUAL_STRING("bad checksum", dht22StatusName(DHT22_BAD_CHECKSUM));
+}
+
+// Host cost of decoding one capture, over a mix of the traces above: good
+// frames across the value range, a glitched one and a bad checksum
+void test_decode_cost(void) {
+  std::vector<std::vector<dht22_edge_t> > traces;
+  for (uint16_t t = 0; t < 64; ++t) {
+    uint8_t raw[5];
+    rawFor((uint16_t)(t * 15), (t & 1) ? (uint16_t)(0x8000 | t) : (uint16_t)(t * 7), raw);
+    if (t % 16 == 15) raw[4] ^= 0x01;
+    frame(raw);
+    if (t % 16 == 7) {
+      for (size_t i = edgeCount; i > 20; --i) edges[i] = edges[i - 1];
+      edgeCount++;
+      edges[21].us += 2;
+    }
+    traces.emplace_back(edges, edges + edgeCount);
+  }
+
+  const uint32_t ROUNDS = 2000;
+  uint32_t ok = 0, bad = 0;
+  dht22_reading_t r;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t n = 0; n < ROUNDS; ++n) {
+    for (const std::vector<dht22_edge_t> &tr : traces) {
+      if (dht22Decode(tr.data(), tr.size(), r) == DHT22_OK) ok++;
+      else bad++;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  uint32_t decodes = ROUNDS * (uint32_t)traces.size();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / decodes;
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%u decodes, %.1f ns per decode (%u edges per frame)",
+           (unsigned)decodes, ns, (unsigned)traces[0].size());
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL_UINT32(ROUNDS * 60, ok);
+  TEST_ASSERT_EQUAL_UINT32(ROUNDS * 4, bad);
+  // The capture itself takes ~5 ms on the wire
+  TEST_ASSERT_TRUE(ns < 50000.0);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_decodes_positive_temperature);
+  RUN_TEST(test_decodes_negative_temperature);
+  RUN_TEST(test_repeated_level_glitch_is_collapsed);
+  RUN_TEST(test_no_edges_is_no_response);
+  RUN_TEST(test_truncated_frames);
+  RUN_TEST(test_too_many_pulses_is_noise);
+  RUN_TEST(test_bad_checksum);
+  RUN_TEST(test_corrupt_bit_flips_fail_checksum);
+  RUN_TEST(test_bad_response_timing);
+  RUN_TEST(test_overlong_bit_is_bad_timing);
+  RUN_TEST(test_status_names);
+  RUN_TEST(test_decode_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,138 @@
+#include <unity.h>
+#include <stdio.h>
+#include "FlashLog.h"
+
+// FlashLog on the host FileFlashDevice: round trip, remount, ring overwrite
+// and a power cut at every byte of a write sequence.
+typedef struct {
+  uint32_t seq;
+  float value;
+} record_t;
+
+typedef FlashLog<record_t> Log;
+
+static const char* PATH = "test_flash_log.bin";
+static constexpr uint32_t SECTOR = 256;
+static constexpr uint32_t SIZE = 4 * SECTOR;
+
+static record_t rec(uint32_t seq) {
+  record_t r;
+  r.seq = seq;
+  r.value = seq * 0.5f;
+  return r;
+}
+
+// Every pending record, oldest first, without consuming
+static size_t readAll(Log &log, record_t* out, size_t max) { return log.peek(out, max); }
+
+void setUp(void) { remove(PATH); }
+void tearDown(void) { remove(PATH); }
+
+void test_append_peek_consume(void) {
+  FileFlashDevice dev(PATH, SIZE, SECTOR);
+  Log log(dev);
+  TEST_ASSERT_TRUE(log.mount());
+  TEST_ASSERT_EQUAL_UINT32(0, log.pending());
+  for (uint32_t i = 1; i <= 20; ++i) TEST_ASSERT_TRUE(log.append(rec(i)));
+  TEST_ASSERT_EQUAL_UINT32(20, log.pending());
+
+  record_t out[8];
+  TEST_ASSERT_EQUAL(8, log.peek(out, 8));
+  TEST_ASSERT_EQUAL_UINT32(1, out[0].seq);
+  TEST_ASSERT_EQUAL_UINT32(8, out[7].seq);
+  log.consume(8);
+  TEST_ASSERT_EQUAL_UINT32(12, log.pending());
+  TEST_ASSERT_EQUAL(1, log.peek(out, 1));
+  TEST_ASSERT_EQUAL_UINT32(9, out[0].seq);
+}
+
+void test_survives_remount(void) {
+  {
+    FileFlashDevice dev(PATH, SIZE, SECTOR);
+    Log log(dev);
+    TEST_ASSERT_TRUE(log.mount());
+    for (uint32_t i = 1; i <= 25; ++i) log.append(rec(i));
+    log.consume(10);
+  }
+  FileFlashDevice dev(PATH, SIZE, SECTOR);
+  Log log(dev);
+  TEST_ASSERT_TRUE(log.mount());
+  TEST_ASSERT_EQUAL_UINT32(15, log.pending());
+  record_t out[32];
+  size_t n = readAll(log, out, 32);
+  TEST_ASSERT_EQUAL(15, n);
+  for (size_t i = 0; i < n; ++i) TEST_ASSERT_EQUAL_UINT32(11 + i, out[i].seq);
+  // Appending continues after the old head
+  TEST_ASSERT_TRUE(log.append(rec(26)));
+  TEST_ASSERT_EQUAL(16, readAll(log, out, 32));
+  TEST_ASSERT_EQUAL_UINT32(26, out[15].seq);
+}
+
+void test_ring_overwrites_oldest(void) {
+  FileFlashDevice dev(PATH, SIZE, SECTOR);
+  Log log(dev);
+  TEST_ASSERT_TRUE(log.mount());
+  uint32_t total = log.capacity() + 2 * ((SECTOR - Log::HEADER_SIZE) / Log::SLOT_SIZE);
+  for (uint32_t i = 1; i <= total; ++i) TEST_ASSERT_TRUE(log.append(rec(i)));
+  TEST_ASSERT_TRUE(log.overwritten() > 0);
+  TEST_ASSERT_EQUAL_UINT32(total, log.pending() + log.overwritten());
+
+  record_t out[128];
+  size_t n = readAll(log, out, 128);
+  TEST_ASSERT_EQUAL(log.pending(), n);
+  TEST_ASSERT_EQUAL_UINT32(total, out[n - 1].seq);
+  for (size_t i = 1; i < n; ++i) TEST_ASSERT_EQUAL_UINT32(out[i - 1].seq + 1, out[i].seq);
+}
+
+// Cut the power after every possible number of bytes while appending records
+// (covering a segment switch), remount and check that every append that
+// returned true is still there, in order, and nothing else but whole records.
+void test_power_cut_anywhere(void) {
+  const uint32_t before = 12;  // segment switch after 15 slots per segment
+  const uint32_t attempts = 6;
+  const long maxBytes = attempts * (long)(Log::SLOT_SIZE + 1) + Log::HEADER_SIZE + 8;
+
+  for (long cut = 0; cut <= maxBytes; ++cut) {
+    remove(PATH);
+    uint32_t committed = before;
+    {
+      FileFlashDevice dev(PATH, SIZE, SECTOR);
+      Log log(dev);
+      TEST_ASSERT_TRUE(log.mount());
+      for (uint32_t i = 1; i <= before; ++i) TEST_ASSERT_TRUE(log.append(rec(i)));
+      log.consume(3);
+      dev.powerCutAfter(cut);
+      for (uint32_t i = before + 1; i <= before + attempts; ++i) {
+        if (!log.append(rec(i))) break;
+        committed = i;
+      }
+    }
+
+    FileFlashDevice dev(PATH, SIZE, SECTOR);
+    Log log(dev);
+    TEST_ASSERT_TRUE(log.mount());
+    record_t out[64];
+    size_t n = readAll(log, out, 64);
+    // Records 4..committed survive; the torn one never shows up
+    TEST_ASSERT_EQUAL(committed - 3, n);
+    TEST_ASSERT_EQUAL_UINT32(n, log.pending());
+    for (size_t i = 0; i < n; ++i) {
+      TEST_ASSERT_EQUAL_UINT32(4 + i, out[i].seq);
+      TEST_ASSERT_EQUAL_FLOAT((4 + i) * 0.5f, out[i].value);
+    }
+
+    // The log keeps working after the cut
+    TEST_ASSERT_TRUE(log.append(rec(100)));
+    n = readAll(log, out, 64);
+    TEST_ASSERT_EQUAL_UINT32(100, out[n - 1].seq);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_append_peek_consume);
+  RUN_TEST(test_survives_remount);
+  RUN_TEST(test_ring_overwrites_oldest);
+  RUN_TEST(test_power_cut_anywhere);
+  return UNITY_END();
+}
@@ -0,0 +1,228 @@
+#include <unity.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include "HttpUplink.h"
+
+// HttpUplink over PosixHttpStream against a scripted HTTP/1.1 server on
+// 127.0.0.1: every request it reads is answered with the next canned
+// response, and it counts connections and requests.
+class TestServer {
+public:
+  TestServer() : accepts(0), requests(0), _listen(-1), _port(0), _stop(false) {}
+
+  void start(const std::vector<std::string> &responses) {
+    _responses = responses;
+    _next = 0;
+    accepts = 0;
+    requests = 0;
+    _stop = false;
+    _listen = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in a;
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    a.sin_port = 0;
+    bind(_listen, (sockaddr*)&a, sizeof(a));
+    socklen_t len = sizeof(a);
+    getsockname(_listen, (sockaddr*)&a, &len);
+    _port = ntohs(a.sin_port);
+    listen(_listen, 4);
+    _thread = std::thread([this] { run(); });
+  }
+
+  void stop() {
+    _stop = true;
+    shutdown(_listen, SHUT_RDWR);
+    ::close(_listen);
+    if (_thread.joinable()) _thread.join();
+  }
+
+  uint16_t port() const { return _port; }
+
+  std::atomic<int> accepts;
+  std::atomic<int> requests;
+
+private:
+  int _listen;
+  uint16_t _port;
+  std::atomic<bool> _stop;
+  std::thread _thread;
+  std::vector<std::string> _responses;
+  size_t _next;
+
+  void run() {
+    while (!_stop) {
+      int fd = accept(_listen, NULL, NULL);
+      if (fd < 0) return;
+      accepts++;
+      serve(fd);
+      ::close(fd);
+    }
+  }
+
+  // Read whole requests (head + Content-Length body) and answer each one;
+  // a response marked with "Connection: close" or without framing ends the
+  // connection after it is written
+  void serve(int fd) {
+    std::string in;
+    char buf[2048];
+    for (;;) {
+      size_t end = in.find("\r\n\r\n");
+      if (end != std::string::npos) {
+        size_t cl = in.find("Content-Length: ");
+        size_t body = cl == std::string::npos ? 0 : (size_t)atol(in.c_str() + cl + 16);
+        if (in.size() >= end + 4 + body) {
+          in.erase(0, end + 4 + body);
+          requests++;
+          if (_next >= _responses.size()) return;
+          const std::string &r = _responses[_next++];
+          send(fd, r.data(), r.size(), MSG_NOSIGNAL);
+          if (r.find("Connection: close") != std::string::npos || r.find("#close") != std::string::npos) return;
+          continue;
+        }
+      }
+      ssize_t n = recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0) return;
+      in.append(buf, (size_t)n);
+    }
+  }
+};
+
+typedef HttpUplink<24, 2, 2> Uplink;
+
+static TestServer server;
+static uint32_t nowMs;
+
+static sensor_payload_t sample(uint32_t seq) {
+  sensor_payload_t p;
+  sensorPayloadClear(p);
+  p.seq = seq;
+  p.tempC = 20.5f;
+  return p;
+}
+
+// Poll until every queued sample is answered (or give up after ~2 s)
+static void drain(Uplink &up, PosixHttpStream &stream) {
+  for (int i = 0; i < 2000 && (up.queued() > 0 || up.inFlight() > 0); ++i) {
+    if (!stream.isOpen()) stream.open();
+    up.poll(nowMs, 0);
+    nowMs++;
+    usleep(1000);
+  }
+}
+
+void setUp(void) { nowMs = 1000; }
+void tearDown(void) { server.stop(); }
+
+static const char* OK_200 = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+
+void test_keep_alive_pipelined(void) {
+  server.start({OK_200, OK_200, OK_200});
+  PosixHttpStream stream("127.0.0.1", server.port());
+  Uplink up(stream, 5000);
+  up.setTarget("127.0.0.1", "/ingest");
+  TEST_ASSERT_TRUE(stream.open());
+  for (uint32_t i = 1; i <= 6; ++i) up.add(sample(i), nowMs);
+  drain(up, stream);
+  TEST_ASSERT_EQUAL(0, up.queued());
+  TEST_ASSERT_EQUAL_UINT32(3, up.stats().ok);
+  TEST_ASSERT_EQUAL_UINT32(6, up.stats().samples);
+  TEST_ASSERT_EQUAL(1, server.accepts.load());
+  TEST_ASSERT_TRUE(stream.isOpen());
+}
+
+void test_204_without_length_keeps_connection(void) {
+  // No Content-Length and no body: must not be taken as a close-delimited body
+  server.start({"HTTP/1.1 204 No Content\r\n\r\n", "HTTP/1.1 204 No Content\r\nConnection: keep-alive\r\n\r\n",
+                OK_200});
+  PosixHttpStream stream("127.0.0.1", server.port());
+  Uplink up(stream, 5000);
+  up.setTarget("127.0.0.1", "/ingest");
+  TEST_ASSERT_TRUE(stream.open());
+  for (uint32_t i = 1; i <= 6; ++i) up.add(sample(i), nowMs);
+  drain(up, stream);
+  TEST_ASSERT_EQUAL(0, up.queued());
+  TEST_ASSERT_EQUAL_UINT32(3, up.stats().ok);
+  TEST_ASSERT_EQUAL_UINT32(0, up.stats().failed);
+  TEST_ASSERT_EQUAL(1, server.accepts.load());
+  TEST_ASSERT_TRUE(stream.isOpen());
+}
+
+void test_100_continue_then_200(void) {
+  server.start({"HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n"});
+  PosixHttpStream stream("127.0.0.1", server.port());
+  Uplink up(stream, 5000);
+  up.setTarget("127.0.0.1", "/ingest");
+  TEST_ASSERT_TRUE(stream.open());
+  up.add(sample(1), nowMs);
+  up.add(sample(2), nowMs);
+  drain(up, stream);
+  TEST_ASSERT_EQUAL_UINT32(1, up.stats().ok);
+  TEST_ASSERT_TRUE(stream.isOpen());
+}
+
+void test_chunked_body(void) {
+  server.start({"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n4\r\nabcd\r\n0\r\n\r\n", OK_200});
+  PosixHttpStream stream("127.0.0.1", server.port());
+  Uplink up(stream, 5000);
+  up.setTarget("127.0.0.1", "/ingest");
+  TEST_ASSERT_TRUE(stream.open());
+  for (uint32_t i = 1; i <= 4; ++i) up.add(sample(i), nowMs);
+  drain(up, stream);
+  TEST_ASSERT_EQUAL_UINT32(2, up.stats().ok);
+  TEST_ASSERT_EQUAL(1, server.accepts.load());
+}
+
+void test_close_delimited_200_reconnects(void) {
+  // No framing on a 200: the body runs to close, the next batch needs a new connection
+  server.start({"HTTP/1.1 200 OK\r\n\r\n#close", OK_200});
+  PosixHttpStream stream("127.0.0.1", server.port());
+  Uplink up(stream, 5000);
+  up.setTarget("127.0.0.1", "/ingest");
+  TEST_ASSERT_TRUE(stream.open());
+  up.add(sample(1), nowMs);
+  up.add(sample(2), nowMs);
+  drain(up, stream);
+  TEST_ASSERT_EQUAL_UINT32(1, up.stats().ok);
+  TEST_ASSERT_FALSE(stream.isOpen());
+
+  up.add(sample(3), nowMs);
+  up.add(sample(4), nowMs);
+  drain(up, stream);
+  TEST_ASSERT_EQUAL_UINT32(2, up.stats().ok);
+  TEST_ASSERT_EQUAL_UINT32(4, up.stats().samples);
+  TEST_ASSERT_EQUAL(2, server.accepts.load());
+}
+
+void test_5xx_requeues_4xx_drops(void) {
+  server.start({"HTTP/1.1 503 Busy\r\nContent-Length: 0\r\nConnection: close\r\n\r\n",
+                "HTTP/1.1 400 Bad\r\nContent-Length: 0\r\n\r\n"});
+  PosixHttpStream stream("127.0.0.1", server.port());
+  Uplink up(stream, 5000);
+  up.setTarget("127.0.0.1", "/ingest");
+  TEST_ASSERT_TRUE(stream.open());
+  up.add(sample(1), nowMs);
+  up.add(sample(2), nowMs);
+  drain(up, stream);
+  TEST_ASSERT_EQUAL_UINT32(1, up.stats().failed);
+  TEST_ASSERT_EQUAL_UINT32(1, up.stats().rejected);
+  TEST_ASSERT_EQUAL_UINT32(0, up.stats().samples);
+  TEST_ASSERT_EQUAL(0, up.queued());
+  TEST_ASSERT_EQUAL(2, server.requests.load());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_keep_alive_pipelined);
+  RUN_TEST(test_204_without_length_keeps_connection);
+  RUN_TEST(test_100_continue_then_200);
+  RUN_TEST(test_chunked_body);
+  RUN_TEST(test_close_delimited_200_reconnects);
+  RUN_TEST(test_5xx_requeues_4xx_drops);
+  return UNITY_END();
+}
@@ -0,0 +1,269 @@
+#include <unity.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "I2cBus.h"
+
+// I2cScheduler driven the way the I2cManager bus task drives it, against a
+// mock I2cPort that records every transaction and advances a fake clock by
+// its time on the wire (9 clocks per byte at 400 kHz, plus START/STOP).
+static const uint32_t BYTE_US = 9 * 1000000 / 400000 + 1;
+static const uint32_t TXN_OVERHEAD_US = 25;
+static const uint8_t SENSOR_ADDR = 0x23;
+static const uint8_t DISPLAY_ADDR = 0x3C;
+
+typedef I2cScheduler<3, 40> Queues; // I2C_MAX_DEVICES, the bus task's queue
+
+typedef struct {
+  uint8_t addr;
+  I2cOp op;
+  size_t bytes;       // on the wire, address byte included
+  uint8_t first;      // first byte written, to tell transactions apart
+  uint32_t startUs;
+  uint32_t endUs;
+} io_t;
+
+class MockPort : public I2cPort {
+public:
+  uint32_t nowUs = 0;
+  uint8_t nackAddr = 0;
+  std::vector<io_t> log;
+
+  bool write(uint8_t addr, const uint8_t* head, size_t headLen, const uint8_t* data, size_t len) override {
+    uint8_t first = headLen ? head[0] : (len ? data[0] : 0);
+    if (headLen > 1) first = head[1]; // command frames: 0x00 then the command
+    transfer(addr, I2C_WRITE, 1 + headLen + len, first);
+    return addr != nackAddr;
+  }
+
+  bool read(uint8_t addr, uint8_t* out, size_t len) override {
+    for (size_t i = 0; i < len; ++i) out[i] = (uint8_t)(0xA0 + i);
+    transfer(addr, I2C_READ, 1 + len, 0);
+    return addr != nackAddr;
+  }
+
+  uint32_t nowMs() const { return nowUs / 1000; }
+
+private:
+  void transfer(uint8_t addr, I2cOp op, size_t bytes, uint8_t first) {
+    io_t io = { addr, op, bytes, first, nowUs, 0 };
+    nowUs += TXN_OVERHEAD_US + (uint32_t)bytes * BYTE_US;
+    io.endUs = nowUs;
+    log.push_back(io);
+  }
+};
+
+// The bus task loop: run what is due, otherwise sleep until it is
+static void runUntil(Queues &q, MockPort &port, uint32_t untilMs) {
+  while (port.nowMs() < untilMs) {
+    i2c_txn_t txn;
+    int dev;
+    uint8_t addr;
+    if (!q.take(port.nowMs(), txn, dev, addr)) {
+      uint32_t wait = q.msUntilDue(port.nowMs());
+      if (wait == UINT32_MAX || port.nowMs() + wait > untilMs) port.nowUs = untilMs * 1000;
+      else port.nowUs += (wait ? wait : 1) * 1000;
+      continue;
+    }
+    bool ok = Queues::execute(port, addr, txn);
+    q.finish(dev, ok, port.nowMs());
+    Queues::complete(txn, ok);
+  }
+}
+
+// Completion log shared by the callbacks
+typedef struct {
+  int tag;
+  bool ok;
+  size_t len;
+  uint8_t data0;
+} done_t;
+
+static std::vector<done_t> done;
+
+static void onDone(void* ctx, bool ok, const uint8_t* data, size_t len) {
+  done.push_back({ (int)(intptr_t)ctx, ok, len, len ? data[0] : (uint8_t)0 });
+}
+
+// An SSD1306 frame as DisplayManager::pushRuns queues it: per page, the
+// page/column command, then the 128 bytes in I2C_MAX_CHUNK pieces
+static uint8_t framebuffer[8 * 128];
+
+static size_t queueFrame(Queues &q, int dev, uint32_t now, int tagBase) {
+  size_t n = 0;
+  for (uint8_t page = 0; page < 8; ++page) {
+    const uint8_t cmd[] = { 0x00, (uint8_t)(0xB0 | page), 0x00, 0x10 };
+    TEST_ASSERT_TRUE(q.submitWrite(dev, cmd, sizeof(cmd), nullptr, 0, 0, now, onDone,
+                                   (void*)(intptr_t)(tagBase + n++)));
+    const uint8_t prefix = 0x40;
+    for (size_t off = 0; off < 128; off += I2C_MAX_CHUNK) {
+      TEST_ASSERT_TRUE(q.submitWrite(dev, &prefix, 1, framebuffer + page * 128 + off, I2C_MAX_CHUNK, 0, now,
+                                     onDone, (void*)(intptr_t)(tagBase + n++)));
+    }
+  }
+  return n;
+}
+
+static MockPort port;
+
+void setUp(void) {
+  port = MockPort();
+  done.clear();
+  for (size_t i = 0; i < sizeof(framebuffer); ++i) framebuffer[i] = (uint8_t)i;
+}
+void tearDown(void) {}
+
+void test_device_order_and_round_robin(void) {
+  Queues q;
+  int a = q.addDevice(0x10, 1);
+  int b = q.addDevice(0x11, 1);
+  for (uint8_t i = 0; i < 5; ++i) {
+    const uint8_t cmd[] = { 0x00, i };
+    TEST_ASSERT_TRUE(q.submitWrite(a, cmd, 2, nullptr, 0, 0, 0, onDone, (void*)(intptr_t)(100 + i)));
+    TEST_ASSERT_TRUE(q.submitWrite(b, cmd, 2, nullptr, 0, 0, 0, onDone, (void*)(intptr_t)(200 + i)));
+  }
+  runUntil(q, port, 100);
+
+  // Each device in submission order, equal priorities taking turns
+  TEST_ASSERT_EQUAL(10, port.log.size());
+  TEST_ASSERT_EQUAL(10, done.size());
+  for (size_t i = 0; i < port.log.size(); ++i) {
+    TEST_ASSERT_EQUAL_UINT8(i % 2 ? 0x11 : 0x10, port.log[i].addr);
+    TEST_ASSERT_EQUAL_UINT8(i / 2, port.log[i].first);
+    TEST_ASSERT_EQUAL((i % 2 ? 200 : 100) + (int)(i / 2), done[i].tag);
+  }
+  TEST_ASSERT_EQUAL_UINT32(5, q.stats(a).done);
+  TEST_ASSERT_EQUAL(0, q.pending(b));
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, q.msUntilDue(port.nowMs()));
+}
+
+void test_sensor_read_waits_one_chunk(void) {
+  Queues q;
+  int sensor = q.addDevice(SENSOR_ADDR, 2);
+  int display = q.addDevice(DISPLAY_ADDR, 1);
+  size_t chunks = queueFrame(q, display, 0, 0);
+  TEST_ASSERT_EQUAL(24, chunks);
+
+  // Run part of the push; the sensor read arrives just as the next chunk starts
+  for (int i = 0; i < 5; ++i) TEST_ASSERT_TRUE(q.step(port, port.nowMs()));
+  i2c_txn_t txn;
+  int dev;
+  uint8_t addr;
+  TEST_ASSERT_TRUE(q.take(port.nowMs(), txn, dev, addr));
+  uint32_t submitUs = port.nowUs;
+  const uint8_t measure = 0x20;
+  TEST_ASSERT_TRUE(q.submitWrite(sensor, &measure, 1, nullptr, 0, 0, port.nowMs(), onDone, (void*)(intptr_t)900));
+  TEST_ASSERT_TRUE(q.submitRead(sensor, 2, 0, port.nowMs(), onDone, (void*)(intptr_t)901));
+  bool ok = Queues::execute(port, addr, txn);
+  q.finish(dev, ok, port.nowMs());
+  Queues::complete(txn, ok);
+  runUntil(q, port, 200);
+
+  // The sensor transactions run back to back after that chunk; the frame
+  // finishes afterwards, in order
+  TEST_ASSERT_EQUAL(chunks + 2, port.log.size());
+  TEST_ASSERT_EQUAL_UINT8(DISPLAY_ADDR, port.log[5].addr);
+  TEST_ASSERT_EQUAL_UINT8(SENSOR_ADDR, port.log[6].addr);
+  TEST_ASSERT_EQUAL(I2C_WRITE, port.log[6].op);
+  TEST_ASSERT_EQUAL_UINT8(SENSOR_ADDR, port.log[7].addr);
+  TEST_ASSERT_EQUAL(I2C_READ, port.log[7].op);
+  int expectTag = 0;
+  for (const done_t &d : done) {
+    if (d.tag >= 900) continue;
+    TEST_ASSERT_EQUAL(expectTag++, d.tag);
+  }
+  TEST_ASSERT_EQUAL((int)chunks, expectTag);
+
+  const done_t* read = nullptr;
+  for (const done_t &d : done)
+    if (d.tag == 901) read = &d;
+  TEST_ASSERT_NOT_NULL(read);
+  TEST_ASSERT_TRUE(read->ok);
+  TEST_ASSERT_EQUAL(2, read->len);
+  TEST_ASSERT_EQUAL_UINT8(0xA0, read->data0);
+
+  // Bus hold: no transaction is longer than one full chunk, and the sensor
+  // waited at most for the one in progress
+  uint32_t chunkUs = TXN_OVERHEAD_US + (1 + 1 + I2C_MAX_CHUNK) * BYTE_US;
+  uint32_t longest = 0;
+  for (const io_t &io : port.log)
+    if (io.endUs - io.startUs > longest) longest = io.endUs - io.startUs;
+  TEST_ASSERT_TRUE(longest <= chunkUs);
+  TEST_ASSERT_TRUE(port.log[6].startUs - submitUs <= chunkUs);
+  TEST_ASSERT_TRUE(q.stats(sensor).maxWaitMs <= chunkUs / 1000 + 1); // whole ms
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "longest transaction %u us, frame on the wire %u us",
+           (unsigned)longest, (unsigned)(port.log.back().endUs - port.log.front().startUs));
+  TEST_MESSAGE(msg);
+}
+
+void test_after_ms_times_from_previous_end(void) {
+  Queues q;
+  int sensor = q.addDevice(SENSOR_ADDR, 2);
+  int display = q.addDevice(DISPLAY_ADDR, 1);
+  const uint8_t measure = 0x20;
+  TEST_ASSERT_TRUE(q.submitWrite(sensor, &measure, 1, nullptr, 0, 0, 0, onDone, (void*)(intptr_t)1));
+  TEST_ASSERT_TRUE(q.submitRead(sensor, 2, 180, 0, onDone, (void*)(intptr_t)2));
+  queueFrame(q, display, 0, 10);
+
+  TEST_ASSERT_TRUE(q.step(port, port.nowMs()));
+  uint32_t convStartMs = port.nowMs();
+  TEST_ASSERT_EQUAL_UINT32(0, q.msUntilDue(port.nowMs())); // the display is due meanwhile
+  runUntil(q, port, 1000);
+
+  // The display frame used the bus while the conversion ran; the read came
+  // 180 ms after the conversion command, not after its submission
+  const io_t* readIo = nullptr;
+  size_t displayBefore = 0;
+  for (const io_t &io : port.log) {
+    if (io.op == I2C_READ) readIo = &io;
+    else if (!readIo && io.addr == DISPLAY_ADDR) displayBefore++;
+  }
+  TEST_ASSERT_NOT_NULL(readIo);
+  TEST_ASSERT_EQUAL(24, displayBefore);
+  TEST_ASSERT_TRUE(readIo->startUs / 1000 >= convStartMs + 180);
+  TEST_ASSERT_TRUE(readIo->startUs / 1000 <= convStartMs + 181);
+  TEST_ASSERT_EQUAL(2, done.back().tag);
+}
+
+void test_full_queue_and_nack(void) {
+  Queues q;
+  int sensor = q.addDevice(SENSOR_ADDR, 2);
+  int display = q.addDevice(DISPLAY_ADDR, 1);
+  TEST_ASSERT_TRUE(q.addDevice(0x50, 1) >= 0);
+  TEST_ASSERT_EQUAL(-1, q.addDevice(0x51, 1));
+
+  // Malformed transactions and a full queue are refused, not truncated
+  uint8_t big[I2C_MAX_CHUNK + 1] = {};
+  TEST_ASSERT_FALSE(q.submitWrite(display, big, I2C_INLINE_BYTES + 1, nullptr, 0, 0, 0));
+  TEST_ASSERT_FALSE(q.submitWrite(display, big, 1, big, sizeof(big), 0, 0));
+  TEST_ASSERT_FALSE(q.submitRead(sensor, I2C_INLINE_BYTES + 1, 0, 0));
+  TEST_ASSERT_FALSE(q.submitRead(7, 1, 0, 0));
+  for (int i = 0; i < 40; ++i) TEST_ASSERT_TRUE(q.submitWrite(display, big, 1, nullptr, 0, 0, 0));
+  TEST_ASSERT_FALSE(q.submitWrite(display, big, 1, nullptr, 0, 0, 0));
+  TEST_ASSERT_EQUAL_UINT32(1, q.stats(display).rejected);
+
+  // A NACK fails the transaction with no data and the queue moves on
+  port.nackAddr = SENSOR_ADDR;
+  TEST_ASSERT_TRUE(q.submitRead(sensor, 2, 0, 0, onDone, (void*)(intptr_t)5));
+  const uint8_t measure = 0x20;
+  TEST_ASSERT_TRUE(q.submitWrite(sensor, &measure, 1, nullptr, 0, 0, 0, onDone, (void*)(intptr_t)6));
+  runUntil(q, port, 100);
+  TEST_ASSERT_EQUAL(2, done.size());
+  TEST_ASSERT_FALSE(done[0].ok);
+  TEST_ASSERT_EQUAL(0, done[0].len);
+  TEST_ASSERT_FALSE(done[1].ok);
+  TEST_ASSERT_EQUAL_UINT32(2, q.stats(sensor).failed);
+  TEST_ASSERT_EQUAL_UINT32(40, q.stats(display).done);
+  TEST_ASSERT_EQUAL(0, q.pending(display));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_device_order_and_round_robin);
+  RUN_TEST(test_sensor_read_waits_one_chunk);
+  RUN_TEST(test_after_ms_times_from_previous_end);
+  RUN_TEST(test_full_queue_and_nack);
+  return UNITY_END();
+}
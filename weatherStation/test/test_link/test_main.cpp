@@ -0,0 +1,231 @@
+#include <unity.h>
+#include "Link.h"
+
+// Link on a fake clock with a scripted port: start() results, when the
+// attempt completes or fails, and when the connection drops.
+class FakePort : public LinkPort {
+public:
+  bool startOk = true;
+  bool connectNow = false;  // start() completes synchronously
+  bool isUp = false;
+  bool isFailed = false;
+  int starts = 0;
+  int stops = 0;
+
+  bool start() override {
+    starts++;
+    isFailed = false;
+    if (connectNow) isUp = true;
+    return startOk;
+  }
+  bool connected() override { return isUp; }
+  bool failed() override { return isFailed; }
+  void stop() override {
+    stops++;
+    isUp = false;
+  }
+};
+
+static const uint32_t MIN_BACKOFF = 1000;
+static const uint32_t MAX_BACKOFF = 10000;
+static const uint32_t TIMEOUT = 5000;
+
+// Polls every ms until the link makes its next attempt; returns its time
+static uint32_t waitRetry(Link &link, uint32_t now) {
+  uint32_t attempts = link.stats().attempts;
+  while (link.stats().attempts == attempts) link.poll(++now, true);
+  return now;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_down_connecting_up(void) {
+  FakePort port;
+  Link link("t", port, MIN_BACKOFF, MAX_BACKOFF, TIMEOUT, 1);
+  TEST_ASSERT_EQUAL(LINK_DOWN, link.state());
+
+  link.poll(0, true);
+  TEST_ASSERT_EQUAL(LINK_CONNECTING, link.state());
+  TEST_ASSERT_EQUAL(1, port.starts);
+  TEST_ASSERT_EQUAL_UINT32(0, link.msUntilNextAction(0)); // poll until it completes
+
+  link.poll(100, true);
+  TEST_ASSERT_EQUAL(LINK_CONNECTING, link.state());
+  port.isUp = true;
+  link.poll(200, true);
+  TEST_ASSERT_TRUE(link.up());
+  TEST_ASSERT_EQUAL_UINT32(200, link.since());
+  TEST_ASSERT_EQUAL_UINT32(1, link.stats().ups);
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, link.msUntilNextAction(200));
+
+  // A synchronous port is up on the first poll
+  FakePort sync;
+  sync.connectNow = true;
+  Link fast("s", sync, MIN_BACKOFF, MAX_BACKOFF, TIMEOUT, 1);
+  fast.poll(0, true);
+  TEST_ASSERT_TRUE(fast.up());
+}
+
+void test_timeout_and_failure_back_off(void) {
+  FakePort port;
+  Link link("t", port, MIN_BACKOFF, MAX_BACKOFF, TIMEOUT, 1);
+  link.poll(0, true);
+  link.poll(TIMEOUT - 1, true);
+  TEST_ASSERT_EQUAL(LINK_CONNECTING, link.state());
+  link.poll(TIMEOUT, true);
+  TEST_ASSERT_EQUAL(LINK_BACKOFF, link.state());
+  TEST_ASSERT_EQUAL_UINT32(1, link.stats().failures);
+  uint32_t left = link.msUntilNextAction(TIMEOUT);
+  TEST_ASSERT_TRUE(left >= MIN_BACKOFF / 2 && left <= MIN_BACKOFF);
+
+  // An asynchronous failure backs off without waiting for the timeout
+  uint32_t t = waitRetry(link, TIMEOUT);
+  TEST_ASSERT_EQUAL(LINK_CONNECTING, link.state());
+  port.isFailed = true;
+  link.poll(t + 1, true);
+  TEST_ASSERT_EQUAL(LINK_BACKOFF, link.state());
+
+  // start() failing right away also backs off
+  port.startOk = false;
+  t = waitRetry(link, t + 1);
+  TEST_ASSERT_EQUAL(LINK_BACKOFF, link.state());
+  TEST_ASSERT_EQUAL_UINT32(3, link.stats().failures);
+  TEST_ASSERT_EQUAL_UINT32(3, link.stats().attempts);
+}
+
+void test_backoff_doubles_to_max_with_jitter(void) {
+  FakePort port;
+  port.startOk = false;
+  Link link("t", port, MIN_BACKOFF, MAX_BACKOFF, TIMEOUT, 12345);
+  uint32_t now = 0;
+  link.poll(now, true);
+  uint32_t backoff = MIN_BACKOFF;
+  for (int i = 0; i < 40; ++i) {
+    TEST_ASSERT_EQUAL(LINK_BACKOFF, link.state());
+    // Equal jitter: the wait is within [backoff/2, backoff]
+    uint32_t wait = link.msUntilNextAction(now);
+    TEST_ASSERT_TRUE(wait >= backoff / 2);
+    TEST_ASSERT_TRUE(wait <= backoff);
+    uint32_t retry = waitRetry(link, now);
+    TEST_ASSERT_EQUAL_UINT32(now + wait, retry);
+    now = retry;
+    backoff = backoff * 2 > MAX_BACKOFF ? MAX_BACKOFF : backoff * 2;
+  }
+  TEST_ASSERT_EQUAL_UINT32(41, link.stats().attempts);
+
+  // Success resets the backoff
+  port.startOk = true;
+  port.connectNow = true;
+  now = waitRetry(link, now);
+  TEST_ASSERT_TRUE(link.up());
+  link.reportError(now);
+  uint32_t wait = link.msUntilNextAction(now);
+  TEST_ASSERT_TRUE(wait >= MIN_BACKOFF / 2 && wait <= MIN_BACKOFF);
+}
+
+void test_jitter_spreads_retries(void) {
+  // Stations with different seeds do not retry in lockstep
+  uint32_t minWait = UINT32_MAX, maxWait = 0;
+  for (uint32_t seed = 1; seed <= 200; ++seed) {
+    FakePort port;
+    port.startOk = false;
+    Link link("t", port, 8000, 60000, TIMEOUT, seed);
+    link.poll(0, true);
+    uint32_t wait = link.msUntilNextAction(0);
+    TEST_ASSERT_TRUE(wait >= 4000 && wait <= 8000);
+    if (wait < minWait) minWait = wait;
+    if (wait > maxWait) maxWait = wait;
+  }
+  TEST_ASSERT_TRUE(maxWait - minWait > 2000);
+}
+
+void test_parent_down_tears_down(void) {
+  FakePort port;
+  port.connectNow = true;
+  Link link("t", port, MIN_BACKOFF, MAX_BACKOFF, TIMEOUT, 1);
+  link.poll(0, true);
+  TEST_ASSERT_TRUE(link.up());
+
+  link.poll(10, false);
+  TEST_ASSERT_EQUAL(LINK_DOWN, link.state());
+  TEST_ASSERT_EQUAL(1, port.stops);
+  TEST_ASSERT_EQUAL_UINT32(1, link.stats().drops);
+  link.poll(20, false); // already down: no second stop
+  TEST_ASSERT_EQUAL(1, port.stops);
+
+  // Parent back: connects right away, no backoff
+  link.poll(30, true);
+  TEST_ASSERT_TRUE(link.up());
+
+  // Down while backing off: the backoff restarts from the minimum
+  port.startOk = false;
+  port.connectNow = false;
+  link.reportError(40);
+  uint32_t now = 40;
+  for (int i = 0; i < 3; ++i) now = waitRetry(link, now);
+  TEST_ASSERT_EQUAL(LINK_BACKOFF, link.state());
+  link.poll(100000, false);
+  TEST_ASSERT_EQUAL(LINK_DOWN, link.state());
+  TEST_ASSERT_EQUAL(2, port.stops);
+  link.poll(100001, true);
+  TEST_ASSERT_EQUAL(LINK_BACKOFF, link.state());
+  uint32_t wait = link.msUntilNextAction(100001);
+  TEST_ASSERT_TRUE(wait >= MIN_BACKOFF / 2 && wait <= MIN_BACKOFF);
+}
+
+void test_report_error_and_drop(void) {
+  FakePort port;
+  port.connectNow = true;
+  Link link("t", port, MIN_BACKOFF, MAX_BACKOFF, TIMEOUT, 1);
+
+  // Only an up link reacts to a data-path error
+  link.reportError(0);
+  TEST_ASSERT_EQUAL(LINK_DOWN, link.state());
+  link.poll(0, true);
+  link.reportError(5);
+  TEST_ASSERT_EQUAL(LINK_BACKOFF, link.state());
+  TEST_ASSERT_EQUAL_UINT32(1, link.stats().drops);
+  TEST_ASSERT_EQUAL_UINT32(1, link.stats().failures);
+  link.reportError(6);
+  TEST_ASSERT_EQUAL_UINT32(1, link.stats().drops);
+
+  // A drop seen by poll() reconnects immediately instead of backing off
+  uint32_t now = waitRetry(link, 5);
+  TEST_ASSERT_TRUE(link.up());
+  port.isUp = false;
+  port.connectNow = false;
+  link.poll(now + 1, true);
+  TEST_ASSERT_EQUAL(LINK_CONNECTING, link.state());
+  TEST_ASSERT_EQUAL_UINT32(2, link.stats().drops);
+  TEST_ASSERT_EQUAL_UINT32(0, link.msUntilNextAction(now + 1));
+}
+
+void test_next_action_across_wrap(void) {
+  FakePort port;
+  port.startOk = false;
+  Link link("t", port, MIN_BACKOFF, MAX_BACKOFF, TIMEOUT, 7);
+  uint32_t now = UINT32_MAX - 100; // millis() wraps after 49 days
+  link.poll(now, true);
+  uint32_t wait = link.msUntilNextAction(now);
+  TEST_ASSERT_TRUE(wait >= MIN_BACKOFF / 2 && wait <= MIN_BACKOFF);
+  TEST_ASSERT_EQUAL_UINT32(wait - 50, link.msUntilNextAction(now + 50));
+  TEST_ASSERT_EQUAL_UINT32(0, link.msUntilNextAction(now + wait + 10));
+  link.poll(now + wait - 1, true);
+  TEST_ASSERT_EQUAL(LINK_BACKOFF, link.state());
+  TEST_ASSERT_EQUAL(1, port.starts);
+  link.poll(now + wait, true);
+  TEST_ASSERT_EQUAL(2, port.starts);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_down_connecting_up);
+  RUN_TEST(test_timeout_and_failure_back_off);
+  RUN_TEST(test_backoff_doubles_to_max_with_jitter);
+  RUN_TEST(test_jitter_spreads_retries);
+  RUN_TEST(test_parent_down_tears_down);
+  RUN_TEST(test_report_error_and_drop);
+  RUN_TEST(test_next_action_across_wrap);
+  return UNITY_END();
+}
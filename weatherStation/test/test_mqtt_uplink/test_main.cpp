@@ -0,0 +1,152 @@
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "MqttFields.h"
+#include "MqttBatch.h"
+
+// Host benchmark of the two MQTT uplink modes (MQTT_UPLINK_MODE in Common.h)
+// over the same sample stream: publishes, bytes on the wire and encode time
+// per sample, plus which samples each subscriber view actually receives.
+static const char* BASE = "homestations/1051804/0";
+static constexpr size_t BATCH_SAMPLES = 6; // MQTT_BATCH_MAX_SAMPLES
+static constexpr size_t SAMPLES = 6000;
+
+typedef struct {
+  uint32_t publishes;
+  uint32_t bytes;
+  uint32_t fieldSeqs;   // samples that reached the per-field topics
+  uint32_t batchSeqs;   // samples that reached <base>/batch
+  double ns;
+} uplink_run_t;
+
+static sensor_payload_t sampleAt(uint32_t i) {
+  sensor_payload_t p;
+  sensorPayloadClear(p);
+  p.seq = i + 1;
+  p.tempC = 18.0f + (i % 50) * 0.1f;
+  p.humidity = 60.0f - (i % 30) * 0.2f;
+  p.lux = 800.0f + (i % 200) * 3.7f;
+  p.wind_kmh = 3.0f + (i % 17) * 0.4f;
+  p.wind_gust_kmh = p.wind_kmh + 2.0f;
+  p.wind_avg2m_kmh = 4.1f;
+  p.wind_avg10m_kmh = 4.3f;
+  p.wind_var10m = 1.25f;
+  p.temp_avg = 19.0f;
+  p.humidity_avg = 58.0f;
+  p.lux_avg = 900.0f;
+  p.epoch_ms = 1760000000000ULL + i * 5000ULL;
+  return p;
+}
+
+static size_t topicLen(const char* suffix) { return strlen(BASE) + 1 + strlen(suffix); }
+
+static void countFields(uplink_run_t &r, const sensor_payload_t &p) {
+  mqttFields(p, [&r](const char* suffix, const char* msg) {
+    r.publishes++;
+    r.bytes += mqttWireBytes(topicLen(suffix), strlen(msg));
+    if (strcmp(suffix, "update") == 0) r.fieldSeqs++;
+  });
+}
+
+static uplink_run_t runPerField() {
+  uplink_run_t r = {};
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < SAMPLES; ++i) countFields(r, sampleAt(i));
+  r.ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  return r;
+}
+
+static uplink_run_t runBatched(bool legacyTopics) {
+  static MqttBatch<2 * BATCH_SAMPLES, ser::Json> batch;
+  static uint8_t body[1024]; // MQTT_BATCH_BUFFER
+  uplink_run_t r = {};
+  batch.clear();
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < SAMPLES; ++i) {
+    batch.add(sampleAt(i), i * 5000);
+    if (!batch.due(i * 5000, BATCH_SAMPLES, 30000)) continue;
+    size_t len = batch.encode(body, sizeof(body));
+    TEST_ASSERT_TRUE(len > 0);
+    r.publishes++;
+    r.bytes += mqttWireBytes(topicLen("batch"), len);
+    r.batchSeqs += batch.size();
+    if (legacyTopics) countFields(r, batch.newest());
+    batch.clear();
+  }
+  r.ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  return r;
+}
+
+static void report(const char* mode, const uplink_run_t &r) {
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%-16s %5.2f publishes/sample %6.1f B/sample %7.1f ns/sample",
+           mode, (double)r.publishes / SAMPLES, (double)r.bytes / SAMPLES, r.ns / SAMPLES);
+  TEST_MESSAGE(msg);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_wire_bytes(void) {
+  // 1 fixed header + 1 length byte + 2 topic length + topic + payload
+  TEST_ASSERT_EQUAL_UINT32(4 + 10 + 4, mqttWireBytes(10, 4));
+  // Remaining length of 128 and up takes a second varint byte
+  TEST_ASSERT_EQUAL_UINT32(1 + 2 + 130, mqttWireBytes(28, 100));
+}
+
+void test_field_messages(void) {
+  sensor_payload_t p = sampleAt(41);
+  char seen[16][16];
+  char text[16][32];
+  size_t n = 0;
+  mqttFields(p, [&](const char* suffix, const char* msg) {
+    snprintf(seen[n], sizeof(seen[n]), "%s", suffix);
+    snprintf(text[n], sizeof(text[n]), "%s", msg);
+    n++;
+  });
+  TEST_ASSERT_EQUAL(10, n);
+  TEST_ASSERT_EQUAL_STRING("temperature", seen[0]);
+  TEST_ASSERT_EQUAL_STRING("22.1", text[0]);
+  TEST_ASSERT_EQUAL_STRING("seq", seen[8]);
+  TEST_ASSERT_EQUAL_STRING("42", text[8]);
+  TEST_ASSERT_EQUAL_STRING("update", seen[9]);
+
+  // Missing readings: temperature, humidity and light are skipped, wind is null
+  sensorPayloadClear(p);
+  n = 0;
+  mqttFields(p, [&](const char* suffix, const char* msg) {
+    snprintf(seen[n], sizeof(seen[n]), "%s", suffix);
+    snprintf(text[n], sizeof(text[n]), "%s", msg);
+    n++;
+  });
+  TEST_ASSERT_EQUAL(7, n);
+  TEST_ASSERT_EQUAL_STRING("windspeed", seen[0]);
+  TEST_ASSERT_EQUAL_STRING("null", text[0]);
+}
+
+void test_benchmark_modes(void) {
+  uplink_run_t perField = runPerField();
+  uplink_run_t batched = runBatched(false);
+  uplink_run_t legacy = runBatched(true);
+  report("per-field", perField);
+  report("batched", batched);
+  report("batched+legacy", legacy);
+
+  // Per-field delivers every sample on the field topics
+  TEST_ASSERT_EQUAL_UINT32(SAMPLES, perField.fieldSeqs);
+  // Batched delivers every sample in batches, the field topics only the newest of each
+  TEST_ASSERT_EQUAL_UINT32(SAMPLES, batched.batchSeqs);
+  TEST_ASSERT_EQUAL_UINT32(SAMPLES / BATCH_SAMPLES, legacy.fieldSeqs);
+  // and is far cheaper on the wire
+  TEST_ASSERT_TRUE(batched.publishes * BATCH_SAMPLES == SAMPLES);
+  TEST_ASSERT_TRUE(batched.bytes < perField.bytes);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_wire_bytes);
+  RUN_TEST(test_field_messages);
+  RUN_TEST(test_benchmark_modes);
+  return UNITY_END();
+}
@@ -0,0 +1,137 @@
+#include <unity.h>
+#include "PulseCounter.h"
+
+// Host stand-in for the PCNT unit: a 16-bit counter that resets at the high
+// limit and an overflow "interrupt" the test decides when to run. take() reads
+// both the way PcntPulseCounter does and goes through WrappingCount.
+static constexpr uint16_t LIMIT = 32767;
+
+class FakePulseCounter : public PulseCounter {
+public:
+  FakePulseCounter() : counter(0), overflows(0), pendingIsr(0), _total(LIMIT) {}
+
+  bool begin() override {
+    counter = 0;
+    overflows = 0;
+    pendingIsr = 0;
+    _total.reset();
+    return true;
+  }
+
+  uint32_t take() override { return _total.take(overflows, counter); }
+
+  // Pulses arrive; with deferIsr the overflow interrupts stay pending
+  void pulse(uint32_t n, bool deferIsr = false) {
+    while (n--) {
+      if (++counter == LIMIT) {
+        counter = 0;
+        pendingIsr++;
+      }
+    }
+    if (!deferIsr) runIsr();
+  }
+
+  void runIsr() {
+    overflows += pendingIsr;
+    pendingIsr = 0;
+  }
+
+  uint16_t counter;
+  uint32_t overflows;
+  uint32_t pendingIsr;
+
+private:
+  WrappingCount _total;
+};
+
+static FakePulseCounter fake;
+
+void setUp(void) { fake.begin(); }
+void tearDown(void) {}
+
+void test_counts_since_previous_take(void) {
+  PulseCounter &pc = fake;
+  TEST_ASSERT_EQUAL_UINT32(0, pc.take());
+  fake.pulse(12);
+  TEST_ASSERT_EQUAL_UINT32(12, pc.take());
+  TEST_ASSERT_EQUAL_UINT32(0, pc.take());
+  fake.pulse(3);
+  fake.pulse(4);
+  TEST_ASSERT_EQUAL_UINT32(7, pc.take());
+}
+
+void test_wrap_with_isr_done(void) {
+  fake.pulse(LIMIT - 5);
+  TEST_ASSERT_EQUAL_UINT32(LIMIT - 5, fake.take());
+  fake.pulse(10);
+  TEST_ASSERT_EQUAL_UINT32(1, fake.overflows);
+  TEST_ASSERT_EQUAL_UINT32(10, fake.take());
+}
+
+void test_wrap_before_isr_runs(void) {
+  fake.pulse(LIMIT - 5);
+  TEST_ASSERT_EQUAL_UINT32(LIMIT - 5, fake.take());
+  // Counter is back at 5 but the overflow has not been counted yet
+  fake.pulse(10, true);
+  TEST_ASSERT_EQUAL_UINT32(0, fake.overflows);
+  TEST_ASSERT_EQUAL_UINT32(10, fake.take());
+  // The interrupt catching up must not count the wrap twice
+  fake.runIsr();
+  TEST_ASSERT_EQUAL_UINT32(0, fake.take());
+  fake.pulse(2);
+  TEST_ASSERT_EQUAL_UINT32(2, fake.take());
+}
+
+void test_wrap_exactly_to_zero_before_isr(void) {
+  fake.pulse(100);
+  fake.take();
+  fake.pulse(LIMIT - 100, true);
+  TEST_ASSERT_EQUAL_UINT16(0, fake.counter);
+  TEST_ASSERT_EQUAL_UINT32(LIMIT - 100, fake.take());
+  fake.runIsr();
+  fake.pulse(1);
+  TEST_ASSERT_EQUAL_UINT32(1, fake.take());
+}
+
+void test_several_wraps_between_takes(void) {
+  fake.pulse(3 * (uint32_t)LIMIT + 17);
+  TEST_ASSERT_EQUAL_UINT32(3 * (uint32_t)LIMIT + 17, fake.take());
+}
+
+void test_total_wraps_uint32(void) {
+  // Long uptime: the overflow count itself is near the top of uint32
+  WrappingCount c(LIMIT);
+  uint32_t ovf = UINT32_MAX / LIMIT;
+  c.take(0, 0);
+  TEST_ASSERT_EQUAL_UINT32(ovf * (uint32_t)LIMIT + 10, c.take(ovf, 10));
+  TEST_ASSERT_EQUAL_UINT32(LIMIT + 5, c.take(ovf + 1, 15));
+  TEST_ASSERT_EQUAL_UINT32(LIMIT, c.take(ovf + 2, 15));
+}
+
+void test_steady_wind_never_jumps(void) {
+  // Sample every "tick" with the ISR sometimes late; every delta stays exact
+  uint32_t sum = 0, expected = 0;
+  for (uint32_t tick = 0; tick < 2000; ++tick) {
+    uint32_t n = 97 + tick % 13;
+    bool late = tick % 3 == 0;
+    fake.pulse(n, late);
+    uint32_t d = fake.take();
+    TEST_ASSERT_EQUAL_UINT32(n, d);
+    sum += d;
+    expected += n;
+    if (late) fake.runIsr();
+  }
+  TEST_ASSERT_EQUAL_UINT32(expected, sum);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_counts_since_previous_take);
+  RUN_TEST(test_wrap_with_isr_done);
+  RUN_TEST(test_wrap_before_isr_runs);
+  RUN_TEST(test_wrap_exactly_to_zero_before_isr);
+  RUN_TEST(test_several_wraps_between_takes);
+  RUN_TEST(test_total_wraps_uint32);
+  RUN_TEST(test_steady_wind_never_jumps);
+  return UNITY_END();
+}
@@ -0,0 +1,248 @@
+#include <unity.h>
+#include <deque>
+#include <set>
+#include "ReliableLink.h"
+
+// ReliableSender and SeqWindow against a simulated lossy ESP-NOW link. Every
+// transmission reaches the peer or not, its MAC ack comes back or not, and
+// the send callback fires a few ms later in send order, as on the radio.
+typedef struct {
+  uint32_t seq;
+  uint32_t at;      // callback time
+  bool received;
+  bool acked;
+  bool callback;    // false: the driver never reports this one
+} air_t;
+
+class LossyLink {
+public:
+  LossyLink(uint32_t dataLossPct, uint32_t ackLossPct, uint32_t noCallbackPct, uint32_t seed)
+    : _dataLoss(dataLossPct), _ackLoss(ackLossPct), _noCallback(noCallbackPct), _rng(seed) {}
+
+  // The frame's seq travels in its first 4 bytes
+  bool send(const uint8_t* frame, uint32_t now, SeqWindow &rx, reliable_rx_stats_t &st,
+            std::multiset<uint32_t> &accepted) {
+    air_t a;
+    memcpy(&a.seq, frame, 4);
+    a.at = now + 2;
+    a.received = roll() >= _dataLoss;
+    a.acked = a.received && roll() >= _ackLoss;
+    a.callback = roll() >= _noCallback;
+    if (a.received && rx.accept(a.seq, st)) accepted.insert(a.seq);
+    _air.push_back(a);
+    return true;
+  }
+
+  // Deliver due callbacks, in order
+  template <uint8_t W>
+  void callbacks(ReliableSender<W> &tx, uint32_t now, std::set<uint32_t> &ackedSeqs) {
+    while (!_air.empty() && (int32_t)(now - _air.front().at) >= 0) {
+      air_t a = _air.front();
+      _air.pop_front();
+      if (!a.callback) continue;
+      if (a.acked) ackedSeqs.insert(a.seq);
+      tx.onSendStatus(a.acked, now);
+    }
+  }
+
+  bool idle() const { return _air.empty(); }
+
+private:
+  uint32_t _dataLoss, _ackLoss, _noCallback;
+  uint32_t _rng;
+  std::deque<air_t> _air;
+
+  uint32_t roll() { // xorshift32, 0..99
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return _rng % 100;
+  }
+};
+
+typedef struct {
+  reliable_tx_stats_t tx;
+  reliable_rx_stats_t rx;
+  std::multiset<uint32_t> accepted; // seqs the receiver passed on
+  std::set<uint32_t> acked;         // seqs the sender saw acked
+} run_t;
+
+static run_t runLink(uint32_t frames, uint32_t dataLoss, uint32_t ackLoss, uint32_t noCallback,
+                     uint8_t maxRetries, uint32_t seed) {
+  ReliableSender<4> tx(maxRetries, 20, 100);
+  SeqWindow rxWindow;
+  LossyLink link(dataLoss, ackLoss, noCallback, seed);
+  run_t r;
+  r.rx = reliable_rx_stats_t();
+  uint32_t next = 1000, now = 0;
+  auto send = [&](const uint8_t* f, size_t) { return link.send(f, now, rxWindow, r.rx, r.accepted); };
+
+  while ((next < 1000 + frames || tx.inFlight() > 0 || !link.idle()) && now < 10000000) {
+    while (next < 1000 + frames && tx.canSubmit()) {
+      uint8_t frame[16] = {};
+      memcpy(frame, &next, 4);
+      TEST_ASSERT_TRUE(tx.submit(frame, sizeof(frame), next, now));
+      next++;
+    }
+    tx.poll(now, send);
+    link.callbacks(tx, now, r.acked);
+    now++;
+  }
+  r.tx = tx.stats();
+  return r;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_clean_link_delivers_everything_once(void) {
+  run_t r = runLink(500, 0, 0, 0, 5, 1);
+  TEST_ASSERT_EQUAL_UINT32(500, r.tx.delivered);
+  TEST_ASSERT_EQUAL_UINT32(0, r.tx.retransmits);
+  TEST_ASSERT_EQUAL(500, r.accepted.size());
+  TEST_ASSERT_EQUAL_UINT32(0, r.rx.duplicates);
+  TEST_ASSERT_EQUAL_UINT32(1000, reliableDeliveryPermille(r.tx));
+}
+
+void test_lossy_link_retransmits_without_duplicates(void) {
+  // 20% of frames lost, 20% of the acks for received frames lost
+  run_t r = runLink(2000, 20, 20, 0, 5, 7);
+  TEST_ASSERT_EQUAL_UINT32(2000, r.tx.frames);
+  TEST_ASSERT_EQUAL_UINT32(2000, r.tx.delivered + r.tx.dropped);
+  TEST_ASSERT_TRUE(r.tx.retransmits > 0);
+  TEST_ASSERT_TRUE(reliableDeliveryPermille(r.tx) >= 995);
+
+  // The receiver passes every seq on at most once; lost acks became duplicates
+  for (uint32_t seq : r.accepted) TEST_ASSERT_EQUAL(1, r.accepted.count(seq));
+  TEST_ASSERT_TRUE(r.rx.duplicates > 0);
+  // Everything the sender counts as delivered really arrived
+  for (uint32_t seq : r.acked) TEST_ASSERT_EQUAL(1, r.accepted.count(seq));
+  TEST_ASSERT_EQUAL(r.acked.size(), r.tx.delivered);
+}
+
+void test_gives_up_after_max_retries(void) {
+  run_t r = runLink(200, 100, 0, 0, 3, 3);
+  TEST_ASSERT_EQUAL_UINT32(200, r.tx.dropped);
+  TEST_ASSERT_EQUAL_UINT32(200 * 4, r.tx.transmissions); // first try plus 3 retries
+  TEST_ASSERT_EQUAL(0, r.accepted.size());
+}
+
+void test_missing_callbacks_time_out(void) {
+  run_t r = runLink(1000, 10, 10, 5, 5, 11);
+  TEST_ASSERT_TRUE(r.tx.timeouts > 0);
+  TEST_ASSERT_EQUAL_UINT32(1000, r.tx.delivered + r.tx.dropped);
+  for (uint32_t seq : r.accepted) TEST_ASSERT_EQUAL(1, r.accepted.count(seq));
+}
+
+// The callback of a transmission given up at a timeout arrives while its
+// retransmission is due: it must not count for the retransmission
+void test_late_callback_is_not_credited(void) {
+  ReliableSender<4> tx(3, 20, 100);
+  uint32_t now = 0, sends = 0;
+  auto send = [&](const uint8_t*, size_t) { sends++; return true; };
+  uint8_t frame[16] = {};
+  TEST_ASSERT_TRUE(tx.submit(frame, sizeof(frame), 1, now));
+  tx.poll(now, send);
+  now = 100;
+  tx.poll(now, send);                 // no callback: given up, retry due at 120
+  TEST_ASSERT_EQUAL_UINT32(1, tx.stats().timeouts);
+  now = 120;
+  tx.poll(now, send);                 // the late callback may still come
+  TEST_ASSERT_EQUAL_UINT32(1, sends);
+  TEST_ASSERT_EQUAL_UINT32(80, tx.msUntilNextAction(now));
+
+  now = 150;
+  tx.onSendStatus(true, now);         // late: first transmission's ack
+  TEST_ASSERT_EQUAL_UINT32(1, tx.stats().lateCallbacks);
+  TEST_ASSERT_EQUAL_UINT32(0, tx.stats().delivered);
+  tx.poll(now, send);                 // back in step: the retransmit goes out
+  TEST_ASSERT_EQUAL_UINT32(2, sends);
+  tx.onSendStatus(false, now + 2);    // the retransmit's own result
+  TEST_ASSERT_EQUAL_UINT32(0, tx.stats().delivered);
+  TEST_ASSERT_EQUAL(1, tx.inFlight());
+  now += 2 + 40;                      // second retry delay
+  tx.poll(now, send);
+  TEST_ASSERT_EQUAL_UINT32(3, sends);
+  tx.onSendStatus(true, now + 2);
+  TEST_ASSERT_EQUAL_UINT32(1, tx.stats().delivered);
+  TEST_ASSERT_EQUAL(0, tx.inFlight());
+  tx.onSendStatus(true, now + 3);     // nothing outstanding
+  TEST_ASSERT_EQUAL_UINT32(1, tx.stats().delivered);
+  TEST_ASSERT_EQUAL_UINT32(1, tx.stats().lateCallbacks);
+
+  // A callback that never comes: sends resume one ack timeout after the
+  // timeout and the count starts over
+  ReliableSender<4> lost(3, 20, 100);
+  sends = 0;
+  now = 0;
+  TEST_ASSERT_TRUE(lost.submit(frame, sizeof(frame), 1, now));
+  lost.poll(now, send);
+  lost.poll(100, send);
+  lost.poll(199, send);
+  TEST_ASSERT_EQUAL_UINT32(1, sends);
+  lost.poll(200, send);
+  TEST_ASSERT_EQUAL_UINT32(2, sends);
+  lost.onSendStatus(true, 202);
+  TEST_ASSERT_EQUAL_UINT32(1, lost.stats().delivered);
+  TEST_ASSERT_EQUAL_UINT32(0, lost.stats().lateCallbacks);
+}
+
+void test_seq_window(void) {
+  SeqWindow w;
+  reliable_rx_stats_t st = {};
+  TEST_ASSERT_TRUE(w.accept(100, st));
+  TEST_ASSERT_FALSE(w.accept(100, st));
+  TEST_ASSERT_TRUE(w.accept(103, st));    // 101, 102 missing
+  TEST_ASSERT_EQUAL_UINT32(2, st.missing);
+  TEST_ASSERT_TRUE(w.accept(101, st));    // late frame fills the gap
+  TEST_ASSERT_FALSE(w.accept(101, st));
+  TEST_ASSERT_EQUAL_UINT32(1, st.missing);
+  TEST_ASSERT_EQUAL_UINT32(2, st.duplicates);
+
+  // Sender restarted with a seq far behind or far ahead
+  TEST_ASSERT_TRUE(w.accept(103 - SeqWindow::SPAN, st));
+  TEST_ASSERT_EQUAL_UINT32(1, st.restarts);
+  TEST_ASSERT_TRUE(w.accept(5000, st));
+  TEST_ASSERT_EQUAL_UINT32(2, st.restarts);
+
+  // Wraps around uint32
+  w.reset();
+  TEST_ASSERT_TRUE(w.accept(0xFFFFFFFFu, st));
+  TEST_ASSERT_TRUE(w.accept(0, st));
+  TEST_ASSERT_FALSE(w.accept(0xFFFFFFFFu, st));
+}
+
+void test_duplicate_filter_keeps_streams_apart(void) {
+  // One station's unicast, group and broadcast-to-all frames interleaved,
+  // each stream with its own unrelated seq
+  DuplicateFilter<4> f;
+  uint32_t now = 0;
+  for (uint32_t i = 0; i < 100; ++i) {
+    TEST_ASSERT_TRUE(f.accept(0x12CC, 0, 7000 + i, now++));
+    TEST_ASSERT_TRUE(f.accept(0x12CC, 1, 10 + i, now++));
+    TEST_ASSERT_TRUE(f.accept(0x12CC, 0xFF, 0x80000000u + i, now++));
+    TEST_ASSERT_FALSE(f.accept(0x12CC, 1, 10 + i, now++));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, f.stats().restarts);
+  TEST_ASSERT_EQUAL_UINT32(0, f.stats().missing);
+  TEST_ASSERT_EQUAL_UINT32(100, f.stats().duplicates);
+
+  // A second station's stream takes the free entry, a third evicts the
+  // least recently heard one
+  TEST_ASSERT_TRUE(f.accept(0x3344, 0, 1, now++));
+  TEST_ASSERT_TRUE(f.accept(0x5566, 0, 1, now++));
+  TEST_ASSERT_FALSE(f.accept(0x12CC, 0xFF, 0x80000000u + 99, now++));
+  TEST_ASSERT_FALSE(f.accept(0x5566, 0, 1, now++));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_link_delivers_everything_once);
+  RUN_TEST(test_lossy_link_retransmits_without_duplicates);
+  RUN_TEST(test_gives_up_after_max_retries);
+  RUN_TEST(test_missing_callbacks_time_out);
+  RUN_TEST(test_late_callback_is_not_credited);
+  RUN_TEST(test_seq_window);
+  RUN_TEST(test_duplicate_filter_keeps_streams_apart);
+  return UNITY_END();
+}
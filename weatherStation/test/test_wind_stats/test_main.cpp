@@ -0,0 +1,140 @@
+#include <unity.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "WindStats.h"
+
+// Checks WindStats against a brute-force recomputation over the same history
+// and benchmarks add() against that recomputation (the cost it avoids).
+typedef WindStats<1> Stats;
+
+static constexpr size_t HISTORY = 2 * Stats::MEAN10M_SAMPLES;
+static uint16_t history[HISTORY]; // centi-km/h, as the ring stores them
+static size_t added;
+
+static float sampleAt(size_t i) {
+  // Gusty but repeatable: slow swell, fast flutter and occasional spikes
+  float v = 12.0f + 8.0f * std::sin(i * 0.01f) + 3.0f * std::sin(i * 0.7f);
+  if (i % 97 == 0) v += 25.0f;
+  return v < 0.0f ? 0.0f : v;
+}
+
+static uint16_t centi(float kmh) { return (uint16_t)(kmh * 100.0f + 0.5f); }
+
+static double bruteMean(size_t len) {
+  size_t n = added < len ? added : len;
+  if (n == 0) return 0.0;
+  uint64_t sum = 0;
+  for (size_t k = 0; k < n; ++k) sum += history[(added - 1 - k) % HISTORY];
+  return sum / (100.0 * n);
+}
+
+static double bruteVariance10m() {
+  size_t n = added < Stats::MEAN10M_SAMPLES ? added : Stats::MEAN10M_SAMPLES;
+  if (n == 0) return 0.0;
+  double m = bruteMean(Stats::MEAN10M_SAMPLES), acc = 0.0;
+  for (size_t k = 0; k < n; ++k) {
+    double d = history[(added - 1 - k) % HISTORY] / 100.0 - m;
+    acc += d * d;
+  }
+  return acc / n;
+}
+
+static uint32_t bruteGust() {
+  size_t n = added < Stats::GUST_SAMPLES ? added : Stats::GUST_SAMPLES;
+  uint32_t sum = 0;
+  for (size_t k = 0; k < n; ++k) sum += history[(added - 1 - k) % HISTORY];
+  return (sum + n / 2) / n;
+}
+
+static Stats stats;
+
+void setUp(void) {
+  stats.reset();
+  added = 0;
+}
+void tearDown(void) {}
+
+void test_empty(void) {
+  TEST_ASSERT_EQUAL(0, stats.count());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.mean2m());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.variance10m());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.takeGust());
+}
+
+void test_matches_brute_force(void) {
+  uint32_t peak = 0;
+  for (size_t i = 0; i < 3 * Stats::MEAN10M_SAMPLES; ++i) {
+    float v = sampleAt(i);
+    stats.add(v);
+    history[added % HISTORY] = centi(v);
+    added++;
+    uint32_t g = bruteGust();
+    if (g > peak) peak = g;
+
+    if (i % 61 == 0) {
+      TEST_ASSERT_FLOAT_WITHIN(0.001f, (float)bruteMean(Stats::MEAN2M_SAMPLES), stats.mean2m());
+      TEST_ASSERT_FLOAT_WITHIN(0.001f, (float)bruteMean(Stats::MEAN10M_SAMPLES), stats.mean10m());
+      TEST_ASSERT_FLOAT_WITHIN(0.01f, (float)bruteVariance10m(), stats.variance10m());
+      TEST_ASSERT_FLOAT_WITHIN(0.001f, peak / 100.0f, stats.takeGust());
+      peak = 0;
+    }
+  }
+  TEST_ASSERT_EQUAL(Stats::MEAN10M_SAMPLES, stats.count());
+}
+
+void test_gust_is_peak_3s_mean(void) {
+  for (int i = 0; i < 10; ++i) stats.add(10.0f);
+  stats.add(40.0f); // one-second spike: 3 s mean (10+10+40)/3
+  stats.add(10.0f);
+  stats.add(10.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 20.0f, stats.takeGust());
+  stats.add(10.0f);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f, stats.takeGust());
+}
+
+void test_negative_and_nan_clamp_to_zero(void) {
+  stats.add(-5.0f);
+  stats.add(NAN);
+  TEST_ASSERT_EQUAL(2, stats.count());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, stats.mean2m());
+}
+
+void test_benchmark_add_vs_recompute(void) {
+  static constexpr size_t N = 200000;
+  volatile float sink = 0.0f;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < N; ++i) {
+    stats.add(sampleAt(i));
+    sink = sink + stats.mean10m() + stats.variance10m();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+
+  // Same statistics recomputed over the window on every sample
+  static constexpr size_t M = N / 100;
+  for (size_t i = 0; i < M; ++i) {
+    history[added % HISTORY] = centi(sampleAt(i));
+    added++;
+    sink = sink + (float)bruteMean(Stats::MEAN10M_SAMPLES) + (float)bruteVariance10m();
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  double incNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / N;
+  double bruteNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / M;
+  char msg[96];
+  snprintf(msg, sizeof(msg), "add+stats %.1f ns/sample, recompute %.1f ns/sample", incNs, bruteNs);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(incNs < bruteNs);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty);
+  RUN_TEST(test_matches_brute_force);
+  RUN_TEST(test_gust_is_peak_3s_mean);
+  RUN_TEST(test_negative_and_nan_clamp_to_zero);
+  RUN_TEST(test_benchmark_add_vs_recompute);
+  return UNITY_END();
+}
@@ -0,0 +1,169 @@
+#include <unity.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include "WindowStats.h"
+
+// Checks WindowStats against a brute-force window (the last N valid readings
+// kept in a deque and recomputed in double on every query) and benchmarks
+// add() against that recomputation.
+class BruteWindow {
+public:
+  BruteWindow(size_t n, float alpha) : _n(n), _alpha(alpha), _ewma(NAN) {}
+
+  void add(float x) {
+    if (std::isnan(x)) return;
+    _w.push_back(x);
+    if (_w.size() > _n) _w.pop_front();
+    _ewma = std::isnan(_ewma) ? x : _ewma + _alpha * (x - _ewma);
+  }
+
+  size_t count() const { return _w.size(); }
+  double mean() const {
+    double s = 0.0;
+    for (float x : _w) s += x;
+    return s / _w.size();
+  }
+  double variance() const {
+    double m = mean(), acc = 0.0;
+    for (float x : _w) acc += (x - m) * (x - m);
+    return acc / _w.size();
+  }
+  float min() const {
+    float v = _w.front();
+    for (float x : _w) v = x < v ? x : v;
+    return v;
+  }
+  float max() const {
+    float v = _w.front();
+    for (float x : _w) v = x > v ? x : v;
+    return v;
+  }
+  float ewma() const { return _ewma; }
+
+private:
+  size_t _n;
+  float _alpha;
+  float _ewma;
+  std::deque<float> _w;
+};
+
+// Sensor-like readings: slow drift, noise, steps, runs of equal values, NaN
+static float reading(std::mt19937 &rng, size_t i) {
+  std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+  uint32_t r = rng() % 100;
+  if (r < 3) return NAN;
+  float base = 20.0f + 5.0f * std::sin(i * 0.003f) + ((i / 500) % 2 ? 8.0f : 0.0f);
+  if (r < 13) return std::floor(base); // plateaus and repeats
+  return base + noise(rng);
+}
+
+template <size_t N>
+static void compare(uint32_t seed, size_t readings) {
+  const float alpha = 0.2f;
+  WindowStats<N> ws(alpha);
+  BruteWindow bw(N, alpha);
+  std::mt19937 rng(seed);
+  double worstMean = 0.0, worstVar = 0.0;
+  for (size_t i = 0; i < readings; ++i) {
+    float x = reading(rng, i);
+    ws.add(x);
+    bw.add(x);
+    TEST_ASSERT_EQUAL(bw.count(), ws.count());
+    if (bw.count() == 0) {
+      TEST_ASSERT_TRUE(std::isnan(ws.mean()));
+      TEST_ASSERT_TRUE(std::isnan(ws.min()));
+      continue;
+    }
+    // min/max are exact; mean/variance within float error of a ~28 value
+    TEST_ASSERT_EQUAL_FLOAT(bw.min(), ws.min());
+    TEST_ASSERT_EQUAL_FLOAT(bw.max(), ws.max());
+    TEST_ASSERT_EQUAL_FLOAT(bw.ewma(), ws.ewma());
+    double em = std::fabs(ws.mean() - bw.mean());
+    double ev = std::fabs(ws.variance() - bw.variance());
+    if (em > worstMean) worstMean = em;
+    if (ev > worstVar) worstVar = ev;
+  }
+  char msg[96];
+  snprintf(msg, sizeof(msg), "window %u: worst mean error %.2e, variance error %.2e",
+           (unsigned)N, worstMean, worstVar);
+  TEST_MESSAGE(msg);
+  // No drift over many window turns: the error stays at float rounding
+  TEST_ASSERT_TRUE(worstMean < 1e-3);
+  TEST_ASSERT_TRUE(worstVar < 1e-2);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_empty_is_nan(void) {
+  WindowStats<4> ws;
+  TEST_ASSERT_EQUAL(0, ws.count());
+  TEST_ASSERT_TRUE(std::isnan(ws.mean()));
+  TEST_ASSERT_TRUE(std::isnan(ws.variance()));
+  TEST_ASSERT_TRUE(std::isnan(ws.max()));
+  TEST_ASSERT_TRUE(std::isnan(ws.ewma()));
+  ws.add(NAN);
+  TEST_ASSERT_EQUAL(0, ws.count());
+}
+
+void test_single_slot_window(void) { compare<1>(1, 5000); }
+void test_small_window(void) { compare<5>(2, 20000); }
+void test_minute_window(void) { compare<60>(3, 100000); }
+void test_large_window(void) { compare<600>(4, 100000); }
+
+void test_monotonic_runs(void) {
+  // Strictly rising then falling: the deques hold the whole window
+  WindowStats<16> ws;
+  BruteWindow bw(16, 0.2f);
+  for (int i = 0; i < 200; ++i) {
+    float x = (float)(i < 100 ? i : 200 - i);
+    ws.add(x);
+    bw.add(x);
+    TEST_ASSERT_EQUAL_FLOAT(bw.min(), ws.min());
+    TEST_ASSERT_EQUAL_FLOAT(bw.max(), ws.max());
+  }
+}
+
+void test_add_cost(void) {
+  const size_t N = 60, READINGS = 200000;
+  WindowStats<N> ws;
+  BruteWindow bw(N, 0.2f);
+  std::mt19937 rng(5);
+  static float xs[READINGS];
+  for (size_t i = 0; i < READINGS; ++i) xs[i] = reading(rng, i);
+
+  double sinkWs = 0.0, sinkBw = 0.0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < READINGS; ++i) {
+    ws.add(xs[i]);
+    sinkWs += ws.mean() + ws.variance() + ws.min() + ws.max();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < READINGS; ++i) {
+    bw.add(xs[i]);
+    if (bw.count()) sinkBw += bw.mean() + bw.variance() + bw.min() + bw.max();
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  char msg[128];
+  snprintf(msg, sizeof(msg), "window %u: add+query %.1f ns, recompute %.1f ns (sink %d)", (unsigned)N,
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / READINGS,
+           std::chrono::duration<double, std::nano>(t2 - t1).count() / READINGS,
+           (int)std::isnan(sinkWs + sinkBw));
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_is_nan);
+  RUN_TEST(test_single_slot_window);
+  RUN_TEST(test_small_window);
+  RUN_TEST(test_minute_window);
+  RUN_TEST(test_large_window);
+  RUN_TEST(test_monotonic_runs);
+  RUN_TEST(test_add_cost);
+  return UNITY_END();
+}